@@ -0,0 +1,457 @@
+/*
+ *
+ * Copyright (c) 2017 Robert Quattlebaum
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifndef ASSERT_MACROS_USE_SYSLOG
+#define ASSERT_MACROS_USE_SYSLOG 1
+#endif
+
+#ifndef ASSERT_MACROS_SQUELCH
+#define ASSERT_MACROS_SQUELCH 0
+#endif
+
+#include "assert-macros.h"
+
+#include "capture-file.h"
+#include <syslog.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+
+#define NSEC_PER_SEC                1000000000ull
+
+// How often buffered records are written out while capturing.
+#define CAPTURE_FLUSH_INTERVAL      NSEC_PER_SEC
+
+// How long to wait for the daemon to acknowledge a replayed frame
+// before moving on, when not following the recorded timing.
+#define REPLAY_RESPONSE_TIMEOUT     1000    // ms
+
+// Framing bytes of the panel's serial protocol.
+#define REPLAY_START_OF_MESSAGE     0x0A
+#define REPLAY_ACK                  0x06
+#define REPLAY_NAK                  0x15
+
+static uint64_t
+now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static int
+write_varint(FILE* file, uint64_t value)
+{
+	do {
+		uint8_t byte = value & 0x7F;
+
+		value >>= 7;
+		if (value != 0) {
+			byte |= 0x80;
+		}
+
+		if (putc(byte, file) == EOF) {
+			return -1;
+		}
+	} while (value != 0);
+
+	return 0;
+}
+
+static int
+read_varint(FILE* file, uint64_t* value)
+{
+	int shift = 0;
+	int c;
+
+	*value = 0;
+
+	do {
+		c = getc(file);
+
+		if ((c == EOF) || (shift > 63)) {
+			return -1;
+		}
+
+		*value |= (uint64_t)(c & 0x7F) << shift;
+		shift += 7;
+	} while (c & 0x80);
+
+	return 0;
+}
+
+int
+capture_file_open_write(capture_file_t self, const char* path)
+{
+	static const uint8_t header[8] = {
+		'C', 'C', 'A', 'P', CAPTURE_FILE_VERSION, 0, 0, 0
+	};
+
+	memset(self, 0, sizeof(*self));
+
+	self->file = fopen(path, "wb");
+
+	if (self->file == NULL) {
+		syslog(LOG_ERR, "Unable to open capture file \"%s\": %s", path, strerror(errno));
+		return -1;
+	}
+
+	if (fwrite(header, sizeof(header), 1, self->file) != 1) {
+		syslog(LOG_ERR, "Unable to write to capture file \"%s\": %s", path, strerror(errno));
+		capture_file_close(self);
+		return -1;
+	}
+
+	self->writing = true;
+	self->start_ns = now_ns();
+	self->flushed_ns = 0;
+
+	return 0;
+}
+
+int
+capture_file_open_read(capture_file_t self, const char* path)
+{
+	uint8_t header[8];
+
+	memset(self, 0, sizeof(*self));
+
+	self->file = fopen(path, "rb");
+
+	if (self->file == NULL) {
+		syslog(LOG_ERR, "Unable to open capture file \"%s\": %s", path, strerror(errno));
+		return -1;
+	}
+
+	if ( (fread(header, sizeof(header), 1, self->file) != 1)
+	  || (memcmp(header, CAPTURE_FILE_MAGIC, 4) != 0)
+	  || (header[4] != CAPTURE_FILE_VERSION)
+	) {
+		syslog(LOG_ERR, "\"%s\" isn't a capture file", path);
+		capture_file_close(self);
+		return -1;
+	}
+
+	return 0;
+}
+
+void
+capture_file_close(capture_file_t self)
+{
+	if (self->file != NULL) {
+		fclose(self->file);
+		self->file = NULL;
+	}
+}
+
+int
+capture_file_write(capture_file_t self, int direction, const uint8_t* data, size_t len)
+{
+	uint64_t ns;
+
+	if (!self->writing || (self->file == NULL)) {
+		return -1;
+	}
+
+	ns = now_ns() - self->start_ns;
+
+	if ( (putc(direction, self->file) == EOF)
+	  || (write_varint(self->file, ns - self->last_ns) != 0)
+	  || (write_varint(self->file, len) != 0)
+	  || (fwrite(data, 1, len, self->file) != len)
+	) {
+		syslog(LOG_ERR, "Unable to write to capture file, stopping capture: %s", strerror(errno));
+		capture_file_close(self);
+		return -1;
+	}
+
+	self->last_ns = ns;
+	self->records++;
+
+	// Don't lose more than a moment's worth if we crash.
+	if (ns - self->flushed_ns >= CAPTURE_FLUSH_INTERVAL) {
+		fflush(self->file);
+		self->flushed_ns = ns;
+	}
+
+	return 0;
+}
+
+int
+capture_file_read(capture_file_t self, int* direction, uint64_t* ns, uint8_t* data, size_t max_len)
+{
+	uint64_t delta, len;
+	int c;
+
+	if (self->writing || (self->file == NULL)) {
+		return -1;
+	}
+
+	c = getc(self->file);
+
+	if (c == EOF) {
+		return -1;
+	}
+
+	if ( (read_varint(self->file, &delta) != 0)
+	  || (read_varint(self->file, &len) != 0)
+	  || (len > max_len)
+	  || (fread(data, 1, len, self->file) != len)
+	) {
+		syslog(LOG_WARNING, "Capture file is truncated or corrupt after %u records", self->records);
+		return -1;
+	}
+
+	self->last_ns += delta;
+	self->records++;
+
+	*direction = c;
+	*ns = self->last_ns;
+
+	return (int)len;
+}
+
+// ----------------------------------------------------------------------------
+// Replay
+
+// Just enough of the panel's framing to tell when a frame is done.
+struct replay_frame_parser_s {
+	bool active;
+	bool have_len;
+	int digits;
+	int len;
+	int remaining;
+};
+
+struct replay_s {
+	int fd;
+	struct replay_frame_parser_s from_daemon;
+	struct replay_frame_parser_s from_capture;
+	uint32_t responses;     // ACKs and NAKs from the daemon
+	bool closed;
+};
+
+static int
+hex_value(uint8_t byte)
+{
+	if (isdigit(byte)) {
+		return byte - '0';
+	}
+	return toupper(byte) - 'A' + 10;
+}
+
+// Returns true if `byte` finishes a frame.
+static bool
+replay_frame_parse(struct replay_frame_parser_s* parser, uint8_t byte)
+{
+	if (byte == REPLAY_START_OF_MESSAGE) {
+		memset(parser, 0, sizeof(*parser));
+		parser->active = true;
+		return false;
+	}
+
+	if (!parser->active) {
+		return false;
+	}
+
+	if (!isxdigit(byte)) {
+		parser->active = false;
+		return false;
+	}
+
+	if (!parser->have_len) {
+		parser->len = (parser->len << 4) | hex_value(byte);
+		if (++parser->digits == 2) {
+			// The length covers the data and the checksum, which
+			// are two hex digits per byte.
+			parser->have_len = true;
+			parser->remaining = 2*parser->len;
+			parser->active = (parser->remaining > 0);
+		}
+		return false;
+	}
+
+	if (--parser->remaining == 0) {
+		parser->active = false;
+		return true;
+	}
+
+	return false;
+}
+
+static int
+replay_write(struct replay_s* self, const uint8_t* data, size_t len)
+{
+	while (len > 0) {
+		ssize_t ret = write(self->fd, data, len);
+
+		if (ret > 0) {
+			data += ret;
+			len -= ret;
+		} else if ((ret < 0) && ((errno == EAGAIN) || (errno == EINTR))) {
+			struct pollfd pollfd = { self->fd, POLLOUT, 0 };
+			poll(&pollfd, 1, -1);
+		} else {
+			self->closed = true;
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+// Answers whatever the daemon has sent, waiting up to `timeout` ms
+// (or forever if negative) for something to arrive.
+static int
+replay_service(struct replay_s* self, int timeout)
+{
+	static const uint8_t ack = REPLAY_ACK;
+	struct pollfd pollfd = { self->fd, POLLIN, 0 };
+	uint8_t buffer[256];
+	ssize_t ret;
+	ssize_t i;
+
+	if (poll(&pollfd, 1, timeout) <= 0) {
+		return 0;
+	}
+
+	ret = read(self->fd, buffer, sizeof(buffer));
+
+	if (ret <= 0) {
+		if ((ret < 0) && ((errno == EAGAIN) || (errno == EINTR))) {
+			return 0;
+		}
+		self->closed = true;
+		return -1;
+	}
+
+	for (i = 0; i < ret; i++) {
+		if (!self->from_daemon.active && ((buffer[i] == REPLAY_ACK) || (buffer[i] == REPLAY_NAK))) {
+			self->responses++;
+		} else if (replay_frame_parse(&self->from_daemon, buffer[i])) {
+			if (replay_write(self, &ack, 1) != 0) {
+				return -1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+int
+capture_file_replay(int fd, const char* path, double speed)
+{
+	struct capture_file_s capture;
+	struct replay_s self;
+	uint8_t buffer[256];
+	uint64_t start;
+	uint64_t ns;
+	int direction;
+	int len;
+
+	memset(&self, 0, sizeof(self));
+	self.fd = fd;
+
+	if (capture_file_open_read(&capture, path) != 0) {
+		return -1;
+	}
+
+	if (speed > 0) {
+		syslog(LOG_NOTICE, "Replaying \"%s\" at %gx speed", path, speed);
+	} else {
+		syslog(LOG_NOTICE, "Replaying \"%s\" at full speed", path);
+	}
+
+	start = now_ns();
+
+	while (!self.closed && ((len = capture_file_read(&capture, &direction, &ns, buffer, sizeof(buffer))) >= 0)) {
+		bool finishes_frame = false;
+		uint32_t responses;
+		int i, j;
+
+		if (direction != CAPTURE_FILE_RX) {
+			// What the daemon sent back then doesn't matter now.
+			continue;
+		}
+
+		// The ACKs and NAKs the panel sent were for frames we won't
+		// be getting this time around. We answer those ourselves.
+		for (i = 0, j = 0; i < len; i++) {
+			if ((buffer[i] == REPLAY_ACK) || (buffer[i] == REPLAY_NAK)) {
+				continue;
+			}
+			if (replay_frame_parse(&self.from_capture, buffer[i])) {
+				finishes_frame = true;
+			}
+			buffer[j++] = buffer[i];
+		}
+		len = j;
+
+		if (len == 0) {
+			continue;
+		}
+
+		if (speed > 0) {
+			const uint64_t due = start + (uint64_t)(ns / speed);
+			uint64_t now;
+
+			while (!self.closed && ((now = now_ns()) < due)) {
+				replay_service(&self, (int)((due - now + 999999) / 1000000));
+			}
+		} else {
+			replay_service(&self, 0);
+		}
+
+		// Anything answered by now was for an earlier frame.
+		responses = self.responses;
+
+		if (replay_write(&self, buffer, len) != 0) {
+			break;
+		}
+
+		if ((speed <= 0) && finishes_frame) {
+			// Like the panel, wait for the frame to be acknowledged
+			// before sending the next one.
+			const uint64_t give_up = now_ns() + REPLAY_RESPONSE_TIMEOUT*1000000ull;
+
+			while (!self.closed && (self.responses == responses) && (now_ns() < give_up)) {
+				replay_service(&self, REPLAY_RESPONSE_TIMEOUT);
+			}
+		}
+	}
+
+	syslog(LOG_NOTICE, "Replay of \"%s\" finished after %u records", path, capture.records);
+
+	capture_file_close(&capture);
+
+	while (!self.closed) {
+		replay_service(&self, -1);
+	}
+
+	return 0;
+}
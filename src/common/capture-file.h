@@ -0,0 +1,81 @@
+/*
+ *
+ * Copyright (c) 2017 Robert Quattlebaum
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef concordd_capture_file_h
+#define concordd_capture_file_h 1
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <sys/cdefs.h>
+
+// Compact binary log of the raw bytes exchanged with the panel,
+// for reproducing problems offline with the `replay:` socket.
+//
+// The file starts with an 8-byte header ("CCAP", a version byte
+// and three reserved bytes). Each record that follows is:
+//
+//  * a direction byte (CAPTURE_FILE_RX or CAPTURE_FILE_TX),
+//  * the nanoseconds since the previous record (or since the
+//    capture started) as an unsigned LEB128 varint,
+//  * the number of bytes, as a varint,
+//  * the bytes themselves.
+//
+// Timestamps come from CLOCK_MONOTONIC.
+
+#define CAPTURE_FILE_MAGIC          "CCAP"
+#define CAPTURE_FILE_VERSION        1
+
+#define CAPTURE_FILE_RX             0   // From the panel
+#define CAPTURE_FILE_TX             1   // To the panel
+
+struct capture_file_s {
+	FILE* file;
+	uint64_t last_ns;   // Relative to the start of the capture
+	uint64_t start_ns;  // Writing only: CLOCK_MONOTONIC at the start
+	uint64_t flushed_ns;
+	uint32_t records;
+	bool writing;
+};
+typedef struct capture_file_s *capture_file_t;
+
+__BEGIN_DECLS
+int capture_file_open_write(capture_file_t self, const char* path);
+int capture_file_open_read(capture_file_t self, const char* path);
+void capture_file_close(capture_file_t self);
+
+// Appends a record, timestamped with the current time.
+int capture_file_write(capture_file_t self, int direction, const uint8_t* data, size_t len);
+
+// Reads the next record into `data`. `ns` is set to the time of the
+// record relative to the start of the capture. Returns the number
+// of bytes, or -1 at the end of the file or if it is corrupt.
+int capture_file_read(capture_file_t self, int* direction, uint64_t* ns, uint8_t* data, size_t max_len);
+
+// Plays the panel's side of a capture into `fd`, like the panel
+// would have sent it. `speed` scales the recorded timing (2.0 is
+// twice as fast); zero sends each frame as soon as the previous
+// one has been acknowledged. Frames arriving on `fd` are answered
+// with ACKs. Once the capture runs out, keeps answering until `fd`
+// is closed.
+int capture_file_replay(int fd, const char* path, double speed);
+__END_DECLS
+
+#endif // ifndef concordd_capture_file_h
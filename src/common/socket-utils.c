@@ -27,6 +27,7 @@
 
 #include <stdio.h>
 #include "socket-utils.h"
+#include "capture-file.h"
 #include <ctype.h>
 #include <syslog.h>
 #include <errno.h>
@@ -63,6 +64,14 @@
 #include <sys/prctl.h>
 #endif
 
+#if HAVE_LINUX_SERIAL_H
+#include <linux/serial.h>
+#endif
+
+
+#if defined(TIOCGSERIAL) && defined(TIOCSSERIAL) && defined(ASYNC_LOW_LATENCY)
+#define HAVE_SERIAL_LOW_LATENCY 1
+#endif
 
 #if !defined(HAVE_PTSNAME) && __APPLE__
 #define HAVE_PTSNAME 1
@@ -576,6 +585,44 @@ cleanup_and_fail:
 }
 #endif // PF_UNIX
 
+#if defined(PF_UNIX)
+// Plays back the panel's side of a capture file from a child
+// process. Options are `,speed=<factor>` to replay faster (or
+// slower) than recorded, and `,fast` to replay as fast as the
+// daemon acknowledges the frames.
+static int
+open_replay_socket(const char* path, const char* options)
+{
+	int fd = -1;
+	pid_t pid = -1;
+	double speed = 1.0;
+
+	for (; NULL != options; options = strchr(options+1, ',')) {
+		if (strncasecmp(options, ",speed=", 7) == 0) {
+			speed = strtod(options+7, NULL);
+		} else if (strncasecmp(options, ",fast", 5) == 0) {
+			speed = 0;
+		} else {
+			syslog(LOG_ERR, "Unknown option (%s)", options);
+		}
+	}
+
+	pid = fork_unixdomain_socket(&fd);
+
+	if (pid < 0) {
+		return -1;
+	}
+
+	if (0 == pid) {
+		_exit((capture_file_replay(fd, path, speed) == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	system_socket_table_add_(fd, pid);
+
+	return fd;
+}
+#endif // PF_UNIX
+
 static int
 open_system_socket(const char* command)
 {
@@ -611,6 +658,8 @@ get_super_socket_type_from_path(const char* socket_name)
 		socket_type = SUPER_SOCKET_TYPE_SYSTEM_FORKPTY;
 	} else if (strncasecmp(socket_name, SOCKET_SYSTEM_SOCKETPAIR_COMMAND_PREFIX, sizeof(SOCKET_SYSTEM_SOCKETPAIR_COMMAND_PREFIX)-1) == 0) {
 		socket_type = SUPER_SOCKET_TYPE_SYSTEM_SOCKETPAIR;
+	} else if (strncasecmp(socket_name, SOCKET_REPLAY_COMMAND_PREFIX, sizeof(SOCKET_REPLAY_COMMAND_PREFIX)-1) == 0) {
+		socket_type = SUPER_SOCKET_TYPE_REPLAY;
 	} else if (strncasecmp(socket_name, SOCKET_FD_COMMAND_PREFIX, sizeof(SOCKET_FD_COMMAND_PREFIX)-1) == 0) {
 		socket_type = SUPER_SOCKET_TYPE_FD;
 	} else if (strncasecmp(socket_name, SOCKET_FILE_COMMAND_PREFIX, sizeof(SOCKET_FILE_COMMAND_PREFIX)-1) == 0) {
@@ -690,6 +739,12 @@ open_super_socket(const char* socket_name)
 #endif
 	} else if (SUPER_SOCKET_TYPE_SYSTEM_SOCKETPAIR == socket_type) {
 		fd = open_system_socket_unix_domain(filename);
+#if defined(PF_UNIX)
+	} else if (SUPER_SOCKET_TYPE_REPLAY == socket_type) {
+		fd = open_replay_socket(filename, options);
+		// The options were for the replay, not for termios.
+		options = NULL;
+#endif
 	} else if (SUPER_SOCKET_TYPE_FD == socket_type) {
 		fd = dup((int)strtol(filename, NULL, 0));
 	} else if (SUPER_SOCKET_TYPE_DEVICE == socket_type) {
@@ -801,6 +856,42 @@ open_super_socket(const char* socket_name)
 				FETCH_TERMIOS();
 				cfmakeraw(&tios);
 				COMMIT_TERMIOS();
+			} else if (strncasecmp(options, ",lowlatency", 11) == 0) {
+				// Ask the driver to hand over received bytes right away.
+				// USB serial adapters otherwise hold on to them for up
+				// to 16ms (FTDI) before passing them along.
+#if HAVE_SERIAL_LOW_LATENCY
+				struct serial_struct serial;
+				bool enable = (options[11] != '=') || (options[12] != '0');
+
+				if (0 != ioctl(fd, TIOCGSERIAL, &serial)) {
+					syslog(LOG_WARNING, "TIOCGSERIAL failed, can't set low latency mode. \"%s\" (%d)", strerror(errno), errno);
+				} else {
+					if (enable) {
+						serial.flags |= ASYNC_LOW_LATENCY;
+					} else {
+						serial.flags &= ~ASYNC_LOW_LATENCY;
+					}
+					if (0 != ioctl(fd, TIOCSSERIAL, &serial)) {
+						syslog(LOG_WARNING, "TIOCSSERIAL failed, can't set low latency mode. \"%s\" (%d)", strerror(errno), errno);
+					} else {
+						syslog(LOG_DEBUG, "Serial low latency mode %s.", enable ? "enabled" : "disabled");
+					}
+				}
+#else
+				syslog(LOG_WARNING, "Serial low latency mode isn't supported on this platform");
+#endif
+			} else if (strncasecmp(options, ",vmin=", 6) == 0) {
+				// Minimum number of bytes for a blocking read()
+				FETCH_TERMIOS();
+				tios.c_cc[VMIN] = (cc_t)strtol(options+6,NULL,10);
+				COMMIT_TERMIOS();
+			} else if (strncasecmp(options, ",vtime=", 7) == 0) {
+				// Inter-byte timeout for a blocking read(), in tenths
+				// of a second
+				FETCH_TERMIOS();
+				tios.c_cc[VTIME] = (cc_t)strtol(options+7,NULL,10);
+				COMMIT_TERMIOS();
 			} else if (strncasecmp(options, ",clocal=", 8) == 0) {
 				FETCH_TERMIOS();
 				options = strchr(options,'=');
@@ -32,6 +32,7 @@
 #define SOCKET_SERIAL_COMMAND_PREFIX	"serial:"
 #define SOCKET_SYSTEM_FORKPTY_COMMAND_PREFIX	"system-forkpty:"
 #define SOCKET_SYSTEM_SOCKETPAIR_COMMAND_PREFIX	"system-socketpair:"
+#define SOCKET_REPLAY_COMMAND_PREFIX	"replay:"
 
 __BEGIN_DECLS
 extern int gSocketWrapperBaud;
@@ -48,7 +49,8 @@ enum {
 	SUPER_SOCKET_TYPE_SYSTEM_SOCKETPAIR,
 	SUPER_SOCKET_TYPE_FD,
 	SUPER_SOCKET_TYPE_TCP,
-	SUPER_SOCKET_TYPE_DEVICE
+	SUPER_SOCKET_TYPE_DEVICE,
+	SUPER_SOCKET_TYPE_REPLAY
 };
 
 int get_super_socket_type_from_path(const char* path);
@@ -31,7 +31,6 @@
 #include <inttypes.h>
 #include <stdlib.h>
 
-#define __USE_GNU // Needed for `strcasestr`
 #include <string.h>
 
 void
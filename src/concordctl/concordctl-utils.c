@@ -198,3 +198,84 @@ concordd_status_to_cstr(int status)
     snprintf(ret,sizeof(ret),"%d",status);
     return ret;
 }
+
+int
+for_each_snapshot_entry(
+	DBusConnection *connection,
+	int timeout,
+	const char* path_prefix,
+	int (*visitor)(void* context, const char* path, DBusMessageIter *info_iter),
+	void* context,
+	DBusError *error
+) {
+	int ret = ERRORCODE_UNKNOWN;
+	DBusMessage *message = NULL;
+	DBusMessage *reply = NULL;
+	DBusMessageIter iter;
+	DBusMessageIter array_iter;
+
+	message = dbus_message_new_method_call(
+		CONCORDD_DBUS_NAME,
+		CONCORDD_DBUS_PATH_ROOT,
+		CONCORDD_DBUS_INTERFACE,
+		CONCORDD_DBUS_CMD_GET_SNAPSHOT
+	);
+
+	require_action(message != NULL, bail, ret = ERRORCODE_ALLOC);
+
+	ret = ERRORCODE_TIMEOUT;
+
+	reply = dbus_connection_send_with_reply_and_block(
+		connection,
+		message,
+		timeout,
+		error
+	);
+
+	require(reply != NULL, bail);
+
+	ret = ERRORCODE_UNKNOWN;
+
+	dbus_message_iter_init(reply, &iter);
+
+	require(dbus_message_iter_get_arg_type(&iter) == DBUS_TYPE_ARRAY, bail);
+
+	dbus_message_iter_recurse(&iter, &array_iter);
+
+	for (;
+		 dbus_message_iter_get_arg_type(&array_iter) == DBUS_TYPE_DICT_ENTRY;
+		 dbus_message_iter_next(&array_iter)
+	) {
+		DBusMessageIter entry_iter;
+		const char* path = NULL;
+
+		dbus_message_iter_recurse(&array_iter, &entry_iter);
+
+		require(dbus_message_iter_get_arg_type(&entry_iter) == DBUS_TYPE_STRING, bail);
+
+		dbus_message_iter_get_basic(&entry_iter, &path);
+
+		if ((path_prefix != NULL) && !strhasprefix(path, path_prefix)) {
+			continue;
+		}
+
+		dbus_message_iter_next(&entry_iter);
+
+		if ((*visitor)(context, path, &entry_iter) != 0) {
+			break;
+		}
+	}
+
+	ret = 0;
+
+bail:
+	if (message) {
+		dbus_message_unref(message);
+	}
+
+	if (reply) {
+		dbus_message_unref(reply);
+	}
+
+	return ret;
+}
@@ -65,6 +65,18 @@ const char* concordd_status_to_cstr(int status);
 void print_error_diagnosis(int error);
 void dump_info_from_iter(FILE* file, DBusMessageIter *iter, int indent, bool bare, bool indentFirstLine);
 
+// Fetches every object's info dictionary with a single `get_snapshot`
+// call and invokes `visitor` for each one whose path starts with
+// `path_prefix`. A non-zero return from `visitor` stops the iteration.
+int for_each_snapshot_entry(
+	DBusConnection *connection,
+	int timeout,
+	const char* path_prefix,
+	int (*visitor)(void* context, const char* path, DBusMessageIter *info_iter),
+	void* context,
+	DBusError *error
+);
+
 extern int gPartitionIndex;
 extern int gRet;
 
@@ -217,70 +217,26 @@ bail:
 }
 
 static int
-refresh_zones(DBusConnection *connection, int timeout, DBusError *error)
+refresh_zone_visitor(void* context, const char* path, DBusMessageIter *iter)
 {
-	int ret = ERRORCODE_UNKNOWN;
-    DBusMessage *message = NULL;
-    DBusMessage *reply = NULL;
-    DBusMessageIter iter;
-    int zoneId;
-
-	for (zoneId = 1; zoneId<=96; zoneId++) {
-		char path[DBUS_MAXIMUM_NAME_LENGTH+1];
-		char interface_dbus_name[DBUS_MAXIMUM_NAME_LENGTH+1];
-
-		snprintf(
-			path,
-			sizeof(path),
-			"%s%d",
-			CONCORDD_DBUS_PATH_ZONE,
-			zoneId
-		);
-
-		if (message) {
-			dbus_message_unref(message);
-		}
-
-		message = dbus_message_new_method_call(
-			CONCORDD_DBUS_NAME,
-			path,
-			CONCORDD_DBUS_INTERFACE,
-			CONCORDD_DBUS_CMD_GET_INFO
-		);
+	int zoneId = atoi(path + strlen(CONCORDD_DBUS_PATH_ZONE));
 
-		if (message == NULL) {
-			continue;
-		}
-
-		ret = ERRORCODE_TIMEOUT;
-
-		if (reply) {
-	        dbus_message_unref(reply);
-	    }
-
-		reply = dbus_connection_send_with_reply_and_block(
-			connection,
-			message,
-			timeout,
-			NULL
-		);
-
-		if (reply != NULL) {
-			dbus_message_iter_init(reply, &iter);
-			update_zone(zoneId, &iter);
-		}
-	}
+	update_zone(zoneId, iter);
 
-	ret = 0;
+	return 0;
+}
 
-bail:
-	if (message) {
-        dbus_message_unref(message);
-    }
-	if (reply) {
-        dbus_message_unref(reply);
-    }
-	return ret;
+static int
+refresh_zones(DBusConnection *connection, int timeout, DBusError *error)
+{
+	return for_each_snapshot_entry(
+		connection,
+		timeout,
+		CONCORDD_DBUS_PATH_ZONE,
+		&refresh_zone_visitor,
+		NULL,
+		error
+	);
 }
 
 static void
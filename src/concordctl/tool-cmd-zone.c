@@ -310,6 +310,30 @@ bail:
     return ret;
 }
 
+struct zone_list_context_s {
+	bool all_zones;
+	int style;
+	int zone_count;
+};
+
+static int
+zone_list_visitor(void* context, const char* path, DBusMessageIter *iter)
+{
+	struct zone_list_context_s* zone_list = context;
+	int status = 0;
+
+	if (zone_list->all_zones || get_zone_partition_from_iter(iter) == gPartitionIndex) {
+		status = dump_zone_info(stdout, iter, zone_list->style);
+		zone_list->zone_count++;
+	}
+
+	if (status != 0) {
+		fprintf(stderr, "%s: error printing zone\n", path);
+	}
+
+	return status;
+}
+
 static int
 zone_bypass(DBusConnection *connection, int timeout, int zoneId, bool state, int userId, DBusError *error)
 {
@@ -491,28 +515,20 @@ tool_cmd_zone(int argc, char *argv[])
 					zone_count++;
 				}
 			} else {
-				ret = 0;
-				int zoneId;
-				for (zoneId = 0; zoneId < 96; zoneId++) {
-					status = get_zone_info(connection, timeout, zoneId, &message, &iter, &error);
-					if (status != 0) {
-						dbus_error_free(&error);
-						dbus_error_init(&error);
-						continue;
-					}
-					if (all_zones || get_zone_partition_from_iter(&iter) == gPartitionIndex) {
-						status = dump_zone_info(stdout, &iter, style);
-						zone_count++;
-					}
-					if (message) {
-						dbus_message_unref(message);
-						message = NULL;
-					}
-					if (status != 0){
-						fprintf(stderr, "%s: zone-%d error printing zone\n", argv[0], zoneId);
-						break;
-					}
-				}
+				struct zone_list_context_s context = {
+					.all_zones = all_zones,
+					.style = style,
+					.zone_count = 0,
+				};
+				ret = for_each_snapshot_entry(
+					connection,
+					timeout,
+					CONCORDD_DBUS_PATH_ZONE,
+					&zone_list_visitor,
+					&context,
+					&error
+				);
+				zone_count = context.zone_count;
 				fprintf(stderr, "%d zones total.\n", zone_count);
 			}
 		} else if ((action == ACTION_BYPASS) || (action == ACTION_UNBYPASS)) {
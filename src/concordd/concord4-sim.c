@@ -0,0 +1,838 @@
+/*
+ *
+ * Copyright (c) 2017 Robert Quattlebaum
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Concord 4 panel simulator.
+//
+// Speaks the panel's side of the RS-232 automation protocol, so
+// that concordd can be run and load tested without a panel:
+//
+//     concordd -s 'system:concord4-sim -t 200 -a 30000'
+//
+// or, with `-p`, on a pseudo-terminal whose name is printed on
+// stdout and can be used as the serial port.
+//
+// It answers equipment list requests, dynamic data refreshes and
+// keypresses (arming, disarming and panics), and can generate zone
+// trips, a flapping zone, alarms with siren setup, go and sync, and
+// touchpad text at the given rates. Frames are sent one at a time
+// and retransmitted like the real panel does, and NAKs, bad
+// checksums and lost ACKs can be injected to exercise concordd's
+// error handling.
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "ge-rs232.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+
+#define SIM_MAX_ZONES           96
+#define SIM_PARTITION           1
+#define SIM_AREA                0
+#define SIM_OUT_QUEUE_SIZE      512
+#define SIM_MAX_ATTEMPTS        5
+#define SIM_ALARM_DURATION      15000   // Unless disarmed before then
+#define SIM_PANEL_TYPE          0x14    // Concord
+#define SIM_SERIAL_NUMBER       0x00C0FFEE
+
+struct sim_frame_s {
+	uint8_t data[GE_RS232_MAX_MESSAGE_SIZE];
+	uint8_t len;
+};
+
+struct sim_timer_s {
+	cms_t interval;     // Zero if disabled
+	cms_t next;
+};
+
+struct sim_stats_s {
+	uint32_t frames_queued;
+	uint32_t frames_dropped;
+	uint32_t requests;
+	uint32_t injected_naks;
+	uint32_t injected_bad_checksums;
+	uint32_t injected_lost_acks;
+};
+
+static int gFD = -1;
+static bool gVerbose;
+static volatile sig_atomic_t gDone;
+
+static int gZoneCount = SIM_MAX_ZONES;
+static uint8_t gZoneState[SIM_MAX_ZONES];
+static cms_t gZoneRestoreAt[SIM_MAX_ZONES];
+static cms_t gTripDuration = 2000;
+
+static uint8_t gArmLevel = GE_RS232_ARMING_LEVEL_OFF;
+static int gAlarmZone = -1;
+static cms_t gAlarmEndsAt;
+static uint32_t gTouchpadCount;
+
+static struct sim_timer_s gTripTimer;
+static struct sim_timer_s gFlapTimer;
+static struct sim_timer_s gAlarmTimer;
+static struct sim_timer_s gSirenSyncTimer = { 1000, 0 };
+static struct sim_timer_s gTouchpadTimer;
+
+static int gNakPercent;
+static int gBadChecksumPercent;
+static int gLostAckPercent;
+static bool gDiscardFrame;
+
+static struct ge_rs232_s gInterface;
+static struct sim_frame_s gOutQueue[SIM_OUT_QUEUE_SIZE];
+static int gOutHead;
+static int gOutCount;
+static bool gOutOnWire;
+static struct sim_stats_s gStats;
+
+static uint8_t gTextEncoding[128];
+
+#pragma mark - Helpers
+
+static bool
+chance(int percent)
+{
+	return (percent > 0) && (rand() % 100 < percent);
+}
+
+// Builds the reverse of `ge_rs232_text_token_lookup` for the
+// tokens that stand for a single character.
+static void
+text_encoding_init(void)
+{
+	int i;
+
+	memset(gTextEncoding, 0xFF, sizeof(gTextEncoding));
+
+	for (i = 0; i < 256; i++) {
+		const char* str = ge_rs232_text_token_lookup[i];
+
+		if (str != NULL && str[0] > 0 && str[1] == 0 && gTextEncoding[(int)str[0]] == 0xFF) {
+			gTextEncoding[(int)str[0]] = i;
+		}
+	}
+}
+
+static uint8_t
+encode_text(uint8_t* dest, uint8_t max, const char* text)
+{
+	uint8_t len = 0;
+
+	for (; *text && len < max; text++) {
+		int c = *text;
+
+		if (c >= 'a' && c <= 'z') {
+			c += 'A' - 'a';
+		}
+
+		if (c < 0 || c >= 128 || gTextEncoding[c] == 0xFF) {
+			c = '?';
+		}
+
+		dest[len++] = gTextEncoding[c];
+	}
+
+	return len;
+}
+
+static void
+write_all(const uint8_t* data, size_t len)
+{
+	while (len > 0) {
+		ssize_t ret = write(gFD, data, len);
+
+		if (ret < 0) {
+			if (errno == EINTR || errno == EAGAIN) {
+				continue;
+			}
+			perror("write");
+			gDone = 1;
+			return;
+		}
+
+		data += ret;
+		len -= ret;
+	}
+}
+
+static bool
+timer_fired(struct sim_timer_s* timer, cms_t now)
+{
+	if (timer->interval <= 0 || now - timer->next < 0) {
+		return false;
+	}
+
+	timer->next = now + timer->interval;
+	return true;
+}
+
+static cms_t
+timer_timeout(const struct sim_timer_s* timer, cms_t now, cms_t timeout)
+{
+	if (timer->interval > 0 && timer->next - now < timeout) {
+		timeout = timer->next - now;
+	}
+
+	return timeout < 0 ? 0 : timeout;
+}
+
+#pragma mark - Outbound frames
+
+static void
+queue_frame(const uint8_t* data, uint8_t len)
+{
+	struct sim_frame_s* frame;
+
+	if (gOutCount >= SIM_OUT_QUEUE_SIZE) {
+		gStats.frames_dropped++;
+		return;
+	}
+
+	frame = &gOutQueue[(gOutHead + gOutCount++) % SIM_OUT_QUEUE_SIZE];
+	memcpy(frame->data, data, len);
+	frame->len = len;
+	gStats.frames_queued++;
+}
+
+static void
+queue_zone_status(int zone)
+{
+	const uint8_t msg[] = {
+		GE_RS232_PTA_ZONE_STATUS, SIM_PARTITION, SIM_AREA,
+		zone >> 8, zone & 0xFF,
+		gZoneState[zone]
+	};
+
+	queue_frame(msg, sizeof(msg));
+}
+
+static void
+queue_touchpad_text(const char* text)
+{
+	uint8_t msg[GE_RS232_MAX_MESSAGE_SIZE] = {
+		GE_RS232_PTA_SUBCMD, GE_RS232_PTA_SUBCMD_TOUCHPAD_DISPLAY,
+		SIM_PARTITION, SIM_AREA,
+		1,	// Type
+	};
+	uint8_t len = 5;
+
+	len += encode_text(msg + len, sizeof(msg) - len, text);
+	queue_frame(msg, len);
+}
+
+static void
+queue_arm_level(int user)
+{
+	const uint8_t msg[] = {
+		GE_RS232_PTA_SUBCMD, GE_RS232_PTA_SUBCMD_LEVEL,
+		SIM_PARTITION, SIM_AREA,
+		user >> 8, user & 0xFF,
+		gArmLevel
+	};
+
+	queue_frame(msg, sizeof(msg));
+}
+
+static void
+queue_alarm_trouble(int zone, uint8_t general, uint8_t specific)
+{
+	const uint8_t msg[] = {
+		GE_RS232_PTA_SUBCMD, GE_RS232_PTA_SUBCMD_ALARM_TROUBLE,
+		SIM_PARTITION, SIM_AREA,
+		GE_RS232_ALARM_SOURCE_TYPE_ZONE,
+		0, zone >> 8, zone & 0xFF,
+		general, specific,
+		0, 0
+	};
+
+	queue_frame(msg, sizeof(msg));
+}
+
+static void
+queue_equipment_list(void)
+{
+	const uint8_t panel_type[] = {
+		GE_RS232_PTA_PANEL_TYPE,
+		SIM_PANEL_TYPE,
+		0x00, 0x01,	// Hardware revision
+		0x00, 0x01,	// Software revision
+		(SIM_SERIAL_NUMBER >> 24) & 0xFF,
+		(SIM_SERIAL_NUMBER >> 16) & 0xFF,
+		(SIM_SERIAL_NUMBER >> 8) & 0xFF,
+		SIM_SERIAL_NUMBER & 0xFF,
+	};
+	const uint8_t complete[] = { GE_RS232_PTA_EQUIP_LIST_COMPLETE };
+	uint8_t msg[GE_RS232_MAX_MESSAGE_SIZE];
+	char name[32];
+	uint8_t len;
+	int zone;
+
+	queue_frame(panel_type, sizeof(panel_type));
+
+	for (zone = 0; zone < gZoneCount; zone++) {
+		msg[0] = GE_RS232_PTA_EQUIP_LIST_ZONE_DATA;
+		msg[1] = SIM_PARTITION;
+		msg[2] = SIM_AREA;
+		msg[3] = 13;	// Group: Instant interior
+		msg[4] = zone >> 8;
+		msg[5] = zone & 0xFF;
+		msg[6] = GE_RS232_ZONE_TYPE_RF;
+		msg[7] = gZoneState[zone];
+		len = 8;
+		snprintf(name, sizeof(name), "ZONE %d", zone);
+		len += encode_text(msg + len, sizeof(msg) - len, name);
+		queue_frame(msg, len);
+	}
+
+	msg[0] = GE_RS232_PTA_EQUIP_LIST_PARTITION_DATA;
+	msg[1] = SIM_PARTITION;
+	msg[2] = SIM_AREA;
+	msg[3] = gArmLevel;
+	len = 4;
+	len += encode_text(msg + len, sizeof(msg) - len, "SIMULATOR");
+	queue_frame(msg, len);
+
+	queue_frame(complete, sizeof(complete));
+}
+
+static void
+queue_dynamic_data(void)
+{
+	time_t now = time(NULL);
+	struct tm* tm = localtime(&now);
+	const uint8_t feature_state[] = {
+		GE_RS232_PTA_SUBCMD, GE_RS232_PTA_SUBCMD_FEATURE_STATE,
+		SIM_PARTITION, SIM_AREA,
+		0
+	};
+	const uint8_t time_and_date[] = {
+		GE_RS232_PTA_SUBCMD, GE_RS232_PTA_SUBCMD_TIME_AND_DATE,
+		tm->tm_hour, tm->tm_min,
+		tm->tm_mon + 1, tm->tm_mday,
+		tm->tm_year - 100
+	};
+	int zone;
+
+	for (zone = 0; zone < gZoneCount; zone++) {
+		queue_zone_status(zone);
+	}
+
+	queue_arm_level(GE_RS232_USER_SYSTEM);
+	queue_frame(feature_state, sizeof(feature_state));
+	queue_touchpad_text(gAlarmZone >= 0 ? "ALARM" : "SYSTEM OK");
+
+	// Time and date is always last, concordd takes it to
+	// mean that the refresh is done.
+	queue_frame(time_and_date, sizeof(time_and_date));
+}
+
+#pragma mark - Simulated activity
+
+static void
+start_alarm(int zone, uint8_t specific, cms_t now)
+{
+	const uint8_t siren_setup[] = {
+		GE_RS232_PTA_SUBCMD, GE_RS232_PTA_SUBCMD_SIREN_SETUP,
+		SIM_PARTITION, SIM_AREA,
+		0,	// Repeat until stopped
+		0xFF, 0xFF, 0xFF, 0xFF	// Cadence
+	};
+	const uint8_t siren_go[] = { GE_RS232_PTA_SUBCMD, GE_RS232_PTA_SUBCMD_SIREN_GO };
+	char text[32];
+
+	if (gAlarmZone >= 0) {
+		return;
+	}
+
+	gAlarmZone = zone;
+	gAlarmEndsAt = now + SIM_ALARM_DURATION;
+	gSirenSyncTimer.next = now;
+
+	gZoneState[zone] |= GE_RS232_ZONE_STATUS_ALARM;
+	queue_zone_status(zone);
+	queue_alarm_trouble(zone, GE_RS232_ALARM_GENERAL_TYPE_ALARM, specific);
+	queue_frame(siren_setup, sizeof(siren_setup));
+	queue_frame(siren_go, sizeof(siren_go));
+
+	snprintf(text, sizeof(text), "ALARM ZONE %d", zone);
+	queue_touchpad_text(text);
+}
+
+static void
+stop_alarm(bool canceled)
+{
+	const uint8_t siren_stop[] = {
+		GE_RS232_PTA_SUBCMD, GE_RS232_PTA_SUBCMD_SIREN_STOP,
+		SIM_PARTITION, SIM_AREA
+	};
+	int zone = gAlarmZone;
+
+	if (zone < 0) {
+		return;
+	}
+
+	gAlarmZone = -1;
+
+	queue_frame(siren_stop, sizeof(siren_stop));
+
+	if (canceled) {
+		queue_alarm_trouble(zone, GE_RS232_ALARM_GENERAL_TYPE_ALARM_CANCEL, GE_RS232_ALARM_SPECIFIC_UNSPECIFIED);
+	}
+
+	gZoneState[zone] &= ~GE_RS232_ZONE_STATUS_ALARM;
+	queue_zone_status(zone);
+}
+
+static void
+set_arm_level(uint8_t level)
+{
+	static const char* const names[] = {
+		[GE_RS232_ARMING_LEVEL_OFF] = "SYSTEM DISARMED",
+		[GE_RS232_ARMING_LEVEL_STAY] = "ARMED STAY",
+		[GE_RS232_ARMING_LEVEL_AWAY] = "ARMED AWAY",
+	};
+
+	if (level == GE_RS232_ARMING_LEVEL_OFF) {
+		stop_alarm(true);
+	}
+
+	gArmLevel = level;
+	queue_arm_level(GE_RS232_USER_P0_MASTER + SIM_PARTITION);
+	queue_touchpad_text(names[level]);
+}
+
+static void
+handle_keys(const uint8_t* keys, uint8_t len, cms_t now)
+{
+	char text[32];
+
+	for (; len > 0; len--, keys++) {
+		// Bit 6 marks a held key, see `concordd_queue_keys()`.
+		switch (*keys & ~(1<<6)) {
+		case 0x20:
+			set_arm_level(GE_RS232_ARMING_LEVEL_OFF);
+			break;
+		case 0x27:
+		case GE_RS232_KEYPRESS_ARM_ARAY_NO_DELAY:
+			set_arm_level(GE_RS232_ARMING_LEVEL_AWAY);
+			break;
+		case 0x28:
+			set_arm_level(GE_RS232_ARMING_LEVEL_STAY);
+			break;
+		case 0x4C:
+			start_alarm(0, GE_RS232_ALARM_SPECIFIC_POLICE_PANIC, now);
+			break;
+		case 0x4D:
+			start_alarm(0, GE_RS232_ALARM_SPECIFIC_AUXILIARY_PANIC, now);
+			break;
+		case 0x4E:
+			start_alarm(0, GE_RS232_ALARM_SPECIFIC_FIRE_PANIC, now);
+			break;
+		default:
+			snprintf(text, sizeof(text), "KEY %02X", *keys);
+			queue_touchpad_text(text);
+			break;
+		}
+	}
+}
+
+static void
+run_activity(cms_t now)
+{
+	char text[32];
+	int zone;
+
+	for (zone = 0; zone < gZoneCount; zone++) {
+		if (gZoneRestoreAt[zone] != 0 && now - gZoneRestoreAt[zone] >= 0) {
+			gZoneRestoreAt[zone] = 0;
+			gZoneState[zone] &= ~GE_RS232_ZONE_STATUS_TRIPPED;
+			queue_zone_status(zone);
+		}
+	}
+
+	if (timer_fired(&gTripTimer, now)) {
+		// The last zone is the flapping one.
+		zone = rand() % (gZoneCount > 1 ? gZoneCount - 1 : 1);
+
+		if (!(gZoneState[zone] & GE_RS232_ZONE_STATUS_TRIPPED)) {
+			gZoneState[zone] |= GE_RS232_ZONE_STATUS_TRIPPED;
+			queue_zone_status(zone);
+		}
+
+		// Zero means "not tripped by us".
+		gZoneRestoreAt[zone] = (now + gTripDuration) | 1;
+	}
+
+	if (timer_fired(&gFlapTimer, now)) {
+		zone = gZoneCount - 1;
+		gZoneState[zone] ^= GE_RS232_ZONE_STATUS_TRIPPED;
+		queue_zone_status(zone);
+	}
+
+	if (timer_fired(&gAlarmTimer, now)) {
+		start_alarm(rand() % gZoneCount, GE_RS232_ALARM_SPECIFIC_POLICE, now);
+	}
+
+	if (gAlarmZone >= 0) {
+		if (now - gAlarmEndsAt >= 0) {
+			stop_alarm(false);
+
+		} else if (timer_fired(&gSirenSyncTimer, now)) {
+			const uint8_t siren_sync[] = { GE_RS232_PTA_SUBCMD, GE_RS232_PTA_SUBCMD_SIREN_SYNC };
+			queue_frame(siren_sync, sizeof(siren_sync));
+		}
+	}
+
+	if (timer_fired(&gTouchpadTimer, now)) {
+		snprintf(text, sizeof(text), "SYSTEM OK %u", ++gTouchpadCount);
+		queue_touchpad_text(text);
+	}
+}
+
+static cms_t
+activity_timeout(cms_t now)
+{
+	cms_t timeout = CMS_DISTANT_FUTURE;
+	int zone;
+
+	for (zone = 0; zone < gZoneCount; zone++) {
+		if (gZoneRestoreAt[zone] != 0 && gZoneRestoreAt[zone] - now < timeout) {
+			timeout = gZoneRestoreAt[zone] - now;
+		}
+	}
+
+	if (gAlarmZone >= 0) {
+		if (gAlarmEndsAt - now < timeout) {
+			timeout = gAlarmEndsAt - now;
+		}
+		timeout = timer_timeout(&gSirenSyncTimer, now, timeout);
+	}
+
+	timeout = timer_timeout(&gTripTimer, now, timeout);
+	timeout = timer_timeout(&gFlapTimer, now, timeout);
+	timeout = timer_timeout(&gAlarmTimer, now, timeout);
+	timeout = timer_timeout(&gTouchpadTimer, now, timeout);
+
+	return timeout < 0 ? 0 : timeout;
+}
+
+#pragma mark - Link
+
+static ge_rs232_status_t
+sim_send_bytes(void* context, const uint8_t* data, int len, ge_rs232_t instance)
+{
+	uint8_t buffer[GE_RS232_MAX_MESSAGE_SIZE*2 + 8];
+
+	if (len == 1 && data[0] == GE_RS232_ACK) {
+		if (chance(gNakPercent)) {
+			// Pretend the frame was garbled: NAK it and forget it.
+			buffer[0] = GE_RS232_NAK;
+			data = buffer;
+			gDiscardFrame = true;
+			gStats.injected_naks++;
+
+		} else if (chance(gLostAckPercent)) {
+			// The frame is handled, but concordd never hears
+			// about it and should send it again.
+			gStats.injected_lost_acks++;
+			return GE_RS232_STATUS_OK;
+		}
+
+	} else if (len > 1 && len <= sizeof(buffer) && chance(gBadChecksumPercent)) {
+		memcpy(buffer, data, len);
+		buffer[len - 1] = (buffer[len - 1] == '0') ? '1' : '0';
+		data = buffer;
+		gStats.injected_bad_checksums++;
+	}
+
+	if (gVerbose && len > 1) {
+		fprintf(stderr, "concord4-sim: -> %.*s\n", len - 1, data + 1);
+	}
+
+	write_all(data, len);
+
+	return GE_RS232_STATUS_OK;
+}
+
+static ge_rs232_status_t
+sim_received_message(void* context, const uint8_t* data, uint8_t len, ge_rs232_t instance)
+{
+	if (gDiscardFrame) {
+		gDiscardFrame = false;
+		return GE_RS232_STATUS_OK;
+	}
+
+	gStats.requests++;
+
+	if (gVerbose) {
+		fprintf(stderr, "concord4-sim: <- type 0x%02X, %d bytes\n", data[0], len);
+	}
+
+	switch (data[0]) {
+	case GE_RS232_ATP_EQUIP_LIST_REQUEST:
+		queue_equipment_list();
+		break;
+
+	case GE_RS232_ATP_DYNAMIC_DATA_REFRESH:
+		queue_dynamic_data();
+		break;
+
+	case GE_RS232_ATP_KEYPRESS:
+		if (len > 3) {
+			handle_keys(data + 3, len - 3, time_ms());
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	return GE_RS232_STATUS_OK;
+}
+
+static void
+sim_got_response(void* context, ge_rs232_t instance, bool didAck)
+{
+	if (didAck && gOutOnWire) {
+		gOutOnWire = false;
+		gOutHead = (gOutHead + 1) % SIM_OUT_QUEUE_SIZE;
+		gOutCount--;
+	}
+}
+
+// Stop-and-wait, like the real panel: the next frame only goes
+// out once the last one has been acknowledged.
+static void
+sim_update_link(void)
+{
+	ge_rs232_status_t status = ge_rs232_ready_to_send(&gInterface);
+
+	if (status == GE_RS232_STATUS_WAIT) {
+		return;
+	}
+
+	if (gOutOnWire && status != GE_RS232_STATUS_OK) {
+		if (gInterface.output_attempt_count < SIM_MAX_ATTEMPTS) {
+			ge_rs232_resend_last_message(&gInterface);
+			return;
+		}
+
+		// Give up on it.
+		gOutOnWire = false;
+		gOutHead = (gOutHead + 1) % SIM_OUT_QUEUE_SIZE;
+		gOutCount--;
+		gStats.frames_dropped++;
+	}
+
+	if (!gOutOnWire && gOutCount > 0) {
+		struct sim_frame_s* frame = &gOutQueue[gOutHead];
+
+		gOutOnWire = true;
+		ge_rs232_send_message(&gInterface, frame->data, frame->len);
+	}
+}
+
+#pragma mark - Main
+
+static int
+open_pty(void)
+{
+	struct termios tios;
+	int master = posix_openpt(O_RDWR | O_NOCTTY);
+	int slave;
+
+	if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+		perror("posix_openpt");
+		return -1;
+	}
+
+	// Keeping the slave side open ourselves means that reads from
+	// the master don't fail while concordd isn't connected.
+	slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+
+	if (slave < 0 || tcgetattr(slave, &tios) != 0) {
+		perror(ptsname(master));
+		return -1;
+	}
+
+	cfmakeraw(&tios);
+	tcsetattr(slave, TCSANOW, &tios);
+
+	printf("%s\n", ptsname(master));
+	fflush(stdout);
+
+	return master;
+}
+
+static void
+signal_handler(int sig)
+{
+	gDone = 1;
+}
+
+static void
+print_usage(const char* argv0)
+{
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  -p          Serve on a pseudo-terminal instead of stdin/stdout\n"
+		"  -z <n>      Number of zones (default %d)\n"
+		"  -t <ms>     Trip a random zone every <ms>\n"
+		"  -H <ms>     How long a trip lasts (default %d)\n"
+		"  -f <ms>     Toggle the last zone every <ms>\n"
+		"  -a <ms>     Raise an alarm every <ms>\n"
+		"  -s <ms>     Siren sync interval during an alarm (default %d)\n"
+		"  -T <ms>     Update the touchpad text every <ms>\n"
+		"  -N <pct>    NAK this percentage of received frames\n"
+		"  -X <pct>    Corrupt the checksum of this percentage of sent frames\n"
+		"  -D <pct>    Drop the ACK for this percentage of received frames\n"
+		"  -r <seed>   Random seed\n"
+		"  -v          Log frames to stderr\n",
+		argv0,
+		SIM_MAX_ZONES,
+		(int)gTripDuration,
+		(int)gSirenSyncTimer.interval
+	);
+}
+
+int
+main(int argc, char* argv[])
+{
+	struct pollfd pfd;
+	uint8_t buffer[128];
+	bool use_pty = false;
+	int c;
+
+	srand(time(NULL));
+
+	while ((c = getopt(argc, argv, "pz:t:H:f:a:s:T:N:X:D:r:v")) != -1) {
+		switch (c) {
+		case 'p': use_pty = true; break;
+		case 'z': gZoneCount = atoi(optarg); break;
+		case 't': gTripTimer.interval = atoi(optarg); break;
+		case 'H': gTripDuration = atoi(optarg); break;
+		case 'f': gFlapTimer.interval = atoi(optarg); break;
+		case 'a': gAlarmTimer.interval = atoi(optarg); break;
+		case 's': gSirenSyncTimer.interval = atoi(optarg); break;
+		case 'T': gTouchpadTimer.interval = atoi(optarg); break;
+		case 'N': gNakPercent = atoi(optarg); break;
+		case 'X': gBadChecksumPercent = atoi(optarg); break;
+		case 'D': gLostAckPercent = atoi(optarg); break;
+		case 'r': srand(atoi(optarg)); break;
+		case 'v': gVerbose = true; break;
+		default:
+			print_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (gZoneCount < 1 || gZoneCount > SIM_MAX_ZONES || gSirenSyncTimer.interval <= 0) {
+		print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	gFD = use_pty ? open_pty() : STDOUT_FILENO;
+	pfd.fd = use_pty ? gFD : STDIN_FILENO;
+	pfd.events = POLLIN;
+
+	if (gFD < 0) {
+		return EXIT_FAILURE;
+	}
+
+	signal(SIGINT, &signal_handler);
+	signal(SIGTERM, &signal_handler);
+	signal(SIGPIPE, SIG_IGN);
+
+	text_encoding_init();
+
+	ge_rs232_init(&gInterface);
+	gInterface.send_bytes = &sim_send_bytes;
+	gInterface.received_message = &sim_received_message;
+	gInterface.got_response = &sim_got_response;
+
+	gTripTimer.next = gFlapTimer.next = gAlarmTimer.next = gTouchpadTimer.next = time_ms();
+
+	while (!gDone) {
+		cms_t now = time_ms();
+		cms_t timeout;
+		int ret;
+
+		run_activity(now);
+		sim_update_link();
+
+		timeout = activity_timeout(now);
+
+		if (gOutCount > 0) {
+			cms_t link_timeout = ge_rs232_get_timeout_cms(&gInterface);
+
+			if (link_timeout < timeout) {
+				timeout = link_timeout;
+			}
+		}
+
+		ret = poll(&pfd, 1, timeout >= CMS_DISTANT_FUTURE ? -1 : (int)timeout);
+
+		if (ret < 0) {
+			if (errno != EINTR) {
+				perror("poll");
+				break;
+			}
+			continue;
+		}
+
+		if (ret > 0) {
+			ssize_t len = read(pfd.fd, buffer, sizeof(buffer));
+
+			if (len <= 0) {
+				// concordd went away.
+				break;
+			}
+
+			ge_rs232_receive_bytes(&gInterface, buffer, len);
+		}
+	}
+
+	fprintf(stderr,
+		"concord4-sim: %u requests, %u frames queued (%u dropped), "
+		"%u sent (%u retransmits), %u NAKs and %u timeouts from concordd; "
+		"injected %u NAKs, %u bad checksums, %u lost ACKs\n",
+		gStats.requests,
+		gStats.frames_queued,
+		gStats.frames_dropped,
+		gInterface.stats.frames_sent,
+		gInterface.stats.retransmits,
+		gInterface.stats.naks,
+		gInterface.stats.timeouts,
+		gStats.injected_naks,
+		gStats.injected_bad_checksums,
+		gStats.injected_lost_acks
+	);
+
+	return EXIT_SUCCESS;
+}
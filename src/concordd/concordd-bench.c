@@ -0,0 +1,495 @@
+/*
+ *
+ * Copyright (c) 2017 Robert Quattlebaum
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Microbenchmarks for the frame handling hot paths.
+//
+// Drives `concordd_handle_frame()` with a few typical mixes of
+// panel traffic, along with the text decoders and the frame
+// encoder, and prints how long each call took and how many heap
+// allocations it made.
+//
+//     concordd-bench [-n iterations] [-v]
+//
+// Logging is masked the same way concordd masks it by default, so
+// the cost of formatting messages that are thrown away is counted.
+// With `-v` nothing is masked.
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "concordd.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <time.h>
+
+#define BENCH_PARTITION      1
+
+struct bench_frame_s {
+	uint8_t data[GE_RS232_MAX_MESSAGE_SIZE];
+	uint8_t len;
+};
+
+struct bench_corpus_s {
+	const char* name;
+	struct bench_frame_s* frames;
+	int count;
+};
+
+static uint32_t gSink;
+
+#pragma mark - Allocation counting
+
+#if defined(__GLIBC__)
+// Everything in the process, libc included, ends up here.
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+
+static uint64_t gAllocCount;
+
+void*
+malloc(size_t size)
+{
+	gAllocCount++;
+	return __libc_malloc(size);
+}
+
+void*
+calloc(size_t count, size_t size)
+{
+	gAllocCount++;
+	return __libc_calloc(count, size);
+}
+
+void*
+realloc(void* ptr, size_t size)
+{
+	gAllocCount++;
+	return __libc_realloc(ptr, size);
+}
+
+#define ALLOC_COUNTING      1
+#else
+static uint64_t gAllocCount;
+#define ALLOC_COUNTING      0
+#endif
+
+#pragma mark - Corpus
+
+// Encodes `text` the way the panel would, using the multi-character
+// tokens where possible.
+static uint8_t
+encode_text(uint8_t* dest, uint8_t max, const char* text)
+{
+	uint8_t len = 0;
+
+	while (*text && len < max) {
+		int best = -1;
+		size_t best_len = 0;
+		int i;
+
+		for (i = 0; i < 256; i++) {
+			const char* token = ge_rs232_text_token_lookup[i];
+			size_t token_len = token ? strlen(token) : 0;
+
+			if ( token_len > best_len
+			  && token[0] != '\n'
+			  && strncmp(text, token, token_len) == 0
+			) {
+				best = i;
+				best_len = token_len;
+			}
+		}
+
+		if (best < 0) {
+			text++;
+			continue;
+		}
+
+		dest[len++] = best;
+		text += best_len;
+	}
+
+	return len;
+}
+
+static struct bench_frame_s*
+add_frame(struct bench_corpus_s* corpus, const uint8_t* data, uint8_t len)
+{
+	struct bench_frame_s* frame;
+
+	corpus->frames = realloc(corpus->frames, sizeof(*frame)*(corpus->count + 1));
+	frame = &corpus->frames[corpus->count++];
+	memcpy(frame->data, data, len);
+	frame->len = len;
+
+	return frame;
+}
+
+static void
+add_text_frame(struct bench_corpus_s* corpus, const uint8_t* header, uint8_t header_len, const char* text)
+{
+	uint8_t msg[GE_RS232_MAX_MESSAGE_SIZE];
+	uint8_t len = header_len;
+
+	memcpy(msg, header, header_len);
+	len += encode_text(msg + len, sizeof(msg) - len, text);
+	add_frame(corpus, msg, len);
+}
+
+// Every zone trips and then restores.
+static void
+make_zone_status_corpus(struct bench_corpus_s* corpus)
+{
+	int pass, zone;
+
+	corpus->name = "zone status";
+
+	for (pass = 0; pass < 2; pass++) {
+		for (zone = 0; zone < CONCORDD_MAX_ZONES; zone++) {
+			const uint8_t msg[] = {
+				GE_RS232_PTA_ZONE_STATUS, BENCH_PARTITION, 0,
+				zone >> 8, zone & 0xFF,
+				pass ? 0 : GE_RS232_ZONE_STATUS_TRIPPED
+			};
+			add_frame(corpus, msg, sizeof(msg));
+		}
+	}
+}
+
+// The touchpad text as it changes during exit delay and
+// a fault, with the occasional blinking token.
+static void
+make_touchpad_corpus(struct bench_corpus_s* corpus)
+{
+	static const uint8_t header[] = {
+		GE_RS232_PTA_SUBCMD, GE_RS232_PTA_SUBCMD_TOUCHPAD_DISPLAY,
+		BENCH_PARTITION, 0,
+		1	// Type
+	};
+	static const char* const texts[] = {
+		"SYSTEM OK ",
+		"ARMED TO STAY ",
+		"EXIT DELAY 30",
+		"FRONT DOOR OPEN ",
+		"SENSOR 12 LOW BATTERY ",
+		"ALARM BACK DOOR ",
+	};
+	uint8_t msg[GE_RS232_MAX_MESSAGE_SIZE];
+	uint8_t len;
+	int i;
+
+	corpus->name = "touchpad display";
+
+	for (i = 0; i < sizeof(texts)/sizeof(*texts); i++) {
+		add_text_frame(corpus, header, sizeof(header), texts[i]);
+	}
+
+	// Blinking time of day.
+	memcpy(msg, header, sizeof(header));
+	len = sizeof(header);
+	len += encode_text(msg + len, sizeof(msg) - len, "SYSTEM OK ");
+	msg[len++] = 0xFE;
+	len += encode_text(msg + len, sizeof(msg) - len, "12:34");
+	add_frame(corpus, msg, len);
+}
+
+// Alarms, cancels and troubles from various zones.
+static void
+make_alarm_corpus(struct bench_corpus_s* corpus)
+{
+	static const uint8_t types[][2] = {
+		{ GE_RS232_ALARM_GENERAL_TYPE_ALARM, GE_RS232_ALARM_SPECIFIC_PERIMETER },
+		{ GE_RS232_ALARM_GENERAL_TYPE_ALARM_CANCEL, GE_RS232_ALARM_SPECIFIC_UNSPECIFIED },
+		{ GE_RS232_ALARM_GENERAL_TYPE_NONFIRE_TROUBLE, GE_RS232_TROUBLE_SPECIFIC_LOW_BATTERY },
+		{ GE_RS232_ALARM_GENERAL_TYPE_NONFIRE_TROUBLE_RESTORAL, GE_RS232_TROUBLE_SPECIFIC_LOW_BATTERY },
+		{ GE_RS232_ALARM_GENERAL_TYPE_BYPASS, GE_RS232_BYPASS_SPECIFIC_DIRECT },
+		{ GE_RS232_ALARM_GENERAL_TYPE_UNBYPASS, GE_RS232_BYPASS_SPECIFIC_DIRECT },
+	};
+	int i, zone;
+
+	corpus->name = "alarm/trouble";
+
+	for (zone = 1; zone <= 8; zone++) {
+		for (i = 0; i < sizeof(types)/sizeof(*types); i++) {
+			const uint8_t msg[] = {
+				GE_RS232_PTA_SUBCMD, GE_RS232_PTA_SUBCMD_ALARM_TROUBLE,
+				BENCH_PARTITION, 0,
+				GE_RS232_ALARM_SOURCE_TYPE_ZONE,
+				0, 0, zone,
+				types[i][0], types[i][1],
+				0, 0
+			};
+			add_frame(corpus, msg, sizeof(msg));
+		}
+	}
+}
+
+// An equipment list: every zone, then the partition.
+static void
+make_equip_list_corpus(struct bench_corpus_s* corpus)
+{
+	static const char* const names[] = {
+		"FRONT DOOR ", "BACK DOOR ", "KITCHEN WINDOW ", "GARAGE DOOR ",
+		"MASTER BEDROOM ", "BASEMENT ", "LIVING ROOM ", "HALLWAY ",
+	};
+	static const uint8_t partition_header[] = {
+		GE_RS232_PTA_EQUIP_LIST_PARTITION_DATA, BENCH_PARTITION, 0,
+		GE_RS232_ARMING_LEVEL_OFF
+	};
+	int zone;
+
+	corpus->name = "equip list";
+
+	for (zone = 0; zone < CONCORDD_MAX_ZONES; zone++) {
+		const uint8_t header[] = {
+			GE_RS232_PTA_EQUIP_LIST_ZONE_DATA, BENCH_PARTITION, 0,
+			13,	// Group
+			zone >> 8, zone & 0xFF,
+			GE_RS232_ZONE_TYPE_RF,
+			0	// State
+		};
+		add_text_frame(corpus, header, sizeof(header), names[zone % 8]);
+	}
+
+	add_text_frame(corpus, partition_header, sizeof(partition_header), "PARTITION 1 ");
+}
+
+// Roughly what an active household looks like: mostly zone
+// status changes and touchpad updates.
+static void
+make_mixed_corpus(struct bench_corpus_s* corpus, const struct bench_corpus_s* parts, int part_count)
+{
+	int i, j;
+
+	corpus->name = "mixed";
+
+	for (i = 0; i < CONCORDD_MAX_ZONES*2; i++) {
+		for (j = 0; j < part_count; j++) {
+			// One alarm or equipment list frame for every
+			// eight zone status and touchpad frames.
+			if (j >= 2 && (i % 8) != 0) {
+				continue;
+			}
+			add_frame(corpus, parts[j].frames[i % parts[j].count].data, parts[j].frames[i % parts[j].count].len);
+		}
+	}
+}
+
+#pragma mark - Benchmarks
+
+static ge_rs232_status_t
+bench_send_bytes(void* context, const uint8_t* data, int len, ge_rs232_t instance)
+{
+	gSink += len;
+	return GE_RS232_STATUS_OK;
+}
+
+static void
+bench_zone_info_changed(void* context, concordd_instance_t instance, concordd_zone_t zone, int changed)
+{
+	gSink += changed;
+}
+
+static void
+bench_partition_info_changed(void* context, concordd_instance_t instance, concordd_partition_t partition, int changed)
+{
+	gSink += changed;
+}
+
+static void
+bench_event(void* context, concordd_instance_t instance, concordd_event_t event)
+{
+	gSink++;
+}
+
+static double
+now_seconds(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+static void
+print_result(const char* name, double seconds, uint64_t allocs, uint64_t calls)
+{
+	printf("%-32s %9.1f ns/call", name, seconds*1e9/calls);
+
+	if (ALLOC_COUNTING) {
+		printf(" %7.2f allocs/call", (double)allocs/calls);
+	}
+
+	printf("\n");
+}
+
+static void
+bench_handle_frame(const struct bench_corpus_s* corpus, int iterations)
+{
+	static struct concordd_instance_s instance;
+	char name[64];
+	uint64_t allocs;
+	double start;
+	int i, j;
+
+	concordd_init(&instance);
+	instance.send_bytes_func = &bench_send_bytes;
+	instance.zone_info_changed_func = &bench_zone_info_changed;
+	instance.partition_info_changed_func = &bench_partition_info_changed;
+	instance.event_func = &bench_event;
+
+	// Warm up, so that zones and partitions are active.
+	for (j = 0; j < corpus->count; j++) {
+		concordd_handle_frame(&instance, corpus->frames[j].data, corpus->frames[j].len);
+	}
+
+	allocs = gAllocCount;
+	start = now_seconds();
+
+	for (i = 0; i < iterations; i++) {
+		for (j = 0; j < corpus->count; j++) {
+			concordd_handle_frame(&instance, corpus->frames[j].data, corpus->frames[j].len);
+		}
+	}
+
+	snprintf(name, sizeof(name), "handle_frame(%s)", corpus->name);
+	print_result(name, now_seconds() - start, gAllocCount - allocs, (uint64_t)iterations*corpus->count);
+}
+
+static void
+bench_text(const struct bench_corpus_s* corpus, int iterations, bool one_line, bool reentrant)
+{
+	char buffer[256];
+	char name[64];
+	uint64_t allocs = gAllocCount;
+	double start = now_seconds();
+	uint64_t calls = 0;
+	int i, j;
+
+	for (i = 0; i < iterations; i++) {
+		for (j = 0; j < corpus->count; j++) {
+			// Skip the touchpad frame header.
+			const uint8_t* text = corpus->frames[j].data + 5;
+			uint8_t len = corpus->frames[j].len - 5;
+
+			if (reentrant) {
+				if (one_line) {
+					gSink += ge_text_to_ascii_one_line_r(buffer, sizeof(buffer), text, len);
+				} else {
+					gSink += ge_text_to_ascii_r(buffer, sizeof(buffer), text, len);
+				}
+			} else if (one_line) {
+				gSink += strlen(ge_text_to_ascii_one_line(text, len));
+			} else {
+				gSink += strlen(ge_text_to_ascii(text, len));
+			}
+			calls++;
+		}
+	}
+
+	snprintf(name, sizeof(name), "ge_text_to_ascii%s%s()", one_line ? "_one_line" : "", reentrant ? "_r" : "");
+	print_result(name, now_seconds() - start, gAllocCount - allocs, calls);
+}
+
+static void
+bench_send_message(const struct bench_corpus_s* corpus, int iterations)
+{
+	struct ge_rs232_s interface;
+	uint64_t allocs;
+	double start;
+	int i, j;
+
+	ge_rs232_init(&interface);
+	interface.send_bytes = &bench_send_bytes;
+
+	allocs = gAllocCount;
+	start = now_seconds();
+
+	for (i = 0; i < iterations; i++) {
+		for (j = 0; j < corpus->count; j++) {
+			ge_rs232_send_message(&interface, corpus->frames[j].data, corpus->frames[j].len);
+
+			// As if it had been acknowledged.
+			interface.last_response = GE_RS232_ACK;
+		}
+	}
+
+	print_result("ge_rs232_send_message()", now_seconds() - start,
+		gAllocCount - allocs, (uint64_t)iterations*corpus->count);
+}
+
+int
+main(int argc, char* argv[])
+{
+	struct bench_corpus_s corpus[5];
+	const int part_count = 4;
+	int iterations = 2000;
+	bool verbose = false;
+	int c, i;
+
+	while ((c = getopt(argc, argv, "n:v")) != -1) {
+		switch (c) {
+		case 'n':
+			iterations = atoi(optarg);
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n iterations] [-v]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (iterations <= 0) {
+		return EXIT_FAILURE;
+	}
+
+	openlog("concordd-bench", LOG_PID, LOG_DAEMON);
+	setlogmask(verbose ? ~0 : LOG_UPTO(LOG_NOTICE));
+
+	memset(corpus, 0, sizeof(corpus));
+	make_zone_status_corpus(&corpus[0]);
+	make_touchpad_corpus(&corpus[1]);
+	make_alarm_corpus(&corpus[2]);
+	make_equip_list_corpus(&corpus[3]);
+	make_mixed_corpus(&corpus[4], corpus, part_count);
+
+	printf("%d iterations%s\n", iterations, ALLOC_COUNTING ? "" : ", allocations not counted");
+
+	for (i = 0; i < sizeof(corpus)/sizeof(*corpus); i++) {
+		bench_handle_frame(&corpus[i], i == 4 ? iterations/4 : iterations);
+	}
+
+	bench_text(&corpus[1], iterations*10, false, false);
+	bench_text(&corpus[1], iterations*10, true, false);
+	bench_text(&corpus[1], iterations*10, false, true);
+	bench_text(&corpus[1], iterations*10, true, true);
+	bench_send_message(&corpus[4], iterations/4);
+
+	for (i = 0; i < sizeof(corpus)/sizeof(*corpus); i++) {
+		free(corpus[i].frames);
+	}
+
+	return gSink == 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
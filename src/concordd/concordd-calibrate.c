@@ -0,0 +1,289 @@
+/*
+ *
+ * Copyright (c) 2017 Robert Quattlebaum
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifndef ASSERT_MACROS_USE_SYSLOG
+#define ASSERT_MACROS_USE_SYSLOG 1
+#endif
+
+#ifndef ASSERT_MACROS_SQUELCH
+#define ASSERT_MACROS_SQUELCH 0
+#endif
+
+#include "assert-macros.h"
+
+#include "concordd-calibrate.h"
+#include "concordd-realtime.h"
+#include "ge-rs232.h"
+#include "socket-utils.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+
+#ifndef USEC_PER_SEC
+#define USEC_PER_SEC                    1000000
+#endif
+
+// How long to wait for the panel to answer a frame.
+#define CALIBRATE_RESPONSE_TIMEOUT      (2*USEC_PER_SEC)
+
+// How long to keep listening after the ACK, for the frames that
+// the panel sends in reply to the refresh request.
+#define CALIBRATE_LISTEN_TIME           (300*USEC_PER_MSEC)
+
+// Start bit, 8 data bits, parity and stop bit, as set up by the
+// `,default` socket option.
+#define CALIBRATE_BITS_PER_CHAR         11
+
+struct calibrate_s {
+	int fd;
+	struct ge_rs232_s link;
+
+	bool got_response;
+	bool did_ack;
+	uint32_t response_at;
+
+	// How bytes from the panel are handed to us
+	uint32_t reads;
+	uint32_t bytes;
+	uint32_t last_read_at;
+	uint32_t gaps;
+	uint64_t gap_total;
+	uint32_t gap_max;
+};
+
+static ge_rs232_status_t
+calibrate_send_bytes(void* context, const uint8_t* data, int len, ge_rs232_t link)
+{
+	struct calibrate_s* self = context;
+
+	while (len > 0) {
+		ssize_t ret = write(self->fd, data, len);
+
+		if (ret > 0) {
+			data += ret;
+			len -= ret;
+
+		} else if ((ret < 0) && (errno == EAGAIN)) {
+			struct pollfd pollfd = { self->fd, POLLOUT, 0 };
+
+			if (poll(&pollfd, 1, MSEC_PER_SEC) <= 0) {
+				return GE_RS232_STATUS_ERROR;
+			}
+
+		} else {
+			return GE_RS232_STATUS_ERROR;
+		}
+	}
+
+	return GE_RS232_STATUS_OK;
+}
+
+static ge_rs232_status_t
+calibrate_received_message(void* context, const uint8_t* data, uint8_t len, ge_rs232_t link)
+{
+	return GE_RS232_STATUS_OK;
+}
+
+static void
+calibrate_got_response(void* context, ge_rs232_t link, bool didAck)
+{
+	struct calibrate_s* self = context;
+
+	if (!self->got_response) {
+		self->response_at = concordd_realtime_usec();
+		self->did_ack = didAck;
+		self->got_response = true;
+	}
+}
+
+// Reads from the panel until `duration` microseconds have passed,
+// or until it answered our frame if `until_response` is set.
+static int
+calibrate_listen(struct calibrate_s* self, uint32_t duration, bool until_response)
+{
+	const uint32_t start = concordd_realtime_usec();
+	uint8_t buffer[256];
+
+	while (!(until_response && self->got_response)) {
+		uint32_t elapsed = concordd_realtime_usec() - start;
+		struct pollfd pollfd = { self->fd, POLLIN, 0 };
+		bool mid_frame;
+		ssize_t ret;
+
+		if (elapsed >= duration) {
+			break;
+		}
+
+		ret = poll(&pollfd, 1, (duration - elapsed + USEC_PER_MSEC - 1) / USEC_PER_MSEC);
+
+		if (ret < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+
+		if (ret == 0) {
+			continue;
+		}
+
+		mid_frame = self->link.reading_message;
+		ret = read(self->fd, buffer, sizeof(buffer));
+
+		if (ret < 0) {
+			if ((errno == EAGAIN) || (errno == EINTR)) {
+				continue;
+			}
+			return -1;
+		}
+
+		if (ret == 0) {
+			errno = EPIPE;
+			return -1;
+		}
+
+		if (mid_frame) {
+			// The panel sends a frame without pausing, so any gap
+			// in the middle of one was added on our side.
+			uint32_t gap = concordd_realtime_usec() - self->last_read_at;
+
+			self->gaps++;
+			self->gap_total += gap;
+			if (gap > self->gap_max) {
+				self->gap_max = gap;
+			}
+		}
+
+		self->last_read_at = concordd_realtime_usec();
+		self->reads++;
+		self->bytes += ret;
+
+		ge_rs232_receive_bytes(&self->link, buffer, ret);
+	}
+
+	return 0;
+}
+
+int
+concordd_calibrate(int fd, int round_trips)
+{
+	static const uint8_t refresh[] = { GE_RS232_ATP_DYNAMIC_DATA_REFRESH };
+	struct calibrate_s self;
+	uint32_t rtt_min = UINT32_MAX, rtt_max = 0;
+	uint64_t rtt_total = 0;
+	int answered = 0, naks = 0;
+	int frame_chars;
+	double wire_ms;
+	int i;
+
+	memset(&self, 0, sizeof(self));
+	self.fd = fd;
+
+	ge_rs232_init(&self.link);
+	self.link.context = &self;
+	self.link.send_bytes = &calibrate_send_bytes;
+	self.link.received_message = &calibrate_received_message;
+	self.link.got_response = &calibrate_got_response;
+	self.link.response_context = &self;
+
+	printf("Measuring %d round trips to the panel at %d baud...\n", round_trips, gSocketWrapperBaud);
+
+	// Get whatever the panel was in the middle of out of the way.
+	if (calibrate_listen(&self, CALIBRATE_LISTEN_TIME, false) != 0) {
+		goto fail;
+	}
+
+	for (i = 0; i < round_trips; i++) {
+		uint32_t sent_at;
+
+		self.got_response = false;
+		sent_at = concordd_realtime_usec();
+
+		if (ge_rs232_send_message(&self.link, refresh, sizeof(refresh)) != GE_RS232_STATUS_OK) {
+			goto fail;
+		}
+
+		if (calibrate_listen(&self, CALIBRATE_RESPONSE_TIMEOUT, true) != 0) {
+			goto fail;
+		}
+
+		if (self.got_response && self.did_ack) {
+			uint32_t rtt = self.response_at - sent_at;
+
+			answered++;
+			rtt_total += rtt;
+			if (rtt < rtt_min) {
+				rtt_min = rtt;
+			}
+			if (rtt > rtt_max) {
+				rtt_max = rtt;
+			}
+		} else if (self.got_response) {
+			naks++;
+		}
+
+		// Let the panel finish sending its reply, which we ACK as
+		// it comes in, before starting the next round.
+		if (calibrate_listen(&self, CALIBRATE_LISTEN_TIME, false) != 0) {
+			goto fail;
+		}
+	}
+
+	// Our frame plus the ACK coming back.
+	frame_chars = 1 + 2*(1 + sizeof(refresh) + 1) + 1;
+	wire_ms = frame_chars * CALIBRATE_BITS_PER_CHAR * 1000.0 / gSocketWrapperBaud;
+
+	printf("Frames acknowledged: %d of %d (%d NAKs)\n", answered, round_trips, naks);
+
+	if (answered > 0) {
+		printf("ACK round trip:      min %.1f ms, avg %.1f ms, max %.1f ms\n",
+			rtt_min / 1000.0, (double)rtt_total / answered / 1000.0, rtt_max / 1000.0);
+		printf("Time on the wire:    %.1f ms\n", wire_ms);
+	}
+
+	if (self.reads > 0) {
+		printf("Bytes per read():    %.1f (%u bytes in %u reads)\n",
+			(double)self.bytes / self.reads, self.bytes, self.reads);
+	}
+
+	if (self.gaps > 0) {
+		double gap_max_ms = self.gap_max / 1000.0;
+		// A character takes this long to arrive at our baud rate.
+		double char_ms = CALIBRATE_BITS_PER_CHAR * 1000.0 / gSocketWrapperBaud;
+
+		printf("Delivery gaps:       avg %.1f ms, max %.1f ms (a character takes %.1f ms)\n",
+			(double)self.gap_total / self.gaps / 1000.0, gap_max_ms, char_ms);
+
+		if (gap_max_ms > 4*char_ms) {
+			printf("Bytes are arriving in batches. For USB serial adapters, try the `,lowlatency` socket option.\n");
+		}
+	}
+
+	return (answered > 0) ? 0 : -1;
+
+fail:
+	printf("Calibration failed: %s\n", strerror(errno));
+	return -1;
+}
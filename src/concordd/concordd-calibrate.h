@@ -0,0 +1,34 @@
+/*
+ *
+ * Copyright (c) 2017 Robert Quattlebaum
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef concordd_calibrate_h
+#define concordd_calibrate_h 1
+
+// Measures how long the panel takes to acknowledge a frame from us
+// and how bytes from the panel are delivered to us, then prints a
+// summary. Meant for comparing serial socket options (such as
+// `,lowlatency` for USB serial adapters), not for normal operation.
+//
+// Returns zero if the panel answered at least once.
+
+#define CONCORDD_CALIBRATE_ROUND_TRIPS      20
+
+int concordd_calibrate(int fd, int round_trips);
+
+#endif // ifndef concordd_calibrate_h
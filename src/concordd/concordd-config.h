@@ -26,6 +26,18 @@
 #define kCONCORDDConfig_Chroot "Chroot"
 #define kCONCORDDConfig_SyslogMask "SyslogMask"
 #define kCONCORDDConfig_PIDFile "PIDFile"
+#define kCONCORDDConfig_StateFile "StateFile"
+#define kCONCORDDConfig_CaptureFile "CaptureFile"
+#define kCONCORDDConfig_StateSaveInterval "StateSaveInterval"
+#define kCONCORDDConfig_BackgroundLinkShare "BackgroundLinkShare"
+#define kCONCORDDConfig_CommandTimeout "CommandTimeout"
+#define kCONCORDDConfig_SignalWindow "SignalWindow"
+#define kCONCORDDConfig_DBusMaxOutgoing "DBusMaxOutgoing"
+#define kCONCORDDConfig_DBusV2Signals "DBusV2Signals"
+#define kCONCORDDConfig_EventLoop "EventLoop"
+#define kCONCORDDConfig_SerialThread "SerialThread"
+#define kCONCORDDConfig_RealTimePriority "RealTimePriority"
+#define kCONCORDDConfig_RealTimeCPU "RealTimeCPU"
 
 #define kCONCORDDConfig_PartitionAlarmCommand "PartitionAlarmCommand"
 #define kCONCORDDConfig_PartitionTroubleCommand "PartitionTroubleCommand"
@@ -38,4 +50,10 @@
 #define kCONCORDDConfig_AcPowerFailureCommand "AcPowerFailureCommand"
 #define kCONCORDDConfig_AcPowerRestoredCommand "AcPowerRestoredCommand"
 
+#define kCONCORDDConfig_HookMaxRunning "HookMaxRunning"
+#define kCONCORDDConfig_HookMaxBacklog "HookMaxBacklog"
+#define kCONCORDDConfig_HookTimeout "HookTimeout"
+#define kCONCORDDConfig_HookCoprocessCommand "HookCoprocessCommand"
+#define kCONCORDDConfig_HookCoprocessBacklog "HookCoprocessBacklog"
+
 #endif
@@ -47,135 +47,53 @@ append_dict_entry(
     dbus_message_iter_close_container(dict, &entry);
 }
 
-static bool
-concordd_dbus_path_is_system(const char* path)
-{
-    return strequal(path, CONCORDD_DBUS_PATH_ROOT);
-}
-
-static bool
-concordd_dbus_path_is_zone(const char* path)
-{
-    return strhasprefix(path, CONCORDD_DBUS_PATH_ZONE);
-}
-
-static bool
-concordd_dbus_path_is_partition(const char* path)
-{
-    return strhasprefix(path, CONCORDD_DBUS_PATH_PARTITION);
-}
-
-static bool
-concordd_dbus_path_is_output(const char* path)
-{
-    return strhasprefix(path, CONCORDD_DBUS_PATH_OUTPUT);
-}
-
-static bool
-concordd_dbus_path_is_light(const char* path)
-{
-	static const char* light_dir = "/light/";
-	if (concordd_dbus_path_is_partition(path)) {
-		return strstr(path, light_dir) != NULL;
-	}
-	return false;
-}
-
-static int
-concordd_zone_index_from_dbus_path(const char* path, concordd_instance_t instance)
-{
-    if (concordd_dbus_path_is_zone(path)) {
-        return strtol(path + strlen(CONCORDD_DBUS_PATH_ZONE), NULL, 10);
-    }
-    return -1;
-}
-
-static concordd_zone_t
-concordd_zone_from_dbus_path(const char* path, concordd_instance_t instance)
-{
-    int i = concordd_zone_index_from_dbus_path(path, instance);
-    if (i >= 0) {
-        return concordd_get_zone(instance, i);
-    }
-
-    return NULL;
-}
-
-static int
-concordd_output_index_from_dbus_path(const char* path, concordd_instance_t instance)
-{
-    if (concordd_dbus_path_is_output(path)) {
-        return strtol(path + strlen(CONCORDD_DBUS_PATH_OUTPUT), NULL, 10);
-    }
-    return -1;
-}
-
-static concordd_output_t
-concordd_output_from_dbus_path(const char* path, concordd_instance_t instance)
-{
-    int i = concordd_output_index_from_dbus_path(path, instance);
-    if (i >= 0) {
-        return concordd_get_output(instance, i);
-    }
-
-    return NULL;
-}
+static DBusHandlerResult
+concordd_dbus_handle_system_get_partitions(
+    concordd_dbus_server_t self,
+    struct concordd_dbus_object_s* object,
+    DBusConnection *connection,
+    DBusMessage *   message
+) {
+    DBusMessage *reply = dbus_message_new_method_return(message);
+    DBusMessageIter iter, array_iter;
+    dbus_message_iter_init_append(reply, &iter);
+    char path_buffer[128];
+    int i;
 
-static int
-concordd_partition_index_from_dbus_path(const char* path, concordd_instance_t instance)
-{
-    if (concordd_dbus_path_is_partition(path)) {
-        return strtol(path + strlen(CONCORDD_DBUS_PATH_PARTITION), NULL, 10);
-    }
-    return -1;
-}
+    dbus_message_iter_open_container(
+        &iter,
+        DBUS_TYPE_ARRAY,
+        DBUS_TYPE_STRING_AS_STRING,
+        &array_iter
+        );
 
-static concordd_partition_t
-concordd_partition_from_dbus_path(const char* path, concordd_instance_t instance)
-{
-    int i = concordd_partition_index_from_dbus_path(path, instance);
-    if (i >= 0) {
-        return concordd_get_partition(instance, i);
+    for (i = 0; i < CONCORDD_MAX_PARTITIONS; i++) {
+        char* partition_path = path_buffer;
+        concordd_partition_t partition = concordd_get_partition(self->instance, i);
+        if (partition == NULL || partition->active == false) {
+            continue;
+        }
+        snprintf(partition_path, sizeof(path_buffer), "%s%d", CONCORDD_DBUS_PATH_PARTITION, i);
+        dbus_message_iter_append_basic(&array_iter, DBUS_TYPE_STRING, &partition_path);
     }
 
-    return NULL;
-}
+    dbus_message_iter_close_container(&iter, &array_iter);
 
-static int
-concordd_light_index_from_dbus_path(const char* path, concordd_instance_t instance)
-{
-	static const char* light_dir = "/light/";
-    if (concordd_dbus_path_is_light(path)) {
-		path = strstr(path, light_dir);
-		if (path != NULL) {
-			return strtol(path + strlen(light_dir), NULL, 10);
-		}
-	}
-    return -1;
-}
+    dbus_connection_send(connection, reply, NULL);
 
-static concordd_light_t
-concordd_light_from_dbus_path(const char* path, concordd_instance_t instance)
-{
-    int p = concordd_partition_index_from_dbus_path(path, instance);
-    int l = concordd_light_index_from_dbus_path(path, instance);
-    if ((p >= 0) && (l >= 0)) {
-        concordd_partition_t partition = concordd_get_partition(instance, p);
-		if (partition != NULL) {
-			return concordd_partition_get_light(partition, l);
-		}
-    }
+    dbus_message_unref(reply);
 
-    return NULL;
+    return DBUS_HANDLER_RESULT_HANDLED;
 }
 
-
 static DBusHandlerResult
-concordd_dbus_handle_system_get_partitions(
+concordd_dbus_handle_get_zones(
     concordd_dbus_server_t self,
+    struct concordd_dbus_object_s* object,
     DBusConnection *connection,
     DBusMessage *   message
 ) {
+    int partition_index = object->partition_index;
     DBusMessage *reply = dbus_message_new_method_return(message);
     DBusMessageIter iter, array_iter;
     dbus_message_iter_init_append(reply, &iter);
@@ -189,14 +107,17 @@ concordd_dbus_handle_system_get_partitions(
         &array_iter
         );
 
-    for (i = 0; i < CONCORDD_MAX_PARTITIONS; i++) {
-        char* partition_path = path_buffer;
-        concordd_partition_t partition = concordd_get_partition(self->instance, i);
-        if (partition == NULL || partition->active == false) {
+    for (i = 0; i < CONCORDD_MAX_ZONES; i++) {
+        char* zone_path = path_buffer;
+        concordd_zone_t zone = concordd_get_zone(self->instance, i);
+        if (zone == NULL || zone->active == false) {
             continue;
         }
-        snprintf(partition_path, sizeof(path_buffer), "%s%d", CONCORDD_DBUS_PATH_PARTITION, i);
-        dbus_message_iter_append_basic(&array_iter, DBUS_TYPE_STRING, &partition_path);
+        if (partition_index >= 0 && zone->partition_id != partition_index) {
+            continue;
+        }
+        snprintf(zone_path, sizeof(path_buffer), "%s%d", CONCORDD_DBUS_PATH_ZONE, i);
+        dbus_message_iter_append_basic(&array_iter, DBUS_TYPE_STRING, &zone_path);
     }
 
     dbus_message_iter_close_container(&iter, &array_iter);
@@ -209,6 +130,7 @@ concordd_dbus_handle_system_get_partitions(
 }
 
 struct concordd_dbus_callback_helper_s {
+    struct concordd_dbus_callback_helper_s* next;
     concordd_dbus_server_t self;
     DBusMessage *message;
 };
@@ -221,6 +143,10 @@ concordd_dbus_callback_helper_new(concordd_dbus_server_t self, DBusMessage *mess
         ret->self = self;
         ret->message = message;
         dbus_message_ref(message);
+
+        // Keep track of it in case the caller goes away.
+        ret->next = self->pending_helpers;
+        self->pending_helpers = ret;
     }
     return ret;
 }
@@ -229,11 +155,63 @@ void
 concordd_dbus_callback_helper_free(struct concordd_dbus_callback_helper_s* helper)
 {
     if (helper) {
+        struct concordd_dbus_callback_helper_s** iter = &helper->self->pending_helpers;
+
+        while (*iter != NULL) {
+            if (*iter == helper) {
+                *iter = helper->next;
+                break;
+            }
+            iter = &(*iter)->next;
+        }
+
         dbus_message_unref(helper->message);
         free(helper);
     }
 }
 
+// Returns the deadline to use for a command that was just received.
+static cms_t
+concordd_dbus_command_deadline(concordd_dbus_server_t self)
+{
+    cms_t ret = 0;
+
+    if (self->command_timeout > 0) {
+        ret = self->instance->ge_rs232.time_ms() + self->command_timeout;
+
+        if (ret == 0) {
+            // Zero means "no deadline".
+            ret = 1;
+        }
+    }
+
+    return ret;
+}
+
+// Called when `name` drops off of the bus. Anything it asked for
+// that hasn't been sent to the panel yet is no longer wanted.
+static void
+concordd_dbus_cancel_commands_from(concordd_dbus_server_t self, const char* name)
+{
+    struct concordd_dbus_callback_helper_s* helper = self->pending_helpers;
+
+    while (helper != NULL) {
+        struct concordd_dbus_callback_helper_s* next = helper->next;
+        const char* sender = dbus_message_get_sender(helper->message);
+
+        if (sender != NULL && strcmp(sender, name) == 0) {
+            syslog(LOG_INFO, "Canceling \"%s\" from \"%s\", which has left the bus", dbus_message_get_member(helper->message), name);
+
+            // Finishing the helper frees it, which is why we hang
+            // on to `next` ahead of time. If the command is already
+            // on the wire it is left alone and finishes normally.
+            concordd_cancel(self->instance, (void*)helper);
+        }
+
+        helper = next;
+    }
+}
+
 void
 concordd_dbus_callback_helper(void* context, ge_rs232_status_t status)
 {
@@ -262,11 +240,11 @@ bail:
 static DBusHandlerResult
 concordd_dbus_handle_partition_set_arm_level(
     concordd_dbus_server_t self,
+    struct concordd_dbus_object_s* object,
     DBusConnection *connection,
     DBusMessage *   message
 ) {
-    const char* path = dbus_message_get_path(message);
-    int partition_index = concordd_partition_index_from_dbus_path(path, self->instance);
+    int partition_index = object->partition_index;
     struct concordd_dbus_callback_helper_s* helper;
     ge_rs232_status_t status;
     int32_t arm_level = -1;
@@ -287,6 +265,7 @@ concordd_dbus_handle_partition_set_arm_level(
         self->instance,
         partition_index,
         arm_level,
+        concordd_dbus_command_deadline(self),
         &concordd_dbus_callback_helper,
         (void*)helper);
 
@@ -303,14 +282,14 @@ concordd_dbus_handle_partition_set_arm_level(
 static DBusHandlerResult
 concordd_dbus_handle_light_set_value(
     concordd_dbus_server_t self,
+    struct concordd_dbus_object_s* object,
     DBusConnection *connection,
     DBusMessage *   message
 ) {
     DBusHandlerResult ret = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
-    const char* path = dbus_message_get_path(message);
-    const int partition_index = concordd_partition_index_from_dbus_path(path, self->instance);
-    const int light_index = concordd_light_index_from_dbus_path(path, self->instance);
-	concordd_light_t light = concordd_light_from_dbus_path(path, self->instance);
+    const int partition_index = object->partition_index;
+    const int light_index = object->index;
+	concordd_light_t light = concordd_partition_get_light(concordd_get_partition(self->instance, partition_index), light_index);
     struct concordd_dbus_callback_helper_s* helper;
     bool state = false;
     ge_rs232_status_t status;
@@ -332,6 +311,7 @@ concordd_dbus_handle_light_set_value(
         partition_index,
         light_index,
         state,
+        concordd_dbus_command_deadline(self),
         &concordd_dbus_callback_helper,
         (void*)helper);
 
@@ -348,14 +328,13 @@ concordd_dbus_handle_light_set_value(
 static DBusHandlerResult
 concordd_dbus_handle_output_set_value(
     concordd_dbus_server_t self,
+    struct concordd_dbus_object_s* object,
     DBusConnection *connection,
     DBusMessage *   message
 ) {
     DBusHandlerResult ret = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
-    const char* path = dbus_message_get_path(message);
-    const int partition_index = concordd_partition_index_from_dbus_path(path, self->instance);
-    const int output_index = concordd_output_index_from_dbus_path(path, self->instance);
-	concordd_output_t output = concordd_output_from_dbus_path(path, self->instance);
+    const int output_index = object->index;
+	concordd_output_t output = concordd_get_output(self->instance, output_index);
     struct concordd_dbus_callback_helper_s* helper;
     bool state = false;
     ge_rs232_status_t status;
@@ -376,6 +355,7 @@ concordd_dbus_handle_output_set_value(
         self->instance,
         output_index,
         state,
+        concordd_dbus_command_deadline(self),
         &concordd_dbus_callback_helper,
         (void*)helper);
 
@@ -392,11 +372,11 @@ concordd_dbus_handle_output_set_value(
 static DBusHandlerResult
 concordd_dbus_handle_partition_press_keys(
     concordd_dbus_server_t self,
+    struct concordd_dbus_object_s* object,
     DBusConnection *connection,
     DBusMessage *   message
 ) {
-    const char* path = dbus_message_get_path(message);
-    int partition_index = concordd_partition_index_from_dbus_path(path, self->instance);
+    int partition_index = object->partition_index;
     struct concordd_dbus_callback_helper_s* helper;
     ge_rs232_status_t status;
     const char* keys = NULL;
@@ -417,6 +397,7 @@ concordd_dbus_handle_partition_press_keys(
         self->instance,
         partition_index,
         keys,
+        concordd_dbus_command_deadline(self),
         &concordd_dbus_callback_helper,
         (void*)helper);
 
@@ -430,10 +411,10 @@ concordd_dbus_handle_partition_press_keys(
 static DBusHandlerResult
 concordd_dbus_handle_refresh(
     concordd_dbus_server_t self,
+    struct concordd_dbus_object_s* object,
     DBusConnection *connection,
     DBusMessage *   message
 ) {
-    const char* path = dbus_message_get_path(message);
     struct concordd_dbus_callback_helper_s* helper;
     ge_rs232_status_t status;
 
@@ -452,78 +433,156 @@ concordd_dbus_handle_refresh(
 }
 
 
-static DBusHandlerResult
-concordd_dbus_handle_partition_get_info(
-    concordd_dbus_server_t self,
-    DBusConnection *connection,
-    DBusMessage *   message
-) {
-    DBusHandlerResult ret = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
-    const char* path = dbus_message_get_path(message);
-    int partition_index = concordd_partition_index_from_dbus_path(path, self->instance);
-    concordd_partition_t partition = concordd_get_partition(self->instance, partition_index);
-    DBusMessage *reply = dbus_message_new_method_return(message);
-    ge_rs232_status_t status;
+static void
+append_system_info(DBusMessageIter *dict, concordd_instance_t instance)
+{
+    const char* cstr = NULL;
+    int i = -1;
+    dbus_uint32_t u;
+    dbus_bool_t b = false;
 
-    if (partition_index < 0 || partition == NULL) {
-        goto bail;
-    }
+    i = instance->panel_type;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_PANEL_TYPE,
+                      DBUS_TYPE_INT32,
+                      &i);
 
-    syslog(LOG_DEBUG, "Sending DBus response for \"%s\" to \"%s\"", dbus_message_get_member(message), dbus_message_get_sender(message));
+    i = instance->hw_rev;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_HW_REVISION,
+                      DBUS_TYPE_INT32,
+                      &i);
 
-    if (!reply) {
-        goto bail;
-    }
+    i = instance->sw_rev;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_SW_REVISION,
+                      DBUS_TYPE_INT32,
+                      &i);
 
-    DBusMessageIter iter;
-    DBusMessageIter dict;
-    dbus_message_iter_init_append(reply, &iter);
+    i = instance->serial_number;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_SERIAL_NUMBER,
+                      DBUS_TYPE_INT32,
+                      &i);
 
-    if (!dbus_message_iter_open_container(
-        &iter,
-        DBUS_TYPE_ARRAY,
-        DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
-        DBUS_TYPE_STRING_AS_STRING
-        DBUS_TYPE_VARIANT_AS_STRING
-        DBUS_DICT_ENTRY_END_CHAR_AS_STRING,
-        &dict
-    )) {
-        goto bail;
-    }
+	b = instance->ac_power_failure;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_AC_POWER_FAILURE,
+                      DBUS_TYPE_BOOLEAN,
+                      &b);
+
+	i = instance->ac_power_failure_changed_timestamp;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_AC_POWER_FAILURE_CHANGED_TIMESTAMP,
+                      DBUS_TYPE_INT32,
+                      &i);
+
+    i = instance->ge_rs232.srtt;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_LINK_SRTT,
+                      DBUS_TYPE_INT32,
+                      &i);
+
+    i = instance->ge_rs232.rto;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_LINK_RTO,
+                      DBUS_TYPE_INT32,
+                      &i);
+
+    i = instance->ge_rs232.stats.frames_sent;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_LINK_FRAMES_SENT,
+                      DBUS_TYPE_INT32,
+                      &i);
 
+    i = instance->ge_rs232.stats.frames_received;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_LINK_FRAMES_RECEIVED,
+                      DBUS_TYPE_INT32,
+                      &i);
+
+    i = instance->ge_rs232.stats.retransmits;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_LINK_RETRANSMITS,
+                      DBUS_TYPE_INT32,
+                      &i);
+
+    i = instance->ge_rs232.stats.acks;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_LINK_ACKS,
+                      DBUS_TYPE_INT32,
+                      &i);
+
+    i = instance->ge_rs232.stats.naks;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_LINK_NAKS,
+                      DBUS_TYPE_INT32,
+                      &i);
+
+    i = instance->ge_rs232.stats.timeouts;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_LINK_TIMEOUTS,
+                      DBUS_TYPE_INT32,
+                      &i);
+
+    i = instance->ge_rs232.stats.bad_checksums;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_LINK_BAD_CHECKSUMS,
+                      DBUS_TYPE_INT32,
+                      &i);
+
+    i = instance->ge_rs232.stats.rx_overruns;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_LINK_RX_OVERRUNS,
+                      DBUS_TYPE_INT32,
+                      &i);
+
+    u = instance->change_seq;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_CHANGE_SEQ,
+                      DBUS_TYPE_UINT32,
+                      &u);
+
+    u = instance->change_epoch;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_CHANGE_EPOCH,
+                      DBUS_TYPE_UINT32,
+                      &u);
+}
+
+static void
+append_partition_info(DBusMessageIter *dict, concordd_partition_t partition)
+{
     const char* cstr = NULL;
     int i = -1;
     dbus_bool_t b = false;
 
     cstr = CONCORDD_DBUS_CLASS_NAME_PARTITION;
-    append_dict_entry(&dict,
+    append_dict_entry(dict,
                       CONCORDD_DBUS_INFO_CLASS_NAME,
                       DBUS_TYPE_STRING,
                       &cstr);
 
-    cstr = ge_text_to_ascii_one_line(
-        partition->encoded_touchpad_text,
-        partition->encoded_touchpad_text_len
-    );
-    append_dict_entry(&dict,
+    cstr = partition->touchpad_text;
+    append_dict_entry(dict,
                       CONCORDD_DBUS_INFO_TOUCHPAD_TEXT,
                       DBUS_TYPE_STRING,
                       &cstr);
 
     i = partition->arm_level;
-    append_dict_entry(&dict,
+    append_dict_entry(dict,
                       CONCORDD_DBUS_INFO_ARM_LEVEL,
                       DBUS_TYPE_INT32,
                       &i);
 
 	i = partition->siren_repeat;
-    append_dict_entry(&dict,
+    append_dict_entry(dict,
                       CONCORDD_DBUS_INFO_SIREN_REPEAT,
                       DBUS_TYPE_INT32,
                       &i);
 
 	b = partition->programming_mode;
-	append_dict_entry(&dict,
+	append_dict_entry(dict,
 					  CONCORDD_DBUS_INFO_PROGRAMMING_MODE,
 					  DBUS_TYPE_BOOLEAN,
 					  &b);
@@ -537,78 +596,1248 @@ concordd_dbus_handle_partition_get_info(
 		}
 		cadence[32] = 0;
 		cstr = cadence;
-		append_dict_entry(&dict,
+		append_dict_entry(dict,
 						  CONCORDD_DBUS_INFO_SIREN_CADENCE,
 						  DBUS_TYPE_STRING,
 						  &cstr);
 	}
 
 	i = partition->siren_started_at;
-    append_dict_entry(&dict,
+    append_dict_entry(dict,
                       CONCORDD_DBUS_INFO_SIREN_STARTED_AT,
                       DBUS_TYPE_INT32,
                       &i);
 
     cstr = ge_user_to_cstr(NULL,partition->arm_level_user);
-    append_dict_entry(&dict,
+    append_dict_entry(dict,
                       CONCORDD_DBUS_INFO_ARM_LEVEL_USER,
                       DBUS_TYPE_STRING,
                       &cstr);
 
     b = !!(partition->feature_state & GE_RS232_FEATURE_STATE_CHIME);
-    append_dict_entry(&dict,
+    append_dict_entry(dict,
                       CONCORDD_DBUS_INFO_CHIME,
                       DBUS_TYPE_BOOLEAN,
                       &b);
 
     b = !!(partition->feature_state & GE_RS232_FEATURE_STATE_ENERGY_SAVER);
-    append_dict_entry(&dict,
+    append_dict_entry(dict,
                       CONCORDD_DBUS_INFO_ENERGY_SAVER,
                       DBUS_TYPE_BOOLEAN,
                       &b);
 
     b = !!(partition->feature_state & GE_RS232_FEATURE_STATE_NO_DELAY);
-    append_dict_entry(&dict,
+    append_dict_entry(dict,
                       CONCORDD_DBUS_INFO_NO_DELAY,
                       DBUS_TYPE_BOOLEAN,
                       &b);
 
     b = !!(partition->feature_state & GE_RS232_FEATURE_STATE_LATCHKEY);
-    append_dict_entry(&dict,
+    append_dict_entry(dict,
                       CONCORDD_DBUS_INFO_LATCH_KEY,
                       DBUS_TYPE_BOOLEAN,
                       &b);
 
     b = !!(partition->feature_state & GE_RS232_FEATURE_STATE_SILENT_ARMING);
-    append_dict_entry(&dict,
+    append_dict_entry(dict,
                       CONCORDD_DBUS_INFO_SILENT_ARM,
                       DBUS_TYPE_BOOLEAN,
                       &b);
 
     b = !!(partition->feature_state & GE_RS232_FEATURE_STATE_QUICK_ARM);
-    append_dict_entry(&dict,
+    append_dict_entry(dict,
                       CONCORDD_DBUS_INFO_QUICK_ARM,
                       DBUS_TYPE_BOOLEAN,
                       &b);
+}
 
-    dbus_message_iter_close_container(&iter, &dict);
+static void
+append_light_info(DBusMessageIter *dict, int partition_index, int light_index, concordd_light_t light)
+{
+    const char* cstr = NULL;
+    int i = -1;
+    dbus_bool_t b = false;
 
-    dbus_connection_send(self->dbus_connection, reply, NULL);
+    cstr = CONCORDD_DBUS_CLASS_NAME_LIGHT;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_CLASS_NAME,
+                      DBUS_TYPE_STRING,
+                      &cstr);
 
-    ret = DBUS_HANDLER_RESULT_HANDLED;
+	i = light_index;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_LIGHT_ID,
+                      DBUS_TYPE_INT32,
+                      &i);
+
+    i = partition_index;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_PARTITION_ID,
+                      DBUS_TYPE_INT32,
+                      &i);
+
+	i = light->zone_id;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_ZONE_ID,
+                      DBUS_TYPE_INT32,
+                      &i);
+
+	b = light->light_state;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_VALUE,
+                      DBUS_TYPE_BOOLEAN,
+                      &b);
+
+	/*
+	cstr = ge_user_to_cstr(NULL, light->last_changed_by);
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_LAST_CHANGED_BY,
+                      DBUS_TYPE_STRING,
+                      &cstr);
+	*/
+
+	i = (int)light->last_changed_at;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_LAST_CHANGED_AT,
+                      DBUS_TYPE_INT32,
+                      &i);
+}
+
+static void
+append_output_info(DBusMessageIter *dict, int output_index, concordd_output_t output)
+{
+    const char* cstr = NULL;
+    int i = -1;
+    dbus_bool_t b = false;
+
+    cstr = CONCORDD_DBUS_CLASS_NAME_OUTPUT;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_CLASS_NAME,
+                      DBUS_TYPE_STRING,
+                      &cstr);
+
+	i = output_index;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_OUTPUT_ID,
+                      DBUS_TYPE_INT32,
+                      &i);
+
+	if (output->encoded_name_len > 0) {
+		cstr = output->name;
+		append_dict_entry(dict,
+						  CONCORDD_DBUS_INFO_NAME,
+						  DBUS_TYPE_STRING,
+						  &cstr);
+	}
+
+    i = output->partition_id;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_PARTITION_ID,
+                      DBUS_TYPE_INT32,
+                      &i);
+
+	b = output->output_state;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_VALUE,
+                      DBUS_TYPE_BOOLEAN,
+                      &b);
+
+	b = output->pulse;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_PULSE,
+                      DBUS_TYPE_BOOLEAN,
+                      &b);
+
+	cstr = ge_user_to_cstr(NULL, output->last_changed_by);
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_LAST_CHANGED_BY,
+                      DBUS_TYPE_STRING,
+                      &cstr);
+
+	i = (int32_t)output->last_changed_at;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_LAST_CHANGED_AT,
+                      DBUS_TYPE_INT32,
+                      &i);
+}
+
+static void
+append_zone_info(DBusMessageIter *dict, int zone_index, concordd_zone_t zone)
+{
+    const char* cstr = NULL;
+    int i = -1;
+    dbus_bool_t b = false;
+
+    cstr = CONCORDD_DBUS_CLASS_NAME_ZONE;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_CLASS_NAME,
+                      DBUS_TYPE_STRING,
+                      &cstr);
+
+	i = zone_index;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_ZONE_ID,
+                      DBUS_TYPE_INT32,
+                      &i);
+
+    cstr = zone->name;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_NAME,
+                      DBUS_TYPE_STRING,
+                      &cstr);
+
+    i = zone->partition_id;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_PARTITION_ID,
+                      DBUS_TYPE_INT32,
+                      &i);
+
+	i = zone->type;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_TYPE,
+                      DBUS_TYPE_INT32,
+                      &i);
+
+	if (zone->last_changed_at != 0) {
+		i = zone->last_changed_at;
+		append_dict_entry(dict,
+						  CONCORDD_DBUS_INFO_LAST_CHANGED_AT,
+						  DBUS_TYPE_INT32,
+						  &i);
+	}
+
+	if (zone->last_tripped_at != 0) {
+		i = zone->last_tripped_at;
+		append_dict_entry(dict,
+						  CONCORDD_DBUS_INFO_LAST_TRIPPED_AT,
+						  DBUS_TYPE_INT32,
+						  &i);
+	}
+
+    i = zone->group;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_GROUP,
+                      DBUS_TYPE_INT32,
+                      &i);
+
+    b = !!(zone->zone_state & GE_RS232_ZONE_STATUS_TRIPPED);
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_IS_TRIPPED,
+                      DBUS_TYPE_BOOLEAN,
+                      &b);
+
+    b = !!(zone->zone_state & GE_RS232_ZONE_STATUS_BYPASSED);
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_IS_BYPASSED,
+                      DBUS_TYPE_BOOLEAN,
+                      &b);
+
+    b = !!(zone->zone_state & GE_RS232_ZONE_STATUS_TROUBLE);
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_IS_TROUBLE,
+                      DBUS_TYPE_BOOLEAN,
+                      &b);
+
+    b = !!(zone->zone_state & GE_RS232_ZONE_STATUS_ALARM);
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_IS_ALARM,
+                      DBUS_TYPE_BOOLEAN,
+                      &b);
+
+    b = !!(zone->zone_state & GE_RS232_ZONE_STATUS_FAULT);
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_INFO_IS_FAULT,
+                      DBUS_TYPE_BOOLEAN,
+                      &b);
+
+	i = zone->last_kc;
+	append_dict_entry(dict,
+					  CONCORDD_DBUS_INFO_LAST_KC,
+					  DBUS_TYPE_INT32,
+					  &i);
+
+	i = (int32_t)zone->last_kc_changed_at;
+	append_dict_entry(dict,
+					  CONCORDD_DBUS_INFO_LAST_KC_CHANGED_AT,
+					  DBUS_TYPE_INT32,
+					  &i);
+}
+
+// Version 2 of the interface carries the same state as the
+// dictionaries above, as fixed-signature structs. See
+// `CONCORDD_DBUS_INTERFACE_V2` for the layout of each.
+
+static void
+append_v2_partition(DBusMessageIter *iter, int partition_index, concordd_partition_t partition)
+{
+    DBusMessageIter s;
+    const char* cstr = NULL;
+    dbus_int32_t i;
+    dbus_uint32_t u;
+    dbus_int64_t x;
+
+    dbus_message_iter_open_container(iter, DBUS_TYPE_STRUCT, NULL, &s);
+
+    i = partition_index;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_INT32, &i);
+
+    i = partition->arm_level;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_INT32, &i);
+
+    u = partition->arm_level_user;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_UINT32, &u);
+
+    // The feature bits line up with `GE_RS232_FEATURE_STATE_*`.
+    u = partition->feature_state & 0x3F;
+    if (partition->programming_mode) {
+        u |= CONCORDD_DBUS_V2_PARTITION_PROGRAMMING_MODE;
+    }
+    if (partition->entry_delay_active) {
+        u |= CONCORDD_DBUS_V2_PARTITION_ENTRY_DELAY;
+    }
+    if (partition->exit_delay_active) {
+        u |= CONCORDD_DBUS_V2_PARTITION_EXIT_DELAY;
+    }
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_UINT32, &u);
+
+    cstr = partition->touchpad_text;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_STRING, &cstr);
+
+    u = partition->siren_repeat;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_UINT32, &u);
+
+    u = partition->siren_cadence;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_UINT32, &u);
+
+    x = partition->siren_started_at;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_INT64, &x);
+
+    x = partition->arm_level_timestamp;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_INT64, &x);
+
+    dbus_message_iter_close_container(iter, &s);
+}
+
+static void
+append_v2_light(DBusMessageIter *iter, int partition_index, int light_index, concordd_light_t light)
+{
+    DBusMessageIter s;
+    dbus_int32_t i;
+    dbus_uint32_t u;
+    dbus_int64_t x;
+
+    dbus_message_iter_open_container(iter, DBUS_TYPE_STRUCT, NULL, &s);
+
+    i = partition_index;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_INT32, &i);
+
+    i = light_index;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_INT32, &i);
+
+    i = light->zone_id;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_INT32, &i);
+
+    u = light->light_state ? CONCORDD_DBUS_V2_LIGHT_ON : 0;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_UINT32, &u);
+
+    x = light->last_changed_at;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_INT64, &x);
+
+    dbus_message_iter_close_container(iter, &s);
+}
+
+static void
+append_v2_zone(DBusMessageIter *iter, int zone_index, concordd_zone_t zone)
+{
+    DBusMessageIter s;
+    const char* cstr = NULL;
+    dbus_int32_t i;
+    dbus_uint32_t u;
+    dbus_int64_t x;
+
+    dbus_message_iter_open_container(iter, DBUS_TYPE_STRUCT, NULL, &s);
+
+    i = zone_index;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_INT32, &i);
+
+    i = zone->partition_id;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_INT32, &i);
+
+    i = zone->type;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_INT32, &i);
+
+    i = zone->group;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_INT32, &i);
+
+    // The flags line up with `GE_RS232_ZONE_STATUS_*`.
+    u = zone->zone_state & 0x1F;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_UINT32, &u);
+
+    cstr = zone->name;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_STRING, &cstr);
+
+    x = zone->last_changed_at;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_INT64, &x);
+
+    x = zone->last_tripped_at;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_INT64, &x);
+
+    i = zone->last_kc;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_INT32, &i);
+
+    x = zone->last_kc_changed_at;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_INT64, &x);
+
+    dbus_message_iter_close_container(iter, &s);
+}
+
+static void
+append_v2_output(DBusMessageIter *iter, int output_index, concordd_output_t output)
+{
+    DBusMessageIter s;
+    const char* cstr = NULL;
+    dbus_int32_t i;
+    dbus_uint32_t u;
+    dbus_int64_t x;
+
+    dbus_message_iter_open_container(iter, DBUS_TYPE_STRUCT, NULL, &s);
+
+    i = output_index;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_INT32, &i);
+
+    i = output->partition_id;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_INT32, &i);
+
+    u = 0;
+    if (output->output_state) {
+        u |= CONCORDD_DBUS_V2_OUTPUT_ON;
+    }
+    if (output->pulse) {
+        u |= CONCORDD_DBUS_V2_OUTPUT_PULSE;
+    }
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_UINT32, &u);
+
+    cstr = output->name;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_STRING, &cstr);
+
+    u = output->last_changed_by;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_UINT32, &u);
+
+    x = output->last_changed_at;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_INT64, &x);
+
+    dbus_message_iter_close_container(iter, &s);
+}
+
+static void
+append_v2_event(DBusMessageIter *iter, concordd_event_t event)
+{
+    DBusMessageIter s;
+    uint8_t y;
+    dbus_uint16_t q;
+    dbus_uint32_t u;
+    dbus_int64_t x;
+
+    dbus_message_iter_open_container(iter, DBUS_TYPE_STRUCT, NULL, &s);
+
+    u = event->seq;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_UINT32, &u);
+
+    y = event->status;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_BYTE, &y);
+
+    y = event->partition_id;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_BYTE, &y);
+
+    y = event->source_type;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_BYTE, &y);
+
+    q = event->zone_id;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_UINT16, &q);
+
+    u = event->device_id;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_UINT32, &u);
+
+    y = event->general_type;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_BYTE, &y);
+
+    y = event->specific_type;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_BYTE, &y);
+
+    q = event->extra_data;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_UINT16, &q);
+
+    x = event->timestamp;
+    dbus_message_iter_append_basic(&s, DBUS_TYPE_INT64, &x);
+
+    dbus_message_iter_close_container(iter, &s);
+}
+
+// Appends the v2 struct for `object`. Returns false, without
+// appending anything, for objects `get_info` wouldn't answer for.
+static bool
+append_v2_object(DBusMessageIter *iter, concordd_dbus_server_t self, const struct concordd_dbus_object_s* object)
+{
+    switch (object->type) {
+    case CONCORDD_DBUS_OBJECT_PARTITION:
+        {
+            concordd_partition_t partition = concordd_get_partition(self->instance, object->partition_index);
+            if (partition == NULL) {
+                return false;
+            }
+            append_v2_partition(iter, object->partition_index, partition);
+        }
+        return true;
+
+    case CONCORDD_DBUS_OBJECT_LIGHT:
+        {
+            concordd_partition_t partition = concordd_get_partition(self->instance, object->partition_index);
+            concordd_light_t light = (partition != NULL) ? concordd_partition_get_light(partition, object->index) : NULL;
+            if (light == NULL) {
+                return false;
+            }
+            append_v2_light(iter, object->partition_index, object->index, light);
+        }
+        return true;
+
+    case CONCORDD_DBUS_OBJECT_ZONE:
+        {
+            concordd_zone_t zone = concordd_get_zone(self->instance, object->index);
+            if (zone == NULL || !zone->active) {
+                return false;
+            }
+            append_v2_zone(iter, object->index, zone);
+        }
+        return true;
+
+    case CONCORDD_DBUS_OBJECT_OUTPUT:
+        {
+            concordd_output_t output = concordd_get_output(self->instance, object->index);
+            if (output == NULL || !output->active) {
+                return false;
+            }
+            append_v2_output(iter, object->index, output);
+        }
+        return true;
+    }
+
+    return false;
+}
+
+static void
+concordd_dbus_object_path(const struct concordd_dbus_object_s* object, char* path, size_t size)
+{
+    switch (object->type) {
+    case CONCORDD_DBUS_OBJECT_PARTITION:
+        snprintf(path, size, "%s%d", CONCORDD_DBUS_PATH_PARTITION, object->partition_index);
+        break;
+
+    case CONCORDD_DBUS_OBJECT_LIGHT:
+        snprintf(path, size, "%s%d%s%d", CONCORDD_DBUS_PATH_PARTITION, object->partition_index, "/light/", object->index);
+        break;
+
+    case CONCORDD_DBUS_OBJECT_ZONE:
+        snprintf(path, size, "%s%d", CONCORDD_DBUS_PATH_ZONE, object->index);
+        break;
+
+    case CONCORDD_DBUS_OBJECT_OUTPUT:
+        snprintf(path, size, "%s%d", CONCORDD_DBUS_PATH_OUTPUT, object->index);
+        break;
+
+    default:
+    case CONCORDD_DBUS_OBJECT_SYSTEM:
+        snprintf(path, size, "%s", CONCORDD_DBUS_PATH_ROOT);
+        break;
+    }
+}
+
+static bool
+snapshot_entry_open(DBusMessageIter *array, DBusMessageIter *entry, DBusMessageIter *dict, const char* path)
+{
+    if (!dbus_message_iter_open_container(array, DBUS_TYPE_DICT_ENTRY, NULL, entry)) {
+        return false;
+    }
+
+    dbus_message_iter_append_basic(entry, DBUS_TYPE_STRING, &path);
+
+    return dbus_message_iter_open_container(
+        entry,
+        DBUS_TYPE_ARRAY,
+        DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+        DBUS_TYPE_STRING_AS_STRING
+        DBUS_TYPE_VARIANT_AS_STRING
+        DBUS_DICT_ENTRY_END_CHAR_AS_STRING,
+        dict
+    );
+}
+
+static void
+snapshot_entry_close(DBusMessageIter *array, DBusMessageIter *entry, DBusMessageIter *dict)
+{
+    dbus_message_iter_close_container(entry, dict);
+    dbus_message_iter_close_container(array, entry);
+}
+
+/* Returns the info dictionary of every active object in a single
+ * reply, keyed by object path (a{sa{sv}}). This lets clients populate
+ * a full view with one round trip instead of one get_info per object.
+ */
+static DBusHandlerResult
+concordd_dbus_handle_system_get_snapshot(
+    concordd_dbus_server_t self,
+    struct concordd_dbus_object_s* object,
+    DBusConnection *connection,
+    DBusMessage *   message
+) {
+    DBusHandlerResult ret = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    DBusMessage *reply = dbus_message_new_method_return(message);
+    DBusMessageIter iter, array_iter, entry, dict;
+    char path_buffer[128];
+    int i, j;
+
+    syslog(LOG_DEBUG, "Sending DBus response for \"%s\" to \"%s\"", dbus_message_get_member(message), dbus_message_get_sender(message));
+
+    if (!reply) {
+        goto bail;
+    }
+
+    dbus_message_iter_init_append(reply, &iter);
+
+    if (!dbus_message_iter_open_container(
+        &iter,
+        DBUS_TYPE_ARRAY,
+        DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+        DBUS_TYPE_STRING_AS_STRING
+        DBUS_TYPE_ARRAY_AS_STRING
+        DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+        DBUS_TYPE_STRING_AS_STRING
+        DBUS_TYPE_VARIANT_AS_STRING
+        DBUS_DICT_ENTRY_END_CHAR_AS_STRING
+        DBUS_DICT_ENTRY_END_CHAR_AS_STRING,
+        &array_iter
+    )) {
+        goto bail;
+    }
+
+    if (snapshot_entry_open(&array_iter, &entry, &dict, CONCORDD_DBUS_PATH_ROOT)) {
+        append_system_info(&dict, self->instance);
+        snapshot_entry_close(&array_iter, &entry, &dict);
+    }
+
+    for (i = 0; i < CONCORDD_MAX_PARTITIONS; i++) {
+        concordd_partition_t partition = concordd_get_partition(self->instance, i);
+        if (partition == NULL || partition->active == false) {
+            continue;
+        }
+
+        snprintf(path_buffer, sizeof(path_buffer), "%s%d", CONCORDD_DBUS_PATH_PARTITION, i);
+        if (snapshot_entry_open(&array_iter, &entry, &dict, path_buffer)) {
+            append_partition_info(&dict, partition);
+            snapshot_entry_close(&array_iter, &entry, &dict);
+        }
+
+        for (j = 0; j < sizeof(partition->light)/sizeof(*partition->light); j++) {
+            concordd_light_t light = concordd_partition_get_light(partition, j);
+            if (light == NULL) {
+                continue;
+            }
+            snprintf(path_buffer, sizeof(path_buffer), "%s%d%s%d", CONCORDD_DBUS_PATH_PARTITION, i, "/light/", j);
+            if (snapshot_entry_open(&array_iter, &entry, &dict, path_buffer)) {
+                append_light_info(&dict, i, j, light);
+                snapshot_entry_close(&array_iter, &entry, &dict);
+            }
+        }
+    }
+
+    for (i = 0; i < CONCORDD_MAX_ZONES; i++) {
+        concordd_zone_t zone = concordd_get_zone(self->instance, i);
+        if (zone == NULL || zone->active == false) {
+            continue;
+        }
+        snprintf(path_buffer, sizeof(path_buffer), "%s%d", CONCORDD_DBUS_PATH_ZONE, i);
+        if (snapshot_entry_open(&array_iter, &entry, &dict, path_buffer)) {
+            append_zone_info(&dict, i, zone);
+            snapshot_entry_close(&array_iter, &entry, &dict);
+        }
+    }
+
+    for (i = 0; i < sizeof(self->instance->output)/sizeof(*self->instance->output); i++) {
+        concordd_output_t output = concordd_get_output(self->instance, i);
+        if (output == NULL || output->active == false) {
+            continue;
+        }
+        snprintf(path_buffer, sizeof(path_buffer), "%s%d", CONCORDD_DBUS_PATH_OUTPUT, i);
+        if (snapshot_entry_open(&array_iter, &entry, &dict, path_buffer)) {
+            append_output_info(&dict, i, output);
+            snapshot_entry_close(&array_iter, &entry, &dict);
+        }
+    }
+
+    dbus_message_iter_close_container(&iter, &array_iter);
+
+    dbus_connection_send(self->dbus_connection, reply, NULL);
+
+    ret = DBUS_HANDLER_RESULT_HANDLED;
+bail:
+    if (reply) {
+        dbus_message_unref(reply);
+    }
+    return ret;
+}
+
+static DBusHandlerResult
+concordd_dbus_handle_v2_get_info(
+    concordd_dbus_server_t self,
+    struct concordd_dbus_object_s* object,
+    DBusConnection *connection,
+    DBusMessage *   message
+) {
+    DBusHandlerResult ret = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    DBusMessage *reply = dbus_message_new_method_return(message);
+    DBusMessageIter iter;
+
+    if (!reply) {
+        goto bail;
+    }
+
+    dbus_message_iter_init_append(reply, &iter);
+
+    if (!append_v2_object(&iter, self, object)) {
+        goto bail;
+    }
+
+    syslog(LOG_DEBUG, "Sending DBus response for \"%s\" to \"%s\"", dbus_message_get_member(message), dbus_message_get_sender(message));
+
+    dbus_connection_send(self->dbus_connection, reply, NULL);
+
+    ret = DBUS_HANDLER_RESULT_HANDLED;
+bail:
+    if (reply) {
+        dbus_message_unref(reply);
+    }
+    return ret;
+}
+
+static void
+append_v2_zones(DBusMessageIter *iter, concordd_instance_t instance, int partition_index)
+{
+    DBusMessageIter array_iter;
+    int i;
+
+    dbus_message_iter_open_container(iter, DBUS_TYPE_ARRAY, CONCORDD_DBUS_V2_ZONE_SIGNATURE, &array_iter);
+
+    for (i = 0; i < CONCORDD_MAX_ZONES; i++) {
+        concordd_zone_t zone = concordd_get_zone(instance, i);
+        if (zone == NULL || zone->active == false) {
+            continue;
+        }
+        if (partition_index >= 0 && zone->partition_id != partition_index) {
+            continue;
+        }
+        append_v2_zone(&array_iter, i, zone);
+    }
+
+    dbus_message_iter_close_container(iter, &array_iter);
+}
+
+static DBusHandlerResult
+concordd_dbus_handle_v2_get_zones(
+    concordd_dbus_server_t self,
+    struct concordd_dbus_object_s* object,
+    DBusConnection *connection,
+    DBusMessage *   message
+) {
+    DBusMessage *reply = dbus_message_new_method_return(message);
+    DBusMessageIter iter;
+
+    if (!reply) {
+        return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    }
+
+    dbus_message_iter_init_append(reply, &iter);
+
+    append_v2_zones(&iter, self->instance, object->partition_index);
+
+    dbus_connection_send(connection, reply, NULL);
+
+    dbus_message_unref(reply);
+
+    return DBUS_HANDLER_RESULT_HANDLED;
+}
+
+/* Returns the state of every active object as four arrays of
+ * structs: partitions, lights, zones and outputs.
+ */
+static DBusHandlerResult
+concordd_dbus_handle_v2_system_get_snapshot(
+    concordd_dbus_server_t self,
+    struct concordd_dbus_object_s* object,
+    DBusConnection *connection,
+    DBusMessage *   message
+) {
+    DBusMessage *reply = dbus_message_new_method_return(message);
+    DBusMessageIter iter, array_iter;
+    int i, j;
+
+    syslog(LOG_DEBUG, "Sending DBus response for \"%s\" to \"%s\"", dbus_message_get_member(message), dbus_message_get_sender(message));
+
+    if (!reply) {
+        return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    }
+
+    dbus_message_iter_init_append(reply, &iter);
+
+    dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, CONCORDD_DBUS_V2_PARTITION_SIGNATURE, &array_iter);
+    for (i = 0; i < CONCORDD_MAX_PARTITIONS; i++) {
+        concordd_partition_t partition = concordd_get_partition(self->instance, i);
+        if (partition == NULL || partition->active == false) {
+            continue;
+        }
+        append_v2_partition(&array_iter, i, partition);
+    }
+    dbus_message_iter_close_container(&iter, &array_iter);
+
+    dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, CONCORDD_DBUS_V2_LIGHT_SIGNATURE, &array_iter);
+    for (i = 0; i < CONCORDD_MAX_PARTITIONS; i++) {
+        concordd_partition_t partition = concordd_get_partition(self->instance, i);
+        if (partition == NULL || partition->active == false) {
+            continue;
+        }
+        for (j = 0; j < CONCORDD_MAX_LIGHTS; j++) {
+            concordd_light_t light = concordd_partition_get_light(partition, j);
+            if (light == NULL) {
+                continue;
+            }
+            append_v2_light(&array_iter, i, j, light);
+        }
+    }
+    dbus_message_iter_close_container(&iter, &array_iter);
+
+    append_v2_zones(&iter, self->instance, -1);
+
+    dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, CONCORDD_DBUS_V2_OUTPUT_SIGNATURE, &array_iter);
+    for (i = 0; i < CONCORDD_MAX_OUTPUTS; i++) {
+        concordd_output_t output = concordd_get_output(self->instance, i);
+        if (output == NULL || output->active == false) {
+            continue;
+        }
+        append_v2_output(&array_iter, i, output);
+    }
+    dbus_message_iter_close_container(&iter, &array_iter);
+
+    dbus_connection_send(self->dbus_connection, reply, NULL);
+
+    dbus_message_unref(reply);
+
+    return DBUS_HANDLER_RESULT_HANDLED;
+}
+
+static struct concordd_dbus_object_s*
+concordd_dbus_change_object(concordd_dbus_server_t self, const struct concordd_change_s* change)
+{
+    switch (change->object_type) {
+    case CONCORDD_CHANGE_OBJECT_SYSTEM:
+        return &self->system_object;
+
+    case CONCORDD_CHANGE_OBJECT_PARTITION:
+        if (change->index < CONCORDD_MAX_PARTITIONS) {
+            return &self->partition_object[change->index];
+        }
+        break;
+
+    case CONCORDD_CHANGE_OBJECT_LIGHT:
+        if ((change->partition_id < CONCORDD_MAX_PARTITIONS) && (change->index < CONCORDD_MAX_LIGHTS)) {
+            return &self->light_object[change->partition_id][change->index];
+        }
+        break;
+
+    case CONCORDD_CHANGE_OBJECT_ZONE:
+        if (change->index < CONCORDD_MAX_ZONES) {
+            return &self->zone_object[change->index];
+        }
+        break;
+
+    case CONCORDD_CHANGE_OBJECT_OUTPUT:
+        if (change->index < CONCORDD_MAX_OUTPUTS) {
+            return &self->output_object[change->index];
+        }
+        break;
+    }
+
+    return NULL;
+}
+
+// Appends the v1 info dictionary for `object` to `dict`, the same
+// as `get_info` would return. Returns false for objects `get_info`
+// wouldn't answer for.
+static bool
+append_object_info(DBusMessageIter *dict, concordd_dbus_server_t self, const struct concordd_dbus_object_s* object)
+{
+    switch (object->type) {
+    case CONCORDD_DBUS_OBJECT_SYSTEM:
+        append_system_info(dict, self->instance);
+        return true;
+
+    case CONCORDD_DBUS_OBJECT_PARTITION:
+        {
+            concordd_partition_t partition = concordd_get_partition(self->instance, object->partition_index);
+            if (partition == NULL) {
+                return false;
+            }
+            append_partition_info(dict, partition);
+        }
+        return true;
+
+    case CONCORDD_DBUS_OBJECT_LIGHT:
+        {
+            concordd_partition_t partition = concordd_get_partition(self->instance, object->partition_index);
+            concordd_light_t light = (partition != NULL) ? concordd_partition_get_light(partition, object->index) : NULL;
+            if (light == NULL) {
+                return false;
+            }
+            append_light_info(dict, object->partition_index, object->index, light);
+        }
+        return true;
+
+    case CONCORDD_DBUS_OBJECT_ZONE:
+        {
+            concordd_zone_t zone = concordd_get_zone(self->instance, object->index);
+            if (zone == NULL || !zone->active) {
+                return false;
+            }
+            append_zone_info(dict, object->index, zone);
+        }
+        return true;
+
+    case CONCORDD_DBUS_OBJECT_OUTPUT:
+        {
+            concordd_output_t output = concordd_get_output(self->instance, object->index);
+            if (output == NULL || !output->active) {
+                return false;
+            }
+            append_output_info(dict, object->index, output);
+        }
+        return true;
+    }
+
+    return false;
+}
+
+static void
+get_optional_arg(DBusMessageIter *iter, int type, void *value)
+{
+    if (dbus_message_iter_get_arg_type(iter) == type) {
+        dbus_message_iter_get_basic(iter, value);
+        dbus_message_iter_next(iter);
+    }
+}
+
+// Common to both versions of `get_changes_since`: appends the
+// sequence number, epoch and resync flag to `reply`. Fills `objects`
+// with each object that changed, once, and returns how many there
+// are, or -1 if a resync is required.
+static int
+concordd_dbus_get_changes_since(
+    concordd_dbus_server_t self,
+    DBusMessage *message,
+    DBusMessage *reply,
+    DBusMessageIter *iter,
+    struct concordd_dbus_object_s** objects
+) {
+    struct concordd_change_s changes[CONCORDD_CHANGE_JOURNAL_MAX];
+    DBusMessageIter args;
+    dbus_uint32_t seq = 0;
+    dbus_uint32_t epoch = 0;
+    dbus_uint32_t change_seq = self->instance->change_seq;
+    dbus_uint32_t change_epoch = self->instance->change_epoch;
+    dbus_bool_t resync;
+    int count, ret = 0;
+    int i, j;
+
+    if (dbus_message_iter_init(message, &args)) {
+        get_optional_arg(&args, DBUS_TYPE_UINT32, &seq);
+        get_optional_arg(&args, DBUS_TYPE_UINT32, &epoch);
+    }
+
+    count = concordd_get_changes_since(self->instance, epoch, seq, changes);
+    resync = (count < 0);
+
+    // Different changes can land on the same object, such as a
+    // system change that is reported on each partition.
+    for (i = 0; i < count; i++) {
+        struct concordd_dbus_object_s* changed_object = concordd_dbus_change_object(self, &changes[i]);
+
+        if (changed_object == NULL) {
+            continue;
+        }
+
+        for (j = 0; j < ret; j++) {
+            if (objects[j] == changed_object) {
+                break;
+            }
+        }
+
+        if (j == ret) {
+            objects[ret++] = changed_object;
+        }
+    }
+
+    syslog(LOG_DEBUG, "Sending DBus response for \"%s\" to \"%s\", %u..%u: %d changes", dbus_message_get_member(message), dbus_message_get_sender(message), seq, change_seq, resync ? -1 : ret);
+
+    dbus_message_iter_init_append(reply, iter);
+    dbus_message_iter_append_basic(iter, DBUS_TYPE_UINT32, &change_seq);
+    dbus_message_iter_append_basic(iter, DBUS_TYPE_UINT32, &change_epoch);
+    dbus_message_iter_append_basic(iter, DBUS_TYPE_BOOLEAN, &resync);
+
+    return resync ? -1 : ret;
+}
+
+static DBusHandlerResult
+concordd_dbus_handle_system_get_changes_since(
+    concordd_dbus_server_t self,
+    struct concordd_dbus_object_s* object,
+    DBusConnection *connection,
+    DBusMessage *   message
+) {
+    DBusHandlerResult ret = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    DBusMessage *reply = dbus_message_new_method_return(message);
+    DBusMessageIter iter, array_iter, entry, dict;
+    struct concordd_dbus_object_s* objects[CONCORDD_CHANGE_JOURNAL_MAX];
+    char path_buffer[128];
+    int count, i;
+
+    if (!reply) {
+        goto bail;
+    }
+
+    count = concordd_dbus_get_changes_since(self, message, reply, &iter, objects);
+
+    if (!dbus_message_iter_open_container(
+        &iter,
+        DBUS_TYPE_ARRAY,
+        DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+        DBUS_TYPE_STRING_AS_STRING
+        DBUS_TYPE_ARRAY_AS_STRING
+        DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+        DBUS_TYPE_STRING_AS_STRING
+        DBUS_TYPE_VARIANT_AS_STRING
+        DBUS_DICT_ENTRY_END_CHAR_AS_STRING
+        DBUS_DICT_ENTRY_END_CHAR_AS_STRING,
+        &array_iter
+    )) {
+        goto bail;
+    }
+
+    for (i = 0; i < count; i++) {
+        concordd_dbus_object_path(objects[i], path_buffer, sizeof(path_buffer));
+        if (snapshot_entry_open(&array_iter, &entry, &dict, path_buffer)) {
+            append_object_info(&dict, self, objects[i]);
+            snapshot_entry_close(&array_iter, &entry, &dict);
+        }
+    }
+
+    dbus_message_iter_close_container(&iter, &array_iter);
+
+    dbus_connection_send(self->dbus_connection, reply, NULL);
+
+    ret = DBUS_HANDLER_RESULT_HANDLED;
+bail:
+    if (reply) {
+        dbus_message_unref(reply);
+    }
+    return ret;
+}
+
+static DBusHandlerResult
+concordd_dbus_handle_v2_system_get_changes_since(
+    concordd_dbus_server_t self,
+    struct concordd_dbus_object_s* object,
+    DBusConnection *connection,
+    DBusMessage *   message
+) {
+    static const struct {
+        uint8_t type;
+        const char* signature;
+    } arrays[] = {
+        { CONCORDD_DBUS_OBJECT_PARTITION, CONCORDD_DBUS_V2_PARTITION_SIGNATURE },
+        { CONCORDD_DBUS_OBJECT_LIGHT, CONCORDD_DBUS_V2_LIGHT_SIGNATURE },
+        { CONCORDD_DBUS_OBJECT_ZONE, CONCORDD_DBUS_V2_ZONE_SIGNATURE },
+        { CONCORDD_DBUS_OBJECT_OUTPUT, CONCORDD_DBUS_V2_OUTPUT_SIGNATURE },
+    };
+    DBusHandlerResult ret = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    DBusMessage *reply = dbus_message_new_method_return(message);
+    DBusMessageIter iter, array_iter;
+    struct concordd_dbus_object_s* objects[CONCORDD_CHANGE_JOURNAL_MAX];
+    int count, i, j;
+
+    if (!reply) {
+        goto bail;
+    }
+
+    count = concordd_dbus_get_changes_since(self, message, reply, &iter, objects);
+
+    for (j = 0; j < sizeof(arrays)/sizeof(*arrays); j++) {
+        dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, arrays[j].signature, &array_iter);
+
+        for (i = 0; i < count; i++) {
+            if (objects[i]->type == arrays[j].type) {
+                append_v2_object(&array_iter, self, objects[i]);
+            }
+        }
+
+        dbus_message_iter_close_container(&iter, &array_iter);
+    }
+
+    dbus_connection_send(self->dbus_connection, reply, NULL);
+
+    ret = DBUS_HANDLER_RESULT_HANDLED;
 bail:
+    if (reply) {
+        dbus_message_unref(reply);
+    }
+    return ret;
+}
+
+// Whether `object` has a `get_info` reply that is still current.
+// Nothing is cached while a refresh is in progress, since the
+// equipment list updates things without reporting each change.
+static bool
+concordd_dbus_info_is_cached(concordd_dbus_server_t self, const struct concordd_dbus_object_s* object)
+{
+    return (object->info_reply != NULL)
+        && (object->info_generation == object->generation)
+        && (object->info_refresh_count == self->instance->refresh_count)
+        && !self->instance->refresh_pending;
+}
+
+// Answers `message` with a copy of the cached `get_info` reply
+// for `object`. Returns false if there isn't a current one, in
+// which case the reply has to be built from scratch.
+static bool
+concordd_dbus_send_cached_info(
+    concordd_dbus_server_t self,
+    struct concordd_dbus_object_s* object,
+    DBusMessage *message
+) {
+    DBusMessage *reply;
+
+    if (!concordd_dbus_info_is_cached(self, object)) {
+        return false;
+    }
+
+    // The copy comes without a serial, and only needs to be
+    // addressed to whoever is asking this time.
+    reply = dbus_message_copy(object->info_reply);
+
+    if (reply == NULL) {
+        return false;
+    }
+
+    if ( !dbus_message_set_reply_serial(reply, dbus_message_get_serial(message))
+      || !dbus_message_set_destination(reply, dbus_message_get_sender(message))
+    ) {
+        dbus_message_unref(reply);
+        return false;
+    }
+
+    dbus_connection_send(self->dbus_connection, reply, NULL);
     dbus_message_unref(reply);
+
+    return true;
+}
+
+// Hangs on to `reply` so that later `get_info` calls on `object`
+// can be answered with a copy of it.
+static void
+concordd_dbus_cache_info(
+    concordd_dbus_server_t self,
+    struct concordd_dbus_object_s* object,
+    DBusMessage *reply
+) {
+    if (object->info_reply != NULL) {
+        dbus_message_unref(object->info_reply);
+        object->info_reply = NULL;
+    }
+
+    if (self->instance->refresh_pending) {
+        return;
+    }
+
+    object->info_reply = dbus_message_ref(reply);
+    object->info_generation = object->generation;
+    object->info_refresh_count = self->instance->refresh_count;
+}
+
+static DBusHandlerResult
+concordd_dbus_handle_partition_get_info(
+    concordd_dbus_server_t self,
+    struct concordd_dbus_object_s* object,
+    DBusConnection *connection,
+    DBusMessage *   message
+) {
+    DBusHandlerResult ret = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    int partition_index = object->partition_index;
+    concordd_partition_t partition = concordd_get_partition(self->instance, partition_index);
+    DBusMessage *reply = NULL;
+    ge_rs232_status_t status;
+
+    if (partition_index < 0 || partition == NULL) {
+        goto bail;
+    }
+
+    syslog(LOG_DEBUG, "Sending DBus response for \"%s\" to \"%s\"", dbus_message_get_member(message), dbus_message_get_sender(message));
+
+    if (concordd_dbus_send_cached_info(self, object, message)) {
+        ret = DBUS_HANDLER_RESULT_HANDLED;
+        goto bail;
+    }
+
+    reply = dbus_message_new_method_return(message);
+
+    if (!reply) {
+        goto bail;
+    }
+
+    DBusMessageIter iter;
+    DBusMessageIter dict;
+    dbus_message_iter_init_append(reply, &iter);
+
+    if (!dbus_message_iter_open_container(
+        &iter,
+        DBUS_TYPE_ARRAY,
+        DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+        DBUS_TYPE_STRING_AS_STRING
+        DBUS_TYPE_VARIANT_AS_STRING
+        DBUS_DICT_ENTRY_END_CHAR_AS_STRING,
+        &dict
+    )) {
+        goto bail;
+    }
+
+    append_partition_info(&dict, partition);
+
+    dbus_message_iter_close_container(&iter, &dict);
+
+    dbus_connection_send(self->dbus_connection, reply, NULL);
+
+    concordd_dbus_cache_info(self, object, reply);
+
+    ret = DBUS_HANDLER_RESULT_HANDLED;
+bail:
+    if (reply) {
+        dbus_message_unref(reply);
+    }
     return ret;
 }
 
 static DBusHandlerResult
 concordd_dbus_handle_system_get_info(
     concordd_dbus_server_t self,
+    struct concordd_dbus_object_s* object,
     DBusConnection *connection,
     DBusMessage *   message
 ) {
     DBusHandlerResult ret = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
-    const char* path = dbus_message_get_path(message);
     DBusMessage *reply = dbus_message_new_method_return(message);
     ge_rs232_status_t status;
 
@@ -634,45 +1863,103 @@ concordd_dbus_handle_system_get_info(
         goto bail;
     }
 
-    const char* cstr = NULL;
-    int i = -1;
-    dbus_bool_t b = false;
+    append_system_info(&dict, self->instance);
 
-    i = self->instance->panel_type;
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_PANEL_TYPE,
-                      DBUS_TYPE_INT32,
-                      &i);
+    if (self->hook_executor != NULL) {
+        int i;
 
-    i = self->instance->hw_rev;
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_HW_REVISION,
-                      DBUS_TYPE_INT32,
-                      &i);
+        i = self->hook_executor->running_count;
+        append_dict_entry(&dict,
+                          CONCORDD_DBUS_INFO_HOOKS_RUNNING,
+                          DBUS_TYPE_INT32,
+                          &i);
 
-    i = self->instance->sw_rev;
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_SW_REVISION,
-                      DBUS_TYPE_INT32,
-                      &i);
+        i = self->hook_executor->queued_count;
+        append_dict_entry(&dict,
+                          CONCORDD_DBUS_INFO_HOOKS_QUEUED,
+                          DBUS_TYPE_INT32,
+                          &i);
 
-    i = self->instance->serial_number;
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_SERIAL_NUMBER,
-                      DBUS_TYPE_INT32,
-                      &i);
+        i = self->hook_executor->dropped_count;
+        append_dict_entry(&dict,
+                          CONCORDD_DBUS_INFO_HOOKS_DROPPED,
+                          DBUS_TYPE_INT32,
+                          &i);
+    }
 
-	b = self->instance->ac_power_failure;
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_AC_POWER_FAILURE,
-                      DBUS_TYPE_BOOLEAN,
-                      &b);
+    {
+        int i;
 
-	i = self->instance->ac_power_failure_changed_timestamp;
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_AC_POWER_FAILURE_CHANGED_TIMESTAMP,
-                      DBUS_TYPE_INT32,
-                      &i);
+        i = self->coalesced_count;
+        append_dict_entry(&dict,
+                          CONCORDD_DBUS_INFO_SIGNALS_COALESCED,
+                          DBUS_TYPE_INT32,
+                          &i);
+
+        i = self->deferred_count;
+        append_dict_entry(&dict,
+                          CONCORDD_DBUS_INFO_SIGNALS_DEFERRED,
+                          DBUS_TYPE_INT32,
+                          &i);
+
+        i = (int)dbus_connection_get_outgoing_size(self->dbus_connection);
+        append_dict_entry(&dict,
+                          CONCORDD_DBUS_INFO_DBUS_OUTGOING,
+                          DBUS_TYPE_INT32,
+                          &i);
+    }
+
+    if (self->tx_buffer != NULL) {
+        int i;
+
+        i = self->tx_buffer->count;
+        append_dict_entry(&dict,
+                          CONCORDD_DBUS_INFO_LINK_TX_QUEUED,
+                          DBUS_TYPE_INT32,
+                          &i);
+
+        i = self->tx_buffer->peak;
+        append_dict_entry(&dict,
+                          CONCORDD_DBUS_INFO_LINK_TX_PEAK,
+                          DBUS_TYPE_INT32,
+                          &i);
+
+        i = self->tx_buffer->stall_count;
+        append_dict_entry(&dict,
+                          CONCORDD_DBUS_INFO_LINK_TX_STALLS,
+                          DBUS_TYPE_INT32,
+                          &i);
+
+        i = self->tx_buffer->high_water_count;
+        append_dict_entry(&dict,
+                          CONCORDD_DBUS_INFO_LINK_TX_HIGH_WATER_HITS,
+                          DBUS_TYPE_INT32,
+                          &i);
+    }
+
+    if (self->ack_latency != NULL) {
+        char histogram[256];
+        const char* cstr = histogram;
+        int i;
+
+        concordd_latency_histogram_format(self->ack_latency, histogram, sizeof(histogram));
+        append_dict_entry(&dict,
+                          CONCORDD_DBUS_INFO_LINK_ACK_LATENCY,
+                          DBUS_TYPE_STRING,
+                          &cstr);
+
+        i = __atomic_load_n(&self->ack_latency->samples, __ATOMIC_RELAXED);
+        append_dict_entry(&dict,
+                          CONCORDD_DBUS_INFO_LINK_ACK_LATENCY_SAMPLES,
+                          DBUS_TYPE_INT32,
+                          &i);
+
+        i = __atomic_load_n(&self->ack_latency->max_usec, __ATOMIC_RELAXED);
+        append_dict_entry(&dict,
+                          CONCORDD_DBUS_INFO_LINK_ACK_LATENCY_MAX,
+                          DBUS_TYPE_INT32,
+                          &i);
+    }
 
     dbus_message_iter_close_container(&iter, &dict);
 
@@ -687,15 +1974,14 @@ bail:
 static DBusHandlerResult
 concordd_dbus_handle_output_get_info(
     concordd_dbus_server_t self,
+    struct concordd_dbus_object_s* object,
     DBusConnection *connection,
     DBusMessage *   message
 ) {
     DBusHandlerResult ret = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
-    const char* path = dbus_message_get_path(message);
-    const int partition_index = concordd_partition_index_from_dbus_path(path, self->instance);
-    const int output_index = concordd_output_index_from_dbus_path(path, self->instance);
-	concordd_output_t output = concordd_output_from_dbus_path(path, self->instance);
-    DBusMessage *reply = dbus_message_new_method_return(message);
+    const int output_index = object->index;
+	concordd_output_t output = concordd_get_output(self->instance, output_index);
+    DBusMessage *reply = NULL;
     ge_rs232_status_t status;
 
     if (output_index < 0 || output == NULL || !output->active) {
@@ -704,6 +1990,13 @@ concordd_dbus_handle_output_get_info(
 
     syslog(LOG_DEBUG, "Sending DBus response for \"%s\" to \"%s\"", dbus_message_get_member(message), dbus_message_get_sender(message));
 
+    if (concordd_dbus_send_cached_info(self, object, message)) {
+        ret = DBUS_HANDLER_RESULT_HANDLED;
+        goto bail;
+    }
+
+    reply = dbus_message_new_method_return(message);
+
     if (!reply) {
         goto bail;
     }
@@ -724,70 +2017,19 @@ concordd_dbus_handle_output_get_info(
         goto bail;
     }
 
-    const char* cstr = NULL;
-    int i = -1;
-    dbus_bool_t b = false;
-
-    cstr = CONCORDD_DBUS_CLASS_NAME_OUTPUT;
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_CLASS_NAME,
-                      DBUS_TYPE_STRING,
-                      &cstr);
-
-	i = output_index;
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_OUTPUT_ID,
-                      DBUS_TYPE_INT32,
-                      &i);
-
-	if (output->encoded_name_len > 0) {
-		cstr = ge_text_to_ascii_one_line(
-			output->encoded_name,
-			output->encoded_name_len
-		);
-		append_dict_entry(&dict,
-						  CONCORDD_DBUS_INFO_NAME,
-						  DBUS_TYPE_STRING,
-						  &cstr);
-	}
-
-    i = output->partition_id;
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_PARTITION_ID,
-                      DBUS_TYPE_INT32,
-                      &i);
-
-	b = output->output_state;
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_VALUE,
-                      DBUS_TYPE_BOOLEAN,
-                      &b);
-
-	b = output->pulse;
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_PULSE,
-                      DBUS_TYPE_BOOLEAN,
-                      &b);
-
-	cstr = ge_user_to_cstr(NULL, output->last_changed_by);
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_LAST_CHANGED_BY,
-                      DBUS_TYPE_STRING,
-                      &cstr);
-
-	i = (int32_t)output->last_changed_at;
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_LAST_CHANGED_AT,
-                      DBUS_TYPE_INT32,
-                      &i);
+    append_output_info(&dict, output_index, output);
 
     dbus_message_iter_close_container(&iter, &dict);
 
     dbus_connection_send(self->dbus_connection, reply, NULL);
 
+    concordd_dbus_cache_info(self, object, reply);
+
     ret = DBUS_HANDLER_RESULT_HANDLED;
 bail:
-    dbus_message_unref(reply);
+    if (reply) {
+        dbus_message_unref(reply);
+    }
     return ret;
 }
 
@@ -795,15 +2037,15 @@ bail:
 static DBusHandlerResult
 concordd_dbus_handle_light_get_info(
     concordd_dbus_server_t self,
+    struct concordd_dbus_object_s* object,
     DBusConnection *connection,
     DBusMessage *   message
 ) {
     DBusHandlerResult ret = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
-    const char* path = dbus_message_get_path(message);
-    const int partition_index = concordd_partition_index_from_dbus_path(path, self->instance);
-    const int light_index = concordd_light_index_from_dbus_path(path, self->instance);
-	concordd_light_t light = concordd_light_from_dbus_path(path, self->instance);
-    DBusMessage *reply = dbus_message_new_method_return(message);
+    const int partition_index = object->partition_index;
+    const int light_index = object->index;
+	concordd_light_t light = concordd_partition_get_light(concordd_get_partition(self->instance, partition_index), light_index);
+    DBusMessage *reply = NULL;
     ge_rs232_status_t status;
 
     if (light_index < 0 || light == NULL) {
@@ -812,6 +2054,13 @@ concordd_dbus_handle_light_get_info(
 
     syslog(LOG_DEBUG, "Sending DBus response for \"%s\" to \"%s\"", dbus_message_get_member(message), dbus_message_get_sender(message));
 
+    if (concordd_dbus_send_cached_info(self, object, message)) {
+        ret = DBUS_HANDLER_RESULT_HANDLED;
+        goto bail;
+    }
+
+    reply = dbus_message_new_method_return(message);
+
     if (!reply) {
         goto bail;
     }
@@ -832,75 +2081,37 @@ concordd_dbus_handle_light_get_info(
         goto bail;
     }
 
-    const char* cstr = NULL;
-    int i = -1;
-    dbus_bool_t b = false;
-
-    cstr = CONCORDD_DBUS_CLASS_NAME_LIGHT;
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_CLASS_NAME,
-                      DBUS_TYPE_STRING,
-                      &cstr);
-
-	i = light_index;
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_LIGHT_ID,
-                      DBUS_TYPE_INT32,
-                      &i);
-
-    i = partition_index;
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_PARTITION_ID,
-                      DBUS_TYPE_INT32,
-                      &i);
-
-	i = light->zone_id;
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_ZONE_ID,
-                      DBUS_TYPE_INT32,
-                      &i);
-
-	b = light->light_state;
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_VALUE,
-                      DBUS_TYPE_BOOLEAN,
-                      &b);
-
-	/*
-	cstr = ge_user_to_cstr(NULL, light->last_changed_by);
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_LAST_CHANGED_BY,
-                      DBUS_TYPE_STRING,
-                      &cstr);
-	*/
-
-	i = (int)light->last_changed_at;
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_LAST_CHANGED_AT,
-                      DBUS_TYPE_INT32,
-                      &i);
+    append_light_info(&dict, partition_index, light_index, light);
 
     dbus_message_iter_close_container(&iter, &dict);
 
     dbus_connection_send(self->dbus_connection, reply, NULL);
 
+    // The first change to a light isn't reported, see
+    // `concordd_handle_subcmd2()`.
+    if (light->last_changed_at != 0) {
+        concordd_dbus_cache_info(self, object, reply);
+    }
+
     ret = DBUS_HANDLER_RESULT_HANDLED;
 bail:
-    dbus_message_unref(reply);
+    if (reply) {
+        dbus_message_unref(reply);
+    }
     return ret;
 }
 
 static DBusHandlerResult
 concordd_dbus_handle_zone_get_info(
     concordd_dbus_server_t self,
+    struct concordd_dbus_object_s* object,
     DBusConnection *connection,
     DBusMessage *   message
 ) {
     DBusHandlerResult ret = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
-    const char* path = dbus_message_get_path(message);
-    const int zone_index = concordd_zone_index_from_dbus_path(path, self->instance);
+    const int zone_index = object->index;
     concordd_zone_t zone = concordd_get_zone(self->instance, zone_index);
-    DBusMessage *reply = dbus_message_new_method_return(message);
+    DBusMessage *reply = NULL;
     ge_rs232_status_t status;
 
     if (zone_index < 0 || zone == NULL || !zone->active) {
@@ -909,6 +2120,13 @@ concordd_dbus_handle_zone_get_info(
 
     syslog(LOG_DEBUG, "Sending DBus response for \"%s\" to \"%s\"", dbus_message_get_member(message), dbus_message_get_sender(message));
 
+    if (concordd_dbus_send_cached_info(self, object, message)) {
+        ret = DBUS_HANDLER_RESULT_HANDLED;
+        goto bail;
+    }
+
+    reply = dbus_message_new_method_return(message);
+
     if (!reply) {
         goto bail;
     }
@@ -929,114 +2147,19 @@ concordd_dbus_handle_zone_get_info(
         goto bail;
     }
 
-    const char* cstr = NULL;
-    int i = -1;
-    dbus_bool_t b = false;
-
-    cstr = CONCORDD_DBUS_CLASS_NAME_ZONE;
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_CLASS_NAME,
-                      DBUS_TYPE_STRING,
-                      &cstr);
-
-	i = zone_index;
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_ZONE_ID,
-                      DBUS_TYPE_INT32,
-                      &i);
-
-    cstr = ge_text_to_ascii_one_line(
-        zone->encoded_name,
-        zone->encoded_name_len
-    );
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_NAME,
-                      DBUS_TYPE_STRING,
-                      &cstr);
-
-    i = zone->partition_id;
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_PARTITION_ID,
-                      DBUS_TYPE_INT32,
-                      &i);
-
-	i = zone->type;
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_TYPE,
-                      DBUS_TYPE_INT32,
-                      &i);
-
-	if (zone->last_changed_at != 0) {
-		i = zone->last_changed_at;
-		append_dict_entry(&dict,
-						  CONCORDD_DBUS_INFO_LAST_CHANGED_AT,
-						  DBUS_TYPE_INT32,
-						  &i);
-	}
-
-	if (zone->last_tripped_at != 0) {
-		i = zone->last_tripped_at;
-		append_dict_entry(&dict,
-						  CONCORDD_DBUS_INFO_LAST_TRIPPED_AT,
-						  DBUS_TYPE_INT32,
-						  &i);
-	}
-
-    i = zone->group;
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_GROUP,
-                      DBUS_TYPE_INT32,
-                      &i);
-
-    b = !!(zone->zone_state & GE_RS232_ZONE_STATUS_TRIPPED);
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_IS_TRIPPED,
-                      DBUS_TYPE_BOOLEAN,
-                      &b);
-
-    b = !!(zone->zone_state & GE_RS232_ZONE_STATUS_BYPASSED);
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_IS_BYPASSED,
-                      DBUS_TYPE_BOOLEAN,
-                      &b);
-
-    b = !!(zone->zone_state & GE_RS232_ZONE_STATUS_TROUBLE);
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_IS_TROUBLE,
-                      DBUS_TYPE_BOOLEAN,
-                      &b);
-
-    b = !!(zone->zone_state & GE_RS232_ZONE_STATUS_ALARM);
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_IS_ALARM,
-                      DBUS_TYPE_BOOLEAN,
-                      &b);
-
-    b = !!(zone->zone_state & GE_RS232_ZONE_STATUS_FAULT);
-    append_dict_entry(&dict,
-                      CONCORDD_DBUS_INFO_IS_FAULT,
-                      DBUS_TYPE_BOOLEAN,
-                      &b);
-
-	i = zone->last_kc;
-	append_dict_entry(&dict,
-					  CONCORDD_DBUS_INFO_LAST_KC,
-					  DBUS_TYPE_INT32,
-					  &i);
-
-	i = (int32_t)zone->last_kc_changed_at;
-	append_dict_entry(&dict,
-					  CONCORDD_DBUS_INFO_LAST_KC_CHANGED_AT,
-					  DBUS_TYPE_INT32,
-					  &i);
+    append_zone_info(&dict, zone_index, zone);
 
     dbus_message_iter_close_container(&iter, &dict);
 
     dbus_connection_send(self->dbus_connection, reply, NULL);
 
+    concordd_dbus_cache_info(self, object, reply);
+
     ret = DBUS_HANDLER_RESULT_HANDLED;
 bail:
-    dbus_message_unref(reply);
+    if (reply) {
+        dbus_message_unref(reply);
+    }
     return ret;
 }
 
@@ -1045,6 +2168,7 @@ append_dict_event(DBusMessageIter *dict, concordd_event_t event)
 {
     const char* cstr = NULL;
     int i = -1;
+    dbus_uint32_t u;
     dbus_bool_t b = false;
 	const char* category = "UNKNOWN";
 	const char* specific_desc = "";
@@ -1157,9 +2281,52 @@ append_dict_event(DBusMessageIter *dict, concordd_event_t event)
                           &i);
     }
 
+    i = (int32_t)event->timestamp;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_EXCEPTION_TIMESTAMP,
+                      DBUS_TYPE_INT32,
+                      &i);
+
+    u = event->seq;
+    append_dict_entry(dict,
+                      CONCORDD_DBUS_EXCEPTION_SEQ,
+                      DBUS_TYPE_UINT32,
+                      &u);
+
     return true;
 }
 
+static void concordd_dbus_flush_changes(concordd_dbus_server_t self);
+
+static void
+concordd_dbus_send_v2_event(concordd_dbus_server_t self, const char* path, const char* name, concordd_event_t event)
+{
+    DBusMessageIter iter;
+    DBusMessage *message;
+
+    if (!self->v2_signals) {
+        return;
+    }
+
+    message = dbus_message_new_signal(
+        path,
+        CONCORDD_DBUS_INTERFACE_V2,
+        name
+    );
+
+    if (message == NULL) {
+        return;
+    }
+
+    dbus_message_iter_init_append(message, &iter);
+
+    append_v2_event(&iter, event);
+
+    dbus_connection_send(self->dbus_connection, message, NULL);
+
+    dbus_message_unref(message);
+}
+
 void
 concordd_dbus_event_func(concordd_dbus_server_t self, concordd_instance_t instance, concordd_event_t event)
 {
@@ -1169,6 +2336,9 @@ concordd_dbus_event_func(concordd_dbus_server_t self, concordd_instance_t instan
     DBusMessageIter dict;
     DBusMessage *message = NULL;
 
+    // Let clients see the changes that led up to the event first.
+    concordd_dbus_flush_changes(self);
+
     switch(event->general_type) {
     case GE_RS232_ALARM_GENERAL_TYPE_SYSTEM_TROUBLE:
     case GE_RS232_ALARM_GENERAL_TYPE_SYSTEM_TROUBLE_RESTORAL:
@@ -1231,6 +2401,8 @@ concordd_dbus_event_func(concordd_dbus_server_t self, concordd_instance_t instan
 
     dbus_connection_send(self->dbus_connection, message, NULL);
 
+    concordd_dbus_send_v2_event(self, path, name, event);
+
 bail:
     if (message != NULL) {
         dbus_message_unref(message);
@@ -1240,6 +2412,7 @@ bail:
 static DBusHandlerResult
 concordd_dbus_handle_partition_get_troubles(
     concordd_dbus_server_t self,
+    struct concordd_dbus_object_s* object,
     DBusConnection *connection,
     DBusMessage *   message
 ) {
@@ -1251,6 +2424,7 @@ concordd_dbus_handle_partition_get_troubles(
 static DBusHandlerResult
 concordd_dbus_handle_partition_get_alarms(
     concordd_dbus_server_t self,
+    struct concordd_dbus_object_s* object,
     DBusConnection *connection,
     DBusMessage *   message
 ) {
@@ -1262,34 +2436,170 @@ concordd_dbus_handle_partition_get_alarms(
 static DBusHandlerResult
 concordd_dbus_handle_system_get_troubles(
     concordd_dbus_server_t self,
+    struct concordd_dbus_object_s* object,
+    DBusConnection *connection,
+    DBusMessage *   message
+) {
+    DBusHandlerResult ret = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+	return ret;
+}
+
+// Common to both versions of `get_event_log`. Fills `events` with
+// what was asked for and `cursor` with the cursor for the next page,
+// and returns the number of events.
+static int
+concordd_dbus_query_event_log(
+    concordd_dbus_server_t self,
+    DBusMessage *message,
+    dbus_uint32_t *cursor,
+    concordd_event_t* events
+) {
+    struct concordd_event_filter_s filter = { -1, -1, -1, 0, 0 };
+    DBusMessageIter iter;
+    dbus_int32_t limit = 0;
+    dbus_int32_t value;
+    int count;
+
+    *cursor = 0;
+
+    if (dbus_message_iter_init(message, &iter)) {
+        get_optional_arg(&iter, DBUS_TYPE_UINT32, cursor);
+        get_optional_arg(&iter, DBUS_TYPE_INT32, &limit);
+        get_optional_arg(&iter, DBUS_TYPE_INT32, &filter.partition_id);
+        get_optional_arg(&iter, DBUS_TYPE_INT32, &filter.zone_id);
+        get_optional_arg(&iter, DBUS_TYPE_INT32, &filter.general_type);
+        value = 0;
+        get_optional_arg(&iter, DBUS_TYPE_INT32, &value);
+        filter.since = value;
+        value = 0;
+        get_optional_arg(&iter, DBUS_TYPE_INT32, &value);
+        filter.until = value;
+    }
+
+    if ((limit == 0) || (limit > CONCORDD_EVENT_LOG_MAX) || (limit < -CONCORDD_EVENT_LOG_MAX)) {
+        limit = (limit < 0) ? -CONCORDD_EVENT_LOG_MAX : CONCORDD_EVENT_LOG_MAX;
+    }
+
+    count = concordd_event_log_query(self->instance, *cursor, (limit < 0), &filter, events, abs(limit));
+
+    if (count > 0) {
+        *cursor = events[count - 1]->seq;
+    }
+
+    syslog(LOG_DEBUG, "Sending DBus response for \"%s\" to \"%s\": %d events", dbus_message_get_member(message), dbus_message_get_sender(message), count);
+
+    return count;
+}
+
+static DBusHandlerResult
+concordd_dbus_handle_system_get_event_log(
+    concordd_dbus_server_t self,
+    struct concordd_dbus_object_s* object,
     DBusConnection *connection,
     DBusMessage *   message
 ) {
     DBusHandlerResult ret = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    DBusMessage *reply = dbus_message_new_method_return(message);
+    DBusMessageIter iter, array_iter, dict;
+    concordd_event_t events[CONCORDD_EVENT_LOG_MAX];
+    dbus_uint32_t cursor;
+    int count, i;
+
+    if (!reply) {
+        goto bail;
+    }
+
+    count = concordd_dbus_query_event_log(self, message, &cursor, events);
+
+    dbus_message_iter_init_append(reply, &iter);
+    dbus_message_iter_append_basic(&iter, DBUS_TYPE_UINT32, &cursor);
+
+    if (!dbus_message_iter_open_container(
+        &iter,
+        DBUS_TYPE_ARRAY,
+        DBUS_TYPE_ARRAY_AS_STRING
+        DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+        DBUS_TYPE_STRING_AS_STRING
+        DBUS_TYPE_VARIANT_AS_STRING
+        DBUS_DICT_ENTRY_END_CHAR_AS_STRING,
+        &array_iter
+    )) {
+        goto bail;
+    }
+
+    for (i = 0; i < count; i++) {
+        if (!dbus_message_iter_open_container(
+            &array_iter,
+            DBUS_TYPE_ARRAY,
+            DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+            DBUS_TYPE_STRING_AS_STRING
+            DBUS_TYPE_VARIANT_AS_STRING
+            DBUS_DICT_ENTRY_END_CHAR_AS_STRING,
+            &dict
+        )) {
+            goto bail;
+        }
+        append_dict_event(&dict, events[i]);
+        dbus_message_iter_close_container(&array_iter, &dict);
+    }
+
+    dbus_message_iter_close_container(&iter, &array_iter);
+
+    dbus_connection_send(self->dbus_connection, reply, NULL);
+
+    ret = DBUS_HANDLER_RESULT_HANDLED;
+bail:
+    if (reply) {
+        dbus_message_unref(reply);
+    }
+    return ret;
+}
+
+static DBusHandlerResult
+concordd_dbus_handle_v2_system_get_event_log(
+    concordd_dbus_server_t self,
+    struct concordd_dbus_object_s* object,
+    DBusConnection *connection,
+    DBusMessage *   message
+) {
+    DBusMessage *reply = dbus_message_new_method_return(message);
+    DBusMessageIter iter, array_iter;
+    concordd_event_t events[CONCORDD_EVENT_LOG_MAX];
+    dbus_uint32_t cursor;
+    int count, i;
+
+    if (!reply) {
+        return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    }
+
+    count = concordd_dbus_query_event_log(self, message, &cursor, events);
+
+    dbus_message_iter_init_append(reply, &iter);
+    dbus_message_iter_append_basic(&iter, DBUS_TYPE_UINT32, &cursor);
+
+    dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, CONCORDD_DBUS_V2_EVENT_SIGNATURE, &array_iter);
+    for (i = 0; i < count; i++) {
+        append_v2_event(&array_iter, events[i]);
+    }
+    dbus_message_iter_close_container(&iter, &array_iter);
 
-	return ret;
-}
+    dbus_connection_send(self->dbus_connection, reply, NULL);
 
-static DBusHandlerResult
-concordd_dbus_handle_system_get_event_log(
-    concordd_dbus_server_t self,
-    DBusConnection *connection,
-    DBusMessage *   message
-) {
-    DBusHandlerResult ret = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    dbus_message_unref(reply);
 
-	return ret;
+    return DBUS_HANDLER_RESULT_HANDLED;
 }
 
 static DBusHandlerResult
 concordd_dbus_handle_zone_set_bypassed(
     concordd_dbus_server_t self,
+    struct concordd_dbus_object_s* object,
     DBusConnection *connection,
     DBusMessage *   message
 ) {
     DBusHandlerResult ret = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
-    const char* path = dbus_message_get_path(message);
-    const int zone_index = concordd_zone_index_from_dbus_path(path, self->instance);
+    const int zone_index = object->index;
     struct concordd_dbus_callback_helper_s* helper;
     int user_index = -1;
     bool state = false;
@@ -1313,6 +2623,7 @@ concordd_dbus_handle_zone_set_bypassed(
         zone_index,
         state,
 		user_index,
+        concordd_dbus_command_deadline(self),
         &concordd_dbus_callback_helper,
         (void*)helper);
 
@@ -1329,8 +2640,8 @@ concordd_dbus_handle_zone_set_bypassed(
 	return ret;
 }
 
-void
-concordd_dbus_system_info_changed_func(concordd_dbus_server_t self, concordd_instance_t instance, int changed)
+static void
+concordd_dbus_send_system_changed(concordd_dbus_server_t self, concordd_instance_t instance, int changed)
 {
     DBusMessageIter iter;
     DBusMessageIter dict;
@@ -1414,8 +2725,8 @@ bail:
     }
 }
 
-void
-concordd_dbus_partition_info_changed_func(concordd_dbus_server_t self, concordd_instance_t instance, concordd_partition_t partition, int changed)
+static void
+concordd_dbus_send_partition_changed(concordd_dbus_server_t self, concordd_instance_t instance, concordd_partition_t partition, int changed)
 {
     char path[120] = {0};
     const char* name = CONCORDD_DBUS_SIGNAL_CHANGED;
@@ -1455,10 +2766,7 @@ concordd_dbus_partition_info_changed_func(concordd_dbus_server_t self, concordd_
     dbus_bool_t b = false;
 
 	if (changed & CONCORDD_PARTITION_TOUCHPAD_TEXT_CHANGED) {
-		cstr = ge_text_to_ascii_one_line(
-			partition->encoded_touchpad_text,
-			partition->encoded_touchpad_text_len
-		);
+		cstr = partition->touchpad_text;
 		append_dict_entry(&dict,
 						  CONCORDD_DBUS_INFO_TOUCHPAD_TEXT,
 						  DBUS_TYPE_STRING,
@@ -1586,6 +2894,8 @@ concordd_dbus_siren_sync_func(concordd_dbus_server_t self, concordd_instance_t i
 {
     DBusMessage *message = NULL;
 
+    concordd_dbus_flush_changes(self);
+
     message = dbus_message_new_signal(
         CONCORDD_DBUS_PATH_ROOT,
         CONCORDD_DBUS_INTERFACE,
@@ -1602,8 +2912,8 @@ bail:
     }
 }
 
-void
-concordd_dbus_zone_info_changed_func(concordd_dbus_server_t self, concordd_instance_t instance, concordd_zone_t zone, int changed)
+static void
+concordd_dbus_send_zone_changed(concordd_dbus_server_t self, concordd_instance_t instance, concordd_zone_t zone, int changed)
 {
     char path[120] = {0};
     const char* name = CONCORDD_DBUS_SIGNAL_CHANGED;
@@ -1651,10 +2961,7 @@ concordd_dbus_zone_info_changed_func(concordd_dbus_server_t self, concordd_insta
 	}
 
 	if (changed & CONCORDD_ZONE_ENCODED_NAME_CHANGED) {
-		cstr = ge_text_to_ascii_one_line(
-			zone->encoded_name,
-			zone->encoded_name_len
-		);
+		cstr = zone->name;
 		append_dict_entry(&dict,
 						  CONCORDD_DBUS_INFO_NAME,
 						  DBUS_TYPE_STRING,
@@ -1751,8 +3058,8 @@ bail:
     }
 }
 
-void
-concordd_dbus_light_info_changed_func(concordd_dbus_server_t self,  concordd_instance_t instance, concordd_partition_t partition, concordd_light_t light, int changed)
+static void
+concordd_dbus_send_light_changed(concordd_dbus_server_t self,  concordd_instance_t instance, concordd_partition_t partition, concordd_light_t light, int changed)
 {
     char path[120] = {0};
     const char* name = CONCORDD_DBUS_SIGNAL_CHANGED;
@@ -1834,8 +3141,8 @@ bail:
     }
 }
 
-void
-concordd_dbus_output_info_changed_func(concordd_dbus_server_t self, concordd_instance_t instance, concordd_output_t output, int changed)
+static void
+concordd_dbus_send_output_changed(concordd_dbus_server_t self, concordd_instance_t instance, concordd_output_t output, int changed)
 {
     char path[120] = {0};
     const char* name = CONCORDD_DBUS_SIGNAL_CHANGED;
@@ -1900,10 +3207,7 @@ concordd_dbus_output_info_changed_func(concordd_dbus_server_t self, concordd_ins
 
 
 	if (changed & CONCORDD_OUTPUT_ENCODED_NAME_CHANGED) {
-		cstr = ge_text_to_ascii_one_line(
-			output->encoded_name,
-			output->encoded_name_len
-		);
+		cstr = output->name;
 		append_dict_entry(&dict,
 						  CONCORDD_DBUS_INFO_NAME,
 						  DBUS_TYPE_STRING,
@@ -1928,124 +3232,536 @@ bail:
     }
 }
 
-static DBusHandlerResult
-dbus_message_handler(
-    DBusConnection *connection,
-    DBusMessage *   message,
-    void *                  user_data
-    )
+// Sends the v2 `changed` signal for `object`, which carries all of
+// its state rather than just what changed.
+static void
+concordd_dbus_send_v2_changed(concordd_dbus_server_t self, const struct concordd_dbus_object_s* object)
 {
-    //syslog(LOG_NOTICE, "Got DBus Message");
+    char path[128];
+    DBusMessageIter iter;
+    DBusMessage *message = NULL;
 
-    concordd_dbus_server_t self = (concordd_dbus_server_t)user_data;
-    const char* path = dbus_message_get_path(message);
+    if (!self->v2_signals) {
+        goto bail;
+    }
 
-    DBusHandlerResult ret = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    concordd_dbus_object_path(object, path, sizeof(path));
 
-    if (dbus_message_is_method_call(message, CONCORDD_DBUS_INTERFACE,
-                                    CONCORDD_DBUS_CMD_GET_PARTITIONS)) {
-        if (concordd_dbus_path_is_system(path)) {
-            return concordd_dbus_handle_system_get_partitions(self, connection, message);
-        }
+    message = dbus_message_new_signal(
+        path,
+        CONCORDD_DBUS_INTERFACE_V2,
+        CONCORDD_DBUS_SIGNAL_CHANGED
+    );
 
-    } else if (dbus_message_is_method_call(message, CONCORDD_DBUS_INTERFACE,
-                                    CONCORDD_DBUS_CMD_GET_ZONES)) {
-        if (concordd_dbus_path_is_partition(path)) {
-//            return concordd_dbus_handle_partition_get_zones(self, connection, message);
-        } else if (concordd_dbus_path_is_system(path)) {
-//            return concordd_dbus_handle_system_get_zones(self, connection, message);
-        }
+    if (message == NULL) {
+        goto bail;
+    }
 
-    } else if (dbus_message_is_method_call(message, CONCORDD_DBUS_INTERFACE,
-                                    CONCORDD_DBUS_CMD_GET_BUS_DEVICES)) {
-        if (concordd_dbus_path_is_system(path)) {
-//            return concordd_dbus_handle_system_get_bus_devices(self, connection, message);
-        }
+    dbus_message_iter_init_append(message, &iter);
+
+    if (!append_v2_object(&iter, self, object)) {
+        goto bail;
+    }
+
+    dbus_connection_send(self->dbus_connection, message, NULL);
+
+bail:
+    if (message != NULL) {
+        dbus_message_unref(message);
+    }
+}
+
+static bool
+concordd_dbus_outgoing_is_full(concordd_dbus_server_t self)
+{
+    return (self->max_outgoing > 0)
+        && (dbus_connection_get_outgoing_size(self->dbus_connection) > self->max_outgoing);
+}
+
+// Sends a `changed` signal for each object with changes pending,
+// oldest first. If the bus isn't keeping up, what is left stays
+// pending, and any further changes to those objects are merged
+// into the signal that will eventually be sent.
+static void
+concordd_dbus_flush_changes(concordd_dbus_server_t self)
+{
+    while (self->pending_changes != NULL) {
+        struct concordd_dbus_object_s* object = self->pending_changes;
+        int changed = object->pending_changed;
 
-    } else if (dbus_message_is_method_call(message, CONCORDD_DBUS_INTERFACE,
-                                    CONCORDD_DBUS_CMD_SEND_RAW_FRAME)) {
-        if (concordd_dbus_path_is_system(path)) {
-//            return concordd_dbus_handle_system_send_raw_frame(self, connection, message);
+        if (concordd_dbus_outgoing_is_full(self)) {
+            self->deferred_count++;
+            break;
         }
 
-    } else if (dbus_message_is_method_call(message, CONCORDD_DBUS_INTERFACE,
-                                    CONCORDD_DBUS_CMD_GET_USERS)) {
-        if (concordd_dbus_path_is_partition(path)) {
-//            return concordd_dbus_handle_partition_get_users(self, connection, message);
-        } else if (concordd_dbus_path_is_system(path)) {
-//            return concordd_dbus_handle_system_get_users(self, connection, message);
+        self->pending_changes = object->next_pending;
+        if (self->pending_changes == NULL) {
+            self->pending_changes_tail = &self->pending_changes;
         }
+        object->next_pending = NULL;
+        object->pending_changed = 0;
+
+        switch (object->type) {
+        case CONCORDD_DBUS_OBJECT_SYSTEM:
+            concordd_dbus_send_system_changed(self, self->instance, changed);
+
+            // There is no v2 struct for the system, but programming
+            // mode shows up in the struct of every partition.
+            if ((changed & CONCORDD_PARTITION_PROGRAMMING_MODE_CHANGED) != 0) {
+                int i;
+                for (i = 0; i < CONCORDD_MAX_PARTITIONS; i++) {
+                    if (self->instance->partition[i].active) {
+                        concordd_dbus_send_v2_changed(self, &self->partition_object[i]);
+                    }
+                }
+            }
+            continue;
 
-    } else if (dbus_message_is_method_call(message, CONCORDD_DBUS_INTERFACE,
-                                    CONCORDD_DBUS_CMD_GET_OUTPUTS)) {
-        if (concordd_dbus_path_is_system(path)) {
-//            return concordd_dbus_handle_system_get_outputs(self, connection, message);
+        case CONCORDD_DBUS_OBJECT_PARTITION:
+            concordd_dbus_send_partition_changed(self, self->instance,
+                concordd_get_partition(self->instance, object->partition_index),
+                changed);
+            break;
+
+        case CONCORDD_DBUS_OBJECT_LIGHT:
+            {
+                concordd_partition_t partition = concordd_get_partition(self->instance, object->partition_index);
+                concordd_dbus_send_light_changed(self, self->instance,
+                    partition,
+                    concordd_partition_get_light(partition, object->index),
+                    changed);
+            }
+            break;
+
+        case CONCORDD_DBUS_OBJECT_ZONE:
+            concordd_dbus_send_zone_changed(self, self->instance,
+                concordd_get_zone(self->instance, object->index),
+                changed);
+            break;
+
+        case CONCORDD_DBUS_OBJECT_OUTPUT:
+            concordd_dbus_send_output_changed(self, self->instance,
+                concordd_get_output(self->instance, object->index),
+                changed);
+            break;
         }
 
-    } else if (dbus_message_is_method_call(message, CONCORDD_DBUS_INTERFACE,
-                                    CONCORDD_DBUS_CMD_SET_ARM_LEVEL)) {
-        if (concordd_dbus_path_is_partition(path)) {
-            return concordd_dbus_handle_partition_set_arm_level(self, connection, message);
+        concordd_dbus_send_v2_changed(self, object);
+    }
+}
+
+static void
+concordd_dbus_queue_changes(concordd_dbus_server_t self, struct concordd_dbus_object_s* object, int changed)
+{
+    // Whatever `get_info` would say has changed too.
+    object->generation++;
+
+    if (changed == 0) {
+        return;
+    }
+
+    if (object->pending_changed != 0) {
+        self->coalesced_count++;
+        object->pending_changed |= changed;
+        return;
+    }
+
+    if (self->pending_changes == NULL) {
+        self->pending_changes_deadline = time_ms() + self->signal_window;
+    }
+
+    object->pending_changed = changed;
+    object->next_pending = NULL;
+    *self->pending_changes_tail = object;
+    self->pending_changes_tail = &object->next_pending;
+}
+
+void
+concordd_dbus_system_info_changed_func(concordd_dbus_server_t self, concordd_instance_t instance, int changed)
+{
+	if ((changed & CONCORDD_PARTITION_PROGRAMMING_MODE_CHANGED) != 0) {
+		// Programming mode is kept per partition, but reported
+		// as a change to the system.
+		int i;
+		for (i = 0; i < CONCORDD_MAX_PARTITIONS; i++) {
+			self->partition_object[i].generation++;
+		}
+	}
+
+	concordd_dbus_queue_changes(self, &self->system_object, changed);
+}
+
+void
+concordd_dbus_partition_info_changed_func(concordd_dbus_server_t self, concordd_instance_t instance, concordd_partition_t partition, int changed)
+{
+	int partition_id = concordd_get_partition_index(instance, partition);
+
+	if (partition_id >= 0 && partition_id < CONCORDD_MAX_PARTITIONS) {
+		concordd_dbus_queue_changes(self, &self->partition_object[partition_id], changed);
+	}
+}
+
+void
+concordd_dbus_zone_info_changed_func(concordd_dbus_server_t self, concordd_instance_t instance, concordd_zone_t zone, int changed)
+{
+	int zone_id = concordd_get_zone_index(instance, zone);
+
+	if (zone_id >= 0 && zone_id < CONCORDD_MAX_ZONES) {
+		concordd_dbus_queue_changes(self, &self->zone_object[zone_id], changed);
+	}
+}
+
+void
+concordd_dbus_light_info_changed_func(concordd_dbus_server_t self, concordd_instance_t instance, concordd_partition_t partition, concordd_light_t light, int changed)
+{
+	int partition_id = concordd_get_partition_index(instance, partition);
+	int light_id = concordd_get_light_index(instance, partition, light);
+
+	if ( (partition_id >= 0 && partition_id < CONCORDD_MAX_PARTITIONS)
+	  && (light_id >= 0 && light_id < CONCORDD_MAX_LIGHTS)
+	) {
+		concordd_dbus_queue_changes(self, &self->light_object[partition_id][light_id], changed);
+	}
+}
+
+void
+concordd_dbus_output_info_changed_func(concordd_dbus_server_t self, concordd_instance_t instance, concordd_output_t output, int changed)
+{
+	int output_id = concordd_get_output_index(instance, output);
+
+	if (output_id >= 0 && output_id < CONCORDD_MAX_OUTPUTS) {
+		concordd_dbus_queue_changes(self, &self->output_object[output_id], changed);
+	}
+}
+
+typedef DBusHandlerResult (*concordd_dbus_method_func_t)(
+    concordd_dbus_server_t self,
+    struct concordd_dbus_object_s* object,
+    DBusConnection *connection,
+    DBusMessage *   message
+);
+
+struct concordd_dbus_method_s {
+    const char* member;
+
+    // Version of the interface the method belongs to, see
+    // `CONCORDD_DBUS_INTERFACE_V2`.
+    uint8_t version;
+
+    // Indexed by the type of object the method is called on,
+    // NULL where the method isn't supported.
+    concordd_dbus_method_func_t func[CONCORDD_DBUS_OBJECT_TYPE_COUNT];
+};
+
+static const struct concordd_dbus_method_s concordd_dbus_methods[] = {
+    { CONCORDD_DBUS_CMD_GET_INFO, 1, {
+        [CONCORDD_DBUS_OBJECT_SYSTEM] = &concordd_dbus_handle_system_get_info,
+        [CONCORDD_DBUS_OBJECT_PARTITION] = &concordd_dbus_handle_partition_get_info,
+        [CONCORDD_DBUS_OBJECT_LIGHT] = &concordd_dbus_handle_light_get_info,
+        [CONCORDD_DBUS_OBJECT_ZONE] = &concordd_dbus_handle_zone_get_info,
+        [CONCORDD_DBUS_OBJECT_OUTPUT] = &concordd_dbus_handle_output_get_info,
+    } },
+    { CONCORDD_DBUS_CMD_GET_PARTITIONS, 1, {
+        [CONCORDD_DBUS_OBJECT_SYSTEM] = &concordd_dbus_handle_system_get_partitions,
+    } },
+    { CONCORDD_DBUS_CMD_GET_ZONES, 1, {
+        [CONCORDD_DBUS_OBJECT_SYSTEM] = &concordd_dbus_handle_get_zones,
+        [CONCORDD_DBUS_OBJECT_PARTITION] = &concordd_dbus_handle_get_zones,
+    } },
+    { CONCORDD_DBUS_CMD_GET_SNAPSHOT, 1, {
+        [CONCORDD_DBUS_OBJECT_SYSTEM] = &concordd_dbus_handle_system_get_snapshot,
+    } },
+    { CONCORDD_DBUS_CMD_GET_CHANGES_SINCE, 1, {
+        [CONCORDD_DBUS_OBJECT_SYSTEM] = &concordd_dbus_handle_system_get_changes_since,
+    } },
+    { CONCORDD_DBUS_CMD_GET_TROUBLES, 1, {
+        [CONCORDD_DBUS_OBJECT_SYSTEM] = &concordd_dbus_handle_system_get_troubles,
+        [CONCORDD_DBUS_OBJECT_PARTITION] = &concordd_dbus_handle_partition_get_troubles,
+    } },
+    { CONCORDD_DBUS_CMD_GET_ALARMS, 1, {
+        [CONCORDD_DBUS_OBJECT_PARTITION] = &concordd_dbus_handle_partition_get_alarms,
+    } },
+    { CONCORDD_DBUS_CMD_GET_EVENTLOG, 1, {
+        [CONCORDD_DBUS_OBJECT_SYSTEM] = &concordd_dbus_handle_system_get_event_log,
+    } },
+    { CONCORDD_DBUS_CMD_REFRESH, 1, {
+        [CONCORDD_DBUS_OBJECT_SYSTEM] = &concordd_dbus_handle_refresh,
+    } },
+    { CONCORDD_DBUS_CMD_SET_ARM_LEVEL, 1, {
+        [CONCORDD_DBUS_OBJECT_PARTITION] = &concordd_dbus_handle_partition_set_arm_level,
+    } },
+    { CONCORDD_DBUS_CMD_PRESS_KEYS, 1, {
+        [CONCORDD_DBUS_OBJECT_PARTITION] = &concordd_dbus_handle_partition_press_keys,
+    } },
+    { CONCORDD_DBUS_CMD_SET_VALUE, 1, {
+        [CONCORDD_DBUS_OBJECT_LIGHT] = &concordd_dbus_handle_light_set_value,
+        [CONCORDD_DBUS_OBJECT_OUTPUT] = &concordd_dbus_handle_output_set_value,
+    } },
+    { CONCORDD_DBUS_CMD_SET_BYPASSED, 1, {
+        [CONCORDD_DBUS_OBJECT_ZONE] = &concordd_dbus_handle_zone_set_bypassed,
+    } },
+
+    { CONCORDD_DBUS_CMD_GET_INFO, 2, {
+        [CONCORDD_DBUS_OBJECT_PARTITION] = &concordd_dbus_handle_v2_get_info,
+        [CONCORDD_DBUS_OBJECT_LIGHT] = &concordd_dbus_handle_v2_get_info,
+        [CONCORDD_DBUS_OBJECT_ZONE] = &concordd_dbus_handle_v2_get_info,
+        [CONCORDD_DBUS_OBJECT_OUTPUT] = &concordd_dbus_handle_v2_get_info,
+    } },
+    { CONCORDD_DBUS_CMD_GET_ZONES, 2, {
+        [CONCORDD_DBUS_OBJECT_SYSTEM] = &concordd_dbus_handle_v2_get_zones,
+        [CONCORDD_DBUS_OBJECT_PARTITION] = &concordd_dbus_handle_v2_get_zones,
+    } },
+    { CONCORDD_DBUS_CMD_GET_SNAPSHOT, 2, {
+        [CONCORDD_DBUS_OBJECT_SYSTEM] = &concordd_dbus_handle_v2_system_get_snapshot,
+    } },
+    { CONCORDD_DBUS_CMD_GET_CHANGES_SINCE, 2, {
+        [CONCORDD_DBUS_OBJECT_SYSTEM] = &concordd_dbus_handle_v2_system_get_changes_since,
+    } },
+    { CONCORDD_DBUS_CMD_GET_EVENTLOG, 2, {
+        [CONCORDD_DBUS_OBJECT_SYSTEM] = &concordd_dbus_handle_v2_system_get_event_log,
+    } },
+};
+
+// Open-addressed hash table of `concordd_dbus_methods`, keyed by
+// interface version and member name, so that finding a method takes one hash and usually
+// one string compare no matter how many methods there are. Must be
+// a power of two and comfortably larger than the number of methods.
+#define CONCORDD_DBUS_METHOD_HASH_SIZE      64
+
+static const struct concordd_dbus_method_s* concordd_dbus_method_hash[CONCORDD_DBUS_METHOD_HASH_SIZE];
+
+static uint32_t
+concordd_dbus_member_hash(uint8_t version, const char* member)
+{
+    // FNV-1a
+    uint32_t hash = (2166136261u ^ version) * 16777619u;
+
+    while (*member != 0) {
+        hash ^= (uint8_t)*member++;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static void
+concordd_dbus_method_hash_init(void)
+{
+    static bool initialized;
+    int i;
+
+    if (initialized) {
+        return;
+    }
+
+    initialized = true;
+
+    for (i = 0; i < sizeof(concordd_dbus_methods)/sizeof(*concordd_dbus_methods); i++) {
+        uint32_t slot = concordd_dbus_member_hash(concordd_dbus_methods[i].version, concordd_dbus_methods[i].member);
+
+        while (concordd_dbus_method_hash[slot % CONCORDD_DBUS_METHOD_HASH_SIZE] != NULL) {
+            slot++;
         }
-    } else if (dbus_message_is_method_call(message, CONCORDD_DBUS_INTERFACE,
-                                    CONCORDD_DBUS_CMD_GET_TROUBLES)) {
-        if (concordd_dbus_path_is_partition(path)) {
-            return concordd_dbus_handle_partition_get_troubles(self, connection, message);
-        } else if (concordd_dbus_path_is_system(path)) {
-            return concordd_dbus_handle_system_get_troubles(self, connection, message);
+
+        concordd_dbus_method_hash[slot % CONCORDD_DBUS_METHOD_HASH_SIZE] = &concordd_dbus_methods[i];
+    }
+}
+
+static const struct concordd_dbus_method_s*
+concordd_dbus_method_lookup(uint8_t version, const char* member)
+{
+    const struct concordd_dbus_method_s* method;
+    uint32_t slot = concordd_dbus_member_hash(version, member);
+
+    while ((method = concordd_dbus_method_hash[slot % CONCORDD_DBUS_METHOD_HASH_SIZE]) != NULL) {
+        if ((method->version == version) && strequal(method->member, member)) {
+            break;
         }
-    } else if (dbus_message_is_method_call(message, CONCORDD_DBUS_INTERFACE,
-                                    CONCORDD_DBUS_CMD_GET_ALARMS)) {
-        if (concordd_dbus_path_is_partition(path)) {
-            return concordd_dbus_handle_partition_get_alarms(self, connection, message);
+        slot++;
+    }
+
+    return method;
+}
+
+static DBusHandlerResult
+dbus_object_message_handler(
+    DBusConnection *connection,
+    DBusMessage *   message,
+    void *                  user_data
+    )
+{
+    struct concordd_dbus_object_s* object = (struct concordd_dbus_object_s*)user_data;
+    const struct concordd_dbus_method_s* method;
+    const char* interface = dbus_message_get_interface(message);
+    const char* member = dbus_message_get_member(message);
+    uint8_t version;
+
+    if ( (dbus_message_get_type(message) != DBUS_MESSAGE_TYPE_METHOD_CALL)
+      || (member == NULL)
+    ) {
+        return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    }
+
+    // Calls without an interface are taken to be for v1, which
+    // is what they were before there was more than one.
+    if ((interface == NULL) || strequal(interface, CONCORDD_DBUS_INTERFACE)) {
+        version = 1;
+    } else if (strequal(interface, CONCORDD_DBUS_INTERFACE_V2)) {
+        version = 2;
+    } else {
+        return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    }
+
+    method = concordd_dbus_method_lookup(version, member);
+
+    if ((method == NULL) || (method->func[object->type] == NULL)) {
+        return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    }
+
+    return (*method->func[object->type])(object->self, object, connection, message);
+}
+
+static DBusHandlerResult
+dbus_filter_handler(
+    DBusConnection *connection,
+    DBusMessage *   message,
+    void *                  user_data
+    )
+{
+    concordd_dbus_server_t self = (concordd_dbus_server_t)user_data;
+
+    if (dbus_message_is_signal(message, DBUS_INTERFACE_DBUS, "NameOwnerChanged")) {
+        const char* name = NULL;
+        const char* old_owner = NULL;
+        const char* new_owner = NULL;
+
+        if (dbus_message_get_args(
+                message, NULL,
+                DBUS_TYPE_STRING, &name,
+                DBUS_TYPE_STRING, &old_owner,
+                DBUS_TYPE_STRING, &new_owner,
+                DBUS_TYPE_INVALID)
+          && (new_owner[0] == 0)
+          && (self->pending_helpers != NULL)
+        ) {
+            concordd_dbus_cancel_commands_from(self, name);
         }
-    } else if (dbus_message_is_method_call(message, CONCORDD_DBUS_INTERFACE,
-                                    CONCORDD_DBUS_CMD_GET_EVENTLOG)) {
-        if (concordd_dbus_path_is_system(path)) {
-            return concordd_dbus_handle_system_get_event_log(self, connection, message);
+    }
+
+    // Other filters may be interested in this too, and method
+    // calls are left for `dbus_object_message_handler()`.
+    return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+}
+
+static bool
+concordd_dbus_register_object(
+    concordd_dbus_server_t self,
+    struct concordd_dbus_object_s* object,
+    uint8_t type,
+    int partition_index,
+    int index
+) {
+    static const DBusObjectPathVTable object_vtable = {
+        NULL,
+        &dbus_object_message_handler,
+    };
+    char path[128];
+
+    object->type = type;
+    object->partition_index = partition_index;
+    object->index = index;
+
+    concordd_dbus_object_path(object, path, sizeof(path));
+
+    if (!dbus_connection_register_object_path(self->dbus_connection, path, &object_vtable, (void*)object)) {
+        syslog(LOG_ERR, "Unable to register DBus object path \"%s\"", path);
+        return false;
+    }
+
+    // Only registered objects have this set.
+    object->self = self;
+
+    return true;
+}
+
+static void
+concordd_dbus_unregister_object(concordd_dbus_server_t self, struct concordd_dbus_object_s* object)
+{
+    char path[128];
+
+    if (object->self == NULL) {
+        return;
+    }
+
+    concordd_dbus_object_path(object, path, sizeof(path));
+    dbus_connection_unregister_object_path(self->dbus_connection, path);
+    object->self = NULL;
+}
+
+static void
+concordd_dbus_unregister_objects(concordd_dbus_server_t self)
+{
+    int i, j;
+
+    concordd_dbus_unregister_object(self, &self->system_object);
+
+    for (i = 0; i < CONCORDD_MAX_PARTITIONS; i++) {
+        concordd_dbus_unregister_object(self, &self->partition_object[i]);
+
+        for (j = 0; j < CONCORDD_MAX_LIGHTS; j++) {
+            concordd_dbus_unregister_object(self, &self->light_object[i][j]);
         }
+    }
+
+    for (i = 0; i < CONCORDD_MAX_ZONES; i++) {
+        concordd_dbus_unregister_object(self, &self->zone_object[i]);
+    }
+
+    for (i = 0; i < CONCORDD_MAX_OUTPUTS; i++) {
+        concordd_dbus_unregister_object(self, &self->output_object[i]);
+    }
+}
+
+static bool
+concordd_dbus_register_objects(concordd_dbus_server_t self)
+{
+    int i, j;
+
+    if (!concordd_dbus_register_object(self, &self->system_object, CONCORDD_DBUS_OBJECT_SYSTEM, -1, -1)) {
+        goto bail;
+    }
 
-    } else if (dbus_message_is_method_call(message, CONCORDD_DBUS_INTERFACE,
-                                    CONCORDD_DBUS_CMD_SET_VALUE)) {
-        if (concordd_dbus_path_is_output(path)) {
-            return concordd_dbus_handle_output_set_value(self, connection, message);
-        } else if (concordd_dbus_path_is_light(path)) {
-            return concordd_dbus_handle_light_set_value(self, connection, message);
+    for (i = 0; i < CONCORDD_MAX_PARTITIONS; i++) {
+        if (!concordd_dbus_register_object(self, &self->partition_object[i], CONCORDD_DBUS_OBJECT_PARTITION, i, -1)) {
+            goto bail;
         }
 
-    } else if (dbus_message_is_method_call(message, CONCORDD_DBUS_INTERFACE,
-                                    CONCORDD_DBUS_CMD_SET_BYPASSED)) {
-        if (concordd_dbus_path_is_zone(path)) {
-            return concordd_dbus_handle_zone_set_bypassed(self, connection, message);
-		}
-    } else if (dbus_message_is_method_call(message, CONCORDD_DBUS_INTERFACE,
-                                    CONCORDD_DBUS_CMD_GET_INFO)) {
-        if (concordd_dbus_path_is_output(path)) {
-            return concordd_dbus_handle_output_get_info(self, connection, message);
-        } else if (concordd_dbus_path_is_zone(path)) {
-            return concordd_dbus_handle_zone_get_info(self, connection, message);
-        } else if (concordd_dbus_path_is_light(path)) {
-            return concordd_dbus_handle_light_get_info(self, connection, message);
-        } else if (concordd_dbus_path_is_partition(path)) {
-            return concordd_dbus_handle_partition_get_info(self, connection, message);
-        } else if (concordd_dbus_path_is_system(path)) {
-            return concordd_dbus_handle_system_get_info(self, connection, message);
+        for (j = 0; j < CONCORDD_MAX_LIGHTS; j++) {
+            if (!concordd_dbus_register_object(self, &self->light_object[i][j], CONCORDD_DBUS_OBJECT_LIGHT, i, j)) {
+                goto bail;
+            }
         }
+    }
 
-    } else if (dbus_message_is_method_call(message, CONCORDD_DBUS_INTERFACE,
-                                    CONCORDD_DBUS_CMD_REFRESH)) {
-        if (concordd_dbus_path_is_system(path)) {
-            return concordd_dbus_handle_refresh(self, connection, message);
+    for (i = 0; i < CONCORDD_MAX_ZONES; i++) {
+        if (!concordd_dbus_register_object(self, &self->zone_object[i], CONCORDD_DBUS_OBJECT_ZONE, -1, i)) {
+            goto bail;
         }
+    }
 
-    } else if (dbus_message_is_method_call(message, CONCORDD_DBUS_INTERFACE,
-                                    CONCORDD_DBUS_CMD_PRESS_KEYS)) {
-        if (concordd_dbus_path_is_partition(path)) {
-            return concordd_dbus_handle_partition_press_keys(self, connection, message);
+    for (i = 0; i < CONCORDD_MAX_OUTPUTS; i++) {
+        if (!concordd_dbus_register_object(self, &self->output_object[i], CONCORDD_DBUS_OBJECT_OUTPUT, -1, i)) {
+            goto bail;
         }
     }
 
-    return ret;
+    return true;
+
+bail:
+    // Leave nothing behind pointing at objects that may not be
+    // around for much longer.
+    concordd_dbus_unregister_objects(self);
+    return false;
 }
 
 static DBusConnection *
@@ -2116,26 +3832,36 @@ concordd_dbus_server_init(concordd_dbus_server_t self, concordd_instance_t insta
     }
 
     self->instance = instance;
+    self->command_timeout = CONCORDD_DBUS_DEFAULT_COMMAND_TIMEOUT;
+    self->signal_window = CONCORDD_DBUS_DEFAULT_SIGNAL_WINDOW;
+    self->max_outgoing = CONCORDD_DBUS_DEFAULT_MAX_OUTGOING;
+    self->pending_changes_tail = &self->pending_changes;
 
     dbus_error_init(&error);
 
-    static const DBusObjectPathVTable ipc_interface_vtable = {
-        NULL,
-        &dbus_message_handler,
-    };
+    concordd_dbus_method_hash_init();
+
+    require_action(concordd_dbus_register_objects(self), bail, (self = NULL));
 
-    require_action(
-        dbus_connection_register_fallback(
-            self->dbus_connection,
-            CONCORDD_DBUS_PATH_ROOT,
-            &ipc_interface_vtable,
-            (void*)self
-        ),
-        bail,
-        (self = NULL)
+    dbus_connection_add_filter(self->dbus_connection, &dbus_filter_handler, (void*)self, NULL);
+
+    // Lets us notice when a client with a command still in the
+    // queue disconnects.
+    dbus_bus_add_match(
+        self->dbus_connection,
+        "type='signal',"
+        "sender='" DBUS_SERVICE_DBUS "',"
+        "interface='" DBUS_INTERFACE_DBUS "',"
+        "member='NameOwnerChanged',"
+        "arg2=''",
+        &error
     );
 
-    dbus_connection_add_filter(self->dbus_connection, &dbus_message_handler, (void*)self, NULL);
+    if (error.message) {
+        syslog(LOG_WARNING, "Unable to watch for clients leaving the bus: %s", error.message);
+        dbus_error_free(&error);
+        dbus_error_init(&error);
+    }
 
     syslog(LOG_NOTICE, "Ready. Using DBUS bus \"%s\"", dbus_bus_get_unique_name(self->dbus_connection));
 
@@ -2150,10 +3876,26 @@ bail:
 int
 concordd_dbus_server_process(concordd_dbus_server_t self)
 {
+    if ( (self->pending_changes != NULL)
+      && (self->pending_changes_deadline - time_ms() <= 0)
+    ) {
+        concordd_dbus_flush_changes(self);
+    }
+
     dbus_connection_read_write_dispatch(self->dbus_connection, 0);
     return 0;
 }
 
+int
+concordd_dbus_server_get_fd(concordd_dbus_server_t self)
+{
+    int unix_fd = -1;
+
+    dbus_connection_get_unix_fd(self->dbus_connection, &unix_fd);
+
+    return unix_fd;
+}
+
 int
 concordd_dbus_server_update_fd_set(
     concordd_dbus_server_t self,
@@ -2191,6 +3933,22 @@ concordd_dbus_server_update_fd_set(
         if (dbus_connection_has_messages_to_send(self->dbus_connection)) {
             *timeout = 0;
         }
+
+        // When the bus is backed up, we'll hear about it draining
+        // from the descriptor becoming writable instead.
+        if ( (self->pending_changes != NULL)
+          && !concordd_dbus_outgoing_is_full(self)
+        ) {
+            cms_t cms_until_flush = self->pending_changes_deadline - time_ms();
+
+            if (cms_until_flush < 0) {
+                cms_until_flush = 0;
+            }
+
+            if (cms_until_flush < *timeout) {
+                *timeout = cms_until_flush;
+            }
+        }
     }
 
     ret = 0;
@@ -22,22 +22,117 @@
 
 #include "concordd.h"
 #include "concordd-dbus.h"
+#include "concordd-hook.h"
+#include "concordd-tx-buffer.h"
+#include "concordd-realtime.h"
 #include "time-utils.h"
 #include <sys/select.h>
 #include <dbus/dbus.h>
 
+#define CONCORDD_DBUS_DEFAULT_COMMAND_TIMEOUT   (30*MSEC_PER_SEC)
+#define CONCORDD_DBUS_DEFAULT_SIGNAL_WINDOW     0
+#define CONCORDD_DBUS_DEFAULT_MAX_OUTGOING      (256*1024)
+
 struct concordd_dbus_server_s;
 typedef struct concordd_dbus_server_s *concordd_dbus_server_t;
 
+struct concordd_dbus_callback_helper_s;
+
+enum {
+    CONCORDD_DBUS_OBJECT_SYSTEM,
+    CONCORDD_DBUS_OBJECT_PARTITION,
+    CONCORDD_DBUS_OBJECT_LIGHT,
+    CONCORDD_DBUS_OBJECT_ZONE,
+    CONCORDD_DBUS_OBJECT_OUTPUT,
+
+    CONCORDD_DBUS_OBJECT_TYPE_COUNT
+};
+
+// One of these is registered for each object path we serve, and is
+// handed back to us as the user data of every method call made on
+// it, so the path never needs to be parsed.
+struct concordd_dbus_object_s {
+    concordd_dbus_server_t self;
+    uint8_t type;
+
+    // -1 where it doesn't apply.
+    int8_t partition_index;
+
+    // Index of the zone, light or output, otherwise -1.
+    int16_t index;
+
+    // Bumped whenever what `get_info` returns for this object
+    // changes, as reported by the change notifications.
+    uint32_t generation;
+
+    // The last `get_info` reply, which can be sent again for as
+    // long as `info_generation` and `info_refresh_count` are current.
+    DBusMessage *info_reply;
+    uint32_t info_generation;
+    uint32_t info_refresh_count;
+
+    // Changes that haven't been signaled yet. Objects with any
+    // are on the server's `pending_changes` list.
+    int pending_changed;
+    struct concordd_dbus_object_s *next_pending;
+};
+
 struct concordd_dbus_server_s {
     DBusConnection *dbus_connection;
     concordd_instance_t instance;
+
+    // How long a command from a client may wait in the queue
+    // before it is given up on. Zero waits forever.
+    cms_t command_timeout;
+
+    // Commands that the panel hasn't answered yet.
+    struct concordd_dbus_callback_helper_s *pending_helpers;
+
+    // Optional, used for reporting hook statistics.
+    concordd_hook_executor_t hook_executor;
+
+    // Optional, used for reporting serial output statistics.
+    concordd_tx_buffer_t tx_buffer;
+
+    // Optional, used for reporting how quickly we ACK the panel.
+    concordd_latency_histogram_t ack_latency;
+
+    // Changes to an object are collected for this many ms and then
+    // sent as a single `changed` signal. Zero sends them once the
+    // current trip around the main loop is done.
+    cms_t signal_window;
+
+    // While libdbus holds more than this many bytes that haven't
+    // been written to the bus yet, `changed` signals are held back
+    // and merged. Zero disables the limit.
+    long max_outgoing;
+
+    // Whether to send the v2 signals along with the v1 ones.
+    bool v2_signals;
+
+    // Objects with changes to signal, oldest first.
+    struct concordd_dbus_object_s *pending_changes;
+    struct concordd_dbus_object_s **pending_changes_tail;
+    cms_t pending_changes_deadline;
+
+    uint32_t coalesced_count;
+    uint32_t deferred_count;
+
+    struct concordd_dbus_object_s system_object;
+    struct concordd_dbus_object_s partition_object[CONCORDD_MAX_PARTITIONS];
+    struct concordd_dbus_object_s light_object[CONCORDD_MAX_PARTITIONS][CONCORDD_MAX_LIGHTS];
+    struct concordd_dbus_object_s zone_object[CONCORDD_MAX_ZONES];
+    struct concordd_dbus_object_s output_object[CONCORDD_MAX_OUTPUTS];
 };
 
 concordd_dbus_server_t concordd_dbus_server_init(concordd_dbus_server_t self, concordd_instance_t instance);
 
 int concordd_dbus_server_process(concordd_dbus_server_t self);
 
+// The descriptor of the bus connection, which stays the same for
+// the life of the server.
+int concordd_dbus_server_get_fd(concordd_dbus_server_t self);
+
 int concordd_dbus_server_update_fd_set(concordd_dbus_server_t self, fd_set *read_fd_set, fd_set *write_fd_set, fd_set *error_fd_set, int *max_fd, cms_t *timeout);
 
 void concordd_dbus_event_func(concordd_dbus_server_t self, concordd_instance_t instance, concordd_event_t event);
@@ -30,6 +30,8 @@
 #define CONCORDD_DBUS_CMD_GET_INFO              "get_info"
 #define CONCORDD_DBUS_CMD_GET_PARTITIONS              "get_partitions"
 #define CONCORDD_DBUS_CMD_GET_ZONES              "get_zones"
+#define CONCORDD_DBUS_CMD_GET_SNAPSHOT              "get_snapshot" // Returns a{sa{sv}} keyed by object path
+#define CONCORDD_DBUS_CMD_GET_CHANGES_SINCE              "get_changes_since" // Takes a change sequence number and epoch, see below
 #define CONCORDD_DBUS_CMD_GET_BUS_DEVICES              "get_bus_devices"
 #define CONCORDD_DBUS_CMD_GET_USERS              "get_users"
 #define CONCORDD_DBUS_CMD_GET_OUTPUTS              "get_outputs"
@@ -67,6 +69,7 @@
 #define CONCORDD_DBUS_EXCEPTION_SPECIFIC_TYPE     "specificType"
 #define CONCORDD_DBUS_EXCEPTION_EXTRA_DATA     "extraData"
 #define CONCORDD_DBUS_EXCEPTION_TIMESTAMP     "timestamp"
+#define CONCORDD_DBUS_EXCEPTION_SEQ     "seq"
 #define CONCORDD_DBUS_EXCEPTION_DESCRIPTION     "description"
 #define CONCORDD_DBUS_EXCEPTION_CATEGORY     "category"
 
@@ -84,6 +87,59 @@
 #define CONCORDD_DBUS_INFO_PROGRAMMING_MODE "programmingMode" // bool
 #define CONCORDD_DBUS_INFO_AC_POWER_FAILURE "acPowerFailure" // bool
 #define CONCORDD_DBUS_INFO_AC_POWER_FAILURE_CHANGED_TIMESTAMP "acPowerFailureChangedTimestamp" // unsigned int
+#define CONCORDD_DBUS_INFO_LINK_SRTT        "linkSrtt"     // int, milliseconds
+#define CONCORDD_DBUS_INFO_LINK_RTO         "linkRto"      // int, milliseconds
+#define CONCORDD_DBUS_INFO_LINK_FRAMES_SENT "linkFramesSent" // unsigned int
+#define CONCORDD_DBUS_INFO_LINK_FRAMES_RECEIVED "linkFramesReceived" // unsigned int
+#define CONCORDD_DBUS_INFO_LINK_RETRANSMITS "linkRetransmits" // unsigned int
+#define CONCORDD_DBUS_INFO_LINK_ACKS        "linkAcks"     // unsigned int
+#define CONCORDD_DBUS_INFO_LINK_NAKS        "linkNaks"     // unsigned int
+#define CONCORDD_DBUS_INFO_LINK_TIMEOUTS    "linkTimeouts" // unsigned int
+#define CONCORDD_DBUS_INFO_LINK_BAD_CHECKSUMS "linkBadChecksums" // unsigned int
+#define CONCORDD_DBUS_INFO_LINK_RX_OVERRUNS "linkRxOverruns" // unsigned int
+#define CONCORDD_DBUS_INFO_LINK_TX_QUEUED   "linkTxQueued" // unsigned int, bytes
+#define CONCORDD_DBUS_INFO_LINK_TX_PEAK     "linkTxPeak"   // unsigned int, bytes
+#define CONCORDD_DBUS_INFO_LINK_TX_STALLS   "linkTxStalls" // unsigned int
+#define CONCORDD_DBUS_INFO_LINK_TX_HIGH_WATER_HITS "linkTxHighWaterHits" // unsigned int
+#define CONCORDD_DBUS_INFO_LINK_ACK_LATENCY "linkAckLatency" // string, histogram
+#define CONCORDD_DBUS_INFO_LINK_ACK_LATENCY_SAMPLES "linkAckLatencySamples" // unsigned int
+#define CONCORDD_DBUS_INFO_LINK_ACK_LATENCY_MAX "linkAckLatencyMax" // int, microseconds
+#define CONCORDD_DBUS_INFO_HOOKS_RUNNING    "hooksRunning" // unsigned int
+#define CONCORDD_DBUS_INFO_HOOKS_QUEUED     "hooksQueued"  // unsigned int
+#define CONCORDD_DBUS_INFO_HOOKS_DROPPED    "hooksDropped" // unsigned int
+#define CONCORDD_DBUS_INFO_SIGNALS_COALESCED "signalsCoalesced" // unsigned int
+#define CONCORDD_DBUS_INFO_SIGNALS_DEFERRED "signalsDeferred" // unsigned int
+#define CONCORDD_DBUS_INFO_DBUS_OUTGOING    "dbusOutgoing" // unsigned int, bytes
+#define CONCORDD_DBUS_INFO_CHANGE_SEQ       "changeSeq" // unsigned int
+#define CONCORDD_DBUS_INFO_CHANGE_EPOCH     "changeEpoch" // unsigned int
+
+// `get_event_log` on the root takes up to seven arguments, all
+// optional, in this order:
+//   * u cursor: `seq` of the last event the client has seen, or 0.
+//   * i limit: The number of events to return. If positive, these
+//     are the oldest events after `cursor`, oldest first. If
+//     negative, they are the newest events before `cursor` (or the
+//     newest events, if it is 0), newest first. 0 returns every
+//     event after `cursor`.
+//   * i partitionId, i zoneId, i generalType: -1 for any.
+//   * i since, i until: Unix timestamps, 0 for no bound. `since` is
+//     inclusive, `until` is not.
+// It returns (u cursor, events), where `cursor` is the `seq` of the
+// last event returned (or the given one, if there were none), for
+// getting the next page. The events are an aa{sv} like the `event`
+// signal for v1, and an array of event structs for v2.
+//
+// `get_changes_since` on the root takes the `changeSeq` and
+// `changeEpoch` a client has caught up to (from the root's
+// `get_info`, or an earlier call) and returns (u changeSeq,
+// u changeEpoch, b resyncRequired, ...). The epoch changes every time
+// concordd starts, and a resync is always required if it doesn't
+// match. Unless a resync is required, the rest is the current state
+// of every object that changed since, each listed once: an
+// a{sa{sv}} like `get_snapshot` for v1, and the arrays of partition,
+// light, zone and output structs for v2. If a resync is required,
+// the client has to read everything again (after first noting the
+// new `changeSeq` and `changeEpoch`).
 
 #define CONCORDD_DBUS_INFO_PARTITION_ID     "partitionId"  // unsigned int
 #define CONCORDD_DBUS_INFO_ARM_LEVEL     "armLevel"  // unsigned int
@@ -124,6 +180,62 @@
 #define CONCORDD_DBUS_INFO_LAST_CHANGED_AT     "lastChangedAt"  // unsigned int
 #define CONCORDD_DBUS_INFO_LAST_TRIPPED_AT     "lastTrippedAt"  // unsigned int
 
+// Version 2 of the interface serves the same object paths, but
+// carries state as fixed-signature structs instead of `a{sv}`
+// dictionaries, so that clients can read it without looking up
+// keys. Booleans are folded into a flags word. Times are Unix
+// timestamps, zero if unknown.
+//
+// Methods:
+//   * `get_info` on a partition, light, zone or output returns
+//     its struct.
+//   * `get_zones` on the root or a partition returns an array of
+//     zone structs.
+//   * `get_snapshot` on the root returns arrays of partition,
+//     light, zone and output structs, in that order.
+//
+// Signals, only sent if `DBusV2Signals` is enabled, since they
+// double the signal traffic:
+//   * `changed` carries the whole struct of the object that changed.
+//   * `alarm`, `trouble` and `event` carry an event struct, and are
+//     sent from the same paths as their v1 counterparts.
+#define CONCORDD_DBUS_INTERFACE_V2              "net.voria.concordd.v2"
+
+// partitionId, armLevel, armLevelUser, flags, touchpadText,
+// sirenRepeat, sirenCadence, sirenStartedAt, armLevelChangedAt
+#define CONCORDD_DBUS_V2_PARTITION_SIGNATURE    "(iiuusuuxx)"
+#define CONCORDD_DBUS_V2_PARTITION_CHIME            (1<<0)
+#define CONCORDD_DBUS_V2_PARTITION_ENERGY_SAVER     (1<<1)
+#define CONCORDD_DBUS_V2_PARTITION_NO_DELAY         (1<<2)
+#define CONCORDD_DBUS_V2_PARTITION_LATCH_KEY        (1<<3)
+#define CONCORDD_DBUS_V2_PARTITION_SILENT_ARM       (1<<4)
+#define CONCORDD_DBUS_V2_PARTITION_QUICK_ARM        (1<<5)
+#define CONCORDD_DBUS_V2_PARTITION_PROGRAMMING_MODE (1<<8)
+#define CONCORDD_DBUS_V2_PARTITION_ENTRY_DELAY      (1<<9)
+#define CONCORDD_DBUS_V2_PARTITION_EXIT_DELAY       (1<<10)
+
+// partitionId, lightId, zoneId, flags, lastChangedAt
+#define CONCORDD_DBUS_V2_LIGHT_SIGNATURE        "(iiiux)"
+#define CONCORDD_DBUS_V2_LIGHT_ON                   (1<<0)
+
+// zoneId, partitionId, type, group, flags, name, lastChangedAt,
+// lastTrippedAt, lastKc, lastKcChangedAt
+#define CONCORDD_DBUS_V2_ZONE_SIGNATURE         "(iiiiusxxix)"
+#define CONCORDD_DBUS_V2_ZONE_TRIPPED               (1<<0)
+#define CONCORDD_DBUS_V2_ZONE_FAULT                 (1<<1)
+#define CONCORDD_DBUS_V2_ZONE_ALARM                 (1<<2)
+#define CONCORDD_DBUS_V2_ZONE_TROUBLE               (1<<3)
+#define CONCORDD_DBUS_V2_ZONE_BYPASSED              (1<<4)
+
+// outputId, partitionId, flags, name, lastChangedBy, lastChangedAt
+#define CONCORDD_DBUS_V2_OUTPUT_SIGNATURE       "(iiusux)"
+#define CONCORDD_DBUS_V2_OUTPUT_ON                  (1<<0)
+#define CONCORDD_DBUS_V2_OUTPUT_PULSE               (1<<1)
+
+// seq, status, partitionId, sourceType, zoneId, unitId,
+// generalType, specificType, extraData, timestamp
+#define CONCORDD_DBUS_V2_EVENT_SIGNATURE        "(uyyyquyyqx)"
+
 
 /*
 FOB CODES
@@ -0,0 +1,394 @@
+/*
+ *
+ * Copyright (c) 2017 Robert Quattlebaum
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifndef ASSERT_MACROS_USE_SYSLOG
+#define ASSERT_MACROS_USE_SYSLOG 1
+#endif
+
+#ifndef ASSERT_MACROS_SQUELCH
+#define ASSERT_MACROS_SQUELCH 0
+#endif
+
+#include "assert-macros.h"
+
+#include "concordd-event-loop.h"
+#include <syslog.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#if HAVE_SYS_EPOLL_H && HAVE_SYS_TIMERFD_H && HAVE_SYS_SIGNALFD_H
+#define CONCORDD_EVENT_LOOP_EPOLL 1
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/signalfd.h>
+#endif
+
+#if CONCORDD_EVENT_LOOP_EPOLL
+
+concordd_event_loop_t
+concordd_event_loop_init(concordd_event_loop_t self, const sigset_t* signals)
+{
+	struct epoll_event event;
+
+	memset(self, 0, sizeof(*self));
+	self->epoll_fd = -1;
+	self->timer_fd = -1;
+	self->signal_fd = -1;
+
+	self->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	require_string(self->epoll_fd >= 0, bail, strerror(errno));
+
+	self->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	require_string(self->timer_fd >= 0, bail, strerror(errno));
+
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.fd = self->timer_fd;
+	require_string(epoll_ctl(self->epoll_fd, EPOLL_CTL_ADD, self->timer_fd, &event) == 0, bail, strerror(errno));
+
+	if (signals != NULL) {
+		self->signal_fd = signalfd(-1, signals, SFD_NONBLOCK | SFD_CLOEXEC);
+		require_string(self->signal_fd >= 0, bail, strerror(errno));
+
+		event.data.fd = self->signal_fd;
+		require_string(epoll_ctl(self->epoll_fd, EPOLL_CTL_ADD, self->signal_fd, &event) == 0, bail, strerror(errno));
+
+		// Signals have to be blocked to be read from the signalfd,
+		// which is left until last so that failing above doesn't
+		// leave them blocked. Child processes get a clean signal
+		// mask, see `spawn_shell()`.
+		require_string(sigprocmask(SIG_BLOCK, signals, &self->saved_signal_mask) == 0, bail, strerror(errno));
+		self->signals_blocked = true;
+	}
+
+	return self;
+
+bail:
+	concordd_event_loop_finalize(self);
+	return NULL;
+}
+
+void
+concordd_event_loop_finalize(concordd_event_loop_t self)
+{
+	if (self->signals_blocked) {
+		// Back to the normal signal handlers.
+		sigprocmask(SIG_SETMASK, &self->saved_signal_mask, NULL);
+		self->signals_blocked = false;
+	}
+
+	if (self->signal_fd >= 0) {
+		close(self->signal_fd);
+		self->signal_fd = -1;
+	}
+
+	if (self->timer_fd >= 0) {
+		close(self->timer_fd);
+		self->timer_fd = -1;
+	}
+
+	if (self->epoll_fd >= 0) {
+		close(self->epoll_fd);
+		self->epoll_fd = -1;
+	}
+
+	self->fd_count = 0;
+}
+
+static struct concordd_event_loop_fd_s*
+find_fd(concordd_event_loop_t self, int fd)
+{
+	int i;
+
+	for (i = 0; i < self->fd_count; i++) {
+		if (self->fds[i].fd == fd) {
+			return &self->fds[i];
+		}
+	}
+
+	return NULL;
+}
+
+static int
+ctl_fd(concordd_event_loop_t self, int op, int fd, uint32_t events)
+{
+	struct epoll_event event;
+
+	memset(&event, 0, sizeof(event));
+	event.events = events;
+	event.data.fd = fd;
+
+	self->ctl_count++;
+
+	return epoll_ctl(self->epoll_fd, op, fd, &event);
+}
+
+int
+concordd_event_loop_add_fd(concordd_event_loop_t self, int fd)
+{
+	struct concordd_event_loop_fd_s* entry = find_fd(self, fd);
+
+	if (entry == NULL) {
+		if (self->fd_count >= CONCORDD_EVENT_LOOP_MAX_FDS) {
+			errno = ENOSPC;
+			return -1;
+		}
+
+		if (ctl_fd(self, EPOLL_CTL_ADD, fd, EPOLLIN) != 0) {
+			return -1;
+		}
+
+		entry = &self->fds[self->fd_count++];
+		entry->fd = fd;
+		entry->events = EPOLLIN;
+	}
+
+	entry->permanent = true;
+
+	return 0;
+}
+
+// Brings the kernel's idea of what we are waiting for in line with
+// the given sets, touching only what changed.
+static int
+sync_fds(concordd_event_loop_t self, const fd_set *read_fd_set, const fd_set *write_fd_set, int max_fd)
+{
+	int ret = 0;
+	int fd, i;
+
+	for (fd = 0; fd <= max_fd; fd++) {
+		struct concordd_event_loop_fd_s* entry;
+		uint32_t events = 0;
+
+		if (FD_ISSET(fd, read_fd_set)) {
+			events |= EPOLLIN;
+		}
+
+		if (FD_ISSET(fd, write_fd_set)) {
+			events |= EPOLLOUT;
+		}
+
+		if (events == 0) {
+			continue;
+		}
+
+		entry = find_fd(self, fd);
+
+		if (entry == NULL) {
+			if (self->fd_count >= CONCORDD_EVENT_LOOP_MAX_FDS) {
+				syslog(LOG_ERR, "event-loop: Too many file descriptors");
+				ret = -1;
+				continue;
+			}
+
+			entry = &self->fds[self->fd_count++];
+			entry->fd = fd;
+			entry->events = 0;
+			entry->permanent = false;
+		}
+
+		if (entry->permanent) {
+			if (entry->events != events) {
+				ctl_fd(self, EPOLL_CTL_MOD, fd, events);
+			}
+		} else {
+			// Transient descriptors may have been closed and reopened
+			// under the same number since we last saw them, in which
+			// case the kernel has already forgotten about them.
+			if (entry->events == 0 || ctl_fd(self, EPOLL_CTL_MOD, fd, events) != 0) {
+				if (ctl_fd(self, EPOLL_CTL_ADD, fd, events) != 0 && errno != EEXIST) {
+					syslog(LOG_ERR, "event-loop: Unable to watch fd %d: %s", fd, strerror(errno));
+					ret = -1;
+				}
+			}
+		}
+
+		entry->events = events;
+	}
+
+	for (i = 0; i < self->fd_count; i++) {
+		struct concordd_event_loop_fd_s* entry = &self->fds[i];
+
+		if ( (entry->fd <= max_fd)
+		  && (FD_ISSET(entry->fd, read_fd_set) || FD_ISSET(entry->fd, write_fd_set))
+		) {
+			continue;
+		}
+
+		if (entry->permanent) {
+			if (entry->events != 0) {
+				ctl_fd(self, EPOLL_CTL_MOD, entry->fd, 0);
+				entry->events = 0;
+			}
+		} else {
+			// May fail if it has been closed already, which is fine.
+			ctl_fd(self, EPOLL_CTL_DEL, entry->fd, 0);
+			*entry = self->fds[--self->fd_count];
+			i--;
+		}
+	}
+
+	return ret;
+}
+
+static void
+update_timer(concordd_event_loop_t self, cms_t timeout)
+{
+	struct itimerspec spec;
+	cms_t deadline = time_ms() + timeout;
+
+	if ((timeout <= 0) || (timeout >= CMS_DISTANT_FUTURE)) {
+		// Either we won't block at all, or we'll block until
+		// something happens.
+		if (self->timer_armed) {
+			memset(&spec, 0, sizeof(spec));
+			timerfd_settime(self->timer_fd, 0, &spec, NULL);
+			self->timer_armed = false;
+		}
+		return;
+	}
+
+	if (self->timer_armed && (self->timer_deadline == deadline)) {
+		return;
+	}
+
+	// Deadlines are whole milliseconds of `time_ms()`, which also
+	// runs off of CLOCK_MONOTONIC. Counting from the current time
+	// rather than from the truncated one means we never wake up
+	// before `time_ms()` has reached the deadline.
+	memset(&spec, 0, sizeof(spec));
+	clock_gettime(CLOCK_MONOTONIC, &spec.it_value);
+	spec.it_value.tv_sec += timeout / MSEC_PER_SEC;
+	spec.it_value.tv_nsec += (timeout % MSEC_PER_SEC) * 1000000L;
+	if (spec.it_value.tv_nsec >= 1000000000L) {
+		spec.it_value.tv_sec++;
+		spec.it_value.tv_nsec -= 1000000000L;
+	}
+
+	timerfd_settime(self->timer_fd, TFD_TIMER_ABSTIME, &spec, NULL);
+	self->timer_deadline = deadline;
+	self->timer_armed = true;
+}
+
+int
+concordd_event_loop_wait(
+	concordd_event_loop_t self,
+	fd_set *read_fd_set,
+	fd_set *write_fd_set,
+	int max_fd,
+	cms_t timeout,
+	sigset_t *signals_out
+) {
+	struct epoll_event events[CONCORDD_EVENT_LOOP_MAX_FDS + 2];
+	int event_count;
+	int ret = 0;
+	int i;
+
+	sync_fds(self, read_fd_set, write_fd_set, max_fd);
+	update_timer(self, timeout);
+
+	event_count = epoll_wait(
+		self->epoll_fd,
+		events,
+		sizeof(events)/sizeof(*events),
+		(timeout <= 0) ? 0 : -1
+	);
+
+	FD_ZERO(read_fd_set);
+	FD_ZERO(write_fd_set);
+
+	if (event_count < 0) {
+		return -1;
+	}
+
+	self->wakeup_count++;
+
+	for (i = 0; i < event_count; i++) {
+		int fd = events[i].data.fd;
+
+		if (fd == self->timer_fd) {
+			uint64_t expirations;
+			(void)read(self->timer_fd, &expirations, sizeof(expirations));
+			self->timer_armed = false;
+			self->timer_count++;
+
+		} else if (fd == self->signal_fd) {
+			struct signalfd_siginfo info;
+
+			while (read(self->signal_fd, &info, sizeof(info)) == sizeof(info)) {
+				if (signals_out != NULL) {
+					sigaddset(signals_out, info.ssi_signo);
+				}
+			}
+
+		} else {
+			if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+				FD_SET(fd, read_fd_set);
+			}
+
+			if (events[i].events & EPOLLOUT) {
+				FD_SET(fd, write_fd_set);
+			}
+
+			ret++;
+		}
+	}
+
+	return ret;
+}
+
+#else // if CONCORDD_EVENT_LOOP_EPOLL
+
+concordd_event_loop_t
+concordd_event_loop_init(concordd_event_loop_t self, const sigset_t* signals)
+{
+	return NULL;
+}
+
+void
+concordd_event_loop_finalize(concordd_event_loop_t self)
+{
+}
+
+int
+concordd_event_loop_add_fd(concordd_event_loop_t self, int fd)
+{
+	errno = ENOTSUP;
+	return -1;
+}
+
+int
+concordd_event_loop_wait(
+	concordd_event_loop_t self,
+	fd_set *read_fd_set,
+	fd_set *write_fd_set,
+	int max_fd,
+	cms_t timeout,
+	sigset_t *signals_out
+) {
+	errno = ENOTSUP;
+	return -1;
+}
+
+#endif // else CONCORDD_EVENT_LOOP_EPOLL
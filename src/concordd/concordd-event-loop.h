@@ -0,0 +1,106 @@
+/*
+ *
+ * Copyright (c) 2017 Robert Quattlebaum
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef concordd_event_loop_h
+#define concordd_event_loop_h 1
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <signal.h>
+#include <sys/select.h>
+#include "time-utils.h"
+
+// epoll(7) backend for the main loop, used in place of select()
+// where it is available.
+//
+// The main loop still describes what it is interested in with
+// `fd_set`s, so that the existing `*_update_fd_set()` functions
+// don't need to know which backend is in use, but nothing is
+// handed to the kernel unless it changed:
+//
+//  * Long-lived descriptors (the serial port and D-Bus) are added
+//    once with `concordd_event_loop_add_fd()`. After that, only
+//    changes in whether we want to write to them cost a system call.
+//  * Anything else that shows up in the sets (such as the hook
+//    co-process pipe, which comes and goes) is registered for as
+//    long as it keeps showing up.
+//  * The timeout is turned into an absolute deadline on a timerfd,
+//    which is only re-armed when the deadline moves.
+//  * The given signals are blocked and read from a signalfd, so
+//    they are handled from the loop instead of interrupting it.
+
+#define CONCORDD_EVENT_LOOP_MAX_FDS     16
+
+struct concordd_event_loop_fd_s {
+	int fd;
+	uint32_t events;
+	bool permanent;
+};
+
+struct concordd_event_loop_s;
+typedef struct concordd_event_loop_s *concordd_event_loop_t;
+
+struct concordd_event_loop_s {
+	int epoll_fd;
+	int timer_fd;
+	int signal_fd;
+
+	// What to put the signal mask back to, if `signals_blocked`.
+	sigset_t saved_signal_mask;
+	bool signals_blocked;
+
+	struct concordd_event_loop_fd_s fds[CONCORDD_EVENT_LOOP_MAX_FDS];
+	int fd_count;
+
+	// Absolute deadline the timerfd is armed for, if `timer_armed`.
+	cms_t timer_deadline;
+	bool timer_armed;
+
+	uint32_t wakeup_count;
+	uint32_t timer_count;
+	uint32_t ctl_count;
+};
+
+// Returns NULL if epoll, timerfd or signalfd aren't available, in
+// which case the caller should stick with select(). The signals in
+// `signals` are blocked from here on.
+concordd_event_loop_t concordd_event_loop_init(concordd_event_loop_t self, const sigset_t* signals);
+
+void concordd_event_loop_finalize(concordd_event_loop_t self);
+
+// Registers a descriptor that stays open for as long as the loop
+// is used. Fails for descriptors epoll can't wait on, such as
+// regular files and `/dev/null`.
+int concordd_event_loop_add_fd(concordd_event_loop_t self, int fd);
+
+// Waits until something in `read_fd_set`/`write_fd_set` is ready or
+// `timeout` ms have passed, like select() does. On return, the sets
+// only contain the descriptors that are ready (errors and hangups
+// show up as readable). Signals that arrived are added to
+// `signals_out`. Returns the number of ready descriptors, or -1.
+int concordd_event_loop_wait(
+	concordd_event_loop_t self,
+	fd_set *read_fd_set,
+	fd_set *write_fd_set,
+	int max_fd,
+	cms_t timeout,
+	sigset_t *signals_out
+);
+
+#endif // ifndef concordd_event_loop_h
@@ -0,0 +1,744 @@
+/*
+ *
+ * Copyright (c) 2017 Robert Quattlebaum
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifndef ASSERT_MACROS_USE_SYSLOG
+#define ASSERT_MACROS_USE_SYSLOG 1
+#endif
+
+#ifndef ASSERT_MACROS_SQUELCH
+#define ASSERT_MACROS_SQUELCH 0
+#endif
+
+#include "assert-macros.h"
+
+#include "concordd-hook.h"
+#include <syslog.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+concordd_hook_t
+concordd_hook_new(const char* command)
+{
+	concordd_hook_t hook = calloc(1, sizeof(*hook));
+
+	require(hook != NULL, bail);
+
+	if (command == NULL) {
+		goto bail;
+	}
+
+	hook->command = strdup(command);
+
+	if (hook->command == NULL) {
+		free(hook);
+		hook = NULL;
+	}
+
+bail:
+	return hook;
+}
+
+void
+concordd_hook_free(concordd_hook_t hook)
+{
+	int i;
+
+	if (hook == NULL) {
+		return;
+	}
+
+	for (i = 0; i < hook->env_count; i++) {
+		free(hook->env[i]);
+	}
+
+	free(hook->command);
+	free(hook);
+}
+
+int
+concordd_hook_setenv(concordd_hook_t hook, const char* key, const char* value)
+{
+	int ret = -1;
+	size_t len;
+	char* entry;
+
+	require(hook != NULL, bail);
+	require_string(hook->env_count < CONCORDD_HOOK_MAX_ENV, bail, "Too many hook environment variables");
+
+	len = strlen(key) + 1 + strlen(value) + 1;
+	entry = malloc(len);
+
+	require(entry != NULL, bail);
+
+	snprintf(entry, len, "%s=%s", key, value);
+
+	hook->env[hook->env_count++] = entry;
+
+	ret = 0;
+
+bail:
+	return ret;
+}
+
+int
+concordd_hook_setenvf(concordd_hook_t hook, const char* key, const char* fmt, ...)
+{
+	char value[128];
+	va_list args;
+
+	va_start(args, fmt);
+	vsnprintf(value, sizeof(value), fmt, args);
+	va_end(args);
+
+	return concordd_hook_setenv(hook, key, value);
+}
+
+static bool
+env_key_matches(const char* entry, const char* key, size_t key_len)
+{
+	return (strncmp(entry, key, key_len) == 0) && (entry[key_len] == '=');
+}
+
+// Builds the environment for the child: everything that the hook
+// sets, followed by whatever we inherited that it doesn't override.
+static char**
+build_envp(concordd_hook_t hook)
+{
+	char** envp = NULL;
+	int environ_count = 0;
+	int count = 0;
+	int i, j;
+
+	while (environ[environ_count] != NULL) {
+		environ_count++;
+	}
+
+	envp = calloc(hook->env_count + environ_count + 1, sizeof(char*));
+
+	require(envp != NULL, bail);
+
+	for (i = 0; i < hook->env_count; i++) {
+		envp[count++] = hook->env[i];
+	}
+
+	for (i = 0; i < environ_count; i++) {
+		const char* equals = strchr(environ[i], '=');
+		bool overridden = false;
+
+		if (equals == NULL) {
+			continue;
+		}
+
+		for (j = 0; j < hook->env_count; j++) {
+			if (env_key_matches(hook->env[j], environ[i], equals - environ[i])) {
+				overridden = true;
+				break;
+			}
+		}
+
+		if (!overridden) {
+			envp[count++] = environ[i];
+		}
+	}
+
+bail:
+	return envp;
+}
+
+// Starts `/bin/sh -c command`. If `stdin_fd` isn't -1, it becomes
+// the standard input of the child.
+static int
+spawn_shell(const char* command, char** envp, int stdin_fd, pid_t* pid)
+{
+	int ret = -1;
+	char* argv[] = { "/bin/sh", "-c", (char*)command, NULL };
+	posix_spawnattr_t attr;
+	posix_spawn_file_actions_t file_actions;
+	sigset_t sigset;
+
+	posix_spawnattr_init(&attr);
+	posix_spawn_file_actions_init(&file_actions);
+
+	if (stdin_fd != -1) {
+		posix_spawn_file_actions_adddup2(&file_actions, stdin_fd, STDIN_FILENO);
+	}
+
+	// Give the hook its own process group, so that a timeout
+	// also takes out anything the shell started.
+	posix_spawnattr_setpgroup(&attr, 0);
+
+	// Don't pass down our signal dispositions, in particular
+	// the fact that we ignore SIGPIPE.
+	sigemptyset(&sigset);
+	posix_spawnattr_setsigmask(&attr, &sigset);
+	sigaddset(&sigset, SIGPIPE);
+	sigaddset(&sigset, SIGCHLD);
+	sigaddset(&sigset, SIGINT);
+	sigaddset(&sigset, SIGTERM);
+	sigaddset(&sigset, SIGHUP);
+	posix_spawnattr_setsigdefault(&attr, &sigset);
+
+	posix_spawnattr_setflags(&attr,
+		POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF
+	);
+
+	ret = posix_spawn(pid, argv[0], &file_actions, &attr, argv, envp);
+
+	posix_spawn_file_actions_destroy(&file_actions);
+	posix_spawnattr_destroy(&attr);
+
+	if (ret != 0) {
+		syslog(LOG_ERR, "posix_spawn() failed: %s", strerror(ret));
+		ret = -1;
+	}
+
+	return ret;
+}
+
+static int
+hook_spawn(concordd_hook_t hook)
+{
+	int ret = -1;
+	char** envp = NULL;
+
+	envp = build_envp(hook);
+
+	require(envp != NULL, bail);
+
+	ret = spawn_shell(hook->command, envp, -1, &hook->pid);
+
+	require_noerr(ret, bail);
+
+	hook->started_at = time_ms();
+
+	syslog(LOG_DEBUG, "Started hook \"%s\" (pid %d)", hook->command, (int)hook->pid);
+
+bail:
+	free(envp);
+	return ret;
+}
+
+concordd_hook_executor_t
+concordd_hook_executor_init(
+	concordd_hook_executor_t self,
+	int max_running,
+	int max_backlog,
+	cms_t timeout
+) {
+	memset(self, 0, sizeof(*self));
+
+	self->max_running = (max_running > 0) ? max_running : 1;
+	self->max_backlog = (max_backlog > 0) ? max_backlog : 0;
+	self->timeout = timeout;
+	self->coprocess.fd = -1;
+
+	return self;
+}
+
+/* ------------------------------------------------------------------------- */
+/* MARK: Co-process */
+
+static void
+record_append(char** ptr, const char* str)
+{
+	for (; *str != 0; str++) {
+		switch (*str) {
+		case '\t': *(*ptr)++ = '\\'; *(*ptr)++ = 't'; break;
+		case '\n': *(*ptr)++ = '\\'; *(*ptr)++ = 'n'; break;
+		case '\\': *(*ptr)++ = '\\'; *(*ptr)++ = '\\'; break;
+		default: *(*ptr)++ = *str; break;
+		}
+	}
+}
+
+// Formats the environment of `hook` as a single record line.
+static char*
+record_from_hook(concordd_hook_t hook)
+{
+	static const char prefix[] = "CONCORDD_";
+	char* record = NULL;
+	char* ptr;
+	size_t len = 1;
+	int i;
+
+	for (i = 0; i < hook->env_count; i++) {
+		// Worst case every character needs escaping.
+		len += 2*strlen(hook->env[i]) + 1;
+	}
+
+	record = malloc(len + 1);
+
+	require(record != NULL, bail);
+
+	ptr = record;
+
+	for (i = 0; i < hook->env_count; i++) {
+		const char* entry = hook->env[i];
+		const char* equals = strchr(entry, '=');
+
+		if (strncmp(entry, prefix, sizeof(prefix) - 1) == 0) {
+			entry += sizeof(prefix) - 1;
+		}
+
+		if (i != 0) {
+			*ptr++ = '\t';
+		}
+
+		// Keys never need escaping.
+		memcpy(ptr, entry, equals + 1 - entry);
+		ptr += equals + 1 - entry;
+
+		record_append(&ptr, equals + 1);
+	}
+
+	*ptr++ = '\n';
+	*ptr = 0;
+
+bail:
+	return record;
+}
+
+static void
+coprocess_pop_record(struct concordd_hook_coprocess_s* coprocess)
+{
+	free(coprocess->records[coprocess->records_head]);
+	coprocess->records[coprocess->records_head] = NULL;
+	coprocess->records_head = (coprocess->records_head + 1) % coprocess->records_size;
+	coprocess->records_count--;
+	coprocess->head_offset = 0;
+}
+
+static void
+coprocess_close(struct concordd_hook_coprocess_s* coprocess)
+{
+	if (coprocess->fd != -1) {
+		close(coprocess->fd);
+		coprocess->fd = -1;
+	}
+
+	// A partially written record would be garbage to the next
+	// instance, so start it over.
+	coprocess->head_offset = 0;
+}
+
+static void
+coprocess_flush(struct concordd_hook_coprocess_s* coprocess)
+{
+	while ((coprocess->fd != -1) && (coprocess->records_count > 0)) {
+		const char* record = coprocess->records[coprocess->records_head];
+		size_t len = strlen(record) - coprocess->head_offset;
+		ssize_t written = write(coprocess->fd, record + coprocess->head_offset, len);
+
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+				break;
+			}
+
+			syslog(LOG_WARNING, "Hook co-process: write() failed: %s", strerror(errno));
+
+			// Make sure it goes away so that we can restart it.
+			coprocess_close(coprocess);
+			if (coprocess->pid != 0) {
+				kill(coprocess->pid, SIGTERM);
+			}
+			break;
+		}
+
+		if ((size_t)written < len) {
+			coprocess->head_offset += written;
+			break;
+		}
+
+		coprocess_pop_record(coprocess);
+	}
+}
+
+static int
+coprocess_start(struct concordd_hook_coprocess_s* coprocess)
+{
+	int ret = -1;
+	int fds[2] = { -1, -1 };
+
+	if (pipe(fds) != 0) {
+		syslog(LOG_ERR, "Hook co-process: pipe() failed: %s", strerror(errno));
+		goto bail;
+	}
+
+	// Keep both ends out of hooks spawned later. The co-process still
+	// gets the read end, since the dup2() onto its stdin clears the flag.
+	fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+	fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+	fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+
+	ret = spawn_shell(coprocess->command, environ, fds[0], &coprocess->pid);
+
+	require_noerr(ret, bail);
+
+	coprocess->fd = fds[1];
+	fds[1] = -1;
+	coprocess->started_at = time_ms();
+
+	syslog(LOG_NOTICE, "Started hook co-process \"%s\" (pid %d)", coprocess->command, (int)coprocess->pid);
+
+	coprocess_flush(coprocess);
+
+bail:
+	if (ret != 0) {
+		coprocess->pid = 0;
+		coprocess->restart_at = time_ms() + coprocess->backoff;
+	}
+
+	if (fds[0] != -1) {
+		close(fds[0]);
+	}
+
+	if (fds[1] != -1) {
+		close(fds[1]);
+	}
+
+	return ret;
+}
+
+static void
+coprocess_exited(struct concordd_hook_coprocess_s* coprocess, int status)
+{
+	cms_t now = time_ms();
+
+	coprocess_close(coprocess);
+	coprocess->pid = 0;
+
+	// If it had been running for a while, assume that whatever
+	// was wrong has been fixed and restart it quickly.
+	if (now - coprocess->started_at > CONCORDD_HOOK_COPROCESS_MAX_BACKOFF) {
+		coprocess->backoff = CONCORDD_HOOK_COPROCESS_MIN_BACKOFF;
+	}
+
+	coprocess->restart_at = now + coprocess->backoff;
+
+	syslog(LOG_WARNING,
+		"Hook co-process exited (status 0x%x), restarting in %dms",
+		status,
+		coprocess->backoff
+	);
+
+	coprocess->backoff *= 2;
+
+	if (coprocess->backoff > CONCORDD_HOOK_COPROCESS_MAX_BACKOFF) {
+		coprocess->backoff = CONCORDD_HOOK_COPROCESS_MAX_BACKOFF;
+	}
+
+	coprocess->restart_count++;
+}
+
+static void
+coprocess_send(struct concordd_hook_coprocess_s* coprocess, concordd_hook_t hook)
+{
+	char* record = record_from_hook(hook);
+
+	require(record != NULL, bail);
+
+	if (coprocess->records_count == coprocess->records_size) {
+		if (coprocess->head_offset == 0) {
+			coprocess_pop_record(coprocess);
+		} else {
+			// The oldest record is halfway out the door,
+			// so we have to drop this one instead.
+			free(record);
+			record = NULL;
+		}
+
+		if (coprocess->dropped_count++ == 0) {
+			syslog(LOG_WARNING, "Hook co-process backlog full, dropping records");
+		}
+	}
+
+	if (record != NULL) {
+		int index = (coprocess->records_head + coprocess->records_count) % coprocess->records_size;
+		coprocess->records[index] = record;
+		coprocess->records_count++;
+	}
+
+	coprocess_flush(coprocess);
+
+bail:
+	return;
+}
+
+int
+concordd_hook_executor_start_coprocess(concordd_hook_executor_t self, const char* command, int backlog)
+{
+	int ret = -1;
+	struct concordd_hook_coprocess_s* coprocess = &self->coprocess;
+
+	require(coprocess->command == NULL, bail);
+	require(backlog > 0, bail);
+
+	coprocess->records = calloc(backlog, sizeof(char*));
+
+	require(coprocess->records != NULL, bail);
+
+	coprocess->records_size = backlog;
+	coprocess->command = strdup(command);
+	coprocess->backoff = CONCORDD_HOOK_COPROCESS_MIN_BACKOFF;
+
+	require(coprocess->command != NULL, bail);
+
+	// We will try again later if this fails.
+	coprocess_start(coprocess);
+
+	ret = 0;
+
+bail:
+	return ret;
+}
+
+bool
+concordd_hook_executor_has_coprocess(concordd_hook_executor_t self)
+{
+	return self->coprocess.command != NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+/* MARK: Hooks */
+
+static void
+executor_start(concordd_hook_executor_t self, concordd_hook_t hook)
+{
+	if (hook_spawn(hook) != 0) {
+		self->failed_count++;
+		concordd_hook_free(hook);
+		return;
+	}
+
+	hook->next = self->running;
+	self->running = hook;
+	self->running_count++;
+	self->spawned_count++;
+}
+
+void
+concordd_hook_executor_submit(concordd_hook_executor_t self, concordd_hook_t hook)
+{
+	if (hook == NULL) {
+		return;
+	}
+
+	hook->next = NULL;
+
+	if (self->coprocess.command != NULL) {
+		coprocess_send(&self->coprocess, hook);
+	}
+
+	if (hook->command == NULL) {
+		concordd_hook_free(hook);
+
+	} else if ((self->running_count < self->max_running) && (self->backlog_head == NULL)) {
+		executor_start(self, hook);
+
+	} else if (self->queued_count < self->max_backlog) {
+		if (self->backlog_tail == NULL) {
+			self->backlog_head = hook;
+		} else {
+			self->backlog_tail->next = hook;
+		}
+		self->backlog_tail = hook;
+		self->queued_count++;
+
+	} else {
+		self->dropped_count++;
+		syslog(LOG_WARNING,
+			"Hook backlog full (%d running, %d queued), dropped \"%s\" (%u dropped so far)",
+			self->running_count,
+			self->queued_count,
+			hook->command,
+			self->dropped_count
+		);
+		concordd_hook_free(hook);
+	}
+}
+
+static void
+executor_reap(concordd_hook_executor_t self)
+{
+	int status = 0;
+	pid_t pid;
+
+	// This also collects children that aren't hooks, which is
+	// what the SIGCHLD handler used to do for us.
+	while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+		concordd_hook_t* iter = &self->running;
+
+		while (*iter != NULL && (*iter)->pid != pid) {
+			iter = &(*iter)->next;
+		}
+
+		if (*iter == NULL) {
+			if ((self->coprocess.pid != 0) && (pid == self->coprocess.pid)) {
+				coprocess_exited(&self->coprocess, status);
+			}
+			continue;
+		}
+
+		concordd_hook_t hook = *iter;
+		*iter = hook->next;
+		self->running_count--;
+
+		if (WIFEXITED(status) && WEXITSTATUS(status) != 0) {
+			syslog(LOG_INFO, "Hook \"%s\" exited with status %d", hook->command, WEXITSTATUS(status));
+		} else if (WIFSIGNALED(status) && !hook->terminated) {
+			syslog(LOG_INFO, "Hook \"%s\" killed by signal %d", hook->command, WTERMSIG(status));
+		}
+
+		concordd_hook_free(hook);
+	}
+}
+
+static cms_t
+hook_cms_until_deadline(concordd_hook_executor_t self, concordd_hook_t hook)
+{
+	cms_t deadline = hook->started_at + self->timeout;
+
+	if (hook->terminated) {
+		deadline += CONCORDD_HOOK_KILL_GRACE_PERIOD;
+	}
+
+	return deadline - time_ms();
+}
+
+static void
+executor_enforce_timeouts(concordd_hook_executor_t self)
+{
+	concordd_hook_t hook;
+
+	if (self->timeout <= 0) {
+		return;
+	}
+
+	for (hook = self->running; hook != NULL; hook = hook->next) {
+		if (hook_cms_until_deadline(self, hook) > 0) {
+			continue;
+		}
+
+		if (!hook->terminated) {
+			syslog(LOG_WARNING, "Hook \"%s\" (pid %d) timed out, terminating", hook->command, (int)hook->pid);
+			kill(-hook->pid, SIGTERM);
+			hook->terminated = true;
+			self->killed_count++;
+		} else {
+			syslog(LOG_WARNING, "Hook \"%s\" (pid %d) ignored SIGTERM, killing", hook->command, (int)hook->pid);
+			kill(-hook->pid, SIGKILL);
+
+			// Push the deadline out so we don't spin on it while
+			// waiting for the kernel to deliver SIGCHLD.
+			hook->started_at = time_ms();
+		}
+	}
+}
+
+void
+concordd_hook_executor_process(concordd_hook_executor_t self)
+{
+	executor_reap(self);
+
+	executor_enforce_timeouts(self);
+
+	if ( (self->coprocess.command != NULL)
+	  && (self->coprocess.pid == 0)
+	  && (self->coprocess.restart_at - time_ms() <= 0)
+	) {
+		coprocess_start(&self->coprocess);
+	}
+
+	coprocess_flush(&self->coprocess);
+
+	while ((self->running_count < self->max_running) && (self->backlog_head != NULL)) {
+		concordd_hook_t hook = self->backlog_head;
+
+		self->backlog_head = hook->next;
+		if (self->backlog_head == NULL) {
+			self->backlog_tail = NULL;
+		}
+		self->queued_count--;
+
+		executor_start(self, hook);
+	}
+}
+
+int
+concordd_hook_executor_update_fd_set(
+	concordd_hook_executor_t self,
+	fd_set *read_fd_set,
+	fd_set *write_fd_set,
+	fd_set *error_fd_set,
+	int *max_fd,
+	cms_t *timeout
+) {
+	struct concordd_hook_coprocess_s* coprocess = &self->coprocess;
+	concordd_hook_t hook;
+
+	if ((coprocess->fd != -1) && (coprocess->records_count > 0) && (write_fd_set != NULL)) {
+		FD_SET(coprocess->fd, write_fd_set);
+
+		if ((max_fd != NULL) && (*max_fd < coprocess->fd)) {
+			*max_fd = coprocess->fd;
+		}
+	}
+
+	if (timeout == NULL) {
+		return 0;
+	}
+
+	if ((coprocess->command != NULL) && (coprocess->pid == 0)) {
+		cms_t cms = coprocess->restart_at - time_ms();
+
+		if (cms < *timeout) {
+			*timeout = (cms > 0) ? cms : 0;
+		}
+	}
+
+	if (self->timeout > 0) {
+		for (hook = self->running; hook != NULL; hook = hook->next) {
+			cms_t cms = hook_cms_until_deadline(self, hook);
+
+			if (cms < *timeout) {
+				*timeout = (cms > 0) ? cms : 0;
+			}
+		}
+	}
+
+	return 0;
+}
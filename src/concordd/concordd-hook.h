@@ -0,0 +1,161 @@
+/*
+ *
+ * Copyright (c) 2017 Robert Quattlebaum
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef concordd_hook_h
+#define concordd_hook_h 1
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include <sys/select.h>
+#include "time-utils.h"
+
+// Runs trigger scripts (`ZoneChangedCommand`, etc) without letting
+// a burst of panel activity turn into a burst of processes.
+//
+// The environment for each hook is built in the daemon process and
+// the command is started with `posix_spawn()` running `/bin/sh -c`.
+// At most `max_running` hooks run at once; the rest wait in a FIFO
+// backlog of at most `max_backlog` entries, after which new hooks
+// are dropped. Hooks that run for longer than `timeout` are sent
+// SIGTERM, followed by SIGKILL if they still haven't exited.
+//
+// Optionally, the executor can also keep a single long-lived
+// "co-process" running, which receives every hook as one line on
+// its standard input. Each line is a tab-separated list of
+// `KEY=VALUE` pairs, using the same keys as the environment of the
+// individual hooks but without the `CONCORDD_` prefix, e.g.:
+//
+//     TYPE=ZONE<tab>PARTITION_ID=1<tab>ZONE_ID=4<tab>...
+//
+// Tabs, newlines and backslashes in values are escaped as `\t`,
+// `\n` and `\\`. If the co-process exits it is restarted with
+// an exponential backoff, and records are held in a bounded
+// backlog until it is back. When the backlog is full the oldest
+// record is dropped.
+
+#define CONCORDD_HOOK_MAX_ENV               32
+
+#define CONCORDD_HOOK_DEFAULT_MAX_RUNNING   4
+#define CONCORDD_HOOK_DEFAULT_MAX_BACKLOG   128
+#define CONCORDD_HOOK_DEFAULT_TIMEOUT       (60*MSEC_PER_SEC)
+
+// How long to wait after SIGTERM before using SIGKILL.
+#define CONCORDD_HOOK_KILL_GRACE_PERIOD     (2*MSEC_PER_SEC)
+
+#define CONCORDD_HOOK_DEFAULT_COPROCESS_BACKLOG 256
+#define CONCORDD_HOOK_COPROCESS_MIN_BACKOFF (1*MSEC_PER_SEC)
+#define CONCORDD_HOOK_COPROCESS_MAX_BACKOFF (60*MSEC_PER_SEC)
+
+struct concordd_hook_s;
+typedef struct concordd_hook_s *concordd_hook_t;
+
+struct concordd_hook_s {
+	concordd_hook_t next;
+	char* command;
+	char* env[CONCORDD_HOOK_MAX_ENV];
+	int env_count;
+	pid_t pid;
+	cms_t started_at;
+	bool terminated;
+};
+
+struct concordd_hook_coprocess_s {
+	char* command;
+	pid_t pid;
+	int fd;
+	cms_t started_at;
+	cms_t restart_at;
+	cms_t backoff;
+
+	// Ring of pending records. Only the oldest one can be
+	// partially written, `head_offset` bytes of it so far.
+	char** records;
+	int records_size;
+	int records_head;
+	int records_count;
+	size_t head_offset;
+
+	uint32_t restart_count;
+	uint32_t dropped_count;
+};
+
+struct concordd_hook_executor_s;
+typedef struct concordd_hook_executor_s *concordd_hook_executor_t;
+
+struct concordd_hook_executor_s {
+	int max_running;
+	int max_backlog;
+	cms_t timeout;
+
+	concordd_hook_t running;
+	concordd_hook_t backlog_head;
+	concordd_hook_t backlog_tail;
+
+	// Current number of hooks waiting in the backlog.
+	int queued_count;
+
+	// Current number of hooks with a live process.
+	int running_count;
+
+	// Totals since startup.
+	uint32_t spawned_count;
+	uint32_t dropped_count;
+	uint32_t killed_count;
+	uint32_t failed_count;
+
+	struct concordd_hook_coprocess_s coprocess;
+};
+
+// Returns NULL if we are out of memory. `command` may be NULL for
+// hooks that are only going to be sent to the co-process.
+concordd_hook_t concordd_hook_new(const char* command);
+void concordd_hook_free(concordd_hook_t hook);
+
+// Adds `key=value` to the environment of the hook.
+int concordd_hook_setenv(concordd_hook_t hook, const char* key, const char* value);
+int concordd_hook_setenvf(concordd_hook_t hook, const char* key, const char* fmt, ...)
+	__attribute__((format(printf, 3, 4)));
+
+concordd_hook_executor_t concordd_hook_executor_init(
+	concordd_hook_executor_t self,
+	int max_running,
+	int max_backlog,
+	cms_t timeout
+);
+
+// Starts the co-process. Records are only sent once this has
+// been called.
+int concordd_hook_executor_start_coprocess(concordd_hook_executor_t self, const char* command, int backlog);
+
+bool concordd_hook_executor_has_coprocess(concordd_hook_executor_t self);
+
+// Takes ownership of `hook`. The hook is sent to the co-process (if
+// any), and then, if it has a command, started immediately if there
+// is room for it, otherwise it is added to the backlog.
+void concordd_hook_executor_submit(concordd_hook_executor_t self, concordd_hook_t hook);
+
+// Reaps finished children, enforces timeouts and starts hooks
+// from the backlog. Should be called every time through the main
+// loop, including after select() is interrupted by SIGCHLD.
+void concordd_hook_executor_process(concordd_hook_executor_t self);
+
+int concordd_hook_executor_update_fd_set(concordd_hook_executor_t self, fd_set *read_fd_set, fd_set *write_fd_set, fd_set *error_fd_set, int *max_fd, cms_t *timeout);
+
+#endif // ifndef concordd_hook_h
@@ -0,0 +1,260 @@
+/*
+ *
+ * Copyright (c) 2017 Robert Quattlebaum
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifndef ASSERT_MACROS_USE_SYSLOG
+#define ASSERT_MACROS_USE_SYSLOG 1
+#endif
+
+#ifndef ASSERT_MACROS_SQUELCH
+#define ASSERT_MACROS_SQUELCH 0
+#endif
+
+#include "assert-macros.h"
+
+#include "concordd-realtime.h"
+#include <syslog.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+
+#if HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+#if HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
+
+#if HAVE_SCHED_H
+#include <sched.h>
+#endif
+
+#ifndef PREFAULT_PAGE_SIZE
+#define PREFAULT_PAGE_SIZE      4096
+#endif
+
+static const uint32_t gBucketLimits[CONCORDD_LATENCY_BUCKETS - 1] = CONCORDD_LATENCY_BUCKET_LIMITS;
+
+int
+concordd_realtime_lock_memory(void)
+{
+#if HAVE_MLOCKALL
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+		syslog(LOG_ERR, "mlockall() failed: %s", strerror(errno));
+		return -1;
+	}
+	return 0;
+#else
+	syslog(LOG_ERR, "Can't lock memory on this platform");
+	errno = ENOTSUP;
+	return -1;
+#endif
+}
+
+int
+concordd_realtime_init(const struct concordd_realtime_s* config)
+{
+	int ret = 0;
+
+#if HAVE_SETRLIMIT && defined(RLIMIT_MEMLOCK)
+	{
+		struct rlimit limit = { RLIM_INFINITY, RLIM_INFINITY };
+
+		if (setrlimit(RLIMIT_MEMLOCK, &limit) != 0) {
+			syslog(LOG_WARNING, "Unable to raise RLIMIT_MEMLOCK: %s", strerror(errno));
+		}
+	}
+#endif
+
+#if HAVE_SETRLIMIT && defined(RLIMIT_RTPRIO)
+	if (config->priority > 0) {
+		struct rlimit limit = { config->priority, config->priority };
+
+		if (setrlimit(RLIMIT_RTPRIO, &limit) != 0) {
+			syslog(LOG_WARNING, "Unable to raise RLIMIT_RTPRIO: %s", strerror(errno));
+		}
+	}
+#endif
+
+	if (concordd_realtime_lock_memory() != 0) {
+		ret = -1;
+	}
+
+	return ret;
+}
+
+int
+concordd_realtime_enter(const struct concordd_realtime_s* config)
+{
+	int ret = 0;
+
+#if HAVE_SCHED_SETAFFINITY && defined(CPU_SET)
+	if (config->cpu >= 0) {
+		cpu_set_t cpus;
+
+		CPU_ZERO(&cpus);
+		CPU_SET(config->cpu, &cpus);
+
+		if (sched_setaffinity(0, sizeof(cpus), &cpus) != 0) {
+			syslog(LOG_ERR, "Unable to run on CPU %d: %s", config->cpu, strerror(errno));
+			ret = -1;
+		}
+	}
+#else
+	if (config->cpu >= 0) {
+		syslog(LOG_ERR, "Can't set the CPU affinity on this platform");
+		ret = -1;
+	}
+#endif
+
+#if HAVE_SCHED_SETSCHEDULER
+	if (config->priority > 0) {
+		struct sched_param param;
+		int policy = SCHED_FIFO;
+
+#ifdef SCHED_RESET_ON_FORK
+		// Hooks have no business running at our priority.
+		policy |= SCHED_RESET_ON_FORK;
+#endif
+
+		memset(&param, 0, sizeof(param));
+		param.sched_priority = config->priority;
+
+		// On Linux, this only affects the calling thread.
+		if (sched_setscheduler(0, policy, &param) != 0) {
+			syslog(LOG_ERR, "Unable to use SCHED_FIFO priority %d: %s", config->priority, strerror(errno));
+			ret = -1;
+		}
+	}
+#else
+	if (config->priority > 0) {
+		syslog(LOG_ERR, "Can't use real-time scheduling on this platform");
+		ret = -1;
+	}
+#endif
+
+	return ret;
+}
+
+void
+concordd_realtime_prefault_stack(void)
+{
+	volatile uint8_t stack[CONCORDD_REALTIME_STACK_PREFAULT];
+	size_t i;
+
+	for (i = 0; i < sizeof(stack); i += PREFAULT_PAGE_SIZE) {
+		stack[i] = 0;
+	}
+}
+
+void
+concordd_realtime_prefault(void* ptr, size_t len)
+{
+	volatile uint8_t* bytes = ptr;
+	size_t i;
+
+	// Writing the byte back also faults in copy-on-write pages.
+	for (i = 0; i < len; i += PREFAULT_PAGE_SIZE) {
+		bytes[i] = bytes[i];
+	}
+
+	if (len > 0) {
+		bytes[len - 1] = bytes[len - 1];
+	}
+}
+
+uint32_t
+concordd_realtime_usec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint32_t)ts.tv_sec * 1000000u + (uint32_t)(ts.tv_nsec / 1000);
+}
+
+void
+concordd_latency_histogram_start(concordd_latency_histogram_t self, uint32_t usec)
+{
+	if (!self->pending) {
+		self->pending_since = usec;
+		self->pending = true;
+	}
+}
+
+void
+concordd_latency_histogram_finish(concordd_latency_histogram_t self)
+{
+	uint32_t usec;
+	int i;
+
+	if (!self->pending) {
+		return;
+	}
+
+	usec = concordd_realtime_usec() - self->pending_since;
+	self->pending = false;
+
+	for (i = 0; i < CONCORDD_LATENCY_BUCKETS - 1; i++) {
+		if (usec <= gBucketLimits[i]) {
+			break;
+		}
+	}
+
+	// Relaxed atomics, since the D-Bus server may be reading these
+	// from the main thread while the serial thread records.
+	__atomic_fetch_add(&self->buckets[i], 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&self->samples, 1, __ATOMIC_RELAXED);
+
+	if (usec > __atomic_load_n(&self->max_usec, __ATOMIC_RELAXED)) {
+		__atomic_store_n(&self->max_usec, usec, __ATOMIC_RELAXED);
+	}
+}
+
+void
+concordd_latency_histogram_format(concordd_latency_histogram_t self, char* buffer, size_t len)
+{
+	size_t used = 0;
+	int i;
+
+	buffer[0] = 0;
+
+	for (i = 0; i < CONCORDD_LATENCY_BUCKETS && used < len; i++) {
+		uint32_t count = __atomic_load_n(&self->buckets[i], __ATOMIC_RELAXED);
+		int ret;
+
+		if (i < CONCORDD_LATENCY_BUCKETS - 1) {
+			ret = snprintf(buffer + used, len - used, "%s<=%uus:%u", i ? " " : "", gBucketLimits[i], count);
+		} else {
+			ret = snprintf(buffer + used, len - used, " >%uus:%u", gBucketLimits[i - 1], count);
+		}
+
+		if (ret < 0) {
+			break;
+		}
+
+		used += ret;
+	}
+}
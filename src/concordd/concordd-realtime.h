@@ -0,0 +1,99 @@
+/*
+ *
+ * Copyright (c) 2017 Robert Quattlebaum
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef concordd_realtime_h
+#define concordd_realtime_h 1
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Support for running the serial path with low jitter on hosts
+// that are also busy with other things.
+//
+// Real-time mode locks all of our memory, prefaults the stack and
+// the big state structures so that handling a frame never takes a
+// page fault, and moves the thread doing the serial I/O to a
+// SCHED_FIFO priority (and optionally a CPU of its own).
+//
+// To see whether any of that helps, the time from being woken up
+// by incoming bytes until the ACK for them has been written out is
+// recorded in a histogram, whether or not real-time mode is on.
+
+struct concordd_realtime_s {
+	int priority;   // SCHED_FIFO priority, zero if not enabled
+	int cpu;        // CPU to pin the serial path to, -1 for any
+};
+
+// Locks current and future memory into RAM.
+int concordd_realtime_lock_memory(void);
+
+// The part of real-time mode that needs privileges, so it has to be
+// done before dropping them: locks memory, and raises the resource
+// limits so that memory locked from here on and the SCHED_FIFO
+// priority in `config` are still allowed afterwards.
+int concordd_realtime_init(const struct concordd_realtime_s* config);
+
+// Makes the calling thread real-time as described by `config`.
+// Processes started from this thread go back to normal scheduling.
+int concordd_realtime_enter(const struct concordd_realtime_s* config);
+
+// How much of the stack `concordd_realtime_prefault_stack()` touches.
+#define CONCORDD_REALTIME_STACK_PREFAULT    (64*1024)
+
+// Touches the next CONCORDD_REALTIME_STACK_PREFAULT bytes of the
+// calling thread's stack, so that deeper calls later don't fault.
+void concordd_realtime_prefault_stack(void);
+
+// Touches every page of `ptr` without changing the contents.
+void concordd_realtime_prefault(void* ptr, size_t len);
+
+// Microseconds from a monotonic clock. Wraps after about an hour,
+// which is fine for measuring short intervals.
+uint32_t concordd_realtime_usec(void);
+
+// Upper bounds of the histogram buckets, in microseconds. Anything
+// slower ends up in the last bucket.
+#define CONCORDD_LATENCY_BUCKET_LIMITS \
+	{ 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000 }
+
+#define CONCORDD_LATENCY_BUCKETS        11
+
+struct concordd_latency_histogram_s {
+	uint32_t buckets[CONCORDD_LATENCY_BUCKETS];
+	uint32_t samples;
+	uint32_t max_usec;
+
+	// Start of the interval being measured, if `pending`.
+	uint32_t pending_since;
+	bool pending;
+};
+typedef struct concordd_latency_histogram_s *concordd_latency_histogram_t;
+
+// Starts measuring at `usec`, unless we are already measuring.
+void concordd_latency_histogram_start(concordd_latency_histogram_t self, uint32_t usec);
+
+// Records the time since `concordd_latency_histogram_start()`.
+void concordd_latency_histogram_finish(concordd_latency_histogram_t self);
+
+// Formats the histogram as "<=100us:3 <=250us:0 ... >100000us:0".
+// May be called from a thread other than the one recording.
+void concordd_latency_histogram_format(concordd_latency_histogram_t self, char* buffer, size_t len);
+
+#endif // ifndef concordd_realtime_h
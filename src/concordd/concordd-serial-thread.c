@@ -0,0 +1,416 @@
+/*
+ *
+ * Copyright (c) 2017 Robert Quattlebaum
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifndef ASSERT_MACROS_USE_SYSLOG
+#define ASSERT_MACROS_USE_SYSLOG 1
+#endif
+
+#ifndef ASSERT_MACROS_SQUELCH
+#define ASSERT_MACROS_SQUELCH 0
+#endif
+
+#include "assert-macros.h"
+
+#include "concordd-serial-thread.h"
+#include <syslog.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+
+static void
+wake(int* pending, int fd)
+{
+	static const uint8_t byte = 0;
+
+	// Only the first wakeup since the other side last looked
+	// needs to go through the pipe.
+	if (!__atomic_exchange_n(pending, 1, __ATOMIC_SEQ_CST)) {
+		(void)write(fd, &byte, 1);
+	}
+}
+
+static void
+drain_wakeups(int* pending, int fd)
+{
+	uint8_t buffer[32];
+
+	while (read(fd, buffer, sizeof(buffer)) > 0) {
+	}
+
+	// Cleared before looking at the ring, so that anything pushed
+	// from here on wakes us up again.
+	__atomic_store_n(pending, 0, __ATOMIC_SEQ_CST);
+}
+
+static void
+post_event(concordd_serial_thread_t self, uint8_t type, const uint8_t* data, uint8_t len)
+{
+	if (!concordd_spsc_ring_push(&self->rx_ring, type, data, len)) {
+		// Frames never get here without room (see
+		// `thread_can_receive()`), so this is an ACK or NAK for
+		// one of our frames. The main thread will time out
+		// waiting for it and send the frame again.
+		return;
+	}
+
+	wake(&self->main_wake_pending, self->main_wake_pipe[1]);
+}
+
+// ----------------------------------------------------------------------------
+// Serial thread
+
+static ge_rs232_status_t
+thread_send_bytes(void* context, const uint8_t* data, int len, ge_rs232_t link)
+{
+	concordd_serial_thread_t self = context;
+
+	if (concordd_tx_buffer_send(&self->tx_buffer, data, len) != 0) {
+		return GE_RS232_STATUS_ERROR;
+	}
+
+	return GE_RS232_STATUS_OK;
+}
+
+static bool
+thread_can_receive(void* context, uint8_t len, ge_rs232_t link)
+{
+	concordd_serial_thread_t self = context;
+
+	if (!concordd_spsc_ring_has_room(&self->rx_ring, len)) {
+		__atomic_fetch_add(&self->rx_overruns, 1, __ATOMIC_RELAXED);
+		return false;
+	}
+
+	return true;
+}
+
+static ge_rs232_status_t
+thread_received_message(void* context, const uint8_t* data, uint8_t len, ge_rs232_t link)
+{
+	post_event(context, CONCORDD_SERIAL_EVENT_FRAME, data, len);
+	return GE_RS232_STATUS_OK;
+}
+
+static void
+thread_got_response(void* context, ge_rs232_t link, bool didAck)
+{
+	post_event(context, didAck ? CONCORDD_SERIAL_EVENT_ACK : CONCORDD_SERIAL_EVENT_NAK, NULL, 0);
+
+	// Whether the response was expected is for the main thread
+	// to decide, so keep listening for the next one.
+	link->last_response = 0;
+}
+
+static void*
+serial_thread_main(void* context)
+{
+	concordd_serial_thread_t self = context;
+	uint8_t buffer[256];
+	uint8_t type;
+	int len;
+
+	if ((self->realtime.priority > 0) || (self->realtime.cpu >= 0)) {
+		concordd_realtime_enter(&self->realtime);
+	}
+
+	if (self->realtime.priority > 0) {
+		concordd_realtime_prefault_stack();
+	}
+
+	while (!__atomic_load_n(&self->stop, __ATOMIC_SEQ_CST)) {
+		struct pollfd fds[2];
+		uint32_t bad_checksums = self->link.stats.bad_checksums;
+		uint32_t responses = self->link.stats.frames_received + bad_checksums + self->link.stats.rx_overruns;
+		uint32_t woke_at;
+
+		memset(fds, 0, sizeof(fds));
+
+		// Once there is nothing more to read or write, poll() would
+		// only keep telling us about the hangup.
+		fds[0].fd = (self->eof && concordd_tx_buffer_is_empty(&self->tx_buffer)) ? -1 : self->fd;
+		fds[0].events = self->eof ? 0 : POLLIN;
+
+		if (!concordd_tx_buffer_is_empty(&self->tx_buffer)) {
+			fds[0].events |= POLLOUT;
+		}
+
+		fds[1].fd = self->thread_wake_pipe[0];
+		fds[1].events = POLLIN;
+
+		if (poll(fds, 2, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			goto fail;
+		}
+
+		woke_at = concordd_realtime_usec();
+
+		if (fds[1].revents) {
+			drain_wakeups(&self->thread_wake_pending, self->thread_wake_pipe[0]);
+		}
+
+		// ACKs for what we read go out together with whatever the
+		// main thread wants to send next.
+		concordd_tx_buffer_cork(&self->tx_buffer);
+
+		if (!self->eof && (fds[0].revents & (POLLIN | POLLERR | POLLHUP))) {
+			ssize_t ret = read(self->fd, buffer, sizeof(buffer));
+
+			if (ret > 0) {
+				if (self->capture != NULL) {
+					capture_file_write(self->capture, CAPTURE_FILE_RX, buffer, ret);
+				}
+				ge_rs232_receive_bytes(&self->link, buffer, ret);
+			} else if (ret == 0) {
+				if (fds[0].revents & POLLHUP) {
+					// The other end is gone (a pty, `system:` child
+					// or network peer), so the main thread has to
+					// know.
+					errno = EPIPE;
+					goto fail;
+				}
+				// Nothing more to read (like `/dev/null`), but we can
+				// still write.
+				self->eof = true;
+			} else if (errno != EAGAIN && errno != EINTR) {
+				goto fail;
+			}
+		} else if (self->eof && (fds[0].revents & (POLLERR | POLLHUP))) {
+			errno = EPIPE;
+			goto fail;
+		}
+
+		if (responses != self->link.stats.frames_received + self->link.stats.bad_checksums + self->link.stats.rx_overruns) {
+			// We owe the panel an ACK or NAK from here on.
+			concordd_latency_histogram_start(&self->ack_latency, woke_at);
+		}
+
+		while (bad_checksums != self->link.stats.bad_checksums) {
+			post_event(self, CONCORDD_SERIAL_EVENT_BAD_CHECKSUM, NULL, 0);
+			bad_checksums++;
+		}
+
+		// Never start a frame of our own while the panel is in the
+		// middle of one, and don't pile up more than the transport
+		// can take.
+		while ( !self->link.reading_message
+		     && (self->tx_buffer.count < CONCORDD_TX_BUFFER_HIGH_WATER)
+		     && ((len = concordd_spsc_ring_pop(&self->tx_ring, &type, buffer)) >= 0)
+		) {
+			thread_send_bytes(self, buffer, len, &self->link);
+		}
+
+		if (concordd_tx_buffer_uncork(&self->tx_buffer) != 0) {
+			goto fail;
+		}
+
+		if (concordd_tx_buffer_is_empty(&self->tx_buffer)) {
+			concordd_latency_histogram_finish(&self->ack_latency);
+		}
+	}
+
+	return NULL;
+
+fail:
+	len = errno;
+	post_event(self, CONCORDD_SERIAL_EVENT_ERROR, (const uint8_t*)&len, sizeof(len));
+	return NULL;
+}
+
+// ----------------------------------------------------------------------------
+// Main thread
+
+static int
+make_pipe(int fds[2])
+{
+	int i;
+
+	if (pipe(fds) != 0) {
+		return -1;
+	}
+
+	for (i = 0; i < 2; i++) {
+		fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+		fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+	}
+
+	return 0;
+}
+
+int
+concordd_serial_thread_start(
+	concordd_serial_thread_t self,
+	int fd,
+	const struct concordd_realtime_s* realtime,
+	capture_file_t capture
+) {
+	int ret = -1;
+	sigset_t all_signals, old_signals;
+	pthread_attr_t attr;
+
+	memset(self, 0, sizeof(*self));
+	self->fd = fd;
+	self->realtime.cpu = -1;
+
+	if (realtime != NULL) {
+		self->realtime = *realtime;
+	}
+
+	if ((capture != NULL) && (capture->file != NULL)) {
+		self->capture = capture;
+	}
+
+	self->main_wake_pipe[0] = self->main_wake_pipe[1] = -1;
+	self->thread_wake_pipe[0] = self->thread_wake_pipe[1] = -1;
+
+	ge_rs232_init(&self->link);
+	self->link.context = self;
+	self->link.send_bytes = &thread_send_bytes;
+	self->link.received_message = &thread_received_message;
+	self->link.can_receive = &thread_can_receive;
+	self->link.got_response = &thread_got_response;
+	self->link.response_context = self;
+	self->link.last_response = 0;
+
+	concordd_tx_buffer_init(&self->tx_buffer, fd);
+	self->tx_buffer.capture = self->capture;
+	concordd_spsc_ring_init(&self->rx_ring);
+	concordd_spsc_ring_init(&self->tx_ring);
+
+	require_string(make_pipe(self->main_wake_pipe) == 0, bail, strerror(errno));
+	require_string(make_pipe(self->thread_wake_pipe) == 0, bail, strerror(errno));
+
+	// Signals are for the main thread to handle.
+	sigfillset(&all_signals);
+	pthread_sigmask(SIG_BLOCK, &all_signals, &old_signals);
+	pthread_attr_init(&attr);
+	pthread_attr_setstacksize(&attr, CONCORDD_SERIAL_THREAD_STACK_SIZE);
+	ret = pthread_create(&self->thread, &attr, &serial_thread_main, self);
+	pthread_attr_destroy(&attr);
+	pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+
+	if (ret != 0) {
+		syslog(LOG_ERR, "Unable to start serial thread: %s", strerror(ret));
+		ret = -1;
+		goto bail;
+	}
+
+	self->running = true;
+	ret = 0;
+
+bail:
+	if (ret != 0) {
+		concordd_serial_thread_stop(self);
+	}
+	return ret;
+}
+
+void
+concordd_serial_thread_stop(concordd_serial_thread_t self)
+{
+	int i;
+
+	if (self->running) {
+		__atomic_store_n(&self->stop, 1, __ATOMIC_SEQ_CST);
+		__atomic_store_n(&self->thread_wake_pending, 0, __ATOMIC_SEQ_CST);
+		wake(&self->thread_wake_pending, self->thread_wake_pipe[1]);
+		pthread_join(self->thread, NULL);
+		self->running = false;
+	}
+
+	for (i = 0; i < 2; i++) {
+		if (self->main_wake_pipe[i] >= 0) {
+			close(self->main_wake_pipe[i]);
+			self->main_wake_pipe[i] = -1;
+		}
+		if (self->thread_wake_pipe[i] >= 0) {
+			close(self->thread_wake_pipe[i]);
+			self->thread_wake_pipe[i] = -1;
+		}
+	}
+}
+
+int
+concordd_serial_thread_get_fd(concordd_serial_thread_t self)
+{
+	return self->main_wake_pipe[0];
+}
+
+int
+concordd_serial_thread_send(concordd_serial_thread_t self, const uint8_t* data, int len)
+{
+	if ((len > 255) || !concordd_spsc_ring_push(&self->tx_ring, 0, data, (uint8_t)len)) {
+		errno = ENOBUFS;
+		return -1;
+	}
+
+	wake(&self->thread_wake_pending, self->thread_wake_pipe[1]);
+
+	return 0;
+}
+
+int
+concordd_serial_thread_process(concordd_serial_thread_t self, ge_rs232_t link)
+{
+	uint8_t data[256];
+	uint8_t type;
+	int len;
+
+	drain_wakeups(&self->main_wake_pending, self->main_wake_pipe[0]);
+
+	while ((len = concordd_spsc_ring_pop(&self->rx_ring, &type, data)) >= 0) {
+		switch (type) {
+		case CONCORDD_SERIAL_EVENT_FRAME:
+			link->stats.frames_received++;
+			link->received_message(link->context, data, len, link);
+			break;
+
+		case CONCORDD_SERIAL_EVENT_ACK:
+			ge_rs232_receive_byte(link, GE_RS232_ACK);
+			break;
+
+		case CONCORDD_SERIAL_EVENT_NAK:
+			ge_rs232_receive_byte(link, GE_RS232_NAK);
+			break;
+
+		case CONCORDD_SERIAL_EVENT_BAD_CHECKSUM:
+			link->stats.bad_checksums++;
+			break;
+
+		case CONCORDD_SERIAL_EVENT_ERROR:
+			if (len == sizeof(int)) {
+				memcpy(&errno, data, sizeof(int));
+			}
+			syslog(LOG_ERR, "Serial thread failed: %s", strerror(errno));
+			return -1;
+		}
+	}
+
+	link->stats.rx_overruns = __atomic_load_n(&self->rx_overruns, __ATOMIC_RELAXED);
+
+	return 0;
+}
@@ -0,0 +1,104 @@
+/*
+ *
+ * Copyright (c) 2017 Robert Quattlebaum
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef concordd_serial_thread_h
+#define concordd_serial_thread_h 1
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "ge-rs232.h"
+#include "concordd-spsc-ring.h"
+#include "concordd-tx-buffer.h"
+#include "concordd-realtime.h"
+#include "capture-file.h"
+
+// Optional thread that owns the serial port, so that how quickly
+// we ACK the panel doesn't depend on how busy the main thread is.
+//
+// The thread does the framing, checks checksums and answers each
+// frame with an ACK or NAK right away. Good frames, and the ACKs
+// and NAKs the panel sends for our frames, are handed to the main
+// thread through `rx_ring`. Everything else (the queue, the
+// retransmit timer, decoding) stays on the main thread, whose
+// outgoing bytes reach the thread through `tx_ring`. The rings are
+// lock-free; each direction also has a pipe that is written to
+// only when the other side might be asleep.
+
+#define CONCORDD_SERIAL_EVENT_FRAME         1
+#define CONCORDD_SERIAL_EVENT_ACK           2
+#define CONCORDD_SERIAL_EVENT_NAK           3
+#define CONCORDD_SERIAL_EVENT_BAD_CHECKSUM  4
+#define CONCORDD_SERIAL_EVENT_ERROR         5
+
+// Small, since with real-time mode on all of it is locked into RAM.
+#define CONCORDD_SERIAL_THREAD_STACK_SIZE   (128*1024)
+
+struct concordd_serial_thread_s {
+	int fd;
+	pthread_t thread;
+	bool running;
+
+	// Everything from here down to the rings is only touched by
+	// the thread once it is running.
+	struct ge_rs232_s link;
+	struct concordd_tx_buffer_s tx_buffer;
+	bool eof;
+	struct concordd_realtime_s realtime;
+	capture_file_t capture;
+
+	// Recorded by the thread, read by the main thread.
+	struct concordd_latency_histogram_s ack_latency;
+	uint32_t rx_overruns;   // Frames NAKed for lack of room in `rx_ring`
+
+	struct concordd_spsc_ring_s rx_ring;    // Thread to main
+	struct concordd_spsc_ring_s tx_ring;    // Main to thread
+
+	int main_wake_pipe[2];
+	int thread_wake_pipe[2];
+	int main_wake_pending;
+	int thread_wake_pending;
+	int stop;
+};
+typedef struct concordd_serial_thread_s *concordd_serial_thread_t;
+
+// If `realtime` isn't NULL, the thread makes itself real-time
+// as described. If `capture` is open, the thread records all
+// serial traffic to it.
+int concordd_serial_thread_start(
+	concordd_serial_thread_t self,
+	int fd,
+	const struct concordd_realtime_s* realtime,
+	capture_file_t capture
+);
+void concordd_serial_thread_stop(concordd_serial_thread_t self);
+
+// Descriptor that becomes readable when there is something for
+// `concordd_serial_thread_process()` to do.
+int concordd_serial_thread_get_fd(concordd_serial_thread_t self);
+
+// Hands `len` bytes to the thread to write out, all or nothing.
+// Returns zero, or -1 with `errno` set to ENOBUFS if there is no room.
+int concordd_serial_thread_send(concordd_serial_thread_t self, const uint8_t* data, int len);
+
+// Feeds everything the thread has received into `link`, the main
+// thread's protocol state. Returns -1 if the serial port failed.
+int concordd_serial_thread_process(concordd_serial_thread_t self, ge_rs232_t link);
+
+#endif // ifndef concordd_serial_thread_h
@@ -0,0 +1,112 @@
+/*
+ *
+ * Copyright (c) 2017 Robert Quattlebaum
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "concordd-spsc-ring.h"
+#include <string.h>
+
+#define RING_MASK   (CONCORDD_SPSC_RING_SIZE - 1)
+
+void
+concordd_spsc_ring_init(concordd_spsc_ring_t self)
+{
+	memset(self, 0, sizeof(*self));
+}
+
+static void
+ring_write(concordd_spsc_ring_t self, uint32_t pos, const uint8_t* data, uint32_t len)
+{
+	uint32_t offset = pos & RING_MASK;
+	uint32_t first = CONCORDD_SPSC_RING_SIZE - offset;
+
+	if (first > len) {
+		first = len;
+	}
+
+	memcpy(self->data + offset, data, first);
+	memcpy(self->data, data + first, len - first);
+}
+
+static void
+ring_read(concordd_spsc_ring_t self, uint32_t pos, uint8_t* data, uint32_t len)
+{
+	uint32_t offset = pos & RING_MASK;
+	uint32_t first = CONCORDD_SPSC_RING_SIZE - offset;
+
+	if (first > len) {
+		first = len;
+	}
+
+	memcpy(data, self->data + offset, first);
+	memcpy(data + first, self->data, len - first);
+}
+
+bool
+concordd_spsc_ring_has_room(concordd_spsc_ring_t self, uint8_t len)
+{
+	uint32_t tail = __atomic_load_n(&self->tail, __ATOMIC_RELAXED);
+	uint32_t head = __atomic_load_n(&self->head, __ATOMIC_ACQUIRE);
+
+	return CONCORDD_SPSC_RING_SIZE - (tail - head) >= (uint32_t)len + 2;
+}
+
+bool
+concordd_spsc_ring_push(concordd_spsc_ring_t self, uint8_t type, const void* data, uint8_t len)
+{
+	uint32_t tail = __atomic_load_n(&self->tail, __ATOMIC_RELAXED);
+	const uint8_t header[2] = { type, len };
+
+	if (!concordd_spsc_ring_has_room(self, len)) {
+		self->dropped_count++;
+		return false;
+	}
+
+	ring_write(self, tail, header, sizeof(header));
+	ring_write(self, tail + sizeof(header), data, len);
+
+	// Publish the record only once all of it is in place.
+	__atomic_store_n(&self->tail, tail + sizeof(header) + len, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+int
+concordd_spsc_ring_pop(concordd_spsc_ring_t self, uint8_t* type, void* data)
+{
+	uint32_t head = __atomic_load_n(&self->head, __ATOMIC_RELAXED);
+	uint32_t tail = __atomic_load_n(&self->tail, __ATOMIC_ACQUIRE);
+	uint8_t header[2];
+
+	if (head == tail) {
+		return -1;
+	}
+
+	ring_read(self, head, header, sizeof(header));
+	ring_read(self, head + sizeof(header), data, header[1]);
+
+	// Hand the space back only after we are done reading from it.
+	__atomic_store_n(&self->head, head + sizeof(header) + header[1], __ATOMIC_RELEASE);
+
+	*type = header[0];
+
+	return header[1];
+}
@@ -0,0 +1,59 @@
+/*
+ *
+ * Copyright (c) 2017 Robert Quattlebaum
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef concordd_spsc_ring_h
+#define concordd_spsc_ring_h 1
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Lock-free ring of small records, for exactly one producer thread
+// and one consumer thread. Each record is a type byte and up to 255
+// bytes of payload. A record is only ever pushed whole; if there
+// isn't room for it, the push fails and nothing is written.
+
+#define CONCORDD_SPSC_RING_SIZE     4096    // Must be a power of two
+
+struct concordd_spsc_ring_s {
+	uint8_t data[CONCORDD_SPSC_RING_SIZE];
+
+	// Free-running positions. `head` is only written by the
+	// consumer and `tail` only by the producer.
+	uint32_t head;
+	uint32_t tail;
+
+	// Written by the producer only.
+	uint32_t dropped_count;
+};
+typedef struct concordd_spsc_ring_s *concordd_spsc_ring_t;
+
+void concordd_spsc_ring_init(concordd_spsc_ring_t self);
+
+// Producer side. Returns false if the ring is full.
+bool concordd_spsc_ring_push(concordd_spsc_ring_t self, uint8_t type, const void* data, uint8_t len);
+
+// Producer side. True if a record with `len` bytes of payload fits.
+bool concordd_spsc_ring_has_room(concordd_spsc_ring_t self, uint8_t len);
+
+// Consumer side. Copies the oldest record into `data`, which must
+// have room for 255 bytes, and returns its length, or -1 if the
+// ring is empty.
+int concordd_spsc_ring_pop(concordd_spsc_ring_t self, uint8_t* type, void* data);
+
+#endif // ifndef concordd_spsc_ring_h
@@ -0,0 +1,313 @@
+/*
+ *
+ * Copyright (c) 2017 Robert Quattlebaum
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifndef ASSERT_MACROS_USE_SYSLOG
+#define ASSERT_MACROS_USE_SYSLOG 1
+#endif
+
+#ifndef ASSERT_MACROS_SQUELCH
+#define ASSERT_MACROS_SQUELCH 0
+#endif
+
+#include "assert-macros.h"
+
+#include "concordd-state-file.h"
+#include <syslog.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+struct concordd_state_file_header_s {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t header_size;
+
+	uint32_t serial_number;
+	uint16_t sw_rev;
+	uint16_t hw_rev;
+	uint8_t panel_type;
+	uint8_t ac_power_failure;
+	uint8_t event_log_last;
+	uint8_t reserved;
+	int64_t ac_power_failure_changed_timestamp;
+
+	uint32_t partition_size;
+	uint32_t zone_size;
+	uint32_t output_size;
+	uint32_t trouble_events_size;
+	uint32_t event_log_size;
+	uint32_t event_seq;
+
+	uint32_t checksum;
+};
+
+struct concordd_state_file_section_s {
+	void* ptr;
+	size_t size;
+};
+
+#define STATE_FILE_SECTION_COUNT 5
+
+static void
+get_sections(concordd_instance_t self, struct concordd_state_file_section_s sections[STATE_FILE_SECTION_COUNT])
+{
+	sections[0].ptr = self->partition;
+	sections[0].size = sizeof(self->partition);
+	sections[1].ptr = self->zone;
+	sections[1].size = sizeof(self->zone);
+	sections[2].ptr = self->output;
+	sections[2].size = sizeof(self->output);
+	sections[3].ptr = self->trouble_events;
+	sections[3].size = sizeof(self->trouble_events);
+	sections[4].ptr = self->event_log;
+	sections[4].size = sizeof(self->event_log);
+}
+
+// 32-bit FNV-1a
+static uint32_t
+checksum_update(uint32_t hash, const void* data, size_t len)
+{
+	const uint8_t* bytes = data;
+
+	while (len--) {
+		hash ^= *bytes++;
+		hash *= 16777619;
+	}
+
+	return hash;
+}
+
+#define CHECKSUM_INIT 2166136261u
+
+static void
+fill_header(concordd_instance_t self, struct concordd_state_file_header_s* header)
+{
+	memset(header, 0, sizeof(*header));
+
+	header->magic = CONCORDD_STATE_FILE_MAGIC;
+	header->version = CONCORDD_STATE_FILE_VERSION;
+	header->header_size = sizeof(*header);
+
+	header->partition_size = sizeof(self->partition);
+	header->zone_size = sizeof(self->zone);
+	header->output_size = sizeof(self->output);
+	header->trouble_events_size = sizeof(self->trouble_events);
+	header->event_log_size = sizeof(self->event_log);
+}
+
+int
+concordd_state_file_save(concordd_instance_t self, const char* path)
+{
+	int ret = -1;
+	struct concordd_state_file_header_s header;
+	struct concordd_state_file_section_s sections[STATE_FILE_SECTION_COUNT];
+	char tmp_path[512];
+	FILE* file = NULL;
+	int i;
+
+	require(path != NULL, bail);
+
+	snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+	fill_header(self, &header);
+
+	header.serial_number = self->serial_number;
+	header.sw_rev = self->sw_rev;
+	header.hw_rev = self->hw_rev;
+	header.panel_type = self->panel_type;
+	header.ac_power_failure = self->ac_power_failure;
+	header.event_log_last = self->event_log_last;
+	header.event_seq = self->event_seq;
+	header.ac_power_failure_changed_timestamp = self->ac_power_failure_changed_timestamp;
+
+	get_sections(self, sections);
+
+	header.checksum = CHECKSUM_INIT;
+	for (i = 0; i < STATE_FILE_SECTION_COUNT; i++) {
+		header.checksum = checksum_update(header.checksum, sections[i].ptr, sections[i].size);
+	}
+
+	file = fopen(tmp_path, "wb");
+
+	if (file == NULL) {
+		syslog(LOG_ERR, "Unable to open state file \"%s\": %s", tmp_path, strerror(errno));
+		goto bail;
+	}
+
+	require(fwrite(&header, sizeof(header), 1, file) == 1, bail);
+
+	for (i = 0; i < STATE_FILE_SECTION_COUNT; i++) {
+		require(fwrite(sections[i].ptr, sections[i].size, 1, file) == 1, bail);
+	}
+
+	require(fflush(file) == 0, bail);
+
+	// Make sure the data is on disk before the rename makes it visible.
+	fsync(fileno(file));
+
+	fclose(file);
+	file = NULL;
+
+	if (rename(tmp_path, path) != 0) {
+		syslog(LOG_ERR, "Unable to rename \"%s\" to \"%s\": %s", tmp_path, path, strerror(errno));
+		unlink(tmp_path);
+		goto bail;
+	}
+
+	syslog(LOG_DEBUG, "Saved state to \"%s\"", path);
+
+	ret = 0;
+
+bail:
+	if (file != NULL) {
+		fclose(file);
+		unlink(tmp_path);
+	}
+	return ret;
+}
+
+int
+concordd_state_file_load(concordd_instance_t self, const char* path)
+{
+	int ret = -1;
+	struct concordd_state_file_header_s header;
+	struct concordd_state_file_header_s expected;
+	struct concordd_state_file_section_s sections[STATE_FILE_SECTION_COUNT];
+	uint8_t* payload = NULL;
+	size_t payload_size = 0;
+	uint8_t* ptr;
+	uint32_t checksum = CHECKSUM_INIT;
+	FILE* file = NULL;
+	int i;
+
+	require(path != NULL, bail);
+
+	file = fopen(path, "rb");
+
+	if (file == NULL) {
+		if (errno != ENOENT) {
+			syslog(LOG_WARNING, "Unable to open state file \"%s\": %s", path, strerror(errno));
+		}
+		goto bail;
+	}
+
+	if (fread(&header, sizeof(header), 1, file) != 1) {
+		syslog(LOG_WARNING, "State file \"%s\" is truncated", path);
+		goto bail;
+	}
+
+	fill_header(self, &expected);
+
+	if ( (header.magic != expected.magic)
+	  || (header.version != expected.version)
+	  || (header.header_size != expected.header_size)
+	  || (header.partition_size != expected.partition_size)
+	  || (header.zone_size != expected.zone_size)
+	  || (header.output_size != expected.output_size)
+	  || (header.trouble_events_size != expected.trouble_events_size)
+	  || (header.event_log_size != expected.event_log_size)
+	) {
+		syslog(LOG_WARNING, "State file \"%s\" has an incompatible format, ignoring", path);
+		goto bail;
+	}
+
+	get_sections(self, sections);
+
+	for (i = 0; i < STATE_FILE_SECTION_COUNT; i++) {
+		payload_size += sections[i].size;
+	}
+
+	payload = malloc(payload_size);
+
+	require(payload != NULL, bail);
+
+	if (fread(payload, payload_size, 1, file) != 1) {
+		syslog(LOG_WARNING, "State file \"%s\" is truncated", path);
+		goto bail;
+	}
+
+	checksum = checksum_update(checksum, payload, payload_size);
+
+	if (checksum != header.checksum) {
+		syslog(LOG_WARNING, "State file \"%s\" is corrupt, ignoring", path);
+		goto bail;
+	}
+
+	// Everything checks out, commit it.
+	for (i = 0, ptr = payload; i < STATE_FILE_SECTION_COUNT; ptr += sections[i].size, i++) {
+		memcpy(sections[i].ptr, ptr, sections[i].size);
+	}
+
+	self->serial_number = header.serial_number;
+	self->sw_rev = header.sw_rev;
+	self->hw_rev = header.hw_rev;
+	self->panel_type = header.panel_type;
+	self->ac_power_failure = header.ac_power_failure;
+	self->event_log_last = header.event_log_last;
+	self->event_seq = header.event_seq;
+	concordd_event_log_reindex(self);
+	self->ac_power_failure_changed_timestamp = (time_t)header.ac_power_failure_changed_timestamp;
+
+	for (i = 0; i < sizeof(self->partition)/sizeof(self->partition[0]); i++) {
+		concordd_partition_t partition = &self->partition[i];
+
+		// Transient conditions will be re-reported by the panel
+		// if they are still going on.
+		partition->programming_mode = false;
+		partition->entry_delay_active = false;
+		partition->exit_delay_active = false;
+		partition->siren_repeat = 0;
+		partition->siren_cadence = 0;
+		partition->siren_started_at = 0;
+		partition->stale = partition->active;
+	}
+
+	for (i = 0; i < sizeof(self->zone)/sizeof(self->zone[0]); i++) {
+		self->zone[i].stale = self->zone[i].active;
+	}
+
+	for (i = 0; i < sizeof(self->output)/sizeof(self->output[0]); i++) {
+		self->output[i].stale = self->output[i].active;
+	}
+
+	self->state_restored = true;
+
+	syslog(LOG_NOTICE, "Restored state for panel SN:0x%08x SR:0x%04X from \"%s\"",
+		self->serial_number,
+		self->sw_rev,
+		path
+	);
+
+	ret = 0;
+
+bail:
+	free(payload);
+
+	if (file != NULL) {
+		fclose(file);
+	}
+
+	return ret;
+}
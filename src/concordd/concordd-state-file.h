@@ -0,0 +1,46 @@
+/*
+ *
+ * Copyright (c) 2017 Robert Quattlebaum
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef concordd_state_file_h
+#define concordd_state_file_h 1
+
+#include "concordd.h"
+
+// On-disk image of the panel state, used to answer clients
+// immediately after a restart while the equipment list is
+// being re-read from the panel.
+//
+// The image is a raw copy of the in-memory structures, so the
+// header records the size of each section. A file written by a
+// build with a different layout is rejected rather than misread.
+
+#define CONCORDD_STATE_FILE_MAGIC       0x43435354 // "CCST"
+#define CONCORDD_STATE_FILE_VERSION     2
+
+// Writes the state of `self` to `path`. The file is written to a
+// temporary file first and then renamed into place.
+int concordd_state_file_save(concordd_instance_t self, const char* path);
+
+// Restores the state of `self` from `path`. Should be called after
+// `concordd_init()` but before any frames are handled. All restored
+// objects are marked stale, so that the next equipment refresh
+// removes anything the panel no longer reports.
+int concordd_state_file_load(concordd_instance_t self, const char* path);
+
+#endif // ifndef concordd_state_file_h
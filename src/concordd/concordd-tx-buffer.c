@@ -0,0 +1,162 @@
+/*
+ *
+ * Copyright (c) 2017 Robert Quattlebaum
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "concordd-tx-buffer.h"
+#include <syslog.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+void
+concordd_tx_buffer_init(concordd_tx_buffer_t self, int fd)
+{
+	memset(self, 0, sizeof(*self));
+	self->fd = fd;
+}
+
+bool
+concordd_tx_buffer_is_empty(concordd_tx_buffer_t self)
+{
+	return self->count == 0;
+}
+
+int
+concordd_tx_buffer_send(concordd_tx_buffer_t self, const uint8_t* data, size_t len)
+{
+	size_t tail;
+	size_t first;
+
+	if ((len > 1) && (self->count >= CONCORDD_TX_BUFFER_HIGH_WATER)) {
+		self->high_water_count++;
+		errno = ENOBUFS;
+		return -1;
+	}
+
+	if (len > CONCORDD_TX_BUFFER_SIZE - self->count) {
+		self->error_count++;
+		errno = ENOBUFS;
+		return -1;
+	}
+
+	tail = (self->head + self->count) % CONCORDD_TX_BUFFER_SIZE;
+	first = CONCORDD_TX_BUFFER_SIZE - tail;
+
+	if (first > len) {
+		first = len;
+	}
+
+	memcpy(self->data + tail, data, first);
+	memcpy(self->data, data + first, len - first);
+	self->count += len;
+
+	if (self->count > self->peak) {
+		self->peak = self->count;
+	}
+
+	if (len > 1) {
+		self->frame_pending = true;
+	}
+
+	if (self->corked) {
+		return 0;
+	}
+
+	return concordd_tx_buffer_flush(self);
+}
+
+int
+concordd_tx_buffer_flush(concordd_tx_buffer_t self)
+{
+	while (self->count != 0) {
+		struct iovec iov[2];
+		int iovcnt = 1;
+		ssize_t written;
+
+		iov[0].iov_base = self->data + self->head;
+		iov[0].iov_len = self->count;
+
+		if (self->head + self->count > CONCORDD_TX_BUFFER_SIZE) {
+			// Wrapped around.
+			iov[0].iov_len = CONCORDD_TX_BUFFER_SIZE - self->head;
+			iov[1].iov_base = self->data;
+			iov[1].iov_len = self->count - iov[0].iov_len;
+			iovcnt = 2;
+		}
+
+		written = writev(self->fd, iov, iovcnt);
+
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+				// Try again once the descriptor is writable.
+				self->stall_count++;
+				break;
+			}
+
+			self->error_count++;
+			syslog(LOG_ERR, "Error on writev(): %s (%d bytes pending)", strerror(errno), (int)self->count);
+			return -1;
+		}
+
+		if ((self->capture != NULL) && (written > 0)) {
+			size_t first = (size_t)written;
+
+			if (first > iov[0].iov_len) {
+				first = iov[0].iov_len;
+			}
+
+			capture_file_write(self->capture, CAPTURE_FILE_TX, iov[0].iov_base, first);
+
+			if ((size_t)written > first) {
+				capture_file_write(self->capture, CAPTURE_FILE_TX, iov[1].iov_base, written - first);
+			}
+		}
+
+		self->head = (self->head + written) % CONCORDD_TX_BUFFER_SIZE;
+		self->count -= written;
+	}
+
+	if (self->count == 0) {
+		self->head = 0;
+		self->frame_pending = false;
+	}
+
+	return 0;
+}
+
+void
+concordd_tx_buffer_cork(concordd_tx_buffer_t self)
+{
+	self->corked = true;
+}
+
+int
+concordd_tx_buffer_uncork(concordd_tx_buffer_t self)
+{
+	self->corked = false;
+	return concordd_tx_buffer_flush(self);
+}
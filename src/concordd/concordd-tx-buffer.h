@@ -0,0 +1,86 @@
+/*
+ *
+ * Copyright (c) 2017 Robert Quattlebaum
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef concordd_tx_buffer_h
+#define concordd_tx_buffer_h 1
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "capture-file.h"
+
+// Outbound byte ring for the (non-blocking) serial transport.
+//
+// Bytes are only ever accepted a whole write at a time, so a frame
+// that the transport can't take all at once is finished from the
+// ring when the descriptor becomes writable again, and nothing else
+// gets spliced into the middle of it. While the ring is "corked",
+// writes are held back so that the ACK for an incoming frame and
+// whatever we send next go out in a single writev().
+
+#define CONCORDD_TX_BUFFER_SIZE         1024
+
+// Once this many bytes are waiting, new frames are turned away
+// until the transport catches up. Single-byte ACKs and NAKs are
+// always accepted.
+#define CONCORDD_TX_BUFFER_HIGH_WATER   256
+
+struct concordd_tx_buffer_s {
+	int fd;
+
+	uint8_t data[CONCORDD_TX_BUFFER_SIZE];
+	size_t head;
+	size_t count;
+
+	bool corked;
+
+	// If set, bytes are recorded here as write() takes them, so that
+	// they line up with the received bytes in time.
+	capture_file_t capture;
+
+	// A frame (as opposed to only ACKs or NAKs) is still in the ring.
+	bool frame_pending;
+
+	// Statistics
+	size_t peak;
+	uint32_t stall_count;       // write() couldn't take everything
+	uint32_t high_water_count;  // Frames turned away
+	uint32_t error_count;
+};
+typedef struct concordd_tx_buffer_s *concordd_tx_buffer_t;
+
+void concordd_tx_buffer_init(concordd_tx_buffer_t self, int fd);
+
+// Queues `len` bytes and, unless corked, tries to write them out.
+// Returns zero on success, or -1 with `errno` set to ENOBUFS if the
+// bytes don't fit, or to whatever write() failed with.
+int concordd_tx_buffer_send(concordd_tx_buffer_t self, const uint8_t* data, size_t len);
+
+// Writes out as much as the descriptor will take. Returns zero,
+// or -1 if the descriptor is broken.
+int concordd_tx_buffer_flush(concordd_tx_buffer_t self);
+
+void concordd_tx_buffer_cork(concordd_tx_buffer_t self);
+
+// Uncorks and flushes.
+int concordd_tx_buffer_uncork(concordd_tx_buffer_t self);
+
+bool concordd_tx_buffer_is_empty(concordd_tx_buffer_t self);
+
+#endif // ifndef concordd_tx_buffer_h
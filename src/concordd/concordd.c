@@ -36,6 +36,19 @@
 #include <syslog.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Identity keys for outbound messages, see `GE_QUEUE_KEY_NONE`.
+#define CONCORDD_QUEUE_KEY(kind, a, b)     (((uint32_t)(kind)<<16) | ((uint32_t)(uint8_t)(a)<<8) | (uint8_t)(b))
+#define CONCORDD_QUEUE_KEY_LIGHT           1   // (partition, light)
+#define CONCORDD_QUEUE_KEY_OUTPUT          2   // (output, state)
+#define CONCORDD_QUEUE_KEY_REFRESH         3   // (refresh kind, 0)
+
+#define CONCORDD_REFRESH_KIND_EQUIPMENT    0
+#define CONCORDD_REFRESH_KIND_DYNAMIC      1
+
+static ge_rs232_status_t concordd_queue_keys(concordd_instance_t self, int partition, const char* keys, uint32_t key, cms_t deadline, void (*finished)(void* context,ge_rs232_status_t status),void* context);
 
 concordd_partition_t
 concordd_get_partition(concordd_instance_t self, int i)
@@ -55,9 +68,224 @@ concordd_get_partition_index(concordd_instance_t self, concordd_partition_t part
     return (int)(partition - self->partition);
 }
 
+// Slot in `event_log` of the event with the given `seq`, or -1
+// if it has been overwritten (or was never there).
+static int
+concordd_event_log_slot(concordd_instance_t self, uint32_t seq)
+{
+	uint32_t age = self->event_seq - seq;
+	int slot;
+
+	if ((seq == 0) || (seq > self->event_seq) || (age >= CONCORDD_EVENT_LOG_MAX)) {
+		return -1;
+	}
+
+	slot = (self->event_log_last + CONCORDD_EVENT_LOG_MAX - age) % CONCORDD_EVENT_LOG_MAX;
+
+	if (!self->event_log[slot].valid || (self->event_log[slot].seq != seq)) {
+		return -1;
+	}
+
+	return slot;
+}
+
+// Links the event in `slot`, which must be the newest one
+// indexed so far, into the zone and partition indexes.
+static void
+concordd_event_log_index(concordd_instance_t self, int slot)
+{
+	concordd_event_t event = &self->event_log[slot];
+
+	self->event_log_prev_zone[slot] = 0;
+	self->event_log_prev_partition[slot] = 0;
+
+	if (event->zone_id < CONCORDD_MAX_ZONES) {
+		self->event_log_prev_zone[slot] = self->zone_last_event[event->zone_id];
+		self->zone_last_event[event->zone_id] = event->seq;
+	}
+
+	if (event->partition_id < CONCORDD_MAX_PARTITIONS) {
+		self->event_log_prev_partition[slot] = self->partition_last_event[event->partition_id];
+		self->partition_last_event[event->partition_id] = event->seq;
+	}
+}
+
+void
+concordd_event_log_reindex(concordd_instance_t self)
+{
+	int i;
+
+	memset(self->zone_last_event, 0, sizeof(self->zone_last_event));
+	memset(self->partition_last_event, 0, sizeof(self->partition_last_event));
+
+	// Oldest first, so that each event ends up linked to the one before it.
+	for (i = 1; i <= CONCORDD_EVENT_LOG_MAX; i++) {
+		int slot = (self->event_log_last + i) % CONCORDD_EVENT_LOG_MAX;
+
+		if (self->event_log[slot].valid) {
+			concordd_event_log_index(self, slot);
+		} else {
+			self->event_log_prev_zone[slot] = 0;
+			self->event_log_prev_partition[slot] = 0;
+		}
+	}
+}
+
+concordd_event_t
+concordd_event_log_get(concordd_instance_t self, uint32_t seq)
+{
+	int slot = concordd_event_log_slot(self, seq);
+
+	return (slot < 0) ? NULL : &self->event_log[slot];
+}
+
+static bool
+concordd_event_matches(const struct concordd_event_s* event, const struct concordd_event_filter_s* filter)
+{
+	if (filter == NULL) {
+		return true;
+	}
+
+	return ((filter->partition_id < 0) || (event->partition_id == filter->partition_id))
+		&& ((filter->zone_id < 0) || (event->zone_id == filter->zone_id))
+		&& ((filter->general_type < 0) || (event->general_type == filter->general_type))
+		&& ((filter->since == 0) || (event->timestamp >= filter->since))
+		&& ((filter->until == 0) || (event->timestamp < filter->until));
+}
+
+int
+concordd_event_log_query(concordd_instance_t self, uint32_t cursor, bool newest_first, const struct concordd_event_filter_s* filter, concordd_event_t* events, int max)
+{
+	concordd_event_t matches[CONCORDD_EVENT_LOG_MAX];
+	const uint32_t* prev = NULL;
+	uint32_t seq = self->event_seq;
+	int count = 0;
+	int ret = 0;
+
+	// Everything is found by walking back from the newest event,
+	// following the zone or partition index if the filter has one.
+	if ((filter != NULL) && (filter->zone_id >= 0)) {
+		if (filter->zone_id >= CONCORDD_MAX_ZONES) {
+			return 0;
+		}
+		seq = self->zone_last_event[filter->zone_id];
+		prev = self->event_log_prev_zone;
+
+	} else if ((filter != NULL) && (filter->partition_id >= 0)) {
+		if (filter->partition_id >= CONCORDD_MAX_PARTITIONS) {
+			return 0;
+		}
+		seq = self->partition_last_event[filter->partition_id];
+		prev = self->event_log_prev_partition;
+	}
+
+	if (max <= 0) {
+		return 0;
+	}
+
+	while (count < CONCORDD_EVENT_LOG_MAX) {
+		int slot = concordd_event_log_slot(self, seq);
+
+		if ((slot < 0) || (!newest_first && (seq <= cursor))) {
+			break;
+		}
+
+		if ( (!newest_first || (cursor == 0) || (seq < cursor))
+		  && concordd_event_matches(&self->event_log[slot], filter)
+		) {
+			matches[count++] = &self->event_log[slot];
+
+			if (newest_first && (count == max)) {
+				break;
+			}
+		}
+
+		seq = (prev != NULL) ? prev[slot] : seq - 1;
+	}
+
+	if (newest_first) {
+		for (ret = 0; ret < count; ret++) {
+			events[ret] = matches[ret];
+		}
+	} else {
+		// We want the oldest of these, which were found last.
+		while ((count > 0) && (ret < max)) {
+			events[ret++] = matches[--count];
+		}
+	}
+
+	return ret;
+}
+
+static void
+concordd_journal_change(concordd_instance_t self, uint8_t object_type, int partition_id, int index, int changed)
+{
+	struct concordd_change_s* change;
+
+	self->change_seq++;
+
+	change = &self->change_journal[self->change_seq % CONCORDD_CHANGE_JOURNAL_MAX];
+	change->seq = self->change_seq;
+	change->object_type = object_type;
+	change->partition_id = (uint8_t)partition_id;
+	change->index = (uint8_t)index;
+	change->changed = changed;
+}
+
+static void
+concordd_journal_resync(concordd_instance_t self)
+{
+	concordd_journal_change(self, CONCORDD_CHANGE_OBJECT_RESYNC, 0, 0, 0);
+}
+
+int
+concordd_get_changes_since(concordd_instance_t self, uint32_t epoch, uint32_t seq, struct concordd_change_s* changes)
+{
+	int count = 0;
+	int i;
+
+	if ((epoch != self->change_epoch) || (seq > self->change_seq)) {
+		// From before a restart.
+		return -1;
+	}
+
+	if (self->change_seq - seq > CONCORDD_CHANGE_JOURNAL_MAX) {
+		// Fell out of the journal.
+		return -1;
+	}
+
+	while (seq != self->change_seq) {
+		const struct concordd_change_s* change = &self->change_journal[++seq % CONCORDD_CHANGE_JOURNAL_MAX];
+
+		if (change->object_type == CONCORDD_CHANGE_OBJECT_RESYNC) {
+			return -1;
+		}
+
+		for (i = 0; i < count; i++) {
+			if ( (changes[i].object_type == change->object_type)
+			  && (changes[i].partition_id == change->partition_id)
+			  && (changes[i].index == change->index)
+			) {
+				break;
+			}
+		}
+
+		if (i == count) {
+			changes[count++] = *change;
+		} else {
+			changes[i].seq = change->seq;
+			changes[i].changed |= change->changed;
+		}
+	}
+
+	return count;
+}
+
 void
 concordd_instance_info_changed(concordd_instance_t self, int changed)
 {
+	concordd_journal_change(self, CONCORDD_CHANGE_OBJECT_SYSTEM, 0, 0, changed);
+
     if (self->instance_info_changed_func != NULL) {
         (*self->instance_info_changed_func)(self->context, self, changed);
     }
@@ -66,6 +294,8 @@ concordd_instance_info_changed(concordd_instance_t self, int changed)
 void
 concordd_partition_info_changed(concordd_instance_t self, concordd_partition_t partition, int changed)
 {
+	concordd_journal_change(self, CONCORDD_CHANGE_OBJECT_PARTITION, 0, concordd_get_partition_index(self, partition), changed);
+
     if (self->partition_info_changed_func != NULL) {
         (*self->partition_info_changed_func)(self->context, self, partition, changed);
     }
@@ -74,11 +304,36 @@ concordd_partition_info_changed(concordd_instance_t self, concordd_partition_t p
 void
 concordd_zone_info_changed(concordd_instance_t self, concordd_zone_t zone, int changed)
 {
+	concordd_journal_change(self, CONCORDD_CHANGE_OBJECT_ZONE, 0, concordd_get_zone_index(self, zone), changed);
+
     if (self->zone_info_changed_func != NULL) {
         (*self->zone_info_changed_func)(self->context, self, zone, changed);
     }
 }
 
+static void
+concordd_light_info_changed(concordd_instance_t self, concordd_partition_t partition, concordd_light_t light, int changed)
+{
+	concordd_journal_change(self, CONCORDD_CHANGE_OBJECT_LIGHT,
+		concordd_get_partition_index(self, partition),
+		concordd_get_light_index(self, partition, light),
+		changed);
+
+    if (self->light_info_changed_func != NULL) {
+        (*self->light_info_changed_func)(self->context, self, partition, light, changed);
+    }
+}
+
+static void
+concordd_output_info_changed(concordd_instance_t self, concordd_output_t output, int changed)
+{
+	concordd_journal_change(self, CONCORDD_CHANGE_OBJECT_OUTPUT, 0, concordd_get_output_index(self, output), changed);
+
+    if (self->output_info_changed_func != NULL) {
+        (*self->output_info_changed_func)(self->context, self, output, changed);
+    }
+}
+
 struct concordd_device_s *
 concordd_get_device(concordd_instance_t self, int deviceid)
 {
@@ -158,6 +413,32 @@ concordd_partition_get_light(concordd_partition_t self, int i)
 }
 
 
+// Stores encoded panel text along with its decoded form, which
+// is only decoded again if the text actually changed. Text that
+// doesn't fit in `encoded` is cut short. Returns true if it changed.
+static bool
+concordd_update_text(
+	uint8_t* encoded, uint8_t* encoded_len, size_t encoded_size,
+	char* decoded, size_t decoded_size,
+	const uint8_t* bytes, int len
+) {
+	if (len < 0) {
+		len = 0;
+	} else if (len > encoded_size) {
+		len = encoded_size;
+	}
+
+	if ((len == *encoded_len) && (memcmp(encoded, bytes, len) == 0)) {
+		return false;
+	}
+
+	memcpy(encoded, bytes, len);
+	*encoded_len = len;
+	ge_text_to_ascii_one_line_r(decoded, decoded_size, encoded, len);
+
+	return true;
+}
+
 static ge_rs232_status_t
 concordd_send_bytes_(concordd_instance_t self, const uint8_t* bytes, int len,struct ge_rs232_s* instance)
 {
@@ -170,6 +451,12 @@ concordd_init(concordd_instance_t self)
 	memset(self, 0, sizeof(*self));
 	ge_rs232_init(&self->ge_rs232);
 
+	// Only has to differ from the last run, not be unguessable.
+	self->change_epoch = (uint32_t)time(NULL) ^ ((uint32_t)getpid() << 16);
+	if (self->change_epoch == 0) {
+		self->change_epoch = 1;
+	}
+
     self->ge_rs232.context = (void*)self;
 	self->ge_rs232.received_message = (void*)&concordd_handle_frame;
     self->ge_rs232.send_bytes = (ge_rs232_send_bytes_func_t)concordd_send_bytes_;
@@ -192,26 +479,39 @@ ge_rs232_status_t
 concordd_equipment_refresh(concordd_instance_t self, void (*finished)(void* context,ge_rs232_status_t status), void* context)
 {
 	static const uint8_t refresh_equipment_msg[] = { GE_RS232_ATP_EQUIP_LIST_REQUEST };
+	int i;
+
+	if (self->refresh_pending) {
+		// Already in progress, this request will be folded
+		// into the one that is queued or on the wire. Marking
+		// things stale again now would lose what has already
+		// been reported.
+		goto queue;
+	}
+
 	self->refresh_pending = true;
+	self->refresh_count++;
+	concordd_journal_resync(self);
 	self->bus_device_count = 0;
     // TODO: Invalidate all alarm/trouble events (but not log)
-	int i;
 
-	// Deactivate all zones.
+	// Mark all zones as stale. Anything that isn't reported again
+	// by the equipment list is deactivated once the list is complete,
+	// so clients keep seeing the previous state during the refresh.
 	for (i = 0; i < sizeof(self->zone)/sizeof(self->zone[0]); ++i) {
-		self->zone[i].active = false;
+		self->zone[i].stale = self->zone[i].active;
 	}
 
-	// Deactivate all partitions.
+	// Mark all partitions as stale.
 	for (i = 0; i < sizeof(self->partition)/sizeof(self->partition[0]); ++i) {
-		self->partition[i].active = false;
+		self->partition[i].stale = self->partition[i].active;
 		self->partition[i].entry_delay_active = false;
 		self->partition[i].exit_delay_active = false;
 	}
 
-	// Deactivate all outputs.
+	// Mark all outputs as stale.
 	for (i = 0; i < sizeof(self->output)/sizeof(self->output[0]); ++i) {
-		self->output[i].active = false;
+		self->output[i].stale = self->output[i].active;
 	}
 
 	// Deactivate all bus devices.
@@ -219,14 +519,64 @@ concordd_equipment_refresh(concordd_instance_t self, void (*finished)(void* cont
 		self->bus_device[i].active = false;
 	}
 
-	return ge_queue_message(&self->ge_queue, refresh_equipment_msg, sizeof(refresh_equipment_msg), finished, context);
+queue:
+	return ge_queue_message_with_priority(
+		&self->ge_queue,
+		GE_QUEUE_PRIORITY_BACKGROUND,
+		CONCORDD_QUEUE_KEY(CONCORDD_QUEUE_KEY_REFRESH, CONCORDD_REFRESH_KIND_EQUIPMENT, 0),
+		0,
+		refresh_equipment_msg,
+		sizeof(refresh_equipment_msg),
+		finished,
+		context
+	);
+}
+
+static void
+concordd_equipment_list_complete(concordd_instance_t self)
+{
+	int i;
+
+	// Deactivate anything that was not reported by the equipment list.
+	for (i = 0; i < sizeof(self->zone)/sizeof(self->zone[0]); ++i) {
+		if (self->zone[i].stale) {
+			syslog(LOG_INFO, "[EQUIP_LIST_COMPLETE] Removing stale zone %d", i);
+			self->zone[i].active = false;
+			self->zone[i].stale = false;
+		}
+	}
+
+	for (i = 0; i < sizeof(self->partition)/sizeof(self->partition[0]); ++i) {
+		if (self->partition[i].stale) {
+			syslog(LOG_INFO, "[EQUIP_LIST_COMPLETE] Removing stale partition %d", i);
+			self->partition[i].active = false;
+			self->partition[i].stale = false;
+		}
+	}
+
+	for (i = 0; i < sizeof(self->output)/sizeof(self->output[0]); ++i) {
+		if (self->output[i].stale) {
+			syslog(LOG_INFO, "[EQUIP_LIST_COMPLETE] Removing stale output %d", i);
+			self->output[i].active = false;
+			self->output[i].stale = false;
+		}
+	}
 }
 
 ge_rs232_status_t
 concordd_dynamic_data_refresh(concordd_instance_t self, void (*finished)(void* context,ge_rs232_status_t status), void* context)
 {
     static const uint8_t dynamic_data_refresh_msg[] = { GE_RS232_ATP_DYNAMIC_DATA_REFRESH };
-    return ge_queue_message(&self->ge_queue, dynamic_data_refresh_msg, sizeof(dynamic_data_refresh_msg), finished, context);
+    return ge_queue_message_with_priority(
+        &self->ge_queue,
+        GE_QUEUE_PRIORITY_BACKGROUND,
+        CONCORDD_QUEUE_KEY(CONCORDD_QUEUE_KEY_REFRESH, CONCORDD_REFRESH_KIND_DYNAMIC, 0),
+        0,
+        dynamic_data_refresh_msg,
+        sizeof(dynamic_data_refresh_msg),
+        finished,
+        context
+    );
 }
 
 ge_rs232_status_t
@@ -236,9 +586,39 @@ concordd_refresh(concordd_instance_t self, void (*finished)(void* context,ge_rs2
 //    return concordd_dynamic_data_refresh(self, finished, context);
 }
 
+// Keypresses that arm, disarm or raise a panic jump the queue.
+static bool
+concordd_keypress_is_urgent(uint8_t code)
+{
+	switch (code) {
+	case 0x20: // Arm level 1 (disarm)
+	case 0x27: // Arm away
+	case 0x28: // Arm stay
+	case GE_RS232_KEYPRESS_ARM_ARAY_NO_DELAY:
+	case 0x2C: case 0x2D: case 0x2E: // Touchpad A, C, E
+	case 0x30: case 0x33: case 0x36: // Touchpad B, D, F
+	case 0x4C: case 0x4D: case 0x4E: // Police, auxiliary and fire panics
+		return true;
+	}
+	return false;
+}
+
 ge_rs232_status_t
-concordd_press_keys(concordd_instance_t self, int partition, const char* keys, void (*finished)(void* context,ge_rs232_status_t status),void* context)
+concordd_press_keys(concordd_instance_t self, int partition, const char* keys, cms_t deadline, void (*finished)(void* context,ge_rs232_status_t status),void* context)
+{
+	return concordd_queue_keys(self, partition, keys, GE_QUEUE_KEY_NONE, deadline, finished, context);
+}
+
+int
+concordd_cancel(concordd_instance_t self, void* context)
+{
+	return ge_queue_cancel(&self->ge_queue, context);
+}
+
+static ge_rs232_status_t
+concordd_queue_keys(concordd_instance_t self, int partition, const char* keys, uint32_t key, cms_t deadline, void (*finished)(void* context,ge_rs232_status_t status),void* context)
 {
+	uint8_t priority = GE_QUEUE_PRIORITY_INTERACTIVE;
 	uint8_t msg[GE_RS232_MAX_MESSAGE_SIZE] = {
 		GE_RS232_ATP_KEYPRESS,
 		partition,	// Partition
@@ -289,9 +669,12 @@ concordd_press_keys(concordd_instance_t self, int partition, const char* keys, v
 		if (code==255) {
 			continue;
 		}
+		if (concordd_keypress_is_urgent(code)) {
+			priority = GE_QUEUE_PRIORITY_URGENT;
+		}
 		msg[len++] = code;
 	}
-	return ge_queue_message(&self->ge_queue, msg, len, finished, context);
+	return ge_queue_message_with_priority(&self->ge_queue, priority, key, deadline, msg, len, finished, context);
 }
 
 static ge_rs232_status_t
@@ -319,6 +702,7 @@ concordd_handle_alarm(concordd_instance_t self, uint8_t partitioni, uint8_t st,
     event.specific_type = type_s;
     event.extra_data = esd;
     event.timestamp = time(NULL);
+    event.seq = ++self->event_seq;
     event.status = CONCORDD_EVENT_STATUS_UNSPECIFIED;
 
     // Figure out our status.
@@ -345,6 +729,7 @@ concordd_handle_alarm(concordd_instance_t self, uint8_t partitioni, uint8_t st,
     // Add the event to the event log
     self->event_log_last = (self->event_log_last + 1) % CONCORDD_EVENT_LOG_MAX;
     self->event_log[self->event_log_last] = event;
+    concordd_event_log_index(self, self->event_log_last);
 
     // Update alarm/trouble lists
     switch(type_g) {
@@ -425,11 +810,9 @@ concordd_handle_alarm(concordd_instance_t self, uint8_t partitioni, uint8_t st,
                 output->partition_id = partitioni;
                 output->last_changed_at = time(NULL);
                 output->last_changed_by = source;
-                if (self->output_info_changed_func != NULL) {
-                    (*self->output_info_changed_func)(self->context, self, output, CONCORDD_OUTPUT_OUTPUT_STATE_CHANGED|
-                        CONCORDD_OUTPUT_LAST_CHANGED_AT_CHANGED|
-                        CONCORDD_OUTPUT_LAST_CHANGED_BY_CHANGED);
-                }
+                concordd_output_info_changed(self, output, CONCORDD_OUTPUT_OUTPUT_STATE_CHANGED|
+                    CONCORDD_OUTPUT_LAST_CHANGED_AT_CHANGED|
+                    CONCORDD_OUTPUT_LAST_CHANGED_BY_CHANGED);
             }
             syslog(LOG_NOTICE, "[OUTPUT-%d-ON]: SOURCE:%d(0x%06X)", esd, source, source);
             // Stop processing.
@@ -442,13 +825,10 @@ concordd_handle_alarm(concordd_instance_t self, uint8_t partitioni, uint8_t st,
                 output->partition_id = partitioni;
                 output->last_changed_at = time(NULL);
                 output->last_changed_by = source;
-                if (self->output_info_changed_func != NULL) {
-                    (*self->output_info_changed_func)(self->context, self, output,
-                        CONCORDD_OUTPUT_OUTPUT_STATE_CHANGED|
-                        CONCORDD_OUTPUT_LAST_CHANGED_AT_CHANGED|
-                        CONCORDD_OUTPUT_LAST_CHANGED_BY_CHANGED);
-
-                }
+                concordd_output_info_changed(self, output,
+                    CONCORDD_OUTPUT_OUTPUT_STATE_CHANGED|
+                    CONCORDD_OUTPUT_LAST_CHANGED_AT_CHANGED|
+                    CONCORDD_OUTPUT_LAST_CHANGED_BY_CHANGED);
 
             }
             syslog(LOG_NOTICE, "[OUTPUT-%d-OFF]: SOURCE:%d(0x%06X)", esd, source, source);
@@ -505,10 +885,9 @@ concordd_handle_subcmd2(concordd_instance_t self, const uint8_t* frame_bytes, in
 
                 if ( !self->refresh_pending
 				  && (light->last_changed_at != 0)
-				  && (self->light_info_changed_func != NULL)
 				) {
 					light->last_changed_at = time(NULL);
-                    (*self->light_info_changed_func)(self->context, self,
+                    concordd_light_info_changed(self,
                         partition, light,
                         CONCORDD_LIGHT_LIGHT_STATE_CHANGED
                         |CONCORDD_LIGHT_LAST_CHANGED_AT_CHANGED);
@@ -516,6 +895,14 @@ concordd_handle_subcmd2(concordd_instance_t self, const uint8_t* frame_bytes, in
 					break;
                 } else {
 					light->last_changed_at = time(NULL);
+					if (!self->refresh_pending) {
+						// Not worth a signal, but still a change
+						// for clients catching up from the journal.
+						concordd_journal_change(self, CONCORDD_CHANGE_OBJECT_LIGHT,
+							partitioni, lighti,
+							CONCORDD_LIGHT_LIGHT_STATE_CHANGED
+							|CONCORDD_LIGHT_LAST_CHANGED_AT_CHANGED);
+					}
 				}
             }
         }
@@ -527,12 +914,10 @@ concordd_handle_subcmd2(concordd_instance_t self, const uint8_t* frame_bytes, in
 			if (light != NULL) {
 				light->light_state = (frame_bytes[9] != 0);
                 light->last_changed_at = time(NULL);
-                if (self->light_info_changed_func != NULL) {
-                    (*self->light_info_changed_func)(self->context, self,
-                        partition, light,
-                        CONCORDD_LIGHT_LIGHT_STATE_CHANGED
-                        |CONCORDD_LIGHT_LAST_CHANGED_AT_CHANGED);
-                }
+                concordd_light_info_changed(self,
+                    partition, light,
+                    CONCORDD_LIGHT_LIGHT_STATE_CHANGED
+                    |CONCORDD_LIGHT_LAST_CHANGED_AT_CHANGED);
 			}
         }
         break;
@@ -632,13 +1017,16 @@ concordd_handle_subcmd(concordd_instance_t self, const uint8_t* frame_bytes, int
 		concordd_partition_t partition = concordd_get_partition(self, partitioni);
 
 		if (partition != NULL) {
-			lcd_text_changed = (frame_len-5 != partition->encoded_touchpad_text_len)
-				|| (0 != memcmp(frame_bytes+5, partition->encoded_touchpad_text, frame_len-5));
+			lcd_text_changed = concordd_update_text(
+				partition->encoded_touchpad_text,
+				&partition->encoded_touchpad_text_len,
+				sizeof(partition->encoded_touchpad_text),
+				partition->touchpad_text,
+				sizeof(partition->touchpad_text),
+				frame_bytes+5, frame_len-5
+			);
             partition->active = true;
 
-			partition->encoded_touchpad_text_len = frame_len-5;
-			memcpy(partition->encoded_touchpad_text, frame_bytes+5, frame_len-5);
-
 			if (lcd_text_changed) {
                 concordd_partition_info_changed(self, partition, CONCORDD_PARTITION_TOUCHPAD_TEXT_CHANGED);
             }
@@ -648,7 +1036,9 @@ concordd_handle_subcmd(concordd_instance_t self, const uint8_t* frame_bytes, int
 				"[TOUCHPAD] PN:%d TYPE:%d \"%s\"",
 				partitioni,
 				type,
-				ge_text_to_ascii_one_line(frame_bytes+5, frame_len-5)
+				partition != NULL
+					? partition->touchpad_text
+					: ge_text_to_ascii_one_line(frame_bytes+5, frame_len-5)
 			);
 		}
 		}
@@ -753,6 +1143,11 @@ concordd_handle_subcmd(concordd_instance_t self, const uint8_t* frame_bytes, int
 			frame_bytes[3]
 		);
 		// TIME_AND_DATE
+		if (self->refresh_pending) {
+			// Zones, partitions and outputs may have come and gone
+			// during the refresh without it being reported.
+			concordd_journal_resync(self);
+		}
 		self->refresh_pending = false;
 		break;
 
@@ -796,7 +1191,7 @@ concordd_handle_zone_status(concordd_instance_t self, const uint8_t* frame_bytes
                 "[ZONE] PN:%d ZONE:%d \"%s\" STATUS:%s%s%s%s%s",
                 zone->partition_id,
                 zonei,
-                ge_text_to_ascii_one_line(zone->encoded_name,zone->encoded_name_len),
+                zone->name,
                 zone->zone_state&GE_RS232_ZONE_STATUS_TRIPPED?"T":"-",
                 zone->zone_state&GE_RS232_ZONE_STATUS_FAULT?"F":"-",
                 zone->zone_state&GE_RS232_ZONE_STATUS_ALARM?"A":"-",
@@ -819,6 +1214,7 @@ concordd_handle_equip_list_partition_data(concordd_instance_t self, const uint8_
 		int changes = 0;
 
 		partition->active = true;
+		partition->stale = false;
 
 		if (partition->arm_level != frame_bytes[3]) {
 			changes |= CONCORDD_PARTITION_ARM_LEVEL_CHANGED;
@@ -929,12 +1325,19 @@ concordd_handle_equip_list_output_data(concordd_instance_t self, const uint8_t*
 
 	if (output != NULL) {
 		output->active       = true;
+		output->stale        = false;
 		output->output_state =   (frame_bytes[3] & 1);
 		output->pulse        = !!(frame_bytes[3] & 2);
 		memcpy(output->id_bytes, frame_bytes+4, 5);
 
-		output->encoded_name_len = frame_len-9;
-		memcpy(output->encoded_name, frame_bytes+9, frame_len-9);
+		concordd_update_text(
+			output->encoded_name,
+			&output->encoded_name_len,
+			sizeof(output->encoded_name),
+			output->name,
+			sizeof(output->name),
+			frame_bytes+9, frame_len-9
+		);
 
 		syslog(LOG_INFO, "[EQUIP_LIST_OUTPUT_DATA] OUT:%d(0x%02X) STATE:%d PULSE:%d ID:%02X%02X%02X%02X%02X NAME:\"%s\"",
 			outputi,
@@ -946,7 +1349,7 @@ concordd_handle_equip_list_output_data(concordd_instance_t self, const uint8_t*
 			output->id_bytes[2],
 			output->id_bytes[3],
 			output->id_bytes[4],
-            ge_text_to_ascii_one_line(output->encoded_name, output->encoded_name_len)
+            output->name
 		);
 	}
     return GE_RS232_STATUS_OK;
@@ -977,6 +1380,7 @@ concordd_handle_equip_list_light_to_sensor_data(concordd_instance_t self, const
 	if (partition != NULL) {
 		int i = 0;
 		partition->active = true;
+		partition->stale = false;
 
 		for (i=1;i<10;i++) {
 			concordd_light_t light = concordd_partition_get_light(partition, i);
@@ -1024,8 +1428,16 @@ concordd_handle_equip_list_zone_data(concordd_instance_t self, const uint8_t* fr
 			changes |= (changed_state<<8);
 		}
 
-		zone->encoded_name_len = frame_len-8;
-		memcpy(zone->encoded_name,frame_bytes+8, frame_len-8);
+		if (concordd_update_text(
+				zone->encoded_name,
+				&zone->encoded_name_len,
+				sizeof(zone->encoded_name),
+				zone->name,
+				sizeof(zone->name),
+				frame_bytes+8, frame_len-8
+		)) {
+			changes |= CONCORDD_ZONE_ENCODED_NAME_CHANGED;
+		}
 
 		if ((changes != 0) && zone->active) {
 			zone->active = true;
@@ -1033,6 +1445,7 @@ concordd_handle_equip_list_zone_data(concordd_instance_t self, const uint8_t* fr
 		}
 
 		zone->active = true;
+		zone->stale = false;
 
         syslog(LOG_INFO,"[EQUIP_LIST_ZONE_INFO] ZONE:%d PN:%d AREA:%d TYPE:%d GROUP:\"%s\"(%d) STATUS:%s%s%s%s%s TEXT:\"%s\"",
             zonei,
@@ -1046,8 +1459,7 @@ concordd_handle_equip_list_zone_data(concordd_instance_t self, const uint8_t* fr
             frame_bytes[7]&GE_RS232_ZONE_STATUS_ALARM?"A":"-",
             frame_bytes[7]&GE_RS232_ZONE_STATUS_TROUBLE?"R":"-",
             frame_bytes[7]&GE_RS232_ZONE_STATUS_BYPASSED?"B":"-",
-            ge_text_to_ascii_one_line(zone->encoded_name, zone->encoded_name_len)
-
+            zone->name
         );
     } else {
         syslog(LOG_WARNING,"[EQUIP_LIST_ZONE_INFO] ZONE:%d *ERROR*",zonei);
@@ -1104,10 +1516,35 @@ concordd_handle_equip_list_user_data(concordd_instance_t self, const uint8_t* fr
 static ge_rs232_status_t
 concordd_handle_panel_type(concordd_instance_t self, const uint8_t* frame_bytes, int frame_len)
 {
+	uint16_t sw_rev = (frame_bytes[4]<<8) + frame_bytes[5];
+	uint32_t serial_number = (frame_bytes[6]<<24) + (frame_bytes[7]<<16) + (frame_bytes[8]<<8) + frame_bytes[9];
+	int i;
+
+	if ( self->state_restored
+	  && ((self->serial_number != serial_number) || (self->sw_rev != sw_rev))
+	) {
+		// The state we restored from disk belongs to a different panel
+		// (or firmware). Zones, partitions and outputs will be replaced
+		// by the equipment list, but the event history must go now.
+		syslog(LOG_WARNING, "[PANEL_TYPE] Restored state was for SN:0x%08x SR:0x%04X, discarding event history",
+			self->serial_number,
+			self->sw_rev
+		);
+		memset(self->event_log, 0, sizeof(self->event_log));
+		memset(self->trouble_events, 0, sizeof(self->trouble_events));
+		for (i = 0; i < CONCORDD_MAX_PARTITIONS; i++) {
+			memset(self->partition[i].alarm_events, 0, sizeof(self->partition[i].alarm_events));
+			memset(self->partition[i].trouble_events, 0, sizeof(self->partition[i].trouble_events));
+		}
+		self->event_log_last = 0;
+		concordd_event_log_reindex(self);
+	}
+
+	self->state_restored = false;
 	self->panel_type = frame_bytes[1];
 	self->hw_rev = (frame_bytes[2]<<8) + frame_bytes[3];
-	self->sw_rev = (frame_bytes[4]<<8) + frame_bytes[5];
-	self->serial_number = (frame_bytes[6]<<24) + (frame_bytes[7]<<16) + (frame_bytes[8]<<8) + frame_bytes[9];
+	self->sw_rev = sw_rev;
+	self->serial_number = serial_number;
     syslog(LOG_NOTICE, "[PANEL_TYPE] PT:0x%02X HR:0x%04X SR:0x%04X SN:0x%08x",
 		frame_bytes[1],
 		(frame_bytes[2]<<8) + frame_bytes[3],
@@ -1135,6 +1572,7 @@ concordd_handle_frame(concordd_instance_t self, const uint8_t* frame_bytes, int
 		break;
     case GE_RS232_PTA_EQUIP_LIST_COMPLETE:
         syslog(LOG_NOTICE, "[EQUIP_LIST_COMPLETE]");
+		concordd_equipment_list_complete(self);
 		concordd_dynamic_data_refresh(self, NULL, NULL);
 
         break;
@@ -1172,18 +1610,18 @@ concordd_handle_frame(concordd_instance_t self, const uint8_t* frame_bytes, int
 int
 concordd_get_timeout_cms(concordd_instance_t self)
 {
-    if (self->ge_rs232.last_response == GE_RS232_ACK) {
-        return CMS_DISTANT_FUTURE;
-    } else if (self->ge_rs232.last_response == GE_RS232_NAK) {
-        return 0;
-    } else {
-        return MSEC_PER_SEC;
+    cms_t ret = ge_rs232_get_timeout_cms(&self->ge_rs232);
+    cms_t queue_timeout = ge_queue_get_timeout_cms(&self->ge_queue);
+
+    if (queue_timeout < ret) {
+        ret = queue_timeout;
     }
-    return CMS_DISTANT_FUTURE;
+
+    return ret;
 }
 
 ge_rs232_status_t
-concordd_set_light(concordd_instance_t self, int partitioni, int lighti, bool state, void (*finished)(void* context,ge_rs232_status_t status),void* context)
+concordd_set_light(concordd_instance_t self, int partitioni, int lighti, bool state, cms_t deadline, void (*finished)(void* context,ge_rs232_status_t status),void* context)
 {
 	if (self->refresh_pending) {
         return GE_RS232_STATUS_WAIT;
@@ -1204,11 +1642,19 @@ concordd_set_light(concordd_instance_t self, int partitioni, int lighti, bool st
         return GE_RS232_STATUS_INVALID_ARGUMENT;
     }
 
-    return concordd_press_keys(self, partitioni, cmd, finished, context);
+    return concordd_queue_keys(
+        self,
+        partitioni,
+        cmd,
+        CONCORDD_QUEUE_KEY(CONCORDD_QUEUE_KEY_LIGHT, partitioni, lighti),
+        deadline,
+        finished,
+        context
+    );
 }
 
 ge_rs232_status_t
-concordd_set_zone_bypass(concordd_instance_t self, int zonei, bool bypass, int useri, void (*finished)(void* context,ge_rs232_status_t status),void* context)
+concordd_set_zone_bypass(concordd_instance_t self, int zonei, bool bypass, int useri, cms_t deadline, void (*finished)(void* context,ge_rs232_status_t status),void* context)
 {
 	if (self->refresh_pending) {
         return GE_RS232_STATUS_WAIT;
@@ -1252,11 +1698,11 @@ concordd_set_zone_bypass(concordd_instance_t self, int zonei, bool bypass, int u
 
 	snprintf(cmd, sizeof(cmd), "#%s%02d", user->code_str, zonei);
 
-	return concordd_press_keys(self, zone->partition_id, cmd, finished, context);
+	return concordd_press_keys(self, zone->partition_id, cmd, deadline, finished, context);
 }
 
 ge_rs232_status_t
-concordd_set_output(concordd_instance_t self, int outputi, bool state, void (*finished)(void* context,ge_rs232_status_t status),void* context)
+concordd_set_output(concordd_instance_t self, int outputi, bool state, cms_t deadline, void (*finished)(void* context,ge_rs232_status_t status),void* context)
 {
 	if (self->refresh_pending) {
         return GE_RS232_STATUS_WAIT;
@@ -1280,11 +1726,21 @@ concordd_set_output(concordd_instance_t self, int outputi, bool state, void (*fi
         return GE_RS232_STATUS_ERROR;
 	}
 
-    return concordd_press_keys(self, 1, cmd, finished, context);
+    // The command toggles the output, so only requests for the
+    // same state can be folded together.
+    return concordd_queue_keys(
+        self,
+        1,
+        cmd,
+        CONCORDD_QUEUE_KEY(CONCORDD_QUEUE_KEY_OUTPUT, outputi, state),
+        deadline,
+        finished,
+        context
+    );
 }
 
 ge_rs232_status_t
-concordd_set_arm_level(concordd_instance_t self, int partitioni, int arm_level, void (*finished)(void* context,ge_rs232_status_t status),void* context)
+concordd_set_arm_level(concordd_instance_t self, int partitioni, int arm_level, cms_t deadline, void (*finished)(void* context,ge_rs232_status_t status),void* context)
 {
     concordd_partition_t partition = concordd_get_partition(self, partitioni);
 
@@ -1314,11 +1770,11 @@ concordd_set_arm_level(concordd_instance_t self, int partitioni, int arm_level,
 
         switch (arm_level) {
             case 1:
-                return concordd_press_keys(self, partitioni, "[20]", finished, context);
+                return concordd_press_keys(self, partitioni, "[20]", deadline, finished, context);
             case 2:
-                return concordd_press_keys(self, partitioni, "[28]", finished, context);
+                return concordd_press_keys(self, partitioni, "[28]", deadline, finished, context);
             case 3:
-                return concordd_press_keys(self, partitioni, "[27]", finished, context);
+                return concordd_press_keys(self, partitioni, "[27]", deadline, finished, context);
             default:
                 return GE_RS232_STATUS_INVALID_ARGUMENT;
         }
@@ -61,6 +61,11 @@ typedef uint32_t concordd_source_id_t;
 #define CONCORDD_SOURCE_ID_GET_ZONE(x)				(CONCORDD_SOURCE_ID_IS_ZONE(x)?(x)&0xFFFF:0)
 #define CONCORDD_SOURCE_ID_GET_BUS_DEVICE(x)		(CONCORDD_SOURCE_ID_IS_BUS_DEVICE(x)?(x)&0xFFFFFF:0)
 
+// Room for the decoded zone/output names and touchpad text. Longer
+// text (which would take a panel full of long words) is cut short.
+#define CONCORDD_NAME_MAX							128
+#define CONCORDD_TOUCHPAD_TEXT_MAX					256
+
 #define CONCORDD_GENERAL_PARTITION_ID_CHANGED		(1<<0)
 #define CONCORDD_GENERAL_ENCODED_NAME_CHANGED		(1<<1)
 #define CONCORDD_GENERAL_LAST_CHANGED_BY_CHANGED	(1<<2)
@@ -114,6 +119,7 @@ const char* concordd_zone_group_get_name(int group);
 #define CONCORDD_ZONE_LAST_KC_CHANGED_AT_CHANGED (1<<20)
 struct concordd_zone_s {
 	bool active;
+	bool stale;
 	uint8_t partition_id;
 	uint8_t type;
 	uint8_t group;
@@ -128,6 +134,7 @@ struct concordd_zone_s {
 
 	uint8_t encoded_name[16];
 	uint8_t encoded_name_len;
+	char name[CONCORDD_NAME_MAX];	// Decoded `encoded_name`
 };
 
 struct concordd_device_s {
@@ -159,6 +166,8 @@ struct concordd_event_s {
 
     uint16_t extra_data;
 
+    uint32_t seq;	// Counts up from 1 across all events, never reused
+
     time_t timestamp;
 };
 
@@ -169,6 +178,7 @@ struct concordd_event_s {
 #define CONCORDD_OUTPUT_OUTPUT_STATE_CHANGED		CONCORDD_GENERAL_STATE_CHANGED
 struct concordd_output_s {
 	bool active;
+	bool stale;
 	uint8_t partition_id;
 	uint8_t output_state;
 	bool pulse;
@@ -180,6 +190,7 @@ struct concordd_output_s {
 
 	uint8_t encoded_name[16];
 	uint8_t encoded_name_len;
+	char name[CONCORDD_NAME_MAX];	// Decoded `encoded_name`
 };
 
 struct concordd_user_s {
@@ -193,6 +204,42 @@ struct concordd_user_s {
 #define CONCORDD_SYSTEM_TROUBLE_TYPE_MAX (52)
 #define CONCORDD_EVENT_LOG_MAX (256)
 
+// Selects events for `concordd_event_log_query()`. Negative ids and
+// types match anything, as do zero times.
+struct concordd_event_filter_s {
+	int partition_id;
+	int zone_id;
+	int general_type;
+	time_t since;	// Inclusive
+	time_t until;	// Exclusive
+};
+
+// Every reported change to the system, a partition, light, zone or
+// output is given the next sequence number and remembered in a ring
+// of the last `CONCORDD_CHANGE_JOURNAL_MAX` changes, so that clients
+// which missed some can catch up with `concordd_get_changes_since()`.
+// Sequence numbers start over when concordd does, so each run also
+// picks a new `change_epoch` that clients have to hand back.
+#define CONCORDD_CHANGE_JOURNAL_MAX (256)
+
+// Marks where state changed without each change being reported,
+// such as during an equipment refresh. Clients have to read
+// everything again to get past one of these.
+#define CONCORDD_CHANGE_OBJECT_RESYNC       0
+#define CONCORDD_CHANGE_OBJECT_SYSTEM       1
+#define CONCORDD_CHANGE_OBJECT_PARTITION    2
+#define CONCORDD_CHANGE_OBJECT_LIGHT        3
+#define CONCORDD_CHANGE_OBJECT_ZONE         4
+#define CONCORDD_CHANGE_OBJECT_OUTPUT       5
+
+struct concordd_change_s {
+	uint32_t seq;
+	uint8_t object_type;
+	uint8_t partition_id;	// Only for lights
+	uint8_t index;			// Partition, light, zone or output index
+	int changed;			// Mask of what changed, as given to the `*_info_changed_func`s
+};
+
 #define CONCORDD_PARTITION_CHIME_CHANGED					(GE_RS232_FEATURE_STATE_CHIME<<8)
 #define CONCORDD_PARTITION_ENERGY_SAVER_CHANGED				(GE_RS232_FEATURE_STATE_ENERGY_SAVER<<8)
 #define CONCORDD_PARTITION_NO_DELAY_CHANGED					(GE_RS232_FEATURE_STATE_NO_DELAY<<8)
@@ -208,13 +255,15 @@ struct concordd_user_s {
 #define CONCORDD_PARTITION_ENERGY_SAVER_HIGH_TEMP_CHANGED	(1<<22)
 #define CONCORDD_PARTITION_SIREN_STARTED_AT_CHANGED			(1<<23)
 #define CONCORDD_PARTITION_PROGRAMMING_MODE_CHANGED	        (1<<24)
+#define CONCORDD_MAX_LIGHTS                 10
 struct concordd_partition_s {
 	bool active;
+	bool stale;
 	uint8_t arm_level;
 	uint16_t arm_level_user;
 	time_t arm_level_timestamp;
 
-	struct concordd_light_s light[10];
+	struct concordd_light_s light[CONCORDD_MAX_LIGHTS];
 	uint8_t feature_state;
 	bool programming_mode;
 
@@ -234,6 +283,7 @@ struct concordd_partition_s {
 
 	uint8_t encoded_touchpad_text[32];
 	uint8_t encoded_touchpad_text_len;
+	char touchpad_text[CONCORDD_TOUCHPAD_TEXT_MAX];	// Decoded `encoded_touchpad_text`
 };
 
 
@@ -246,12 +296,13 @@ struct concordd_partition_s {
 
 #define CONCORDD_MAX_PARTITIONS                 8
 #define CONCORDD_MAX_ZONES                 96
+#define CONCORDD_MAX_OUTPUTS                 71
 
 struct concordd_instance_s {
 	struct concordd_partition_s partition[8];
 	struct concordd_zone_s zone[96];
 	struct concordd_device_s bus_device[32];
-	struct concordd_output_s output[71];
+	struct concordd_output_s output[CONCORDD_MAX_OUTPUTS];
 	struct concordd_user_s user[252];
 
 	uint8_t panel_type;
@@ -260,6 +311,8 @@ struct concordd_instance_s {
 	uint32_t serial_number;
 	uint8_t bus_device_count;
 	bool refresh_pending;
+	uint32_t refresh_count;	// Bumped each time an equipment refresh starts
+	bool state_restored;
 	bool programming_mode;
 	bool ac_power_failure;
 	time_t ac_power_failure_changed_timestamp;
@@ -270,6 +323,21 @@ struct concordd_instance_s {
 
     struct concordd_event_s event_log[CONCORDD_EVENT_LOG_MAX];
     uint8_t event_log_last;
+	uint32_t event_seq;	// `seq` of the latest event
+
+	// Indexes into `event_log`, so that finding the events of one
+	// zone or partition doesn't mean going through all of them. Each
+	// event is linked to the one before it for the same zone and
+	// partition, by `seq` (zero for none). Rebuilt by
+	// `concordd_event_log_reindex()`.
+	uint32_t event_log_prev_zone[CONCORDD_EVENT_LOG_MAX];
+	uint32_t event_log_prev_partition[CONCORDD_EVENT_LOG_MAX];
+	uint32_t zone_last_event[CONCORDD_MAX_ZONES];
+	uint32_t partition_last_event[CONCORDD_MAX_PARTITIONS];
+
+	struct concordd_change_s change_journal[CONCORDD_CHANGE_JOURNAL_MAX];	// Indexed by `seq % CONCORDD_CHANGE_JOURNAL_MAX`
+	uint32_t change_seq;	// Sequence number of the latest change
+	uint32_t change_epoch;	// Never zero, different for every run
 
 	struct ge_rs232_s ge_rs232;
 	struct ge_queue_s ge_queue;
@@ -289,12 +357,19 @@ concordd_instance_t concordd_init(concordd_instance_t self);
 int concordd_get_timeout_cms(concordd_instance_t self);
 ge_rs232_status_t concordd_process(concordd_instance_t self);
 ge_rs232_status_t concordd_refresh(concordd_instance_t self, void (*finished)(void* context,ge_rs232_status_t status), void* context);
-ge_rs232_status_t concordd_press_keys(concordd_instance_t self, int partition, const char* keys, void (*finished)(void* context,ge_rs232_status_t status),void* context);
+ge_rs232_status_t concordd_press_keys(concordd_instance_t self, int partition, const char* keys, cms_t deadline, void (*finished)(void* context,ge_rs232_status_t status),void* context);
 ge_rs232_status_t concordd_handle_frame(concordd_instance_t self, const uint8_t* frame_bytes, int frame_len);
-ge_rs232_status_t concordd_set_light(concordd_instance_t self, int partitioni, int light, bool state, void (*finished)(void* context,ge_rs232_status_t status),void* context);
-ge_rs232_status_t concordd_set_output(concordd_instance_t self, int output, bool state, void (*finished)(void* context,ge_rs232_status_t status),void* context);
-ge_rs232_status_t concordd_set_arm_level(concordd_instance_t self, int partition, int arm_level, void (*finished)(void* context,ge_rs232_status_t status),void* context);
-ge_rs232_status_t concordd_set_zone_bypass(concordd_instance_t self, int zonei, bool bypass, int useri, void (*finished)(void* context,ge_rs232_status_t status),void* context);
+ge_rs232_status_t concordd_set_light(concordd_instance_t self, int partitioni, int light, bool state, cms_t deadline, void (*finished)(void* context,ge_rs232_status_t status),void* context);
+ge_rs232_status_t concordd_set_output(concordd_instance_t self, int output, bool state, cms_t deadline, void (*finished)(void* context,ge_rs232_status_t status),void* context);
+ge_rs232_status_t concordd_set_arm_level(concordd_instance_t self, int partition, int arm_level, cms_t deadline, void (*finished)(void* context,ge_rs232_status_t status),void* context);
+// `deadline` for the functions above is an absolute `time_ms()`
+// value after which the command is dropped if it still hasn't
+// been sent to the panel, or zero for none.
+ge_rs232_status_t concordd_set_zone_bypass(concordd_instance_t self, int zonei, bool bypass, int useri, cms_t deadline, void (*finished)(void* context,ge_rs232_status_t status),void* context);
+
+// Forgets about every queued command that was given `context`,
+// see `ge_queue_cancel()`.
+int concordd_cancel(concordd_instance_t self, void* context);
 
 int concordd_get_partition_index(concordd_instance_t self, concordd_partition_t partition);
 concordd_partition_t concordd_get_partition(concordd_instance_t self, int i);
@@ -310,4 +385,29 @@ concordd_light_t concordd_partition_get_light(concordd_partition_t self, int i);
 int concordd_get_output_index(concordd_instance_t self, concordd_output_t output);
 concordd_output_t concordd_get_output(concordd_instance_t self, int i);
 
+// Returns the event with the given `seq`, or NULL if it is no
+// longer in the event log.
+concordd_event_t concordd_event_log_get(concordd_instance_t self, uint32_t seq);
+
+// Fills `events` with up to `max` events from the event log that
+// match `filter` (which may be NULL). If `newest_first` is false,
+// these are the oldest events after `cursor`, oldest first.
+// Otherwise they are the newest events before `cursor` (or the
+// newest events, if `cursor` is zero), newest first. The `seq` of the
+// last one is the cursor for the next page. Returns the number of
+// events.
+int concordd_event_log_query(concordd_instance_t self, uint32_t cursor, bool newest_first, const struct concordd_event_filter_s* filter, concordd_event_t* events, int max);
+
+// Rebuilds the event log indexes, after `event_log` was replaced.
+void concordd_event_log_reindex(concordd_instance_t self);
+
+// Fills `changes` with what changed after sequence number `seq`,
+// one entry per object with the masks of all of its changes merged
+// and `seq` set to its latest change, in the order the objects first
+// changed. `changes` must have room for `CONCORDD_CHANGE_JOURNAL_MAX`
+// entries. Returns the number of entries, or -1 if some of those
+// changes are no longer known and the client has to read everything
+// again.
+int concordd_get_changes_since(concordd_instance_t self, uint32_t epoch, uint32_t seq, struct concordd_change_s* changes);
+
 #endif
@@ -0,0 +1,287 @@
+/*
+ *
+ * Copyright (c) 2017 Robert Quattlebaum
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Microbenchmark for the serial frame decoder.
+//
+// Feeds a corpus of raw serial data through `ge_rs232_receive_byte()`
+// one byte at a time (the way the main loop used to) and through
+// `ge_rs232_receive_bytes()`, checks that both produce the same
+// frames, and prints how long each took.
+//
+//     ge-rs232-bench [-n iterations] [capture-file]
+//
+// The capture file is one written by concordd's `CaptureFile`
+// option; the bytes received from the panel are used as the corpus.
+// Without one, a synthetic corpus of typical panel traffic is used.
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "ge-rs232.h"
+#include "capture-file.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#define READ_CHUNK_SIZE      100    // Same as the main loop
+#define SYNTHETIC_REPEAT     2000
+
+struct bench_result_s {
+	uint32_t frames;
+	uint32_t hash;
+	double seconds;
+};
+
+static uint32_t gFrames;
+static uint32_t gHash;
+
+static ge_rs232_status_t
+bench_send_bytes(void* context, const uint8_t* data, int len, ge_rs232_t instance)
+{
+	return GE_RS232_STATUS_OK;
+}
+
+static ge_rs232_status_t
+bench_received_message(void* context, const uint8_t* data, uint8_t len, ge_rs232_t instance)
+{
+	gFrames++;
+	while (len--) {
+		gHash = (gHash ^ *data++) * 16777619;
+	}
+	return GE_RS232_STATUS_OK;
+}
+
+static size_t
+append_frame(uint8_t* dest, const uint8_t* data, uint8_t len)
+{
+	static const char hex[] = "0123456789ABCDEF";
+	uint8_t checksum = len + 1;
+	size_t ret = 0;
+	int i;
+
+	dest[ret++] = GE_RS232_START_OF_MESSAGE;
+	dest[ret++] = hex[(len + 1) >> 4];
+	dest[ret++] = hex[(len + 1) & 0xF];
+
+	for (i = 0; i < len; i++) {
+		checksum += data[i];
+		dest[ret++] = hex[data[i] >> 4];
+		dest[ret++] = hex[data[i] & 0xF];
+	}
+
+	dest[ret++] = hex[checksum >> 4];
+	dest[ret++] = hex[checksum & 0xF];
+
+	return ret;
+}
+
+// A mix of what a busy panel sends: zone status changes, arming
+// level updates, siren syncs, touchpad text and equipment list
+// entries, with the occasional ACK and line noise in between.
+static uint8_t*
+make_synthetic_corpus(size_t* len)
+{
+	static const uint8_t zone_status[] = { 0x21, 0x01, 0x00, 0x00, 0x04, 0x01 };
+	static const uint8_t arm_level[] = { 0x22, 0x01, 0x01, 0x00, 0xF0, 0x00, 0x02 };
+	static const uint8_t siren_sync[] = { 0x22, 0x05 };
+	static const uint8_t touchpad[] = {
+		0x22, 0x09, 0x01, 0x00, 0x00, 0xF2, 0x3F, 0xF4, 0xF5, 0x50, 0x58, 0x65,
+		0x42, 0x1D, 0x2F, 0x6A, 0x1D, 0x1A, 0x1A, 0x1A
+	};
+	static const uint8_t equip_zone[] = {
+		0x03, 0x01, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x5A,
+		0xF9, 0x1D, 0x89, 0x4C, 0x43, 0x5D
+	};
+	static const uint8_t noise[] = { GE_RS232_ACK, 0x00, 0x00 };
+	const size_t per_repeat = 4*(GE_RS232_MAX_MESSAGE_SIZE*2 + 8) + sizeof(noise);
+	uint8_t* ret = malloc(per_repeat*SYNTHETIC_REPEAT);
+	size_t i;
+
+	*len = 0;
+
+	if (ret == NULL) {
+		return NULL;
+	}
+
+	for (i = 0; i < SYNTHETIC_REPEAT; i++) {
+		*len += append_frame(ret + *len, zone_status, sizeof(zone_status));
+		*len += append_frame(ret + *len, (i & 1) ? siren_sync : arm_level, (i & 1) ? sizeof(siren_sync) : sizeof(arm_level));
+		*len += append_frame(ret + *len, touchpad, sizeof(touchpad));
+		*len += append_frame(ret + *len, equip_zone, sizeof(equip_zone));
+		if ((i % 16) == 0) {
+			memcpy(ret + *len, noise, sizeof(noise));
+			*len += sizeof(noise);
+		}
+	}
+
+	return ret;
+}
+
+static uint8_t*
+read_corpus(const char* path, size_t* len)
+{
+	struct capture_file_s capture;
+	uint8_t buffer[256];
+	uint8_t* ret = NULL;
+	size_t size = 0;
+	uint64_t ns;
+	int direction;
+	int record_len;
+
+	if (capture_file_open_read(&capture, path) != 0) {
+		fprintf(stderr, "%s: Unable to read capture file\n", path);
+		return NULL;
+	}
+
+	*len = 0;
+
+	while ((record_len = capture_file_read(&capture, &direction, &ns, buffer, sizeof(buffer))) >= 0) {
+		if (direction != CAPTURE_FILE_RX) {
+			continue;
+		}
+
+		if (*len + record_len > size) {
+			uint8_t* bigger;
+
+			size = size ? size * 2 : 4096;
+			bigger = realloc(ret, size);
+
+			if (bigger == NULL) {
+				perror("realloc");
+				free(ret);
+				capture_file_close(&capture);
+				return NULL;
+			}
+
+			ret = bigger;
+		}
+
+		memcpy(ret + *len, buffer, record_len);
+		*len += record_len;
+	}
+
+	capture_file_close(&capture);
+
+	if (ret == NULL) {
+		fprintf(stderr, "%s: Nothing was received from the panel\n", path);
+	}
+
+	return ret;
+}
+
+static double
+now_seconds(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+static void
+run(const uint8_t* corpus, size_t len, int iterations, bool bulk, struct bench_result_s* result)
+{
+	struct ge_rs232_s interface;
+	double start;
+	size_t offset;
+	int i;
+
+	gFrames = 0;
+	gHash = 2166136261u;
+
+	start = now_seconds();
+
+	for (i = 0; i < iterations; i++) {
+		ge_rs232_init(&interface);
+		interface.send_bytes = &bench_send_bytes;
+		interface.received_message = &bench_received_message;
+
+		for (offset = 0; offset < len; offset += READ_CHUNK_SIZE) {
+			size_t chunk = len - offset < READ_CHUNK_SIZE ? len - offset : READ_CHUNK_SIZE;
+
+			if (bulk) {
+				ge_rs232_receive_bytes(&interface, corpus + offset, chunk);
+			} else {
+				size_t j;
+				for (j = 0; j < chunk; j++) {
+					if (corpus[offset + j]) {
+						ge_rs232_receive_byte(&interface, corpus[offset + j]);
+					}
+				}
+			}
+		}
+	}
+
+	result->seconds = now_seconds() - start;
+	result->frames = gFrames;
+	result->hash = gHash;
+}
+
+int
+main(int argc, char* argv[])
+{
+	struct bench_result_s per_byte, bulk;
+	uint8_t* corpus;
+	size_t len = 0;
+	int iterations = 50;
+	int c;
+
+	while ((c = getopt(argc, argv, "n:")) != -1) {
+		switch (c) {
+		case 'n':
+			iterations = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n iterations] [capture-file]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind < argc) {
+		corpus = read_corpus(argv[optind], &len);
+	} else {
+		corpus = make_synthetic_corpus(&len);
+	}
+
+	if (corpus == NULL || iterations <= 0) {
+		return EXIT_FAILURE;
+	}
+
+	printf("Corpus: %zu bytes, %d iterations\n", len, iterations);
+
+	run(corpus, len, iterations, false, &per_byte);
+	run(corpus, len, iterations, true, &bulk);
+
+	printf("ge_rs232_receive_byte():  %8u frames %7.2f ns/byte\n",
+		per_byte.frames, per_byte.seconds*1e9/((double)len*iterations));
+	printf("ge_rs232_receive_bytes(): %8u frames %7.2f ns/byte (%.2fx)\n",
+		bulk.frames, bulk.seconds*1e9/((double)len*iterations),
+		per_byte.seconds/bulk.seconds);
+
+	free(corpus);
+
+	if (per_byte.frames != bulk.frames || per_byte.hash != bulk.hash) {
+		fprintf(stderr, "Decoders disagree!\n");
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
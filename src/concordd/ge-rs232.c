@@ -3,6 +3,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <ctype.h>
+#include <stdlib.h>
 #include <syslog.h>
 
 #if __AVR__
@@ -17,48 +18,172 @@ static char int_to_hex_digit(uint8_t x) {
 }
 #endif
 
+// Hex digit decoding table. The low nibble is the value of the
+// digit (zero for anything that isn't one, which is what the
+// panel protocol has always assumed), and `HEX_VALID` is set
+// for actual hex digits.
+#define HEX_VALID	0x10
+
+#define HEX_DIGITS(base, first) \
+	[(first)+0] = HEX_VALID|((base)+0), [(first)+1] = HEX_VALID|((base)+1), \
+	[(first)+2] = HEX_VALID|((base)+2), [(first)+3] = HEX_VALID|((base)+3), \
+	[(first)+4] = HEX_VALID|((base)+4), [(first)+5] = HEX_VALID|((base)+5)
+
+static const uint8_t hex_digit_table[256]
+#if __AVR__
+PROGMEM
+#endif
+= {
+	HEX_DIGITS(0, '0'),
+	['6'] = HEX_VALID|6, ['7'] = HEX_VALID|7,
+	['8'] = HEX_VALID|8, ['9'] = HEX_VALID|9,
+	HEX_DIGITS(10, 'A'),
+	HEX_DIGITS(10, 'a'),
+};
+
+#if __AVR__
+#define hex_digit_lookup(c)	pgm_read_byte_near(hex_digit_table + (uint8_t)(c))
+#else
+#define hex_digit_lookup(c)	hex_digit_table[(uint8_t)(c)]
+#endif
+
 static char
 hex_digit_to_int(char c) {
-	switch(c) {
-	case '0': return 0; break;
-	case '1': return 1; break;
-	case '2': return 2; break;
-	case '3': return 3; break;
-	case '4': return 4; break;
-	case '5': return 5; break;
-	case '6': return 6; break;
-	case '7': return 7; break;
-	case '8': return 8; break;
-	case '9': return 9; break;
-	case 'A':
-	case 'a': return 10; break;
-	case 'B':
-	case 'b': return 11; break;
-	case 'C':
-	case 'c': return 12; break;
-	case 'D':
-	case 'd': return 13; break;
-	case 'E':
-	case 'e': return 14; break;
-	case 'F':
-	case 'f': return 15; break;
-	}
-	return 0;
+	return hex_digit_lookup(c) & 0x0F;
 }
 
 ge_rs232_t
 ge_rs232_init(ge_rs232_t self) {
 	bzero((void*)self,sizeof(*self));
 	self->last_response = GE_RS232_ACK;
+	self->rto = GE_RS232_INITIAL_RTO;
+	self->time_ms = &time_ms;
 	return self;
 }
 
+static void
+ge_rs232_clamp_rto(ge_rs232_t self) {
+	if(self->rto < GE_RS232_MIN_RTO) {
+		self->rto = GE_RS232_MIN_RTO;
+	} else if(self->rto > GE_RS232_MAX_RTO) {
+		self->rto = GE_RS232_MAX_RTO;
+	}
+}
+
+static void
+ge_rs232_update_rtt(ge_rs232_t self, cms_t rtt) {
+	if(rtt < 0) {
+		return;
+	}
+
+	if(self->stats.rtt_samples == 0 || rtt < self->stats.rtt_min) {
+		self->stats.rtt_min = rtt;
+	}
+	if(rtt > self->stats.rtt_max) {
+		self->stats.rtt_max = rtt;
+	}
+	self->stats.rtt_samples++;
+
+	if(self->srtt == 0) {
+		self->srtt = rtt;
+		self->rttvar = rtt/2;
+	} else {
+		cms_t delta = self->srtt - rtt;
+		if(delta < 0) {
+			delta = -delta;
+		}
+		self->rttvar = (3*self->rttvar + delta)/4;
+		self->srtt = (7*self->srtt + rtt)/8;
+	}
+
+	self->rto = self->srtt + 4*self->rttvar;
+	ge_rs232_clamp_rto(self);
+}
+
+static cms_t
+ge_rs232_nak_backoff(ge_rs232_t self) {
+	cms_t backoff = GE_RS232_NAK_BACKOFF;
+	int i;
+
+	for(i = 1; i < self->output_attempt_count && backoff < GE_RS232_MAX_NAK_BACKOFF; i++) {
+		backoff *= 2;
+	}
+
+	if(backoff > GE_RS232_MAX_NAK_BACKOFF) {
+		backoff = GE_RS232_MAX_NAK_BACKOFF;
+	}
+
+	// Jitter keeps us from falling into lock-step with
+	// whatever the panel is busy doing. NAKs don't arrive on
+	// any particular millisecond, so the low bits of the clock
+	// are random enough, and there is no RNG to seed.
+	return backoff + (uint32_t)self->time_ms()%(backoff/2 + 1);
+}
+
 ge_rs232_status_t
 ge_rs232_process(ge_rs232_t self) {
 	// Does nothing for now
 	return GE_RS232_STATUS_OK;
 }
 
+// Handles one decoded byte of the frame being read: the length,
+// the payload, or finally the checksum.
+static ge_rs232_status_t
+ge_rs232_receive_value(ge_rs232_t self, uint8_t value) {
+	ge_rs232_status_t ret = GE_RS232_STATUS_OK;
+
+	if(self->message_len==255) {
+		if(value>GE_RS232_MAX_MESSAGE_SIZE) {
+			ret = GE_RS232_STATUS_MESSAGE_TOO_BIG;
+			self->reading_message = false;
+			goto bail;
+		}
+		if(value<2) {
+			ret = GE_RS232_STATUS_MESSAGE_TOO_SMALL;
+			self->reading_message = false;
+			goto bail;
+		}
+		self->message_len = value;
+		self->current_byte = 0;
+	} else {
+		self->buffer[self->current_byte++] = value;
+	}
+	if(self->current_byte>=self->message_len) {
+		self->reading_message = false;
+		if(self->buffer_sum == value
+		  && self->can_receive
+		  && !self->can_receive(self->context,self->message_len-1,self)
+		) {
+            static const char nak = GE_RS232_NAK;
+			// Nowhere to put it right now. NAK it so that the
+			// panel sends it again, rather than ACK and lose it.
+			self->stats.rx_overruns++;
+			self->send_bytes(self->context,&nak,1,self);
+			ret = GE_RS232_STATUS_WAIT;
+		} else if(self->buffer_sum == value) {
+            static const char ack = GE_RS232_ACK;
+			// ACKs get past the transport's high-water mark, so this
+			// only fails if it is really stuck. Then the panel will
+			// send the frame again, and we'd rather see it then than
+			// twice.
+			ret = self->send_bytes(self->context,&ack,1,self);
+			if(ret) goto bail;
+			self->stats.frames_received++;
+			ret = self->received_message(self->context,self->buffer,self->message_len-1,self);
+		} else {
+            static const char nak = GE_RS232_NAK;
+			self->stats.bad_checksums++;
+			syslog(LOG_WARNING,"Bad checksum: calculated 0x%02X, indicated 0x%02X",self->buffer_sum,value);
+			self->send_bytes(self->context,&nak,1,self);
+			ret = GE_RS232_STATUS_BAD_CHECKSUM;
+		}
+	} else {
+		self->buffer_sum += value;
+	}
+bail:
+	return ret;
+}
+
 ge_rs232_status_t
 ge_rs232_receive_byte(ge_rs232_t self, uint8_t byte) {
 	ge_rs232_status_t ret = GE_RS232_STATUS_OK;
@@ -72,11 +197,18 @@ ge_rs232_receive_byte(ge_rs232_t self, uint8_t byte) {
 	} else if(byte == GE_RS232_ACK && !self->last_response) {
         syslog(LOG_DEBUG,"<ACK>");
 		self->last_response = GE_RS232_ACK;
+		self->stats.acks++;
+		// Karn's algorithm: Only retransmission-free exchanges
+		// give us an unambiguous sample.
+		if(self->output_attempt_count == 1)
+			ge_rs232_update_rtt(self, self->time_ms() - self->last_sent);
 		if(self->got_response)
 			self->got_response(self->response_context,self,true);
 	} else if(byte == GE_RS232_NAK && !self->last_response) {
         syslog(LOG_DEBUG,"<NAK>");
 		self->last_response = GE_RS232_NAK;
+		self->stats.naks++;
+		self->retry_at = self->time_ms() + ge_rs232_nak_backoff(self);
 		if(self->got_response)
 			self->got_response(self->response_context,self,false);
 	} else if(self->reading_message) {
@@ -86,59 +218,108 @@ ge_rs232_receive_byte(ge_rs232_t self, uint8_t byte) {
 		}
 		uint8_t value = (hex_digit_to_int(self->nibble_buffer)<<4)+hex_digit_to_int(byte);
 		self->nibble_buffer = 0;
-		if(self->message_len==255) {
-			if(value>GE_RS232_MAX_MESSAGE_SIZE) {
-				ret = GE_RS232_STATUS_MESSAGE_TOO_BIG;
-				self->reading_message = false;
-				goto bail;
+		ret = ge_rs232_receive_value(self, value);
+	} else {
+		// Just some junk byte we don't know what to do with.
+		ret = GE_RS232_STATUS_JUNK;
+	}
+bail:
+	return ret;
+}
+
+ge_rs232_status_t
+ge_rs232_receive_bytes(ge_rs232_t self, const uint8_t* data, size_t len) {
+	ge_rs232_status_t ret = GE_RS232_STATUS_OK;
+	ge_rs232_status_t status;
+	const uint8_t* end = data + len;
+
+	while(data < end) {
+		if(!self->reading_message) {
+			// Between frames we only care about ACK and NAK, which
+			// usually arrive right in front of the next frame.
+			const uint8_t* start = memchr(data, GE_RS232_START_OF_MESSAGE, end - data);
+
+			if(start == NULL)
+				start = end;
+
+			for(; data < start; data++) {
+				if(*data == GE_RS232_ACK || *data == GE_RS232_NAK)
+					ge_rs232_receive_byte(self, *data);
 			}
-			if(value<2) {
-				ret = GE_RS232_STATUS_MESSAGE_TOO_SMALL;
-				self->reading_message = false;
-				goto bail;
+
+			if(data == end)
+				break;
+
+			ge_rs232_receive_byte(self, *data++);
+			continue;
+		}
+
+		// Inside of a frame: decode pairs of hex digits until
+		// the frame ends or something else shows up.
+		while(data < end) {
+			uint8_t digit = hex_digit_lookup(*data);
+
+			if(!(digit & HEX_VALID))
+				break;
+
+			data++;
+
+			if(!self->nibble_buffer) {
+				self->nibble_buffer = data[-1];
+				continue;
 			}
-			self->message_len = value;
-			self->current_byte = 0;
-		} else {
-			self->buffer[self->current_byte++] = value;
+
+			status = ge_rs232_receive_value(self, (hex_digit_to_int(self->nibble_buffer)<<4) + (digit & 0x0F));
+			self->nibble_buffer = 0;
+
+			if(status != GE_RS232_STATUS_OK && ret == GE_RS232_STATUS_OK)
+				ret = status;
+
+			if(!self->reading_message)
+				break;
 		}
-		if(self->current_byte>=self->message_len) {
-			self->reading_message = false;
-			if(self->buffer_sum == value) {
-                static const char ack = GE_RS232_ACK;
-				self->send_bytes(self->context,&ack,1,self);
-				ret = self->received_message(self->context,self->buffer,self->message_len-1,self);
-			} else {
-                static const char nak = GE_RS232_NAK;
-				fprintf(stderr,"[Bad checksum: calculated:0x%02X != indicated:0x%02X]\n",self->buffer_sum,value);
-				self->send_bytes(self->context,&nak,1,self);
-				ret = GE_RS232_STATUS_BAD_CHECKSUM;
+
+		if(data < end && self->reading_message) {
+			// Framing characters, ACK/NAK and junk in the middle of
+			// a frame are rare, so the per-byte path handles them.
+			if(*data) {
+				status = ge_rs232_receive_byte(self, *data);
+
+				if(status != GE_RS232_STATUS_OK && status != GE_RS232_STATUS_JUNK && ret == GE_RS232_STATUS_OK)
+					ret = status;
 			}
-		} else {
-			self->buffer_sum += value;
+			data++;
 		}
-	} else {
-		// Just some junk byte we don't know what to do with.
-		ret = GE_RS232_STATUS_JUNK;
 	}
-bail:
+
 	return ret;
 }
 
 ge_rs232_status_t
 ge_rs232_ready_to_send(ge_rs232_t self) {
 	ge_rs232_status_t ret = GE_RS232_STATUS_WAIT;
-	time_t curr_time = time(&curr_time);
 	if(self->last_response == GE_RS232_ACK) {
 		ret = GE_RS232_STATUS_OK;
 	} else if(self->last_response == GE_RS232_NAK) {
-		ret = GE_RS232_STATUS_NAK;
-	} else if(curr_time-self->last_sent > 1) {
+		if(self->retry_at - self->time_ms() <= 0)
+			ret = GE_RS232_STATUS_NAK;
+	} else if(self->time_ms() - self->last_sent >= self->rto) {
 		ret = GE_RS232_STATUS_TIMEOUT;
 	}
 	return ret;
 }
 
+cms_t
+ge_rs232_get_timeout_cms(ge_rs232_t self) {
+	cms_t ret = CMS_DISTANT_FUTURE;
+	if(self->last_response == GE_RS232_NAK) {
+		ret = self->retry_at - self->time_ms();
+	} else if(self->last_response != GE_RS232_ACK) {
+		ret = self->last_sent + self->rto - self->time_ms();
+	}
+	return ret < 0 ? 0 : ret;
+}
+
 ge_rs232_status_t
 ge_rs232_resend_last_message(ge_rs232_t self) {
 	return ge_rs232_send_message(self,self->output_buffer,self->output_buffer_len);
@@ -150,6 +331,8 @@ ge_rs232_send_message(ge_rs232_t self, const uint8_t* data, uint8_t len) {
 	uint8_t checksum = len+1;
     uint8_t buffer[GE_RS232_MAX_MESSAGE_SIZE+7];
     uint8_t *buffer_ptr = buffer;
+	bool is_new;
+	int i;
 
 	if(len>GE_RS232_MAX_MESSAGE_SIZE) {
 		ret = GE_RS232_STATUS_MESSAGE_TOO_BIG;
@@ -165,20 +348,12 @@ ge_rs232_send_message(ge_rs232_t self, const uint8_t* data, uint8_t len) {
         "[OUTFRAME] %d bytes, Type:%d",
         len, data[0]);
 
-	if (data != self->output_buffer) {
-		memcpy(self->output_buffer,data,len);
-		self->output_buffer_len = len;
-		self->output_attempt_count = 0;
-	}
-
-	self->output_attempt_count++;
-
-//    if(self->last_response == 0) {
-//        ret = self->send_byte(self->context,0x0D,self);
-//        if(ret) goto bail;
-//    }
-
-	self->last_response = 0;
+	// The queue resends from its own copy, so a frame identical to
+	// one that hasn't been acknowledged yet is a retransmission.
+	is_new = data != self->output_buffer
+	  && (self->last_response == GE_RS232_ACK
+	    || len != self->output_buffer_len
+	    || memcmp(self->output_buffer,data,len) != 0);
 
     *buffer_ptr++ = GE_RS232_START_OF_MESSAGE;
     // Checksum has the length+1, which is what we want to write out.
@@ -186,54 +361,332 @@ ge_rs232_send_message(ge_rs232_t self, const uint8_t* data, uint8_t len) {
     *buffer_ptr++ = int_to_hex_digit(checksum);
 
 	// Write out the data.
-	for(;len;len--,data++) {
-		checksum += *data;
-        *buffer_ptr++ = int_to_hex_digit((*data)>>4);
-		*buffer_ptr++ = int_to_hex_digit(*data);
+	for(i=0;i<len;i++) {
+		checksum += data[i];
+        *buffer_ptr++ = int_to_hex_digit(data[i]>>4);
+		*buffer_ptr++ = int_to_hex_digit(data[i]);
 	}
 
 	// Now write out the checksum.
     *buffer_ptr++ = int_to_hex_digit(checksum>>4);
     *buffer_ptr++ = int_to_hex_digit(checksum);
 
-    // Send it out
+    // Send it out. If the transport can't take it right now
+    // (GE_RS232_STATUS_WAIT), nothing has happened yet, so leave
+    // the state of the link alone until it does.
 	ret = self->send_bytes(self->context,buffer,buffer_ptr-buffer,self);
 	if(ret) goto bail;
 
-	self->last_sent = time(&self->last_sent);
+	if(is_new) {
+		memcpy(self->output_buffer,data,len);
+		self->output_buffer_len = len;
+		self->output_attempt_count = 0;
+	}
+
+	self->output_attempt_count++;
+
+	if(self->output_attempt_count > 1) {
+		self->stats.retransmits++;
+	}
+
+	if(self->last_response == 0) {
+		// We never heard back about the last frame.
+		self->stats.timeouts++;
+		self->rto *= 2;
+		ge_rs232_clamp_rto(self);
+	}
+
+	self->last_response = 0;
+	self->stats.frames_sent++;
+	self->last_sent = self->time_ms();
 bail:
 	return ret;
 }
 
 ge_queue_t
 ge_queue_init(ge_queue_t qinterface, ge_rs232_t interface) {
-	memset((void*)qinterface,sizeof(*qinterface),0);
+	memset((void*)qinterface,0,sizeof(*qinterface));
 	qinterface->interface = interface;
+	qinterface->background_share = GE_QUEUE_DEFAULT_BACKGROUND_SHARE;
+	qinterface->background_tokens = GE_QUEUE_SHAPER_BURST;
+	qinterface->tokens_updated_at = qinterface->interface->time_ms();
+	qinterface->foreground_seen_at = qinterface->interface->time_ms() - GE_QUEUE_SHAPER_WINDOW;
 	return qinterface;
 }
 
+static void
+ge_queue_refill_tokens(ge_queue_t qinterface) {
+	cms_t now = qinterface->interface->time_ms();
+
+	qinterface->background_tokens += (now - qinterface->tokens_updated_at)*qinterface->background_share/100;
+	qinterface->tokens_updated_at = now;
+
+	if(qinterface->background_tokens > GE_QUEUE_SHAPER_BURST) {
+		qinterface->background_tokens = GE_QUEUE_SHAPER_BURST;
+	}
+}
+
+// Returns how long `message` has to wait before the shaper lets
+// it onto the link, zero if it can go now.
+static cms_t
+ge_queue_shaper_delay(ge_queue_t qinterface, const struct ge_message_s *message) {
+	cms_t since_foreground;
+	cms_t delay;
+
+	if(message->priority != GE_QUEUE_PRIORITY_BACKGROUND
+		|| qinterface->background_share >= 100
+	) {
+		return 0;
+	}
+
+	since_foreground = qinterface->interface->time_ms() - qinterface->foreground_seen_at;
+
+	if(since_foreground >= GE_QUEUE_SHAPER_WINDOW) {
+		// Nobody else has wanted the link lately.
+		return 0;
+	}
+
+	ge_queue_refill_tokens(qinterface);
+
+	if(qinterface->background_tokens >= 0) {
+		return 0;
+	}
+
+	if(qinterface->background_share == 0) {
+		delay = CMS_DISTANT_FUTURE;
+	} else {
+		delay = (-qinterface->background_tokens*100 + qinterface->background_share - 1)/qinterface->background_share;
+	}
+
+	if(delay > GE_QUEUE_SHAPER_WINDOW - since_foreground) {
+		delay = GE_QUEUE_SHAPER_WINDOW - since_foreground;
+	}
+
+	return delay;
+}
+
+// Picks the oldest message from the most important class.
+static struct ge_message_s*
+ge_queue_next(ge_queue_t qinterface) {
+	struct ge_message_s *ret = NULL;
+	int i;
+
+	if(qinterface->current != NULL)
+		return qinterface->current;
+
+	for(i = 0; i < GE_QUEUE_MAX_MESSAGES; i++) {
+		struct ge_message_s *message = &qinterface->queue[i];
+
+		if(!message->in_use)
+			continue;
+
+		if(ret == NULL
+			|| message->priority < ret->priority
+			|| (message->priority == ret->priority && (int32_t)(message->seq - ret->seq) < 0)
+		) {
+			ret = message;
+		}
+	}
+
+	return ret;
+}
+
+// Frees the slot of `message`, moving its waiters to `waiter`.
+// Returns the number of waiters, which are then to be told how it
+// went with `ge_queue_notify()`.
+static uint8_t
+ge_queue_release(ge_queue_t qinterface, struct ge_message_s *message, struct ge_message_waiter_s waiter[GE_QUEUE_MAX_WAITERS]) {
+	uint8_t waiter_count = message->waiter_count;
+
+	memcpy(waiter, message->waiter, sizeof(*waiter)*GE_QUEUE_MAX_WAITERS);
+
+	if(message->priority != GE_QUEUE_PRIORITY_BACKGROUND) {
+		qinterface->foreground_seen_at = qinterface->interface->time_ms();
+	}
+
+	if(qinterface->current == message)
+		qinterface->current = NULL;
+
+	message->in_use = false;
+	message->waiter_count = 0;
+	qinterface->count--;
+
+	return waiter_count;
+}
+
+static void
+ge_queue_notify(const struct ge_message_waiter_s *waiter, uint8_t waiter_count, ge_rs232_status_t status) {
+	uint8_t i;
+
+	for(i = 0; i < waiter_count; i++) {
+		if(NULL!=waiter[i].finished)
+			waiter[i].finished(waiter[i].context, status);
+	}
+}
+
+static void
+ge_queue_finish(ge_queue_t qinterface, struct ge_message_s *message, ge_rs232_status_t status) {
+	struct ge_message_waiter_s waiter[GE_QUEUE_MAX_WAITERS];
+	uint8_t waiter_count;
+
+	// The callbacks may queue something else, so the slot
+	// needs to be released first.
+	waiter_count = ge_queue_release(qinterface, message, waiter);
+	ge_queue_notify(waiter, waiter_count, status);
+}
+
+// Takes waiter `i` off of `message` and tells it `status`. If that
+// was the last waiter and the message isn't on the wire, the
+// message is dropped.
+static void
+ge_queue_remove_waiter(ge_queue_t qinterface, struct ge_message_s *message, uint8_t i, ge_rs232_status_t status) {
+	struct ge_message_waiter_s waiter = message->waiter[i];
+
+	message->waiter_count--;
+	memmove(&message->waiter[i], &message->waiter[i+1], (message->waiter_count - i)*sizeof(waiter));
+
+	if(message->waiter_count == 0 && message != qinterface->current) {
+		message->in_use = false;
+		qinterface->count--;
+	}
+
+	if(NULL!=waiter.finished)
+		waiter.finished(waiter.context, status);
+}
+
+// Gives up on anything whose deadline has passed while it was
+// still waiting for its turn.
+static void
+ge_queue_expire(ge_queue_t qinterface) {
+	cms_t now = qinterface->interface->time_ms();
+	int i, j;
+
+	for(i = 0; i < GE_QUEUE_MAX_MESSAGES; i++) {
+		struct ge_message_s *message = &qinterface->queue[i];
+
+		uint32_t seq = message->seq;
+
+		if(!message->in_use || message == qinterface->current)
+			continue;
+
+		// A callback may reuse the slot once it is released.
+		for(j = message->waiter_count - 1; j >= 0 && message->in_use && message->seq == seq; j--) {
+			if(message->waiter[j].deadline == 0 || (now - message->waiter[j].deadline) < 0)
+				continue;
+
+			syslog(LOG_INFO, "ge_queue: Deadline passed for class %d message (%d ms late)", message->priority, now - message->waiter[j].deadline);
+			ge_queue_remove_waiter(qinterface, message, j, GE_RS232_STATUS_TIMEOUT);
+		}
+	}
+}
+
+int
+ge_queue_cancel(ge_queue_t qinterface, void* context) {
+	int ret = 0;
+	int i, j;
+
+	for(i = 0; i < GE_QUEUE_MAX_MESSAGES; i++) {
+		struct ge_message_s *message = &qinterface->queue[i];
+		uint32_t seq = message->seq;
+
+		// What's on the wire finishes normally, like in
+		// `ge_queue_expire()`.
+		if(!message->in_use || message == qinterface->current)
+			continue;
+
+		for(j = message->waiter_count - 1; j >= 0 && message->in_use && message->seq == seq; j--) {
+			if(message->waiter[j].context != context)
+				continue;
+
+			ge_queue_remove_waiter(qinterface, message, j, GE_RS232_STATUS_CANCELED);
+			ret++;
+		}
+	}
+
+	if(ret != 0) {
+		syslog(LOG_DEBUG, "ge_queue: Canceled %d waiter(s)", ret);
+	}
+
+	return ret;
+}
+
 static void
 ge_queue_got_response(void* context,struct ge_rs232_s* instance, bool didAck) {
 	ge_queue_t qinterface = context;
 	ge_rs232_status_t status = ge_rs232_ready_to_send(qinterface->interface);
-	struct ge_message_s *message = &qinterface->queue[qinterface->head];
+	struct ge_message_s *message = qinterface->current;
 
-	if(status==GE_RS232_STATUS_OK || message->attempts>=3) {
-		if(NULL!=message->finished)
-			message->finished(
-				message->context,
-				status
-			);
-		qinterface->head = (qinterface->head+1)&(GE_QUEUE_MAX_MESSAGES-1);
+	if(status==GE_RS232_STATUS_WAIT && instance->last_response==GE_RS232_NAK) {
+		// Still backing off from the NAK.
+		status = GE_RS232_STATUS_NAK;
 	}
 
 	qinterface->interface->got_response = NULL;
 	qinterface->interface->response_context = NULL;
 
+	if(message == NULL)
+		return;
+
+	if(message->priority == GE_QUEUE_PRIORITY_BACKGROUND && qinterface->background_share < 100) {
+		// Stop-and-wait: the link was ours from the moment we
+		// started sending until now.
+		ge_queue_refill_tokens(qinterface);
+		qinterface->background_tokens -= qinterface->interface->time_ms() - qinterface->current_sent_at;
+	}
+
+	if(status==GE_RS232_STATUS_OK || message->attempts>=3) {
+		ge_queue_finish(qinterface, message, status);
+	}
 }
 
 bool ge_queue_is_empty(ge_queue_t qinterface) {
-    return qinterface->head == qinterface->tail;
+    return qinterface->count == 0;
+}
+
+bool
+ge_queue_ready_to_send(ge_queue_t qinterface) {
+	struct ge_message_s *message = ge_queue_next(qinterface);
+
+	if(message == NULL)
+		return false;
+
+	if(ge_rs232_ready_to_send(qinterface->interface)==GE_RS232_STATUS_WAIT)
+		return false;
+
+	return message == qinterface->current || ge_queue_shaper_delay(qinterface, message) == 0;
+}
+
+cms_t
+ge_queue_get_timeout_cms(ge_queue_t qinterface) {
+	struct ge_message_s *message = ge_queue_next(qinterface);
+	cms_t ret = CMS_DISTANT_FUTURE;
+	cms_t now = qinterface->interface->time_ms();
+	int i, j;
+
+	if(message != NULL && message != qinterface->current)
+		ret = ge_queue_shaper_delay(qinterface, message);
+
+	for(i = 0; i < GE_QUEUE_MAX_MESSAGES; i++) {
+		message = &qinterface->queue[i];
+
+		if(!message->in_use || message == qinterface->current)
+			continue;
+
+		for(j = 0; j < message->waiter_count; j++) {
+			cms_t remaining = message->waiter[j].deadline - now;
+
+			if(message->waiter[j].deadline == 0)
+				continue;
+
+			if(remaining < 0)
+				remaining = 0;
+
+			if(remaining < ret)
+				ret = remaining;
+		}
+	}
+
+	return ret;
 }
 
 ge_rs232_status_t
@@ -241,7 +694,9 @@ ge_queue_update(ge_queue_t qinterface) {
 	ge_rs232_status_t status = 0;
     struct ge_message_s *message;
 
-	if(qinterface->head==qinterface->tail)
+	ge_queue_expire(qinterface);
+
+	if(qinterface->count == 0)
 		goto bail;	// Empty.
 
 	if(ge_rs232_ready_to_send(qinterface->interface)==GE_RS232_STATUS_WAIT)
@@ -253,8 +708,18 @@ ge_queue_update(ge_queue_t qinterface) {
 		(*qinterface->interface->got_response)(qinterface->interface->response_context,qinterface->interface,0);
 	}
 
+	message = ge_queue_next(qinterface);
+
+	if(message == NULL)
+		goto bail;	// Nothing left after the timeout.
+
+	if(message != qinterface->current && ge_queue_shaper_delay(qinterface, message) != 0)
+		goto bail;	// Background traffic is over budget.
+
 	// RELEASE THE KRAKEN!
-    message = &qinterface->queue[qinterface->head];
+	qinterface->current = message;
+	qinterface->current_sent_at = qinterface->interface->time_ms();
+	qinterface->sent_count[message->priority]++;
 	message->attempts++;
 
 	qinterface->interface->got_response = &ge_queue_got_response;
@@ -262,383 +727,535 @@ ge_queue_update(ge_queue_t qinterface) {
 
 	status = ge_rs232_send_message(qinterface->interface, message->msg, message->msg_len);
 
+	if(status == GE_RS232_STATUS_WAIT) {
+		// The transport is backed up. This wasn't an attempt.
+		qinterface->sent_count[message->priority]--;
+		message->attempts--;
+	}
+
 bail:
 	return status;
 }
 
+// Finds the slot to give up so that a message of `priority` can
+// be queued: the newest message of the least important class that
+// is less important than `priority` and isn't on the wire.
+static struct ge_message_s*
+ge_queue_eviction_candidate(ge_queue_t qinterface, uint8_t priority) {
+	struct ge_message_s *ret = NULL;
+	int i;
+
+	for(i = 0; i < GE_QUEUE_MAX_MESSAGES; i++) {
+		struct ge_message_s *message = &qinterface->queue[i];
+
+		if(!message->in_use || message == qinterface->current || message->priority <= priority)
+			continue;
+
+		if(ret == NULL
+			|| message->priority > ret->priority
+			|| (message->priority == ret->priority && (int32_t)(message->seq - ret->seq) > 0)
+		) {
+			ret = message;
+		}
+	}
+
+	return ret;
+}
+
 ge_rs232_status_t ge_queue_message(
 	ge_queue_t qinterface,
 	const uint8_t* data,
 	uint8_t len,
 	void (*finished)(void* context,ge_rs232_status_t status),
 	void* context
+) {
+	return ge_queue_message_with_priority(qinterface, GE_QUEUE_PRIORITY_INTERACTIVE, GE_QUEUE_KEY_NONE, 0, data, len, finished, context);
+}
+
+// Tries to fold a new message into one that is already queued
+// under the same key. Returns true if it was.
+static bool
+ge_queue_merge(
+	ge_queue_t qinterface,
+	uint8_t priority,
+	uint32_t key,
+	cms_t deadline,
+	const uint8_t* data,
+	uint8_t len,
+	void (*finished)(void* context,ge_rs232_status_t status),
+	void* context
+) {
+	int i;
+
+	if(key == GE_QUEUE_KEY_NONE)
+		return false;
+
+	for(i = 0; i < GE_QUEUE_MAX_MESSAGES; i++) {
+		struct ge_message_s *message = &qinterface->queue[i];
+		bool same = false;
+
+		if(!message->in_use || message->key != key)
+			continue;
+
+		if(message->waiter_count >= GE_QUEUE_MAX_WAITERS)
+			continue;
+
+		same = (message->msg_len == len) && (memcmp(message->msg, data, len) == 0);
+
+		if(!same) {
+			if(message == qinterface->current) {
+				// Too late to change what is on the wire.
+				continue;
+			}
+
+			// Newer command wins, but keeps the older one's
+			// place in line.
+			memcpy(message->msg, data, len);
+			message->msg_len = len;
+		}
+
+		if(message->priority > priority && message != qinterface->current)
+			message->priority = priority;
+
+		message->waiter[message->waiter_count].finished = finished;
+		message->waiter[message->waiter_count].context = context;
+		message->waiter[message->waiter_count].deadline = deadline;
+		message->waiter_count++;
+		qinterface->merged_count++;
+
+		syslog(LOG_DEBUG, "ge_queue: %s queued message with key 0x%08X", same?"Joined":"Superseded", key);
+
+		return true;
+	}
+
+	return false;
+}
+
+ge_rs232_status_t ge_queue_message_with_priority(
+	ge_queue_t qinterface,
+	uint8_t priority,
+	uint32_t key,
+	cms_t deadline,
+	const uint8_t* data,
+	uint8_t len,
+	void (*finished)(void* context,ge_rs232_status_t status),
+	void* context
 ) {
 	ge_rs232_status_t status = 0;
-	struct ge_message_s *message = &qinterface->queue[qinterface->tail];
+	struct ge_message_s *message = NULL;
+	struct ge_message_waiter_s evicted[GE_QUEUE_MAX_WAITERS];
+	uint8_t evicted_count = 0;
+	int i;
+
+	if(len > GE_RS232_MAX_MESSAGE_SIZE || priority >= GE_QUEUE_PRIORITY_COUNT) {
+		status = GE_RS232_STATUS_INVALID_ARGUMENT;
+		goto bail;
+	}
+
+	if(ge_queue_merge(qinterface, priority, key, deadline, data, len, finished, context))
+		goto bail;
 
-	// Stuff is added to the tail and removed from the head.
-	// Tail is always empty.
+	for(i = 0; i < GE_QUEUE_MAX_MESSAGES; i++) {
+		if(!qinterface->queue[i].in_use) {
+			message = &qinterface->queue[i];
+			break;
+		}
+	}
+
+	if(message == NULL) {
+		message = ge_queue_eviction_candidate(qinterface, priority);
+
+		if(message == NULL) {
+			// Queue is full!
+			status = GE_RS232_STATUS_QUEUE_FULL;
+			goto bail;
+		}
 
-	if((qinterface->tail-qinterface->head&(GE_QUEUE_MAX_MESSAGES-1)) == (GE_QUEUE_MAX_MESSAGES-1)) {
-		// Queue is full!
-		status = GE_RS232_STATUS_QUEUE_FULL;
+		syslog(LOG_INFO, "ge_queue: Queue full, dropping class %d message for class %d", message->priority, priority);
+
+		// The evicted message's waiters are told only once the
+		// slot is ours, as they may well queue something else.
+		evicted_count = ge_queue_release(qinterface, message, evicted);
 	}
 
-	message->context = context;
-	message->finished = finished;
+	message->in_use = true;
+	message->priority = priority;
+	message->seq = qinterface->next_seq++;
+	message->key = key;
+	message->waiter_count = 1;
+	message->waiter[0].context = context;
+	message->waiter[0].finished = finished;
+	message->waiter[0].deadline = deadline;
 	memcpy(message->msg,data,len);
 	message->msg_len = len;
 	message->attempts = 0;
+	qinterface->count++;
 
-	qinterface->tail = (qinterface->tail+1)&(GE_QUEUE_MAX_MESSAGES-1);
+	if(priority != GE_QUEUE_PRIORITY_BACKGROUND) {
+		qinterface->foreground_seen_at = qinterface->interface->time_ms();
+	}
 
 	ge_queue_update(qinterface);
 
+	ge_queue_notify(evicted, evicted_count, GE_RS232_STATUS_QUEUE_FULL);
+
 bail:
 	return status;
 }
 
+// Every token the panel uses in text, as `_(code, string)`, so that
+// both tables below are built from the same list.
+#define GE_TEXT_TOKENS(_) \
+	_(0x00, "0")                                                        \
+	_(0x01, "1")                                                        \
+	_(0x02, "2")                                                        \
+	_(0x03, "3")                                                        \
+	_(0x04, "4")                                                        \
+	_(0x05, "5")                                                        \
+	_(0x06, "6")                                                        \
+	_(0x07, "7")                                                        \
+	_(0x08, "8")                                                        \
+	_(0x09, "9")                                                        \
+	_(0x0C, "#")                                                        \
+	_(0x0D, ":")                                                        \
+	_(0x0E, "/")                                                        \
+	_(0x0F, "?")                                                        \
+	_(0x10, ".")                                                        \
+	_(0x11, "A")                                                        \
+	_(0x12, "B")                                                        \
+	_(0x13, "C")                                                        \
+	_(0x14, "D")                                                        \
+	_(0x15, "E")                                                        \
+	_(0x16, "F")                                                        \
+	_(0x17, "G")                                                        \
+	_(0x18, "H")                                                        \
+	_(0x19, "I")                                                        \
+	_(0x1A, "J")                                                        \
+	_(0x1B, "K")                                                        \
+	_(0x1C, "L")                                                        \
+	_(0x1D, "M")                                                        \
+	_(0x1E, "N")                                                        \
+	_(0x1F, "O")                                                        \
+	_(0x20, "P")                                                        \
+	_(0x21, "Q")                                                        \
+	_(0x22, "R")                                                        \
+	_(0x23, "S")                                                        \
+	_(0x24, "T")                                                        \
+	_(0x25, "U")                                                        \
+	_(0x26, "V")                                                        \
+	_(0x27, "W")                                                        \
+	_(0x28, "X")                                                        \
+	_(0x29, "Y")                                                        \
+	_(0x2A, "Z")                                                        \
+	_(0x2B, " ")                                                        \
+	_(0x2C, "'")                                                        \
+	_(0x2D, "-")                                                        \
+	_(0x2E, "_")                                                        \
+	_(0x2F, "*")                                                        \
+	_(0x30, "AC POWER ")                                                \
+	_(0x31, "ACCESS ")                                                  \
+	_(0x32, "ACCOUNT ")                                                 \
+	_(0x33, "ALARM ")                                                   \
+	_(0x34, "ALL ")                                                     \
+	_(0x35, "ARM ")                                                     \
+	_(0x36, "ARMING ")                                                  \
+	_(0x37, "AREA ")                                                    \
+	_(0x38, "ATTIC ")                                                   \
+	_(0x39, "AUTO ")                                                    \
+	_(0x3A, "AUXILIARY ")                                               \
+	_(0x3B, "AWAY ")                                                    \
+	_(0x3C, "BACK ")                                                    \
+	_(0x3D, "BATTERY ")                                                 \
+	_(0x3E, "BEDROOM ")                                                 \
+	_(0x3F, "BEEPS ")                                                   \
+	_(0x40, "BOTTOM ")                                                  \
+	_(0x41, "BREEZEWAY ")                                               \
+	_(0x42, "BASEMENT ")                                                \
+	_(0x43, "BATHROOM ")                                                \
+	_(0x44, "BUS ")                                                     \
+	_(0x45, "BYPASS ")                                                  \
+	_(0x46, "BYPASSED ")                                                \
+	_(0x47, "CABINET ")                                                 \
+	_(0x48, "CANCELED ")                                                \
+	_(0x49, "CARPET ")                                                  \
+	_(0x4A, "CHIME ")                                                   \
+	_(0x4B, "CLOSET ")                                                  \
+	_(0x4C, "CLOSING ")                                                 \
+	_(0x4D, "CODE ")                                                    \
+	_(0x4E, "CONTROL ")                                                 \
+	_(0x4F, "CPU ")                                                     \
+	_(0x50, "DEGREES ")                                                 \
+	_(0x51, "DEN ")                                                     \
+	_(0x52, "DESK ")                                                    \
+	_(0x53, "DELAY ")                                                   \
+	_(0x54, "DELETE ")                                                  \
+	_(0x55, "DINING ")                                                  \
+	_(0x56, "DIRECT ")                                                  \
+	_(0x57, "DOOR ")                                                    \
+	_(0x58, "DOWN ")                                                    \
+	_(0x59, "DOWNLOAD ")                                                \
+	_(0x5A, "DOWNSTAIRS ")                                              \
+	_(0x5B, "DRAWER ")                                                  \
+	_(0x5C, "DISPLAY ")                                                 \
+	_(0x5D, "DURESS ")                                                  \
+	_(0x5E, "EAST ")                                                    \
+	_(0x5F, "ENERGY SAVER ")                                            \
+	_(0x60, "ENTER ")                                                   \
+	_(0x61, "ENTRY ")                                                   \
+	_(0x62, "ERROR ")                                                   \
+	_(0x63, "EXIT ")                                                    \
+	_(0x64, "FAIL ")                                                    \
+	_(0x65, "FAILURE ")                                                 \
+	_(0x66, "FAMILY ")                                                  \
+	_(0x67, "FEATURES ")                                                \
+	_(0x68, "FIRE ")                                                    \
+	_(0x69, "FIRST ")                                                   \
+	_(0x6A, "FLOOR ")                                                   \
+	_(0x6B, "FORCE ")                                                   \
+	_(0x6C, "FORMAT ")                                                  \
+	_(0x6D, "FREEZE ")                                                  \
+	_(0x6E, "FRONT ")                                                   \
+	_(0x6F, "FURNACE ")                                                 \
+	_(0x70, "GARAGE ")                                                  \
+	_(0x71, "GALLERY ")                                                 \
+	_(0x72, "GOODBYE ")                                                 \
+	_(0x73, "GROUP ")                                                   \
+	_(0x74, "HALL ")                                                    \
+	_(0x75, "HEAT ")                                                    \
+	_(0x76, "HELLO ")                                                   \
+	_(0x77, "HELP ")                                                    \
+	_(0x78, "HIGH ")                                                    \
+	_(0x79, "HOURLY ")                                                  \
+	_(0x7A, "HOUSE ")                                                   \
+	_(0x7B, "IMMEDIATE ")                                               \
+	_(0x7C, "IN SERVICE ")                                              \
+	_(0x7D, "INTERIOR ")                                                \
+	_(0x7E, "INTRUSION ")                                               \
+	_(0x7F, "INVALID ")                                                 \
+	_(0x80, "IS ")                                                      \
+	_(0x81, "KEY ")                                                     \
+	_(0x82, "KITCHEN ")                                                 \
+	_(0x83, "LAUNDRY ")                                                 \
+	_(0x84, "LEARN ")                                                   \
+	_(0x85, "LEFT ")                                                    \
+	_(0x86, "LIBRARY ")                                                 \
+	_(0x87, "LEVEL ")                                                   \
+	_(0x88, "LIGHT ")                                                   \
+	_(0x89, "LIGHTS ")                                                  \
+	_(0x8A, "LIVING ")                                                  \
+	_(0x8B, "LOW ")                                                     \
+	_(0x8C, "MAIN ")                                                    \
+	_(0x8D, "MASTER ")                                                  \
+	_(0x8E, "MEDICAL")                                                  \
+	_(0x8F, "MEMORY ")                                                  \
+	_(0x90, "MIN ")                                                     \
+	_(0x91, "MODE ")                                                    \
+	_(0x92, "MOTION ")                                                  \
+	_(0x93, "NIGHT ")                                                   \
+	_(0x94, "NORTH ")                                                   \
+	_(0x95, "NOT ")                                                     \
+	_(0x96, "NUMBER ")                                                  \
+	_(0x97, "OFF ")                                                     \
+	_(0x98, "OFFICE ")                                                  \
+	_(0x99, "OK ")                                                      \
+	_(0x9A, "ON ")                                                      \
+	_(0x9B, "OPEN ")                                                    \
+	_(0x9C, "OPENING ")                                                 \
+	_(0x9D, "PANIC ")                                                   \
+	_(0x9E, "PARTITION ")                                               \
+	_(0x9F, "PATIO ")                                                   \
+	_(0xA0, "PHONE ")                                                   \
+	_(0xA1, "POLICE ")                                                  \
+	_(0xA2, "POOL ")                                                    \
+	_(0xA3, "PORCH ")                                                   \
+	_(0xA4, "PRESS ")                                                   \
+	_(0xA5, "QUIET ")                                                   \
+	_(0xA6, "QUICK ")                                                   \
+	_(0xA7, "RECEIVER ")                                                \
+	_(0xA8, "REAR ")                                                    \
+	_(0xA9, "REPORT ")                                                  \
+	_(0xAA, "REMOTE ")                                                  \
+	_(0xAB, "RESTORE ")                                                 \
+	_(0xAC, "RIGHT ")                                                   \
+	_(0xAD, "ROOM ")                                                    \
+	_(0xAE, "SCHEDULE ")                                                \
+	_(0xAF, "SCRIPT ")                                                  \
+	_(0xB0, "SEC ")                                                     \
+	_(0xB1, "SECOND ")                                                  \
+	_(0xB2, "SET ")                                                     \
+	_(0xB3, "SENSOR ")                                                  \
+	_(0xB4, "SHOCK ")                                                   \
+	_(0xB5, "SIDE ")                                                    \
+	_(0xB6, "SIREN ")                                                   \
+	_(0xB7, "SLIDING ")                                                 \
+	_(0xB8, "SMOKE ")                                                   \
+	_(0xB9, "Sn ")	/* ??? */                                           \
+	_(0xBA, "SOUND ")                                                   \
+	_(0xBB, "SOUTH ")                                                   \
+	_(0xBC, "SPECIAL ")                                                 \
+	_(0xBD, "STAIRS ")                                                  \
+	_(0xBE, "START ")                                                   \
+	_(0xBF, "STATUS ")                                                  \
+	_(0xC0, "STAY ")                                                    \
+	_(0xC1, "STOP ")                                                    \
+	_(0xC2, "SUPERVISORY ")                                             \
+	_(0xC3, "SYSTEM ")                                                  \
+	_(0xC4, "TAMPER ")                                                  \
+	_(0xC5, "TEMPERATURE ")                                             \
+	_(0xC6, "TEMPORARY ")                                               \
+	_(0xC7, "TEST ")                                                    \
+	_(0xC8, "TIME ")                                                    \
+	_(0xC9, "TIMEOUT ")                                                 \
+	_(0xCA, "TOUCHPAD ")                                                \
+	_(0xCB, "TRIP ")                                                    \
+	_(0xCC, "TROUBLE ")                                                 \
+	_(0xCD, "UNBYPASS ")                                                \
+	_(0xCE, "UNIT ")                                                    \
+	_(0xCF, "UP ")                                                      \
+	_(0xD0, "VERIFY ")                                                  \
+	_(0xD1, "VIOLATION ")                                               \
+	_(0xD2, "WARNING ")                                                 \
+	_(0xD3, "WEST ")                                                    \
+	_(0xD4, "WINDOW ")                                                  \
+	_(0xD5, "MENU ")                                                    \
+	_(0xD6, "RETURN ")                                                  \
+	_(0xD7, "POUND ")                                                   \
+	_(0xD8, "HOME ")                                                    \
+	_(0xF9, "\n")	/* Carriage Return */                               \
+	_(0xFA, " ")	/* "pseudo space", whatever the hell that means. */ \
+	_(0xFB, "\n")	/* Another Carriage Return? */                      \
+	_(0xFD, "\b")	/* Backspace...? */                                 \
+	_(0xFE, "")	/* Indicates that the next token should blink. */
+
+#define GE_TEXT_TOKEN_STRING(code, str)	[code] = str,
+#define GE_TEXT_TOKEN_LEN(code, str)	[code] = sizeof(str) - 1,
+
 const char *ge_rs232_text_token_lookup[256] = {
-	"0",
-	"1",
-	"2",
-	"3",
-	"4",
-	"5",
-	"6",
-	"7",
-	"8",
-	"9",
-	[0x0c]="#",
-	":",
-	"/",
-	"?",
-	".",
-	"A",
-	"B",
-	"C",
-	"D",
-	"E",
-	"F",
-	"G",
-	"H",
-	"I",
-	"J",
-	"K",
-	"L",
-	"M",
-	"N",
-	"O",
-	"P",
-	"Q",
-	"R",
-	"S",
-	"T",
-	"U",
-	"V",
-	"W",
-	"X",
-	"Y",
-	"Z",
-	" ",
-	"'",
-	"-",
-	"_",
-	"*",
-	"AC POWER ",
-	"ACCESS ",
-	"ACCOUNT ",
-	"ALARM ",
-	"ALL ",
-	"ARM ",
-	"ARMING ",
-	"AREA ",
-	"ATTIC ",
-	"AUTO ",
-	"AUXILIARY ",
-	"AWAY ",
-	"BACK ",
-	"BATTERY ",
-	"BEDROOM ",
-	"BEEPS ",
-	"BOTTOM ",
-	"BREEZEWAY ",
-	"BASEMENT ",
-	"BATHROOM ",
-	"BUS ",
-	"BYPASS ",
-	"BYPASSED ",
-	"CABINET ",
-	"CANCELED ",
-	"CARPET ",
-	"CHIME ",
-	"CLOSET ",
-	"CLOSING ",
-	"CODE ",
-	"CONTROL ",
-	"CPU ",
-	"DEGREES ",
-	"DEN ",
-	"DESK ",
-	"DELAY ",
-	"DELETE ",
-	"DINING ",
-	"DIRECT ",
-	"DOOR ",
-	"DOWN ",
-	"DOWNLOAD ",
-	"DOWNSTAIRS ",
-	"DRAWER ",
-	"DISPLAY ",
-	"DURESS ",
-	"EAST ",
-	"ENERGY SAVER ",
-	"ENTER ",
-	"ENTRY ",
-	"ERROR ",
-	"EXIT ",
-	"FAIL ",
-	"FAILURE ",
-	"FAMILY ",
-	"FEATURES ",
-	"FIRE ",
-	"FIRST ",
-	"FLOOR ",
-	"FORCE ",
-	"FORMAT ",
-	"FREEZE ",
-	"FRONT ",
-	"FURNACE ",
-	"GARAGE ",
-	"GALLERY ",
-	"GOODBYE ",
-	"GROUP ",
-	"HALL ",
-	"HEAT ",
-	"HELLO ",
-	"HELP ",
-	"HIGH ",
-	"HOURLY ",
-	"HOUSE ",
-	"IMMEDIATE ",
-	"IN SERVICE ",
-	"INTERIOR ",
-	"INTRUSION ",
-	"INVALID ",
-	"IS ",
-	[0x81] = "KEY ",
-	[0x82] = "KITCHEN ",
-	[0x83] = "LAUNDRY ",
-	[0x84] = "LEARN ",
-	[0x85] = "LEFT ",
-	[0x86] = "LIBRARY ",
-	[0x87] = "LEVEL ",
-	[0x88] = "LIGHT ",
-	[0x89] = "LIGHTS ",
-	[0x8A] = "LIVING ",
-	[0x8B] = "LOW ",
-	[0x8C] = "MAIN ",
-	[0x8D] = "MASTER ",
-	[0x8E] = "MEDICAL",
-	[0x8F] = "MEMORY ",
-	[0x90] = "MIN ",
-	"MODE ",
-	"MOTION ",
-	"NIGHT ",
-	"NORTH ",
-	"NOT ",
-	"NUMBER ",
-	"OFF ",
-	"OFFICE ",
-	"OK ",
-	"ON ",
-	"OPEN ",
-	"OPENING ",
-	"PANIC ",
-	"PARTITION ",
-	"PATIO ",
-	"PHONE ",
-	"POLICE ",
-	"POOL ",
-	"PORCH ",
-	"PRESS ",
-	"QUIET ",
-	"QUICK ",
-	"RECEIVER ",
-	"REAR ",
-	"REPORT ",
-	"REMOTE ",
-	"RESTORE ",
-	"RIGHT ",
-	"ROOM ",
-	"SCHEDULE ",
-	"SCRIPT ",
-	"SEC ",
-	"SECOND ",
-	"SET ",
-	"SENSOR ",
-	"SHOCK ",
-	"SIDE ",
-	"SIREN ",
-	"SLIDING ",
-	"SMOKE ",
-	"Sn ", // ???
-	"SOUND ",
-	"SOUTH ",
-	"SPECIAL ",
-	"STAIRS ",
-	"START ",
-	"STATUS ",
-	"STAY ",
-	"STOP ",
-	"SUPERVISORY ",
-	"SYSTEM ",
-	"TAMPER ",
-	"TEMPERATURE ",
-	"TEMPORARY ",
-	"TEST ",
-	"TIME ",
-	"TIMEOUT ",
-	"TOUCHPAD ",
-	"TRIP ",
-	"TROUBLE ",
-	"UNBYPASS ",
-	"UNIT ",
-	"UP ",
-	"VERIFY ",
-	"VIOLATION ",
-	"WARNING ",
-	"WEST ",
-	"WINDOW ",
-	"MENU ",
-	"RETURN ",
-	"POUND ",
-	"HOME ",
-	[0xF9]="\n",	// Carriage Return
-	[0xFA]=" ",		// "pseudo space", whatever the hell that means.
-	[0xFB]="\n",	// Another Carriage Return?
-	[0xFD]="\b",	// Backspace...?
-	[0xFE]="",		// Indicates that the next token should blink.
+	GE_TEXT_TOKENS(GE_TEXT_TOKEN_STRING)
+};
+
+// Lengths of the strings in `ge_rs232_text_token_lookup`.
+static const uint8_t ge_text_token_len[256] = {
+	GE_TEXT_TOKENS(GE_TEXT_TOKEN_LEN)
 };
 
 #define GE_TEXT_BLINK_TOKEN		0xFE
 
-const char*
-ge_text_to_ascii_one_line(const uint8_t * bytes, uint8_t len) {
-	static char ret[1024];
+// Ends a run of blinking tokens with a ">", which goes in front
+// of the trailing space, if there is one.
+static size_t
+ge_text_end_blink(char* dest, size_t pos, size_t max) {
+	if (pos && isspace((unsigned char)dest[pos-1])) {
+		dest[pos-1] = '>';
+		if (pos < max)
+			dest[pos++] = ' ';
+	} else if (pos < max) {
+		dest[pos++] = '>';
+	}
+	return pos;
+}
+
+static size_t
+ge_text_decode(char* dest, size_t size, const uint8_t * bytes, uint8_t len, bool one_line) {
 	bool blink_next_token = false;
-	ret[0] = 0;
-	// TODO: Optimize!
+	size_t max = size - 1;	// Room for the terminator
+	size_t pos = 0;
+
+	if (size == 0)
+		return 0;
+
 	while(len--) {
 		uint8_t code = *bytes++;
+		const char* str;
+		size_t str_len;
+
 		if (code == GE_TEXT_BLINK_TOKEN) {
-			if (blink_next_token == false) {
-				strlcat(ret,"<",sizeof(ret));
+			if (blink_next_token == false && pos < max) {
+				dest[pos++] = '<';
 			}
 			blink_next_token = true;
-			if (len--) {
-				code = *bytes++;
-			} else {
-				continue;
+			if (len == 0) {
+				break;
 			}
+			len--;
+			code = *bytes++;
 		} else {
 			if (blink_next_token == true) {
-				if (isspace(ret[strlen(ret)-1])) {
-					ret[strlen(ret)-1] = 0;
-					strlcat(ret,"> ",sizeof(ret));
-				} else {
-					strlcat(ret,">",sizeof(ret));
-				}
+				pos = ge_text_end_blink(dest, pos, max);
 			}
 			blink_next_token = false;
 		}
-		const char* str = ge_rs232_text_token_lookup[code];
-		if (str) {
-			if (str[0]=='\n') {
-				if (len) {
-					strlcat(ret,isspace(ret[strlen(ret)-1])?"| ":" | ",sizeof(ret));
-				}
-			} else if (str[0]=='\b') {
-				// Backspace
-				if (ret[0]) {
-					ret[strlen(ret)-1] = 0;
-				}
+
+		str = ge_rs232_text_token_lookup[code];
+
+		if (str == NULL) {
+			str = "?";
+			str_len = 1;
+		} else {
+			str_len = ge_text_token_len[code];
+		}
+
+		if (str[0] == '\b') {
+			// Backspace
+			if (pos)
+				pos--;
+			continue;
+		}
+
+		if (one_line && str[0] == '\n') {
+			if (!len)
+				continue;
+			if (pos && isspace((unsigned char)dest[pos-1])) {
+				str = "| ";
+				str_len = 2;
 			} else {
-				strlcat(ret,str,sizeof(ret));
+				str = " | ";
+				str_len = 3;
 			}
-		} else {
-			strlcat(ret,"?",sizeof(ret));
 		}
+
+		if (str_len > max - pos)
+			str_len = max - pos;
+
+		memcpy(dest + pos, str, str_len);
+		pos += str_len;
 	}
+
 	if (blink_next_token == true) {
-		if (isspace(ret[strlen(ret)-1])) {
-			ret[strlen(ret)-1] = 0;
-			strlcat(ret,"> ",sizeof(ret));
-		} else {
-			strlcat(ret,">",sizeof(ret));
-		}
+		pos = ge_text_end_blink(dest, pos, max);
 	}
+
 	// Remove trailing whitespace.
-	for(len=strlen(ret);len && isspace(ret[len-1]);len--) {
-		ret[len-1] = 0;
+	while (pos && isspace((unsigned char)dest[pos-1])) {
+		pos--;
 	}
+
+	dest[pos] = 0;
+
+	return pos;
+}
+
+size_t
+ge_text_to_ascii_r(char* dest, size_t size, const uint8_t * bytes, uint8_t len) {
+	return ge_text_decode(dest, size, bytes, len, false);
+}
+
+size_t
+ge_text_to_ascii_one_line_r(char* dest, size_t size, const uint8_t * bytes, uint8_t len) {
+	return ge_text_decode(dest, size, bytes, len, true);
+}
+
+const char*
+ge_text_to_ascii_one_line(const uint8_t * bytes, uint8_t len) {
+	static char ret[1024];
+	ge_text_to_ascii_one_line_r(ret, sizeof(ret), bytes, len);
 	return ret;
 }
 
 const char*
 ge_text_to_ascii(const uint8_t * bytes, uint8_t len) {
 	static char ret[1024];
-	ret[0] = 0;
-	bool blink_next_token = false;
-	// TODO: Optimize!
-	while(len--) {
-		uint8_t code = *bytes++;
-		if (code == GE_TEXT_BLINK_TOKEN) {
-			if (blink_next_token == false) {
-				strlcat(ret,"<",sizeof(ret));
-			}
-			blink_next_token = true;
-			if (len--) {
-				code = *bytes++;
-			} else {
-				continue;
-			}
-		} else {
-			if (blink_next_token == true) {
-				if (isspace(ret[strlen(ret)-1])) {
-					ret[strlen(ret)-1] = 0;
-					strlcat(ret,"> ",sizeof(ret));
-				} else {
-					strlcat(ret,">",sizeof(ret));
-				}
-			}
-			blink_next_token = false;
-		}
-		const char* str = ge_rs232_text_token_lookup[code];
-		if(str) {
-			if(str[0]=='\b') {
-				// Backspace
-				if(ret[0])
-					ret[strlen(ret)-1] = 0;
-			} else {
-				strlcat(ret,str,sizeof(ret));
-			}
-		} else {
-			strlcat(ret,"?",sizeof(ret));
-		}
-	}
-	if (blink_next_token == true) {
-		if (isspace(ret[strlen(ret)-1])) {
-			ret[strlen(ret)-1] = 0;
-			strlcat(ret,"> ",sizeof(ret));
-		} else {
-			strlcat(ret,">",sizeof(ret));
-		}
-	}
-	// Remove trailing whitespace.
-	for(len=strlen(ret);len && isspace(ret[len-1]);len--) {
-		ret[len-1] = 0;
-	}
+	ge_text_to_ascii_r(ret, sizeof(ret), bytes, len);
 	return ret;
 }
 
@@ -3,8 +3,10 @@
 #define __GE_RS232_H__
 
 #include <stdint.h>
+#include <stddef.h>
 #include <stdbool.h>
 #include <time.h>
+#include "time-utils.h"
 
 #define GE_RS232_START_OF_MESSAGE	(0x0A)	// ASCII Line Feed
 #define GE_RS232_ACK				(0x06)	// ASCII ACK
@@ -13,9 +15,44 @@
 #define GE_RS232_MAX_MESSAGE_SIZE	(56)
 
 #ifndef GE_QUEUE_MAX_MESSAGES
-#define GE_QUEUE_MAX_MESSAGES		(8)
+#define GE_QUEUE_MAX_MESSAGES		(16)
 #endif
 
+// Outbound message classes, most important first. The queue
+// always sends the oldest message of the most important class.
+#define GE_QUEUE_PRIORITY_URGENT		(0)	// Arming, disarming and panics
+#define GE_QUEUE_PRIORITY_INTERACTIVE	(1)	// Lights, outputs, other keypresses
+#define GE_QUEUE_PRIORITY_BACKGROUND	(2)	// Refreshes and other bulk traffic
+#define GE_QUEUE_PRIORITY_COUNT			(3)
+
+// Background link shaper. For `GE_QUEUE_SHAPER_WINDOW` ms after
+// any other class has used the queue, background messages may
+// only occupy the link for `background_share` percent of the
+// time, with bursts of up to `GE_QUEUE_SHAPER_BURST` ms.
+#define GE_QUEUE_DEFAULT_BACKGROUND_SHARE	(25)
+#define GE_QUEUE_SHAPER_WINDOW		(5000)
+#define GE_QUEUE_SHAPER_BURST		(500)
+
+// Messages queued with the same non-zero key refer to the same
+// thing (a light, an output, a refresh). A message with identical
+// contents to one already queued or on the wire joins it, and one
+// with different contents replaces a queued one in place. Either
+// way, all callers are finished from the single transmission.
+#define GE_QUEUE_KEY_NONE			(0)
+#define GE_QUEUE_MAX_WAITERS		(4)
+
+// Retransmission timeout bounds, in milliseconds. The timeout
+// is derived from the measured ACK round-trip time in the same
+// way as TCP (RFC 6298), and doubles after each timeout.
+#define GE_RS232_INITIAL_RTO		(1000)
+#define GE_RS232_MIN_RTO			(200)
+#define GE_RS232_MAX_RTO			(4000)
+
+// How long to wait before resending after a NAK. Doubles with
+// each attempt, plus up to 50% of random jitter.
+#define GE_RS232_NAK_BACKOFF		(50)
+#define GE_RS232_MAX_NAK_BACKOFF	(1000)
+
 
 #define GE_RS232_STATUS_OK					(0)
 #define GE_RS232_STATUS_ERROR				(-1)
@@ -30,6 +67,7 @@
 #define GE_RS232_STATUS_INVALID_ARGUMENT   (-10)
 #define GE_RS232_STATUS_ALREADY            (-11)
 #define GE_RS232_STATUS_FORBIDDEN          (-12)
+#define GE_RS232_STATUS_CANCELED           (-13)
 
 #define GE_RS232_ZONE_STATUS_TRIPPED		(1<<0)
 #define GE_RS232_ZONE_STATUS_FAULT			(1<<1)
@@ -201,6 +239,20 @@ typedef struct ge_rs232_s* ge_rs232_t;
 
 typedef ge_rs232_status_t (*ge_rs232_send_bytes_func_t)(void* context, const uint8_t* data, int len, ge_rs232_t instance);
 
+struct ge_rs232_stats_s {
+	uint32_t frames_sent;
+	uint32_t retransmits;
+	uint32_t acks;
+	uint32_t naks;
+	uint32_t timeouts;
+	uint32_t frames_received;
+	uint32_t bad_checksums;
+	uint32_t rx_overruns;
+	uint32_t rtt_samples;
+	cms_t rtt_min;
+	cms_t rtt_max;
+};
+
 struct ge_rs232_s {
 	void* context;
 	bool reading_message;
@@ -209,38 +261,79 @@ struct ge_rs232_s {
 	uint8_t nibble_buffer;
 	uint8_t last_response;
 	uint8_t buffer_sum;
-	time_t last_sent;
+	cms_t last_sent;
+	cms_t srtt;		// Smoothed round-trip time, 0 if not measured yet
+	cms_t rttvar;	// Round-trip time variation
+	cms_t rto;		// Current retransmission timeout
+	cms_t retry_at;	// Don't resend before this after a NAK
+	struct ge_rs232_stats_s stats;
 	uint8_t buffer[GE_RS232_MAX_MESSAGE_SIZE];
 	uint8_t output_buffer[GE_RS232_MAX_MESSAGE_SIZE];
 	uint8_t output_buffer_len;
 	uint8_t output_attempt_count;
 	ge_rs232_status_t (*received_message)(void* context, const uint8_t* data, uint8_t len,struct ge_rs232_s* instance);
+	// Optional. Returning false NAKs a good frame instead of
+	// handing it to `received_message`.
+	bool (*can_receive)(void* context, uint8_t len,struct ge_rs232_s* instance);
     ge_rs232_send_bytes_func_t send_bytes;
 	void* response_context;
 	void (*got_response)(void* context,struct ge_rs232_s* instance, bool didAck);
+	// Milliseconds from a monotonic clock, used for all the timing
+	// here and in the queue. `ge_rs232_init()` sets it to `time_ms()`.
+	cms_t (*time_ms)(void);
 };
 
 ge_rs232_t ge_rs232_init(ge_rs232_t interface);
 ge_rs232_status_t ge_rs232_process(ge_rs232_t interface);
 ge_rs232_status_t ge_rs232_receive_byte(ge_rs232_t interface, uint8_t byte);
+
+// Same as calling `ge_rs232_receive_byte()` for every non-zero byte
+// of `data`, but decodes whole frames at a time. Returns the first
+// error, if any, but always consumes everything.
+ge_rs232_status_t ge_rs232_receive_bytes(ge_rs232_t interface, const uint8_t* data, size_t len);
 ge_rs232_status_t ge_rs232_ready_to_send(ge_rs232_t interface);
+cms_t ge_rs232_get_timeout_cms(ge_rs232_t interface);
 ge_rs232_status_t ge_rs232_send_message(ge_rs232_t interface, const uint8_t* data, uint8_t len);
 ge_rs232_status_t ge_rs232_resend_last_message(ge_rs232_t self);
 
 #pragma mark - Queue Interface
 
+struct ge_message_waiter_s {
+	void* context;
+	void (*finished)(void* context,ge_rs232_status_t status);
+
+	// If not zero, the waiter gives up at this time if the message
+	// hasn't been put on the wire yet, see `ge_queue_message_with_priority()`.
+	cms_t deadline;
+};
+
 struct ge_message_s {
 	uint8_t msg[GE_RS232_MAX_MESSAGE_SIZE];
 	uint8_t msg_len;
 	uint8_t attempts;
-	void* context;
-	void (*finished)(void* context,ge_rs232_status_t status);
+	uint8_t priority;
+	bool in_use;
+	uint32_t seq;
+	uint32_t key;
+	uint8_t waiter_count;
+	struct ge_message_waiter_s waiter[GE_QUEUE_MAX_WAITERS];
 };
 
 struct ge_queue_s {
 	ge_rs232_t interface;
 	struct ge_message_s queue[GE_QUEUE_MAX_MESSAGES];
-	uint8_t head, tail;
+	struct ge_message_s *current;	// On the wire, waiting for a response
+	uint8_t count;
+	uint32_t next_seq;
+
+	uint8_t background_share;	// Percent, 100 disables shaping
+	cms_t background_tokens;
+	cms_t tokens_updated_at;
+	cms_t foreground_seen_at;
+	cms_t current_sent_at;
+
+	uint32_t sent_count[GE_QUEUE_PRIORITY_COUNT];
+	uint32_t merged_count;
 };
 typedef struct ge_queue_s *ge_queue_t;
 
@@ -249,6 +342,13 @@ ge_queue_t ge_queue_init(ge_queue_t qinterface,ge_rs232_t interface);
 ge_rs232_status_t ge_queue_update(ge_queue_t qinterface);
 bool ge_queue_is_empty(ge_queue_t qinterface);
 
+// True if `ge_queue_update()` would put something on the wire.
+bool ge_queue_ready_to_send(ge_queue_t qinterface);
+
+// How long until the shaper lets the next message go, or until
+// the next deadline passes.
+cms_t ge_queue_get_timeout_cms(ge_queue_t qinterface);
+
 ge_rs232_status_t ge_queue_message(
 	ge_queue_t qinterface,
 	const uint8_t* data,
@@ -257,12 +357,41 @@ ge_rs232_status_t ge_queue_message(
 	void* context
 );
 
+// `deadline` is an absolute value of the link's `time_ms`, or zero
+// for none.
+// A waiter whose deadline passes before its message makes it onto
+// the wire is removed and finished with `GE_RS232_STATUS_TIMEOUT`.
+// The message itself is dropped once nobody is waiting for it.
+ge_rs232_status_t ge_queue_message_with_priority(
+	ge_queue_t qinterface,
+	uint8_t priority,
+	uint32_t key,
+	cms_t deadline,
+	const uint8_t* data,
+	uint8_t len,
+	void (*finished)(void* context,ge_rs232_status_t status),
+	void* context
+);
+
+// Finishes every waiter with the given context with
+// `GE_RS232_STATUS_CANCELED`, and drops messages that nobody is
+// waiting for anymore. The message already on the wire is left
+// alone, and its waiters finish normally. Returns the number of
+// waiters that were canceled.
+int ge_queue_cancel(ge_queue_t qinterface, void* context);
+
 #pragma mark - Text conversion
 
 extern const char* ge_rs232_text_token_lookup[256];
 
 const char* ge_text_to_ascii_one_line(const uint8_t * bytes, uint8_t len);
 const char* ge_text_to_ascii(const uint8_t * bytes, uint8_t len);
+
+// Same as the above, but decode into `dest`, which is always
+// terminated, and return the length of the text. Text that
+// doesn't fit is cut short.
+size_t ge_text_to_ascii_one_line_r(char* dest, size_t size, const uint8_t * bytes, uint8_t len);
+size_t ge_text_to_ascii_r(char* dest, size_t size, const uint8_t * bytes, uint8_t len);
 const char* ge_user_to_cstr(char* dest, int user);
 
 const char* ge_specific_alarm_to_cstr(char* dest, int code);
@@ -15,6 +15,14 @@
 #include "concordd.h"
 #include "concordd-config.h"
 #include "concordd-dbus-server.h"
+#include "concordd-event-loop.h"
+#include "concordd-tx-buffer.h"
+#include "concordd-serial-thread.h"
+#include "concordd-realtime.h"
+#include "concordd-calibrate.h"
+#include "capture-file.h"
+#include "concordd-state-file.h"
+#include "concordd-hook.h"
 
 #include "config-file.h"
 #include "args.h"
@@ -86,6 +94,7 @@ static arg_list_item_t option_list[] = {
 	{ 'o', "option", "<option-string>", "Config option"},
 	{ 's', "socket", "<socket>", "Socket file"},
 	{ 'v', "version", NULL, "Print version" },
+	{ 'C', "calibrate", NULL, "Measure the serial round trip time and exit" },
 #if HAVE_PWD_H
 	{ 'u', "user", NULL, "Username for dropping privileges" },
 #endif
@@ -106,6 +115,22 @@ static const char* gProcessName = "concordd";
 static const char* gPIDFilename = NULL;
 static const char* gChroot = CONCORDD_DEFAULT_CHROOT_PATH;
 static const char* gSocketPath = "/dev/null";
+static const char* gStateFilePath = NULL;
+static const char* gCaptureFilePath = NULL;
+static int gStateSaveInterval = 300;
+static int gBackgroundLinkShare = GE_QUEUE_DEFAULT_BACKGROUND_SHARE;
+static int gCommandTimeout = CONCORDD_DBUS_DEFAULT_COMMAND_TIMEOUT/MSEC_PER_SEC;
+static int gSignalWindow = CONCORDD_DBUS_DEFAULT_SIGNAL_WINDOW;
+static int gDBusMaxOutgoing = CONCORDD_DBUS_DEFAULT_MAX_OUTGOING;
+static bool gDBusV2Signals = false;
+static bool gUseEpoll = true;
+static bool gUseSerialThread = false;
+static struct concordd_realtime_s gRealTime = { 0, -1 };
+static int gHookMaxRunning = CONCORDD_HOOK_DEFAULT_MAX_RUNNING;
+static int gHookMaxBacklog = CONCORDD_HOOK_DEFAULT_MAX_BACKLOG;
+static int gHookTimeout = CONCORDD_HOOK_DEFAULT_TIMEOUT/MSEC_PER_SEC;
+static const char* gHookCoprocessCommand;
+static int gHookCoprocessBacklog = CONCORDD_HOOK_DEFAULT_COPROCESS_BACKLOG;
 
 static const char* gPartitionAlarmCommand;
 static const char* gPartitionTroubleCommand;
@@ -181,13 +206,9 @@ signal_SIGHUP(int sig)
 static void
 signal_SIGCHLD(int sig)
 {
-	// Automatically call wait as children terminate.
-    int stat = 0;
-    pid_t pid = -1;
-
-	do {
-		pid = waitpid(-1, &stat, WNOHANG);
-	} while (pid > 0);
+	// Children are reaped by the hook executor from the main
+	// loop. We only need this handler so that select() gets
+	// interrupted when a child terminates.
 }
 
 /* ------------------------------------------------------------------------- */
@@ -312,6 +333,86 @@ set_config_param(
             gAcPowerRestoredCommand = strdup(value);
         }
         ret = 0;
+	} else if (strcaseequal(key, kCONCORDDConfig_StateFile)) {
+		if (value[0] == 0) {
+			gStateFilePath = NULL;
+		} else {
+			gStateFilePath = strdup(value);
+		}
+		ret = 0;
+	} else if (strcaseequal(key, kCONCORDDConfig_CaptureFile)) {
+		if (value[0] == 0) {
+			gCaptureFilePath = NULL;
+		} else {
+			gCaptureFilePath = strdup(value);
+		}
+		ret = 0;
+	} else if (strcaseequal(key, kCONCORDDConfig_StateSaveInterval)) {
+		gStateSaveInterval = atoi(value);
+		ret = 0;
+		require(0 <= gStateSaveInterval, bail);
+	} else if (strcaseequal(key, kCONCORDDConfig_SerialThread)) {
+		gUseSerialThread = strtobool(value);
+		ret = 0;
+	} else if (strcaseequal(key, kCONCORDDConfig_RealTimePriority)) {
+		gRealTime.priority = atoi(value);
+		ret = 0;
+		require(0 <= gRealTime.priority && gRealTime.priority <= 99, bail);
+	} else if (strcaseequal(key, kCONCORDDConfig_RealTimeCPU)) {
+		gRealTime.cpu = atoi(value);
+		ret = 0;
+		require(-1 <= gRealTime.cpu, bail);
+	} else if (strcaseequal(key, kCONCORDDConfig_EventLoop)) {
+		if (strcaseequal(value, "epoll")) {
+			gUseEpoll = true;
+		} else if (strcaseequal(value, "select")) {
+			gUseEpoll = false;
+		} else {
+			goto bail;
+		}
+		ret = 0;
+	} else if (strcaseequal(key, kCONCORDDConfig_CommandTimeout)) {
+		gCommandTimeout = atoi(value);
+		ret = 0;
+		require(0 <= gCommandTimeout, bail);
+	} else if (strcaseequal(key, kCONCORDDConfig_SignalWindow)) {
+		gSignalWindow = atoi(value);
+		ret = 0;
+		require(0 <= gSignalWindow, bail);
+	} else if (strcaseequal(key, kCONCORDDConfig_DBusMaxOutgoing)) {
+		gDBusMaxOutgoing = atoi(value);
+		ret = 0;
+		require(0 <= gDBusMaxOutgoing, bail);
+	} else if (strcaseequal(key, kCONCORDDConfig_DBusV2Signals)) {
+		gDBusV2Signals = strtobool(value);
+		ret = 0;
+	} else if (strcaseequal(key, kCONCORDDConfig_BackgroundLinkShare)) {
+		gBackgroundLinkShare = atoi(value);
+		ret = 0;
+		require(0 <= gBackgroundLinkShare && gBackgroundLinkShare <= 100, bail);
+	} else if (strcaseequal(key, kCONCORDDConfig_HookCoprocessCommand)) {
+		if (value[0] == 0) {
+			gHookCoprocessCommand = NULL;
+		} else {
+			gHookCoprocessCommand = strdup(value);
+		}
+		ret = 0;
+	} else if (strcaseequal(key, kCONCORDDConfig_HookCoprocessBacklog)) {
+		gHookCoprocessBacklog = atoi(value);
+		ret = 0;
+		require(0 < gHookCoprocessBacklog, bail);
+	} else if (strcaseequal(key, kCONCORDDConfig_HookMaxRunning)) {
+		gHookMaxRunning = atoi(value);
+		ret = 0;
+		require(0 < gHookMaxRunning, bail);
+	} else if (strcaseequal(key, kCONCORDDConfig_HookMaxBacklog)) {
+		gHookMaxBacklog = atoi(value);
+		ret = 0;
+		require(0 <= gHookMaxBacklog, bail);
+	} else if (strcaseequal(key, kCONCORDDConfig_HookTimeout)) {
+		gHookTimeout = atoi(value);
+		ret = 0;
+		require(0 <= gHookTimeout, bail);
 	} else if (strcaseequal(key, kCONCORDDConfig_PIDFile)) {
 		if (gPIDFilename)
 			goto bail;
@@ -403,23 +504,58 @@ struct concordd_state_s {
     struct concordd_instance_s instance;
     int fd;
     struct concordd_dbus_server_s dbus_server;
+    struct concordd_hook_executor_s hook_executor;
+    struct concordd_tx_buffer_s tx_buffer;
+
+    // Only used if `gUseSerialThread` is set, in which case it
+    // owns `fd` and `tx_buffer` is unused.
+    struct concordd_serial_thread_s serial_thread;
+
+    // Time from being woken up by serial input until our ACK for it
+    // is out, when there is no serial thread to measure it.
+    struct concordd_latency_histogram_s ack_latency;
+
+    // Raw serial traffic, if `gCaptureFilePath` is set. Written to
+    // by the serial thread instead, if there is one.
+    struct capture_file_s capture;
 };
 
 static ge_rs232_status_t
 send_bytes_func(struct concordd_state_s* context, const uint8_t* data, int len, struct ge_rs232_s* instance) {
-    while (len > 0) {
-        ssize_t written = write(context->fd, data, len);
-        if (written < 0) {
-            syslog(LOG_ERR, "Error on write(): %s (data:%p, len:%d)", strerror(errno),data, len);
-            return GE_RS232_STATUS_ERROR;
+    int ret;
+
+    if (context->serial_thread.running) {
+        ret = concordd_serial_thread_send(&context->serial_thread, data, len);
+    } else {
+        ret = concordd_tx_buffer_send(&context->tx_buffer, data, len);
+    }
+
+    if (ret != 0) {
+        if (errno == ENOBUFS) {
+            syslog(LOG_WARNING, "Serial output is backed up, holding off on %d bytes", len);
+            return GE_RS232_STATUS_WAIT;
         }
-        len  -= written;
-        data += written;
+        return GE_RS232_STATUS_ERROR;
     }
 
     return GE_RS232_STATUS_OK;
 }
 
+static int
+flush_serial_output(struct concordd_state_s* context)
+{
+    bool frame_pending = context->tx_buffer.frame_pending;
+    int ret = concordd_tx_buffer_uncork(&context->tx_buffer);
+
+    if (frame_pending && !context->tx_buffer.frame_pending) {
+        // The retransmit timer should run from when the frame
+        // actually left, not from when it was queued.
+        context->instance.ge_rs232.last_sent = context->instance.ge_rs232.time_ms();
+    }
+
+    return ret;
+}
+
 void
 concordd_instance_info_changed_func(void* context, concordd_instance_t instance, int changed)
 {
@@ -434,6 +570,7 @@ concordd_instance_info_changed_func(void* context, concordd_instance_t instance,
     }
 
 	const char* command = NULL;
+	concordd_hook_t hook = NULL;
 
 	if (instance->ac_power_failure) {
 		command = gAcPowerFailureCommand;
@@ -441,19 +578,21 @@ concordd_instance_info_changed_func(void* context, concordd_instance_t instance,
 		command = gAcPowerRestoredCommand;
 	}
 
-	if (command == NULL) {
+	if (command == NULL && !concordd_hook_executor_has_coprocess(&concordd_state->hook_executor)) {
 		return;
 	}
 
 	// Now handle via system.
-    int pid = fork();
-    if (pid == -1) {
-        syslog(LOG_ERR, "concordd_instance_info_changed_func: fork() failed: %s", strerror(errno));
+	hook = concordd_hook_new(command);
+	if (hook == NULL) {
+		syslog(LOG_ERR, "concordd_instance_info_changed_func: Unable to allocate hook");
+		return;
+	}
 
-    } else if (pid == 0) {
-		// Child
-        _exit(system(command));
-    }
+	concordd_hook_setenv(hook, "CONCORDD_TYPE", "AC-POWER");
+	concordd_hook_setenv(hook, "CONCORDD_AC_POWER_FAILURE", instance->ac_power_failure ? "1" : "0");
+
+	concordd_hook_executor_submit(&concordd_state->hook_executor, hook);
 }
 
 void
@@ -471,11 +610,12 @@ void
 concordd_zone_info_changed_func(void* context, concordd_instance_t instance, concordd_zone_t zone, int changed)
 {
     struct concordd_state_s *concordd_state = (struct concordd_state_s *)context;
+    concordd_hook_t hook = NULL;
 
 	// Pass-thru to D-Bus first.
 	concordd_dbus_zone_info_changed_func(&concordd_state->dbus_server, instance, zone, changed);
 
-    if (gZoneChangedCommand == NULL) {
+    if (gZoneChangedCommand == NULL && !concordd_hook_executor_has_coprocess(&concordd_state->hook_executor)) {
         return;
     }
 
@@ -485,204 +625,184 @@ concordd_zone_info_changed_func(void* context, concordd_instance_t instance, con
     }
 
     // Now handle via system.
-    int pid = fork();
-    if (pid == -1) {
-        syslog(LOG_ERR, "concordd_zone_info_changed_func: fork() failed: %s", strerror(errno));
-
-    } else if (pid == 0) {
-        char value[64];
-
-        setenv("CONCORDD_TYPE", "ZONE", 1);
-
-        snprintf(value, sizeof(value), "%d", zone->partition_id);
-        setenv("CONCORDD_PARTITION_ID", value, 1);
-
-        snprintf(value, sizeof(value), "%d", concordd_get_zone_index(instance, zone));
-        setenv("CONCORDD_ZONE_ID", value, 1);
-
-		setenv("CONCORDD_ZONE_NAME", ge_text_to_ascii_one_line(zone->encoded_name, zone->encoded_name_len), 1);
-
-		snprintf(value, sizeof(value), "%d", zone->type);
-        setenv("CONCORDD_ZONE_TYPE", value, 1);
-
-		snprintf(value, sizeof(value), "%d", zone->group);
-        setenv("CONCORDD_ZONE_GROUP", value, 1);
-
-
-		if ((changed&CONCORDD_ZONE_TRIPPED_CHANGED) == CONCORDD_ZONE_TRIPPED_CHANGED) {
-	        setenv(
-				"CONCORDD_ZONE_TRIPPED",
-				(zone->zone_state&GE_RS232_ZONE_STATUS_TRIPPED) == GE_RS232_ZONE_STATUS_TRIPPED
-					? "1"
-					: "0",
-				1
-			);
-		}
+    hook = concordd_hook_new(gZoneChangedCommand);
+    if (hook == NULL) {
+        syslog(LOG_ERR, "concordd_zone_info_changed_func: Unable to allocate hook");
+        return;
+    }
 
-		if ((changed&CONCORDD_ZONE_LAST_KC_CHANGED) == CONCORDD_ZONE_LAST_KC_CHANGED) {
-			snprintf(value, sizeof(value), "%d", zone->last_kc);
-	        setenv("CONCORDD_KEYFOB_BUTTON", value, 1);
-		}
+    concordd_hook_setenv(hook, "CONCORDD_TYPE", "ZONE");
+    concordd_hook_setenvf(hook, "CONCORDD_PARTITION_ID", "%d", zone->partition_id);
+    concordd_hook_setenvf(hook, "CONCORDD_ZONE_ID", "%d", concordd_get_zone_index(instance, zone));
+	concordd_hook_setenv(hook, "CONCORDD_ZONE_NAME", zone->name);
+    concordd_hook_setenvf(hook, "CONCORDD_ZONE_TYPE", "%d", zone->type);
+    concordd_hook_setenvf(hook, "CONCORDD_ZONE_GROUP", "%d", zone->group);
+
+	if ((changed&CONCORDD_ZONE_TRIPPED_CHANGED) == CONCORDD_ZONE_TRIPPED_CHANGED) {
+		concordd_hook_setenv(
+			hook,
+			"CONCORDD_ZONE_TRIPPED",
+			(zone->zone_state&GE_RS232_ZONE_STATUS_TRIPPED) == GE_RS232_ZONE_STATUS_TRIPPED
+				? "1"
+				: "0"
+		);
+	}
 
-		if ((zone->zone_state&GE_RS232_ZONE_STATUS_ALARM) == GE_RS232_ZONE_STATUS_ALARM) {
-	        setenv("CONCORDD_ZONE_ALARM", "1", 1);
-		}
+	if ((changed&CONCORDD_ZONE_LAST_KC_CHANGED) == CONCORDD_ZONE_LAST_KC_CHANGED) {
+		concordd_hook_setenvf(hook, "CONCORDD_KEYFOB_BUTTON", "%d", zone->last_kc);
+	}
 
-		if ((zone->zone_state&GE_RS232_ZONE_STATUS_FAULT) == GE_RS232_ZONE_STATUS_FAULT) {
-	        setenv("CONCORDD_ZONE_FAULT", "1", 1);
-		}
+	if ((zone->zone_state&GE_RS232_ZONE_STATUS_ALARM) == GE_RS232_ZONE_STATUS_ALARM) {
+		concordd_hook_setenv(hook, "CONCORDD_ZONE_ALARM", "1");
+	}
 
-		if ((zone->zone_state&GE_RS232_ZONE_STATUS_TROUBLE) == GE_RS232_ZONE_STATUS_TROUBLE) {
-	        setenv("CONCORDD_ZONE_TROUBLE", "1", 1);
-		}
+	if ((zone->zone_state&GE_RS232_ZONE_STATUS_FAULT) == GE_RS232_ZONE_STATUS_FAULT) {
+		concordd_hook_setenv(hook, "CONCORDD_ZONE_FAULT", "1");
+	}
 
-		if ((zone->zone_state&GE_RS232_ZONE_STATUS_BYPASSED) == GE_RS232_ZONE_STATUS_BYPASSED) {
-	        setenv("CONCORDD_ZONE_BYPASSED", "1", 1);
-		}
+	if ((zone->zone_state&GE_RS232_ZONE_STATUS_TROUBLE) == GE_RS232_ZONE_STATUS_TROUBLE) {
+		concordd_hook_setenv(hook, "CONCORDD_ZONE_TROUBLE", "1");
+	}
 
-        _exit(system(gZoneChangedCommand));
-    } else {
-        syslog(LOG_DEBUG, "concordd_zone_info_changed_func: forked system hook");
+	if ((zone->zone_state&GE_RS232_ZONE_STATUS_BYPASSED) == GE_RS232_ZONE_STATUS_BYPASSED) {
+		concordd_hook_setenv(hook, "CONCORDD_ZONE_BYPASSED", "1");
 	}
+
+    concordd_hook_executor_submit(&concordd_state->hook_executor, hook);
 }
 
 void
 concordd_event_func(void* context, concordd_instance_t instance, concordd_event_t event)
 {
     struct concordd_state_s *concordd_state = (struct concordd_state_s *)context;
+    concordd_hook_t hook = NULL;
+    const char* command = NULL;
+    const char* type = NULL;
+    const char* status = NULL;
+    const char* specific_desc = NULL;
 
     // Pass-thru to D-Bus first.
     concordd_dbus_event_func(&concordd_state->dbus_server, instance, event);
 
+    switch(event->general_type) {
+    case GE_RS232_ALARM_GENERAL_TYPE_SYSTEM_TROUBLE:
+    case GE_RS232_ALARM_GENERAL_TYPE_SYSTEM_TROUBLE_RESTORAL:
+        command = gSystemTroubleCommand;
+        type = "SYSTEM-TROUBLE";
+        specific_desc = ge_specific_system_trouble_to_cstr(NULL, event->specific_type);
+        break;
+
+    case GE_RS232_ALARM_GENERAL_TYPE_ALARM:
+    case GE_RS232_ALARM_GENERAL_TYPE_ALARM_RESTORAL:
+    case GE_RS232_ALARM_GENERAL_TYPE_ALARM_CANCEL:
+        command = gPartitionAlarmCommand;
+        type = "PARTITION-ALARM";
+        specific_desc = ge_specific_alarm_to_cstr(NULL, event->specific_type);
+        break;
+
+    case GE_RS232_ALARM_GENERAL_TYPE_FIRE_TROUBLE:
+    case GE_RS232_ALARM_GENERAL_TYPE_NONFIRE_TROUBLE:
+    case GE_RS232_ALARM_GENERAL_TYPE_FIRE_TROUBLE_RESTORAL:
+    case GE_RS232_ALARM_GENERAL_TYPE_NONFIRE_TROUBLE_RESTORAL:
+        command = gPartitionTroubleCommand;
+        type = "PARTITION-TROUBLE";
+        specific_desc = ge_specific_trouble_to_cstr(NULL, event->specific_type);
+        break;
+
+    case GE_RS232_ALARM_GENERAL_TYPE_PARTITION_EVENT:
+        command = gPartitionEventCommand;
+        type = "PARTITION-EVENT";
+        specific_desc = ge_specific_partition_to_cstr(NULL, event->specific_type);
+        break;
+
+    case GE_RS232_ALARM_GENERAL_TYPE_SYSTEM_EVENT:
+        command = gSystemEventCommand;
+        type = "SYSTEM-EVENT";
+        break;
+    }
+
+    if (type == NULL) {
+        return;
+    }
+
+    if (command == NULL && !concordd_hook_executor_has_coprocess(&concordd_state->hook_executor)) {
+        return;
+    }
+
     // Now handle via system.
-    int pid = fork();
-    if (pid == -1) {
-        syslog(LOG_ERR, "concordd_event_func: fork() failed: %s", strerror(errno));
-    } else if (pid == 0) {
-        // Child
-        char value[64];
-        const char* command = NULL;
-        const char* specific_desc = NULL;
-
-        switch(event->general_type) {
-        case GE_RS232_ALARM_GENERAL_TYPE_SYSTEM_TROUBLE:
-        case GE_RS232_ALARM_GENERAL_TYPE_SYSTEM_TROUBLE_RESTORAL:
-            snprintf(value, sizeof(value), "SYSTEM-TROUBLE");
-            command = gSystemTroubleCommand;
-            specific_desc = ge_specific_system_trouble_to_cstr(NULL, event->specific_type);
-            break;
-
-        case GE_RS232_ALARM_GENERAL_TYPE_ALARM:
-        case GE_RS232_ALARM_GENERAL_TYPE_ALARM_RESTORAL:
-        case GE_RS232_ALARM_GENERAL_TYPE_ALARM_CANCEL:
-            command = gPartitionAlarmCommand;
-            snprintf(value, sizeof(value), "PARTITION-ALARM");
-            specific_desc = ge_specific_alarm_to_cstr(NULL, event->specific_type);
-            break;
-
-        case GE_RS232_ALARM_GENERAL_TYPE_FIRE_TROUBLE:
-        case GE_RS232_ALARM_GENERAL_TYPE_NONFIRE_TROUBLE:
-        case GE_RS232_ALARM_GENERAL_TYPE_FIRE_TROUBLE_RESTORAL:
-        case GE_RS232_ALARM_GENERAL_TYPE_NONFIRE_TROUBLE_RESTORAL:
-            command = gPartitionTroubleCommand;
-            snprintf(value, sizeof(value), "PARTITION-TROUBLE");
-            specific_desc = ge_specific_trouble_to_cstr(NULL, event->specific_type);
-            break;
-
-        case GE_RS232_ALARM_GENERAL_TYPE_PARTITION_EVENT:
-            command = gPartitionEventCommand;
-            snprintf(value, sizeof(value), "PARTITION-EVENT");
-            specific_desc = ge_specific_partition_to_cstr(NULL, event->specific_type);
-            break;
-
-        case GE_RS232_ALARM_GENERAL_TYPE_SYSTEM_EVENT:
-            command = gSystemEventCommand;
-            snprintf(value, sizeof(value), "SYSTEM-EVENT");
-            break;
-        }
+    hook = concordd_hook_new(command);
+    if (hook == NULL) {
+        syslog(LOG_ERR, "concordd_event_func: Unable to allocate hook");
+        return;
+    }
 
-        if (command) {
-            setenv("CONCORDD_TYPE", value, 1);
-
-            switch (event->status) {
-            case CONCORDD_EVENT_STATUS_ONGOING:
-                snprintf(value, sizeof(value), "%s", "ONGOING");
-                break;
-            case CONCORDD_EVENT_STATUS_CANCELED:
-                snprintf(value, sizeof(value), "%s", "CANCELED");
-                break;
-            case CONCORDD_EVENT_STATUS_RESTORED:
-                snprintf(value, sizeof(value), "%s", "RESTORED");
-                break;
-            default:
-            case CONCORDD_EVENT_STATUS_UNSPECIFIED:
-                snprintf(value, sizeof(value), "%s", "TRIGGERED");
-                break;
-            }
-            setenv("CONCORDD_EVENT_STATUS", value, 1);
-
-            snprintf(value, sizeof(value), "%d", event->general_type);
-            setenv("CONCORDD_EVENT_GENERAL_TYPE", value, 1);
-
-            snprintf(value, sizeof(value), "%d", event->specific_type);
-            setenv("CONCORDD_EVENT_SPECIFIC_TYPE", value, 1);
-
-            snprintf(value, sizeof(value), "%d", event->extra_data);
-            setenv("CONCORDD_EVENT_EXTRA_DATA", value, 1);
-
-            snprintf(value, sizeof(value), "%d", event->partition_id);
-            setenv("CONCORDD_PARTITION_ID", value, 1);
-
-            if (event->zone_id != 0xFFFF) {
-                concordd_zone_t zone = concordd_get_zone(instance, event->zone_id);
-                snprintf(value, sizeof(value), "%d", event->zone_id);
-                setenv("CONCORDD_ZONE_ID", value, 1);
-                setenv("CONCORDD_EVENT_SOURCE_ID", value, 1);
-
-                if (zone) {
-                    const char* zone_name = ge_text_to_ascii_one_line(zone->encoded_name, zone->encoded_name_len);
-                    setenv("CONCORDD_ZONE_NAME", zone_name, 1);
-                    snprintf(value, sizeof(value), "%s %s [%s] (%d.%d) ZONE %d: %s",
-                        getenv("CONCORDD_EVENT_STATUS"),
-                        getenv("CONCORDD_TYPE"),
-                        specific_desc,
-                        event->general_type,
-                        event->specific_type,
-                        event->zone_id,
-                        zone_name
-                    );
-                    setenv("CONCORDD_EVENT_DESC", value, 1);
-                }
-            } else {
-                snprintf(value, sizeof(value), "%d", event->device_id);
-                setenv("CONCORDD_UNIT_ID", value, 1);
-                setenv("CONCORDD_EVENT_SOURCE_ID", value, 1);
-
-                    snprintf(value, sizeof(value), "%s %s [%s] (%d.%d) UNIT %d",
-                        getenv("CONCORDD_EVENT_STATUS"),
-                        getenv("CONCORDD_TYPE"),
-                        specific_desc,
-                        event->general_type,
-                        event->specific_type,
-                        event->device_id
-                    );
-                    setenv("CONCORDD_EVENT_DESC", value, 1);
-            }
-        }
+    switch (event->status) {
+    case CONCORDD_EVENT_STATUS_ONGOING:
+        status = "ONGOING";
+        break;
+    case CONCORDD_EVENT_STATUS_CANCELED:
+        status = "CANCELED";
+        break;
+    case CONCORDD_EVENT_STATUS_RESTORED:
+        status = "RESTORED";
+        break;
+    default:
+    case CONCORDD_EVENT_STATUS_UNSPECIFIED:
+        status = "TRIGGERED";
+        break;
+    }
 
-        _exit(system(command));
+    concordd_hook_setenv(hook, "CONCORDD_TYPE", type);
+    concordd_hook_setenv(hook, "CONCORDD_EVENT_STATUS", status);
+    concordd_hook_setenvf(hook, "CONCORDD_EVENT_GENERAL_TYPE", "%d", event->general_type);
+    concordd_hook_setenvf(hook, "CONCORDD_EVENT_SPECIFIC_TYPE", "%d", event->specific_type);
+    concordd_hook_setenvf(hook, "CONCORDD_EVENT_EXTRA_DATA", "%d", event->extra_data);
+    concordd_hook_setenvf(hook, "CONCORDD_PARTITION_ID", "%d", event->partition_id);
+
+    if (event->zone_id != 0xFFFF) {
+        concordd_zone_t zone = concordd_get_zone(instance, event->zone_id);
+        concordd_hook_setenvf(hook, "CONCORDD_ZONE_ID", "%d", event->zone_id);
+        concordd_hook_setenvf(hook, "CONCORDD_EVENT_SOURCE_ID", "%d", event->zone_id);
+
+        if (zone) {
+            const char* zone_name = zone->name;
+            concordd_hook_setenv(hook, "CONCORDD_ZONE_NAME", zone_name);
+            concordd_hook_setenvf(hook, "CONCORDD_EVENT_DESC", "%s %s [%s] (%d.%d) ZONE %d: %s",
+                status,
+                type,
+                specific_desc,
+                event->general_type,
+                event->specific_type,
+                event->zone_id,
+                zone_name
+            );
+        }
+    } else {
+        concordd_hook_setenvf(hook, "CONCORDD_UNIT_ID", "%d", event->device_id);
+        concordd_hook_setenvf(hook, "CONCORDD_EVENT_SOURCE_ID", "%d", event->device_id);
+        concordd_hook_setenvf(hook, "CONCORDD_EVENT_DESC", "%s %s [%s] (%d.%d) UNIT %d",
+            status,
+            type,
+            specific_desc,
+            event->general_type,
+            event->specific_type,
+            event->device_id
+        );
     }
+
+    concordd_hook_executor_submit(&concordd_state->hook_executor, hook);
 }
 
 void
 concordd_light_info_changed_func(void* context,  concordd_instance_t instance, concordd_partition_t partition, concordd_light_t light, int changed)
 {
     struct concordd_state_s *concordd_state = (struct concordd_state_s *)context;
+    concordd_hook_t hook = NULL;
 
     // Pass-thru to D-Bus first.
     concordd_dbus_light_info_changed_func(&concordd_state->dbus_server, instance, partition, light, changed);
 
-    if (gLightChangedCommand == NULL) {
+    if (gLightChangedCommand == NULL && !concordd_hook_executor_has_coprocess(&concordd_state->hook_executor)) {
         return;
     }
 
@@ -692,47 +812,38 @@ concordd_light_info_changed_func(void* context,  concordd_instance_t instance, c
     }
 
     // Now handle via system.
-    int pid = fork();
-    if (pid == -1) {
-        syslog(LOG_ERR, "concordd_light_info_changed_func: fork() failed: %s", strerror(errno));
-
-    } else if (pid == 0) {
-        char value[64];
-
-        setenv("CONCORDD_TYPE", "LIGHT", 1);
-
-        snprintf(value, sizeof(value), "%d", concordd_get_partition_index(instance, partition));
-        setenv("CONCORDD_PARTITION_ID", value, 1);
-
-        snprintf(value, sizeof(value), "%d", concordd_get_light_index(instance, partition, light));
-        setenv("CONCORDD_LIGHT_ID", value, 1);
+    hook = concordd_hook_new(gLightChangedCommand);
+    if (hook == NULL) {
+        syslog(LOG_ERR, "concordd_light_info_changed_func: Unable to allocate hook");
+        return;
+    }
 
-        snprintf(value, sizeof(value), "%d", light->light_state);
-        setenv("CONCORDD_LIGHT_STATE", value, 1);
+    concordd_hook_setenv(hook, "CONCORDD_TYPE", "LIGHT");
+    concordd_hook_setenvf(hook, "CONCORDD_PARTITION_ID", "%d", concordd_get_partition_index(instance, partition));
+    concordd_hook_setenvf(hook, "CONCORDD_LIGHT_ID", "%d", concordd_get_light_index(instance, partition, light));
+    concordd_hook_setenvf(hook, "CONCORDD_LIGHT_STATE", "%d", light->light_state);
 
-        if (0 == (changed & CONCORDD_LIGHT_LAST_CHANGED_AT_CHANGED)) {
-            snprintf(value, sizeof(value), "%ld", light->last_changed_at);
-            setenv("CONCORDD_LAST_CHANGED_AT", value, 1);
-        }
-
-        if (0 == (changed & CONCORDD_LIGHT_LAST_CHANGED_BY_CHANGED)) {
-            snprintf(value, sizeof(value), "%d", light->last_changed_by);
-            setenv("CONCORDD_LAST_CHANGED_BY", value, 1);
-        }
+    if (0 == (changed & CONCORDD_LIGHT_LAST_CHANGED_AT_CHANGED)) {
+        concordd_hook_setenvf(hook, "CONCORDD_LAST_CHANGED_AT", "%ld", light->last_changed_at);
+    }
 
-        _exit(system(gLightChangedCommand));
+    if (0 == (changed & CONCORDD_LIGHT_LAST_CHANGED_BY_CHANGED)) {
+        concordd_hook_setenvf(hook, "CONCORDD_LAST_CHANGED_BY", "%d", light->last_changed_by);
     }
+
+    concordd_hook_executor_submit(&concordd_state->hook_executor, hook);
 }
 
 void
 concordd_output_info_changed_func(void* context, concordd_instance_t instance, concordd_output_t output, int changed)
 {
     struct concordd_state_s *concordd_state = (struct concordd_state_s *)context;
+    concordd_hook_t hook = NULL;
 
     // Pass-thru to D-Bus first.
     concordd_dbus_output_info_changed_func(&concordd_state->dbus_server, instance, output, changed);
 
-    if (gOutputChangedCommand == NULL) {
+    if (gOutputChangedCommand == NULL && !concordd_hook_executor_has_coprocess(&concordd_state->hook_executor)) {
         return;
     }
 
@@ -742,35 +853,26 @@ concordd_output_info_changed_func(void* context, concordd_instance_t instance, c
     }
 
     // Now handle via system.
-    int pid = fork();
-    if (pid == -1) {
-        syslog(LOG_ERR, "concordd_output_info_changed_func: fork() failed: %s", strerror(errno));
-
-    } else if (pid == 0) {
-        char value[64];
-
-        setenv("CONCORDD_TYPE", "OUTPUT", 1);
-
-        snprintf(value, sizeof(value), "%d", concordd_get_output_index(instance, output));
-        setenv("CONCORDD_OUTPUT_ID", value, 1);
-
-        snprintf(value, sizeof(value), "%d", output->output_state);
-        setenv("CONCORDD_OUTPUT_STATE", value, 1);
+    hook = concordd_hook_new(gOutputChangedCommand);
+    if (hook == NULL) {
+        syslog(LOG_ERR, "concordd_output_info_changed_func: Unable to allocate hook");
+        return;
+    }
 
-        if (0 == (changed & CONCORDD_OUTPUT_LAST_CHANGED_AT_CHANGED)) {
-            snprintf(value, sizeof(value), "%ld", output->last_changed_at);
-            setenv("CONCORDD_LAST_CHANGED_AT", value, 1);
-        }
+    concordd_hook_setenv(hook, "CONCORDD_TYPE", "OUTPUT");
+    concordd_hook_setenvf(hook, "CONCORDD_OUTPUT_ID", "%d", concordd_get_output_index(instance, output));
+    concordd_hook_setenvf(hook, "CONCORDD_OUTPUT_STATE", "%d", output->output_state);
 
-        if (0 == (changed & CONCORDD_OUTPUT_LAST_CHANGED_BY_CHANGED)) {
-            snprintf(value, sizeof(value), "%d", output->last_changed_by);
-            setenv("CONCORDD_LAST_CHANGED_BY", value, 1);
-        }
+    if (0 == (changed & CONCORDD_OUTPUT_LAST_CHANGED_AT_CHANGED)) {
+        concordd_hook_setenvf(hook, "CONCORDD_LAST_CHANGED_AT", "%ld", output->last_changed_at);
+    }
 
-        _exit(system(gOutputChangedCommand));
+    if (0 == (changed & CONCORDD_OUTPUT_LAST_CHANGED_BY_CHANGED)) {
+        concordd_hook_setenvf(hook, "CONCORDD_LAST_CHANGED_BY", "%d", output->last_changed_by);
     }
-}
 
+    concordd_hook_executor_submit(&concordd_state->hook_executor, hook);
+}
 void
 concordd_siren_sync_func(void* context,  concordd_instance_t instance)
 {
@@ -788,8 +890,13 @@ main(int argc, char * argv[])
 {
 	int c;
 	int fds_ready = 0;
+	bool calibrate = false;
+	uint32_t woke_at = 0;
 	bool interface_added = false;
 	int zero_cms_in_a_row_count = 0;
+	cms_t next_state_save = 0;
+	struct concordd_event_loop_s event_loop_storage;
+	concordd_event_loop_t event_loop = NULL;
 	const char* config_file = SYSCONFDIR "/concordd.conf";
 	static struct option long_options[] =
 	{
@@ -801,6 +908,7 @@ main(int argc, char * argv[])
 		{"socket",	required_argument,	0,	's'},
 		{"baudrate",	required_argument,	0,	'b'},
 		{"user",	required_argument,	0,	'u'},
+		{"calibrate",	no_argument,		0,	'C'},
 		{0,		0,			0,	0}
 	};
 
@@ -809,13 +917,15 @@ main(int argc, char * argv[])
 	// ========================================================================
 	// INITIALIZATION and ARGUMENT PARSING
 
+	memset(&concordd_state, 0, sizeof(concordd_state));
+
 	gSocketWrapperBaud = 9600;
 
 	gPreviousHandlerForSIGINT = signal(SIGINT, &signal_SIGINT);
 	gPreviousHandlerForSIGTERM = signal(SIGTERM, &signal_SIGTERM);
 	signal(SIGHUP, &signal_SIGHUP);
 
-	// Automatically clean up child processes.
+	// Wake up the main loop when child processes exit.
 	signal(SIGCHLD, &signal_SIGCHLD);
 
 	// Always ignore SIGPIPE.
@@ -837,7 +947,7 @@ main(int argc, char * argv[])
 	optind = 0;
 	while(1) {
 		int option_index = 0;
-		c = getopt_long(argc, argv, "hvd:c:o:I:s:b:u:", long_options,
+		c = getopt_long(argc, argv, "hvd:c:o:I:s:b:u:C", long_options,
 			&option_index);
 
 		if (c == -1)
@@ -893,7 +1003,7 @@ main(int argc, char * argv[])
 	optind = 0;
 	while(1) {
 		int option_index = 0;
-		c = getopt_long(argc, argv, "hvd:c:o:I:s:b:u:", long_options,
+		c = getopt_long(argc, argv, "hvd:c:o:I:s:b:u:C", long_options,
 			&option_index);
 
 		if (c == -1)
@@ -916,6 +1026,10 @@ main(int argc, char * argv[])
 			set_config_param(NULL, kCONCORDDConfig_PrivDropToUser, optarg);
 			break;
 
+		case 'C':
+			calibrate = true;
+			break;
+
 		case 'o':
 			if ((optind >= argc) || (strncmp(argv[optind], "-", 1) == 0)) {
 				syslog(LOG_ERR, "Missing argument to '-o'.");
@@ -946,6 +1060,12 @@ main(int argc, char * argv[])
 		syslog(LOG_NOTICE, "\tBUILD_VERSION = %s", internal_build_source_version);
 	}
 
+	if (gRealTime.priority > 0) {
+		// Needs privileges. Failing isn't fatal, we just get
+		// more jitter.
+		concordd_realtime_init(&gRealTime);
+	}
+
 	// ========================================================================
 	// Dropping Privileges
 
@@ -1021,12 +1141,50 @@ main(int argc, char * argv[])
 	}
 #endif // #if HAVE_PWD_H
 
+    if (calibrate) {
+        int fd = open_super_socket(gSocketPath);
+
+        if (fd < 0) {
+            syslog(LOG_ERR, "Failed to open \"%s\": %s", gSocketPath, strerror(errno));
+            gRet = ERRORCODE_ERRNO;
+            goto bail;
+        }
+
+        gRet = (concordd_calibrate(fd, CONCORDD_CALIBRATE_ROUND_TRIPS) == 0) ? 0 : ERRORCODE_UNKNOWN;
+        close_super_socket(fd);
+        goto bail;
+    }
+
     // ========================================================================
     // Set up state
 
     concordd_init(&concordd_state.instance);
     concordd_state.instance.send_bytes_func = (ge_rs232_send_bytes_func_t)&send_bytes_func;
     concordd_state.instance.context = (void*)&concordd_state;
+    concordd_state.instance.ge_queue.background_share = gBackgroundLinkShare;
+
+    concordd_hook_executor_init(
+        &concordd_state.hook_executor,
+        gHookMaxRunning,
+        gHookMaxBacklog,
+        gHookTimeout*MSEC_PER_SEC
+    );
+
+    if (gHookCoprocessCommand != NULL) {
+        concordd_hook_executor_start_coprocess(
+            &concordd_state.hook_executor,
+            gHookCoprocessCommand,
+            gHookCoprocessBacklog
+        );
+    }
+
+    // Restore the last known state before touching the serial port,
+    // so that D-Bus clients have something to look at right away.
+    if (gStateFilePath != NULL) {
+        concordd_state_file_load(&concordd_state.instance, gStateFilePath);
+        next_state_save = time_ms() + gStateSaveInterval*MSEC_PER_SEC;
+    }
+
     concordd_state.fd = open_super_socket(gSocketPath);
 
     if (concordd_state.fd < 0) {
@@ -1034,11 +1192,46 @@ main(int argc, char * argv[])
         goto bail;
     }
 
+    concordd_tx_buffer_init(&concordd_state.tx_buffer, concordd_state.fd);
+
+    if (gCaptureFilePath != NULL) {
+        if (capture_file_open_write(&concordd_state.capture, gCaptureFilePath) != 0) {
+            goto bail;
+        }
+        syslog(LOG_NOTICE, "Capturing serial traffic to \"%s\"", gCaptureFilePath);
+        concordd_state.tx_buffer.capture = &concordd_state.capture;
+    }
+
     if (concordd_dbus_server_init(&concordd_state.dbus_server, &concordd_state.instance)==NULL) {
         syslog(LOG_ERR, "Failed to start DBus server");
         goto bail;
     }
 
+    concordd_state.dbus_server.hook_executor = &concordd_state.hook_executor;
+    concordd_state.dbus_server.command_timeout = gCommandTimeout*MSEC_PER_SEC;
+    concordd_state.dbus_server.signal_window = gSignalWindow;
+    concordd_state.dbus_server.max_outgoing = gDBusMaxOutgoing;
+    concordd_state.dbus_server.v2_signals = gDBusV2Signals;
+
+    if (gRealTime.priority > 0) {
+        concordd_realtime_prefault(&concordd_state, sizeof(concordd_state));
+        concordd_realtime_prefault_stack();
+    }
+
+    if (gUseSerialThread) {
+        if (concordd_serial_thread_start(&concordd_state.serial_thread, concordd_state.fd, &gRealTime, &concordd_state.capture) != 0) {
+            goto bail;
+        }
+        syslog(LOG_INFO, "Serial port is handled by its own thread");
+        concordd_state.dbus_server.ack_latency = &concordd_state.serial_thread.ack_latency;
+    } else {
+        if ((gRealTime.priority > 0) || (gRealTime.cpu >= 0)) {
+            concordd_realtime_enter(&gRealTime);
+        }
+        concordd_state.dbus_server.tx_buffer = &concordd_state.tx_buffer;
+        concordd_state.dbus_server.ack_latency = &concordd_state.ack_latency;
+    }
+
 	concordd_refresh(&concordd_state.instance, NULL, NULL);
 
     concordd_state.instance.event_func = &concordd_event_func;
@@ -1049,6 +1242,33 @@ main(int argc, char * argv[])
 	concordd_state.instance.partition_info_changed_func = &concordd_partition_info_changed_func;
 	concordd_state.instance.siren_sync_func = &concordd_siren_sync_func;
 
+	// What the main loop waits on for serial input.
+	const int serial_fd = concordd_state.serial_thread.running
+		? concordd_serial_thread_get_fd(&concordd_state.serial_thread)
+		: concordd_state.fd;
+
+	if (gUseEpoll) {
+		sigset_t signals;
+
+		sigemptyset(&signals);
+		sigaddset(&signals, SIGINT);
+		sigaddset(&signals, SIGTERM);
+		sigaddset(&signals, SIGHUP);
+		sigaddset(&signals, SIGCHLD);
+
+		event_loop = concordd_event_loop_init(&event_loop_storage, &signals);
+
+		if ( (event_loop != NULL)
+		  && ( (concordd_event_loop_add_fd(event_loop, serial_fd) != 0)
+		    || (concordd_event_loop_add_fd(event_loop, concordd_dbus_server_get_fd(&concordd_state.dbus_server)) != 0)
+		  )
+		) {
+			syslog(LOG_INFO, "Can't use epoll with \"%s\" (%s), using select()", gSocketPath, strerror(errno));
+			concordd_event_loop_finalize(event_loop);
+			event_loop = NULL;
+		}
+	}
+
 	// ========================================================================
 	// MAIN LOOP
 
@@ -1061,12 +1281,19 @@ main(int argc, char * argv[])
 		int max_fd = -1;
 		struct timeval timeout;
 
+		// Reap finished hooks and start any that are waiting.
+		concordd_hook_executor_process(&concordd_state.hook_executor);
+
 		FD_ZERO(&gReadableFDs);
 		FD_ZERO(&gWritableFDs);
 		FD_ZERO(&gErrorableFDs);
 
 		// Update the FD masks and timeouts
-        if (ge_queue_is_empty(&concordd_state.instance.ge_queue) || concordd_state.instance.ge_rs232.reading_message == true) {
+        if (concordd_state.serial_thread.running) {
+            // The serial thread takes care of waiting on the port.
+            FD_SET(serial_fd, &gReadableFDs);
+            max_fd = serial_fd;
+        } else if (!ge_queue_ready_to_send(&concordd_state.instance.ge_queue) || concordd_state.instance.ge_rs232.reading_message == true) {
             FD_SET(concordd_state.fd, &gReadableFDs);
             max_fd = concordd_state.fd;
             //FD_SET(concordd_state.fd, &gErrorableFDs);
@@ -1081,8 +1308,29 @@ main(int argc, char * argv[])
             max_fd = concordd_state.fd;
         }
 
+        if (!concordd_tx_buffer_is_empty(&concordd_state.tx_buffer)) {
+            // Finish writing out what the transport couldn't take.
+            FD_SET(concordd_state.fd, &gWritableFDs);
+        }
+
         cms_timeout = concordd_get_timeout_cms(&concordd_state.instance);
 
+        concordd_hook_executor_update_fd_set(
+            &concordd_state.hook_executor,
+            &gReadableFDs,
+            &gWritableFDs,
+            &gErrorableFDs,
+            &max_fd,
+            &cms_timeout
+        );
+
+        if ((gStateFilePath != NULL) && (gStateSaveInterval > 0)) {
+            cms_t cms_until_save = next_state_save - time_ms();
+            if (cms_until_save < cms_timeout) {
+                cms_timeout = cms_until_save;
+            }
+        }
+
         concordd_dbus_server_update_fd_set(
             &concordd_state.dbus_server,
             &gReadableFDs,
@@ -1132,18 +1380,50 @@ main(int argc, char * argv[])
 			zero_cms_in_a_row_count = 0;
 		}
 
-		// Convert our `cms` value into timeval compatible with select().
-		timeout.tv_sec = cms_timeout / MSEC_PER_SEC;
-		timeout.tv_usec = (cms_timeout % MSEC_PER_SEC) * USEC_PER_MSEC;
-
-		// Block until we timeout or there is FD activity.
-		fds_ready = select(
-			max_fd + 1,
-			&gReadableFDs,
-			&gWritableFDs,
-			&gErrorableFDs,
-			&timeout
-		);
+		if (event_loop != NULL) {
+			sigset_t signals;
+
+			sigemptyset(&signals);
+
+			fds_ready = concordd_event_loop_wait(
+				event_loop,
+				&gReadableFDs,
+				&gWritableFDs,
+				max_fd,
+				cms_timeout,
+				&signals
+			);
+
+			FD_ZERO(&gErrorableFDs);
+
+			if (sigismember(&signals, SIGINT)) {
+				syslog(LOG_NOTICE, "Caught SIGINT!");
+				gRet = ERRORCODE_INTERRUPT;
+			} else if (sigismember(&signals, SIGTERM)) {
+				syslog(LOG_NOTICE, "Caught SIGTERM!");
+				gRet = ERRORCODE_QUIT;
+			} else if (sigismember(&signals, SIGHUP)) {
+				syslog(LOG_NOTICE, "Caught SIGHUP!");
+				gRet = ERRORCODE_SIGHUP;
+			}
+
+			// SIGCHLD needs nothing more than the wakeup, the hook
+			// executor reaps children at the top of the loop.
+
+		} else {
+			// Convert our `cms` value into timeval compatible with select().
+			timeout.tv_sec = cms_timeout / MSEC_PER_SEC;
+			timeout.tv_usec = (cms_timeout % MSEC_PER_SEC) * USEC_PER_MSEC;
+
+			// Block until we timeout or there is FD activity.
+			fds_ready = select(
+				max_fd + 1,
+				&gReadableFDs,
+				&gWritableFDs,
+				&gErrorableFDs,
+				&timeout
+			);
+		}
 
 		if (fds_ready < 0) {
 			if (errno == EINTR) {
@@ -1152,8 +1432,8 @@ main(int argc, char * argv[])
 				// set and we will break out of the main loop in a moment.
 				continue;
 			}
-			syslog(LOG_ERR, "select() errno=\"%s\" (%d)", strerror(errno),
-			       errno);
+			syslog(LOG_ERR, "%s() errno=\"%s\" (%d)", (event_loop != NULL) ? "epoll_wait" : "select",
+			       strerror(errno), errno);
 
 			gRet = ERRORCODE_ERRNO;
 			break;
@@ -1164,39 +1444,95 @@ main(int argc, char * argv[])
             goto bail;
         }
 
-        if (FD_ISSET(concordd_state.fd, &gReadableFDs)) {
+        woke_at = concordd_realtime_usec();
+
+        // Hold on to the ACKs for what we read until we know if
+        // we have a frame of our own to send along with them.
+        concordd_tx_buffer_cork(&concordd_state.tx_buffer);
+
+        if (concordd_state.serial_thread.running) {
+            if ( FD_ISSET(serial_fd, &gReadableFDs)
+              && (concordd_serial_thread_process(&concordd_state.serial_thread, &concordd_state.instance.ge_rs232) != 0)
+            ) {
+                goto bail;
+            }
+        } else if (FD_ISSET(concordd_state.fd, &gReadableFDs)) {
             uint8_t buffer[100];
             ssize_t ret = read(concordd_state.fd, buffer, sizeof(buffer));
             if (ret > 0) {
-                ssize_t i;
-                for (i = 0; i<ret; ++i) {
-                    uint8_t byte = buffer[i];
-                    if (!byte) {
-                        continue;
-                    }
-                    ge_rs232_receive_byte(&concordd_state.instance.ge_rs232, byte);
+                const struct ge_rs232_stats_s* stats = &concordd_state.instance.ge_rs232.stats;
+                uint32_t responses = stats->frames_received + stats->bad_checksums;
+
+                if (concordd_state.capture.file != NULL) {
+                    capture_file_write(&concordd_state.capture, CAPTURE_FILE_RX, buffer, ret);
+                }
+
+                ge_rs232_receive_bytes(&concordd_state.instance.ge_rs232, buffer, ret);
+
+                if (responses != stats->frames_received + stats->bad_checksums) {
+                    concordd_latency_histogram_start(&concordd_state.ack_latency, woke_at);
                 }
-            } else if (ret == -1) {
+            } else if (ret == -1 && errno != EAGAIN) {
                 syslog(LOG_ERR, "read() errno=\"%s\" (%d)", strerror(errno),
                    errno);
                 goto bail;
             }
         }
 
-        concordd_dbus_server_process(&concordd_state.dbus_server);
+        // Don't stack more frames behind one that is still on
+        // its way out.
+        if (!concordd_state.tx_buffer.frame_pending) {
+            ge_rs232_status = concordd_process(&concordd_state.instance);
 
-        ge_rs232_status = concordd_process(&concordd_state.instance);
+            if (ge_rs232_status != GE_RS232_STATUS_OK) {
+                syslog(LOG_ERR, "concordd_process() failed: %d", ge_rs232_status);
+                goto bail;
+            }
+        }
 
-        if (ge_rs232_status != GE_RS232_STATUS_OK) {
-            syslog(LOG_ERR, "concordd_process() failed: %d", ge_rs232_status);
+        if (flush_serial_output(&concordd_state) != 0) {
             goto bail;
         }
 
+        if (concordd_tx_buffer_is_empty(&concordd_state.tx_buffer)) {
+            concordd_latency_histogram_finish(&concordd_state.ack_latency);
+        }
+
+        concordd_dbus_server_process(&concordd_state.dbus_server);
+
+        if ( (gStateFilePath != NULL)
+          && (gStateSaveInterval > 0)
+          && (next_state_save - time_ms() <= 0)
+        ) {
+            // Don't persist a half-finished equipment refresh.
+            if (!concordd_state.instance.refresh_pending) {
+                concordd_state_file_save(&concordd_state.instance, gStateFilePath);
+            }
+            next_state_save = time_ms() + gStateSaveInterval*MSEC_PER_SEC;
+        }
+
 	} // while (!gRet)
 
 bail:
 	syslog(LOG_NOTICE, "Cleaning up. (gRet = %d)", gRet);
 
+	if (event_loop != NULL) {
+		concordd_event_loop_finalize(event_loop);
+	}
+
+	if (concordd_state.serial_thread.running) {
+		concordd_serial_thread_stop(&concordd_state.serial_thread);
+	}
+
+	capture_file_close(&concordd_state.capture);
+
+	if ( (gStateFilePath != NULL)
+	  && (next_state_save != 0)
+	  && !concordd_state.instance.refresh_pending
+	) {
+		concordd_state_file_save(&concordd_state.instance, gStateFilePath);
+	}
+
 	if (gRet == ERRORCODE_QUIT) {
 		gRet = 0;
 	}
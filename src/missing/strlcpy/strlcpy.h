@@ -28,6 +28,12 @@
 #ifndef MISSING_STRLCPY_HEADER_INCLUDED
 #define MISSING_STRLCPY_HEADER_INCLUDED 1
 
+// This is forced in ahead of everything else, so config.h has
+// to be pulled in first to get the same system extensions.
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
 #include <string.h>
 
 #ifndef HAVE_STRLCPY